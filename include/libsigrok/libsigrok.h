@@ -176,10 +176,26 @@ enum sr_packettype {
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. */
+	SR_DF_LOGIC_RLE,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
 
+/** Flags for sr_session_datafeed_callback_add_full(). */
+enum sr_datafeed_callback_flag {
+	/** The callback accepts SR_DF_LOGIC_RLE packets. */
+	SR_DATAFEED_LOGIC_RLE = 0x01,
+};
+
+/** How a session's feed queue handles packets when the queue is full. */
+enum sr_feed_queue_policy {
+	/** Block the sender until the consumer has caught up. */
+	SR_FEED_QUEUE_BLOCK = 10000,
+	/** Drop logic and analog packets. Other packets never get dropped. */
+	SR_FEED_QUEUE_DROP,
+};
+
 /** Measured quantity, sr_analog_meaning.mq. */
 enum sr_mq {
 	SR_MQ_VOLTAGE = 10000,
@@ -483,6 +499,18 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_buffer
+ * Opaque structure representing a reference counted sample data buffer.
+ *
+ * Acquisition drivers can send datafeed packets whose logic or analog
+ * data is backed by such a buffer. Consumers can retain the data past
+ * the datafeed callback by taking a reference, without copying it.
+ *
+ * @see sr_packet_buffer_get(), sr_buffer_ref(), sr_buffer_unref().
+ */
+struct sr_buffer;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -514,6 +542,21 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Run i consists of lengths[i] samples which all have the value at
+ * values + i * unitsize. Only datafeed callbacks which were registered
+ * with the SR_DATAFEED_LOGIC_RLE flag receive these packets, all other
+ * callbacks get the expanded samples in SR_DF_LOGIC packets.
+ */
+struct sr_datafeed_logic_rle {
+	uint64_t num_runs;
+	uint16_t unitsize;
+	void *values;
+	uint64_t *lengths;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -618,6 +661,8 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/** If set, this output module accepts SR_DF_LOGIC_RLE packets. */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
 };
 
 struct sr_input;
@@ -1173,6 +1218,42 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/**
+	 * Range of samples to replay from a session file, as a
+	 * (start, end) tuple of sample numbers. The end is exclusive,
+	 * an end of 0 replays up to the end of the capture.
+	 */
+	SR_CONF_SAMPLE_RANGE,
+
+	/**
+	 * Number of capture file chunks which get decompressed ahead
+	 * of time by worker threads. 0 (the default) reads sequentially.
+	 */
+	SR_CONF_READ_AHEAD,
+
+	/** Compression method of the capturefile's content ("lzo1x"). */
+	SR_CONF_CAPTURE_CODEC,
+
+	/**
+	 * Complete USB transfers in a dedicated thread, which passes
+	 * the data to the session thread. Not available while other
+	 * devices' USB transfers get handled by the session's main loop,
+	 * the device falls back to the main loop then.
+	 */
+	SR_CONF_USB_EVENT_THREAD,
+
+	/**
+	 * Grow the number and size of USB transfers during the
+	 * acquisition when the host falls behind.
+	 */
+	SR_CONF_ADAPTIVE_TRANSFERS,
+
+	/**
+	 * Generate samples as fast as possible instead of pacing them
+	 * to the samplerate in real time.
+	 */
+	SR_CONF_UNTHROTTLED,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
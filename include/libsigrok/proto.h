@@ -30,6 +30,10 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *buf);
+SR_API int sr_analog_to_int16(const struct sr_datafeed_analog *analog,
+		int16_t *buf);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -145,6 +149,8 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_callback_add_full(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t flags);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
@@ -153,11 +159,24 @@ SR_API int sr_session_stop(struct sr_session *session);
 SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
+SR_API int sr_session_feed_queue_set(struct sr_session *session,
+		size_t depth, int policy);
+SR_API int sr_session_feed_queue_merge_set(struct sr_session *session,
+		gboolean merge);
+SR_API int sr_session_feed_queue_stats_get(struct sr_session *session,
+		size_t *high_water, uint64_t *dropped, uint64_t *unordered);
 
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
 
+SR_API struct sr_buffer *sr_packet_buffer_get(
+		const struct sr_datafeed_packet *packet);
+SR_API struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf);
+SR_API void sr_buffer_unref(struct sr_buffer *buf);
+SR_API void *sr_buffer_data_get(const struct sr_buffer *buf);
+SR_API size_t sr_buffer_size_get(const struct sr_buffer *buf);
+
 /*--- input/input.c ---------------------------------------------------------*/
 
 SR_API const struct sr_input_module **sr_input_list(void);
@@ -23,6 +23,10 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ANALOG_X86_KERNELS 1
+#include <immintrin.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -157,12 +161,482 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
+/** @cond PRIVATE */
+/*
+ * Sample data encodings which the conversion routines below support.
+ * Determined once per datafeed packet, such that the inner loops need
+ * not re-evaluate encoding properties nor call through reader function
+ * pointers for every single value.
+ */
+enum analog_input_type {
+	ANALOG_IN_UNSUPPORTED,
+	ANALOG_IN_U8,
+	ANALOG_IN_I8,
+	ANALOG_IN_U16LE,
+	ANALOG_IN_U16BE,
+	ANALOG_IN_I16LE,
+	ANALOG_IN_I16BE,
+	ANALOG_IN_U32LE,
+	ANALOG_IN_U32BE,
+	ANALOG_IN_I32LE,
+	ANALOG_IN_I32BE,
+	ANALOG_IN_F32LE,
+	ANALOG_IN_F32BE,
+	ANALOG_IN_F64LE,
+	ANALOG_IN_F64BE,
+};
+
+/* A single conversion job. Exactly one of fout and dout is set. */
+struct analog_conv {
+	enum analog_input_type type;
+	const uint8_t *in;
+	size_t count;
+	double scale, offset;
+	gboolean is_unity;
+	float *fout;
+	double *dout;
+};
+
+/** @endcond */
+
+static enum analog_input_type analog_input_type(
+		const struct sr_analog_encoding *encoding)
+{
+	gboolean be;
+
+	be = encoding->is_bigendian;
+	if (encoding->is_float) {
+		if (encoding->unitsize == sizeof(float))
+			return be ? ANALOG_IN_F32BE : ANALOG_IN_F32LE;
+		if (encoding->unitsize == sizeof(double))
+			return be ? ANALOG_IN_F64BE : ANALOG_IN_F64LE;
+		return ANALOG_IN_UNSUPPORTED;
+	}
+	if (encoding->unitsize == sizeof(uint8_t))
+		return encoding->is_signed ? ANALOG_IN_I8 : ANALOG_IN_U8;
+	if (encoding->unitsize == sizeof(uint16_t) && encoding->is_signed)
+		return be ? ANALOG_IN_I16BE : ANALOG_IN_I16LE;
+	if (encoding->unitsize == sizeof(uint16_t))
+		return be ? ANALOG_IN_U16BE : ANALOG_IN_U16LE;
+	if (encoding->unitsize == sizeof(uint32_t) && encoding->is_signed)
+		return be ? ANALOG_IN_I32BE : ANALOG_IN_I32LE;
+	if (encoding->unitsize == sizeof(uint32_t))
+		return be ? ANALOG_IN_U32BE : ANALOG_IN_U32LE;
+
+	return ANALOG_IN_UNSUPPORTED;
+}
+
+static void analog_type_unsupported(const struct sr_analog_encoding *encoding,
+		const char *conv_name)
+{
+	char type_text[10];
+
+	/*
+	 * Error messages for unsupported input property combinations
+	 * will only be seen by developers and maintainers of input
+	 * formats or acquisition device drivers. Terse output is
+	 * acceptable there, users shall never see them.
+	 */
+	snprintf(type_text, sizeof(type_text), "%c%d%s",
+		encoding->is_float ? 'f' : encoding->is_signed ? 'i' : 'u',
+		encoding->unitsize * 8, encoding->is_bigendian ? "be" : "le");
+	sr_err("Unsupported type for analog-to-%s conversion: %s.",
+		conv_name, type_text);
+}
+
+#ifdef ANALOG_X86_KERNELS
+
+/*
+ * The vector kernels only cover the 8/16 bit integer and the single
+ * precision float encodings, which is what scopes and DAQ devices
+ * send in bulk. Values get widened to double precision before the
+ * scale/offset calculation, which keeps results identical to the
+ * scalar implementation. The unity scale/offset case skips the
+ * double precision detour for float output, 8/16 bit integers are
+ * exactly representable in single precision.
+ */
+static gboolean analog_type_vectorized(enum analog_input_type type)
+{
+	switch (type) {
+	case ANALOG_IN_U8:
+	case ANALOG_IN_I8:
+	case ANALOG_IN_U16LE:
+	case ANALOG_IN_U16BE:
+	case ANALOG_IN_I16LE:
+	case ANALOG_IN_I16BE:
+	case ANALOG_IN_F32LE:
+	case ANALOG_IN_F32BE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+__attribute__((target("sse2")))
+static size_t analog_convert_sse2(const struct analog_conv *conv)
+{
+	const uint8_t *in;
+	size_t idx;
+	gboolean is_float, is_unity;
+	uint32_t word;
+	__m128i zero, raw, ints;
+	__m128 flts;
+	__m128d scale, offset, lo, hi;
+
+	in = conv->in;
+	is_float = conv->type == ANALOG_IN_F32LE || conv->type == ANALOG_IN_F32BE;
+	is_unity = conv->is_unity;
+	zero = _mm_setzero_si128();
+	scale = _mm_set1_pd(conv->scale);
+	offset = _mm_set1_pd(conv->offset);
+	ints = zero;
+	flts = _mm_setzero_ps();
+
+	for (idx = 0; idx + 4 <= conv->count; idx += 4) {
+		switch (conv->type) {
+		case ANALOG_IN_U8:
+		case ANALOG_IN_I8:
+			memcpy(&word, in, sizeof(word));
+			in += 4;
+			raw = _mm_cvtsi32_si128(word);
+			if (conv->type == ANALOG_IN_U8) {
+				ints = _mm_unpacklo_epi8(raw, zero);
+				ints = _mm_unpacklo_epi16(ints, zero);
+			} else {
+				ints = _mm_unpacklo_epi8(raw, raw);
+				ints = _mm_unpacklo_epi16(ints, ints);
+				ints = _mm_srai_epi32(ints, 24);
+			}
+			break;
+		case ANALOG_IN_U16LE:
+		case ANALOG_IN_U16BE:
+		case ANALOG_IN_I16LE:
+		case ANALOG_IN_I16BE:
+			raw = _mm_loadl_epi64((const __m128i *)in);
+			in += 8;
+			if (conv->type == ANALOG_IN_U16BE || conv->type == ANALOG_IN_I16BE)
+				raw = _mm_or_si128(_mm_slli_epi16(raw, 8),
+					_mm_srli_epi16(raw, 8));
+			if (conv->type == ANALOG_IN_U16LE || conv->type == ANALOG_IN_U16BE) {
+				ints = _mm_unpacklo_epi16(raw, zero);
+			} else {
+				ints = _mm_unpacklo_epi16(raw, raw);
+				ints = _mm_srai_epi32(ints, 16);
+			}
+			break;
+		case ANALOG_IN_F32LE:
+		case ANALOG_IN_F32BE:
+			raw = _mm_loadu_si128((const __m128i *)in);
+			in += 16;
+			if (conv->type == ANALOG_IN_F32BE) {
+				raw = _mm_or_si128(_mm_slli_epi16(raw, 8),
+					_mm_srli_epi16(raw, 8));
+				raw = _mm_or_si128(_mm_slli_epi32(raw, 16),
+					_mm_srli_epi32(raw, 16));
+			}
+			flts = _mm_castsi128_ps(raw);
+			break;
+		default:
+			return 0;
+		}
+
+		if (is_unity && conv->fout) {
+			if (!is_float)
+				flts = _mm_cvtepi32_ps(ints);
+			_mm_storeu_ps(&conv->fout[idx], flts);
+			continue;
+		}
+
+		if (is_float) {
+			lo = _mm_cvtps_pd(flts);
+			hi = _mm_cvtps_pd(_mm_movehl_ps(flts, flts));
+		} else {
+			lo = _mm_cvtepi32_pd(ints);
+			hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(ints,
+				_MM_SHUFFLE(1, 0, 3, 2)));
+		}
+		lo = _mm_add_pd(_mm_mul_pd(lo, scale), offset);
+		hi = _mm_add_pd(_mm_mul_pd(hi, scale), offset);
+		if (conv->fout) {
+			flts = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+			_mm_storeu_ps(&conv->fout[idx], flts);
+		} else {
+			_mm_storeu_pd(&conv->dout[idx + 0], lo);
+			_mm_storeu_pd(&conv->dout[idx + 2], hi);
+		}
+	}
+
+	return idx;
+}
+
+__attribute__((target("avx2")))
+static size_t analog_convert_avx2(const struct analog_conv *conv)
+{
+	const uint8_t *in;
+	size_t idx;
+	gboolean is_float, is_unity;
+	__m128i raw, swap16;
+	__m256i ints, swap32;
+	__m256 flts;
+	__m256d scale, offset, lo, hi;
+
+	in = conv->in;
+	is_float = conv->type == ANALOG_IN_F32LE || conv->type == ANALOG_IN_F32BE;
+	is_unity = conv->is_unity;
+	swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+		9, 8, 11, 10, 13, 12, 15, 14);
+	swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12);
+	scale = _mm256_set1_pd(conv->scale);
+	offset = _mm256_set1_pd(conv->offset);
+	ints = _mm256_setzero_si256();
+	flts = _mm256_setzero_ps();
+
+	for (idx = 0; idx + 8 <= conv->count; idx += 8) {
+		switch (conv->type) {
+		case ANALOG_IN_U8:
+			raw = _mm_loadl_epi64((const __m128i *)in);
+			in += 8;
+			ints = _mm256_cvtepu8_epi32(raw);
+			break;
+		case ANALOG_IN_I8:
+			raw = _mm_loadl_epi64((const __m128i *)in);
+			in += 8;
+			ints = _mm256_cvtepi8_epi32(raw);
+			break;
+		case ANALOG_IN_U16LE:
+		case ANALOG_IN_U16BE:
+			raw = _mm_loadu_si128((const __m128i *)in);
+			in += 16;
+			if (conv->type == ANALOG_IN_U16BE)
+				raw = _mm_shuffle_epi8(raw, swap16);
+			ints = _mm256_cvtepu16_epi32(raw);
+			break;
+		case ANALOG_IN_I16LE:
+		case ANALOG_IN_I16BE:
+			raw = _mm_loadu_si128((const __m128i *)in);
+			in += 16;
+			if (conv->type == ANALOG_IN_I16BE)
+				raw = _mm_shuffle_epi8(raw, swap16);
+			ints = _mm256_cvtepi16_epi32(raw);
+			break;
+		case ANALOG_IN_F32LE:
+		case ANALOG_IN_F32BE:
+			ints = _mm256_loadu_si256((const __m256i *)in);
+			in += 32;
+			if (conv->type == ANALOG_IN_F32BE)
+				ints = _mm256_shuffle_epi8(ints, swap32);
+			flts = _mm256_castsi256_ps(ints);
+			break;
+		default:
+			return 0;
+		}
+
+		if (is_unity && conv->fout) {
+			if (!is_float)
+				flts = _mm256_cvtepi32_ps(ints);
+			_mm256_storeu_ps(&conv->fout[idx], flts);
+			continue;
+		}
+
+		if (is_float) {
+			lo = _mm256_cvtps_pd(_mm256_castps256_ps128(flts));
+			hi = _mm256_cvtps_pd(_mm256_extractf128_ps(flts, 1));
+		} else {
+			lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(ints));
+			hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(ints, 1));
+		}
+		lo = _mm256_add_pd(_mm256_mul_pd(lo, scale), offset);
+		hi = _mm256_add_pd(_mm256_mul_pd(hi, scale), offset);
+		if (conv->fout) {
+			_mm_storeu_ps(&conv->fout[idx + 0], _mm256_cvtpd_ps(lo));
+			_mm_storeu_ps(&conv->fout[idx + 4], _mm256_cvtpd_ps(hi));
+		} else {
+			_mm256_storeu_pd(&conv->dout[idx + 0], lo);
+			_mm256_storeu_pd(&conv->dout[idx + 4], hi);
+		}
+	}
+
+	return idx;
+}
+
+#endif
+
+/*
+ * Run the widest vector kernel which the CPU supports, returns the
+ * number of values which were converted. The caller handles the
+ * remainder (or everything for encodings without a vector kernel).
+ */
+static size_t analog_convert_vector(const struct analog_conv *conv)
+{
+#ifdef ANALOG_X86_KERNELS
+	int features;
+
+	if (!analog_type_vectorized(conv->type))
+		return 0;
+	features = sr_cpu_features();
+	if (features & SR_CPU_AVX2)
+		return analog_convert_avx2(conv);
+	if (features & SR_CPU_SSE2)
+		return analog_convert_sse2(conv);
+#else
+	(void)conv;
+#endif
+
+	return 0;
+}
+
+/** @cond PRIVATE */
+#define ANALOG_CONVERT_LOOP(read, width) \
+	do { \
+		in += idx * (width); \
+		if (conv->fout) { \
+			for (; idx < conv->count; idx++, in += (width)) { \
+				value = read(in); \
+				value *= conv->scale; \
+				value += conv->offset; \
+				conv->fout[idx] = value; \
+			} \
+		} else { \
+			for (; idx < conv->count; idx++, in += (width)) { \
+				value = read(in); \
+				value *= conv->scale; \
+				value += conv->offset; \
+				conv->dout[idx] = value; \
+			} \
+		} \
+	} while (0)
+/** @endcond */
+
+/*
+ * Convert sample values starting at index idx, with the encoding's
+ * reader inlined into a dedicated loop.
+ *
+ * Do all internal calculations on double precision values. Only trim
+ * the result data to single precision when the caller asked for it.
+ */
+static void analog_convert_scalar(const struct analog_conv *conv, size_t idx)
+{
+	const uint8_t *in;
+	double value;
+
+	in = conv->in;
+	switch (conv->type) {
+	case ANALOG_IN_U8:
+		ANALOG_CONVERT_LOOP(read_u8, sizeof(uint8_t));
+		break;
+	case ANALOG_IN_I8:
+		ANALOG_CONVERT_LOOP(read_i8, sizeof(int8_t));
+		break;
+	case ANALOG_IN_U16LE:
+		ANALOG_CONVERT_LOOP(read_u16le, sizeof(uint16_t));
+		break;
+	case ANALOG_IN_U16BE:
+		ANALOG_CONVERT_LOOP(read_u16be, sizeof(uint16_t));
+		break;
+	case ANALOG_IN_I16LE:
+		ANALOG_CONVERT_LOOP(read_i16le, sizeof(int16_t));
+		break;
+	case ANALOG_IN_I16BE:
+		ANALOG_CONVERT_LOOP(read_i16be, sizeof(int16_t));
+		break;
+	case ANALOG_IN_U32LE:
+		ANALOG_CONVERT_LOOP(read_u32le, sizeof(uint32_t));
+		break;
+	case ANALOG_IN_U32BE:
+		ANALOG_CONVERT_LOOP(read_u32be, sizeof(uint32_t));
+		break;
+	case ANALOG_IN_I32LE:
+		ANALOG_CONVERT_LOOP(read_i32le, sizeof(int32_t));
+		break;
+	case ANALOG_IN_I32BE:
+		ANALOG_CONVERT_LOOP(read_i32be, sizeof(int32_t));
+		break;
+	case ANALOG_IN_F32LE:
+		ANALOG_CONVERT_LOOP(read_fltle, sizeof(float));
+		break;
+	case ANALOG_IN_F32BE:
+		ANALOG_CONVERT_LOOP(read_fltbe, sizeof(float));
+		break;
+	case ANALOG_IN_F64LE:
+		ANALOG_CONVERT_LOOP(read_dblle, sizeof(double));
+		break;
+	case ANALOG_IN_F64BE:
+		ANALOG_CONVERT_LOOP(read_dblbe, sizeof(double));
+		break;
+	default:
+		break;
+	}
+}
+
+static int analog_convert(const struct sr_datafeed_analog *analog,
+		float *fout, double *dout, const char *conv_name)
+{
+	struct analog_conv conv;
+	enum analog_input_type native_type;
+	size_t unitsize, idx;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!fout && !dout)
+		return SR_ERR_ARG;
+
+	conv.type = analog_input_type(analog->encoding);
+	if (conv.type == ANALOG_IN_UNSUPPORTED) {
+		analog_type_unsupported(analog->encoding, conv_name);
+		return SR_ERR;
+	}
+
+	/*
+	 * Prepare the iteration over the sample data: Get the common
+	 * scale/offset factors which apply to all individual values.
+	 * Position the read pointer on the first byte of input data.
+	 */
+	conv.in = analog->data;
+	conv.count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	conv.offset = analog->encoding->offset.p;
+	conv.offset /= analog->encoding->offset.q;
+	conv.scale = analog->encoding->scale.p;
+	conv.scale /= analog->encoding->scale.q;
+	conv.is_unity = conv.scale == 1.0 && conv.offset == 0.0;
+	conv.fout = fout;
+	conv.dout = dout;
+
+	/*
+	 * Immediately handle the special case where input data needs
+	 * no conversion at all because it already is in the caller's
+	 * native format, and no scale/offset applies.
+	 */
+#ifdef WORDS_BIGENDIAN
+	native_type = fout ? ANALOG_IN_F32BE : ANALOG_IN_F64BE;
+#else
+	native_type = fout ? ANALOG_IN_F32LE : ANALOG_IN_F64LE;
+#endif
+	if (conv.type == native_type && conv.is_unity) {
+		unitsize = fout ? sizeof(fout[0]) : sizeof(dout[0]);
+		memcpy(fout ? (void *)fout : (void *)dout, conv.in,
+			conv.count * unitsize);
+		return SR_OK;
+	}
+
+	idx = analog_convert_vector(&conv);
+	analog_convert_scalar(&conv, idx);
+
+	return SR_OK;
+}
+
 /**
  * Convert an analog datafeed payload to an array of floats.
  *
  * The caller must provide the #outbuf space for the conversion result,
  * and is expected to free allocated space after use.
  *
+ * Calculations are done in double precision, results are trimmed to
+ * single precision. See sr_analog_to_double() for a variant which
+ * keeps the double precision values.
+ *
  * @param[in] analog The analog payload to convert. Must not be NULL.
  *                   analog->data, analog->meaning, and analog->encoding
  *                   must not be NULL.
@@ -177,14 +651,71 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *outbuf)
 {
-	size_t count;
-	gboolean host_bigendian;
-	gboolean input_float, input_signed, input_bigendian;
-	size_t input_unitsize;
-	double scale, offset, value;
-	const uint8_t *data8;
-	gboolean input_is_native;
-	char type_text[10];
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, outbuf, NULL, "float");
+}
+
+/**
+ * Convert an analog datafeed payload to an array of doubles.
+ *
+ * Works like sr_analog_to_float(), but does not trim the result to
+ * single precision. Applications which process values in double
+ * precision should use this routine, to avoid the round-trip through
+ * single precision floats.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *                    Must have room for analog->num_samples values per
+ *                    channel in analog->meaning->channels.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_double(const struct sr_datafeed_analog *analog,
+		double *outbuf)
+{
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	return analog_convert(analog, NULL, outbuf, "double");
+}
+
+/**
+ * Convert an analog datafeed payload to an array of raw 16bit integers.
+ *
+ * Copies the raw sample values of 8bit and 16bit integer encodings to
+ * host endian int16_t values, scale and offset are NOT applied. The
+ * caller can apply analog->encoding->scale and analog->encoding->offset
+ * when needed, or use the raw values directly (e.g. for display of
+ * scope traces). Float encodings, unsigned 16bit encodings (which
+ * exceed the int16_t range), and wider integers are not supported.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *                    Must have room for analog->num_samples values per
+ *                    channel in analog->meaning->channels.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_to_int16(const struct sr_datafeed_analog *analog,
+		int16_t *outbuf)
+{
+	enum analog_input_type type, native_type;
+	const uint8_t *in;
+	size_t count, idx;
 
 	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
 		return SR_ERR_ARG;
@@ -192,190 +723,41 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		return SR_ERR_ARG;
 
 	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	in = analog->data;
 
-	/*
-	 * Determine properties of the input data's and the host's
-	 * native formats, to simplify test conditions below.
-	 * Error messages for unsupported input property combinations
-	 * will only be seen by developers and maintainers of input
-	 * formats or acquisition device drivers. Terse output is
-	 * acceptable there, users shall never see them.
-	 */
 #ifdef WORDS_BIGENDIAN
-	host_bigendian = TRUE;
+	native_type = ANALOG_IN_I16BE;
 #else
-	host_bigendian = FALSE;
+	native_type = ANALOG_IN_I16LE;
 #endif
-	input_float = analog->encoding->is_float;
-	input_signed = analog->encoding->is_signed;
-	input_bigendian = analog->encoding->is_bigendian;
-	input_unitsize = analog->encoding->unitsize;
-
-	/*
-	 * Prepare the iteration over the sample data: Get the common
-	 * scale/offset factors which apply to all individual values.
-	 * Position the read pointer on the first byte of input data.
-	 */
-	offset = analog->encoding->offset.p;
-	offset /= analog->encoding->offset.q;
-	scale = analog->encoding->scale.p;
-	scale /= analog->encoding->scale.q;
-	data8 = analog->data;
-
-	/*
-	 * Immediately handle the special case where input data needs
-	 * no conversion because it already is in the application's
-	 * native format. Do apply scale/offset though when applicable
-	 * on our way out.
-	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
-		input_bigendian == host_bigendian;
-	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
-		if (scale != 1.0 || offset != 0.0) {
-			while (count--) {
-				*outbuf *= scale;
-				*outbuf += offset;
-				outbuf++;
-			}
-		}
+	type = analog_input_type(analog->encoding);
+	if (type == native_type) {
+		memcpy(outbuf, in, count * sizeof(outbuf[0]));
 		return SR_OK;
 	}
 
-	/*
-	 * Accept sample values in different widths and data types and
-	 * endianess formats (floating point or signed or unsigned
-	 * integer, in either endianess, for a set of supported widths).
-	 * Common scale/offset factors apply to all sample values.
-	 *
-	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
-	 */
-	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_fltbe_inc;
-		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_dblbe_inc;
-		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_float) {
-		snprintf(type_text, sizeof(type_text), "%c%zu%s",
-			'f', input_unitsize * 8, input_bigendian ? "be" : "le");
-		sr_err("Unsupported type for analog-to-float conversion: %s.",
-			type_text);
-		return SR_ERR;
-	}
-
-	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
-		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i16be_inc;
-		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+	/* Simple loops which compilers turn into vector code by themselves. */
+	switch (type) {
+	case ANALOG_IN_U8:
+		for (idx = 0; idx < count; idx++)
+			outbuf[idx] = in[idx];
 		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u16be_inc;
-		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+	case ANALOG_IN_I8:
+		for (idx = 0; idx < count; idx++)
+			outbuf[idx] = (int8_t)in[idx];
 		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_i32be_inc;
-		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+	case ANALOG_IN_I16LE:
+		for (idx = 0; idx < count; idx++)
+			outbuf[idx] = (int16_t)(in[2 * idx] | (in[2 * idx + 1] << 8));
 		return SR_OK;
-	}
-	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
-		if (input_bigendian)
-			reader = read_u32be_inc;
-		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+	case ANALOG_IN_I16BE:
+		for (idx = 0; idx < count; idx++)
+			outbuf[idx] = (int16_t)((in[2 * idx] << 8) | in[2 * idx + 1]);
 		return SR_OK;
+	default:
+		analog_type_unsupported(analog->encoding, "int16");
+		return SR_ERR;
 	}
-	snprintf(type_text, sizeof(type_text), "%c%zu%s",
-		input_float ? 'f' : input_signed ? 'i' : 'u',
-		input_unitsize * 8, input_bigendian ? "be" : "le");
-	sr_err("Unsupported type for analog-to-float conversion: %s.",
-		type_text);
-	return SR_ERR;
 }
 
 /**
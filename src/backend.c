@@ -538,6 +538,61 @@ static int sanity_check_all_transform_modules(void)
 	return ret;
 }
 
+/**
+ * Get the vector instruction sets which the CPU supports.
+ *
+ * Code with SIMD kernels uses this to pick a kernel at runtime. Setting
+ * the SIGROK_NO_SIMD environment variable disables all vector kernels,
+ * which allows to test and benchmark the portable code paths. Detection
+ * runs once, the result is cached.
+ *
+ * @return A bit mask of SR_CPU_* flags, zero on other architectures.
+ *
+ * @private
+ */
+static gint cpu_features_limit = SR_CPU_SSE2 | SR_CPU_AVX2;
+
+SR_PRIV int sr_cpu_features(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	static gsize features;
+	gsize detected;
+
+	/* Have an extra bit, g_once_init_leave() rejects zero values. */
+	if (g_once_init_enter(&features)) {
+		detected = 1 << 16;
+		__builtin_cpu_init();
+		if (!g_getenv("SIGROK_NO_SIMD")) {
+			if (__builtin_cpu_supports("sse2"))
+				detected |= SR_CPU_SSE2;
+			if (__builtin_cpu_supports("avx2"))
+				detected |= SR_CPU_AVX2;
+		}
+		g_once_init_leave(&features, detected);
+	}
+
+	return features & g_atomic_int_get(&cpu_features_limit);
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Restrict the vector instruction sets which sr_cpu_features() reports.
+ *
+ * Tests use this to run each SIMD kernel and the portable code on the
+ * same CPU. Instruction sets which the CPU lacks (or which got disabled
+ * by SIGROK_NO_SIMD) don't get enabled.
+ *
+ * @param features A bit mask of SR_CPU_* flags which may get reported.
+ *
+ * @private
+ */
+SR_PRIV void sr_cpu_features_limit(int features)
+{
+	g_atomic_int_set(&cpu_features_limit, features);
+}
+
 /**
  * Initialize libsigrok.
  *
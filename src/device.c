@@ -527,6 +527,7 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	g_free(sdi->version);
 	g_free(sdi->serial_num);
 	g_free(sdi->connection_id);
+	sr_config_cache_free(sdi);
 	g_free(sdi);
 }
 
@@ -738,6 +739,8 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Opening device instance.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi);
+
 	ret = sdi->driver->dev_open(sdi);
 
 	if (ret == SR_OK)
@@ -780,6 +783,8 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Closing device instance.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi);
+
 	return sdi->driver->dev_close(sdi);
 }
 
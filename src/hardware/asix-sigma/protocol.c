@@ -1142,6 +1142,10 @@ SR_PRIV int sigma_set_samplerate(const struct sr_dev_inst *sdi)
  *
  * The buffer holds up to CHUNK_SIZE bytes. The unit size is fixed (the
  * driver provides a fixed channel layout regardless of samplerate).
+ *
+ * When the session's consumers accept run-length encoded data, the
+ * buffer holds (value, run length) pairs instead, and long runs of
+ * the same sample value need not get expanded.
  */
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
@@ -1151,9 +1155,12 @@ struct submit_buffer {
 	size_t max_samples, curr_samples;
 	uint8_t *sample_data;
 	uint8_t *write_pointer;
+	uint64_t *run_lengths;
+	gboolean rle;
 	struct sr_dev_inst *sdi;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle logic_rle;
 };
 
 static int alloc_submit_buffer(struct sr_dev_inst *sdi)
@@ -1168,23 +1175,41 @@ static int alloc_submit_buffer(struct sr_dev_inst *sdi)
 	devc->buffer = buffer;
 
 	buffer->unit_size = sizeof(uint16_t);
+	buffer->rle = sr_session_accepts_logic_rle(sdi->session);
 	size = CHUNK_SIZE;
-	size /= buffer->unit_size;
+	if (buffer->rle)
+		size /= buffer->unit_size + sizeof(*buffer->run_lengths);
+	else
+		size /= buffer->unit_size;
 	buffer->max_samples = size;
 	size *= buffer->unit_size;
 	buffer->sample_data = g_try_malloc0(size);
 	if (!buffer->sample_data)
 		return SR_ERR_MALLOC;
 	buffer->write_pointer = buffer->sample_data;
+	if (buffer->rle) {
+		buffer->run_lengths = g_try_malloc0(buffer->max_samples *
+			sizeof(*buffer->run_lengths));
+		if (!buffer->run_lengths)
+			return SR_ERR_MALLOC;
+	}
 	sr_sw_limits_init(&devc->limit.submit);
 
 	buffer->sdi = sdi;
 	memset(&buffer->logic, 0, sizeof(buffer->logic));
 	buffer->logic.unitsize = buffer->unit_size;
 	buffer->logic.data = buffer->sample_data;
+	memset(&buffer->logic_rle, 0, sizeof(buffer->logic_rle));
+	buffer->logic_rle.unitsize = buffer->unit_size;
+	buffer->logic_rle.values = buffer->sample_data;
+	buffer->logic_rle.lengths = buffer->run_lengths;
 	memset(&buffer->packet, 0, sizeof(buffer->packet));
 	buffer->packet.type = SR_DF_LOGIC;
 	buffer->packet.payload = &buffer->logic;
+	if (buffer->rle) {
+		buffer->packet.type = SR_DF_LOGIC_RLE;
+		buffer->packet.payload = &buffer->logic_rle;
+	}
 
 	return SR_OK;
 }
@@ -1233,6 +1258,7 @@ static void free_submit_buffer(struct dev_context *devc)
 	devc->buffer = NULL;
 
 	g_free(buffer->sample_data);
+	g_free(buffer->run_lengths);
 	g_free(buffer);
 }
 
@@ -1249,6 +1275,7 @@ static int flush_submit_buffer(struct dev_context *devc)
 
 	/* Submit to the session feed. */
 	buffer->logic.length = buffer->curr_samples * buffer->unit_size;
+	buffer->logic_rle.num_runs = buffer->curr_samples;
 	ret = sr_session_send(buffer->sdi, &buffer->packet);
 	if (ret != SR_OK)
 		return ret;
@@ -1260,6 +1287,51 @@ static int flush_submit_buffer(struct dev_context *devc)
 	return SR_OK;
 }
 
+/*
+ * Run-length encoded flavour of addto_submit_buffer(), which takes the
+ * whole run at once. The current position counts runs, not samples.
+ */
+static int addto_submit_buffer_rle(struct dev_context *devc,
+	uint16_t sample, size_t count)
+{
+	struct submit_buffer *buffer;
+	struct sr_sw_limits *limits;
+	uint64_t remain;
+	gboolean exceeded;
+	int ret;
+
+	buffer = devc->buffer;
+	limits = &devc->limit.submit;
+	if (!devc->use_triggers) {
+		ret = sr_sw_limits_get_remain(limits,
+			&remain, NULL, NULL, &exceeded);
+		if (ret != SR_OK)
+			return ret;
+		if (exceeded)
+			return SR_OK;
+		if (remain && count > remain)
+			count = remain;
+	}
+	if (!count)
+		return SR_OK;
+
+	if (buffer->curr_samples && read_u16le(buffer->write_pointer
+			- buffer->unit_size) == sample) {
+		buffer->run_lengths[buffer->curr_samples - 1] += count;
+	} else {
+		write_u16le_inc(&buffer->write_pointer, sample);
+		buffer->run_lengths[buffer->curr_samples++] = count;
+		if (buffer->curr_samples == buffer->max_samples) {
+			ret = flush_submit_buffer(devc);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+	sr_sw_limits_update_samples_read(limits, count);
+
+	return SR_OK;
+}
+
 static int addto_submit_buffer(struct dev_context *devc,
 	uint16_t sample, size_t count)
 {
@@ -1268,6 +1340,9 @@ static int addto_submit_buffer(struct dev_context *devc,
 	int ret;
 
 	buffer = devc->buffer;
+	if (buffer->rle)
+		return addto_submit_buffer_rle(devc, sample, count);
+
 	limits = &devc->limit.submit;
 	if (!devc->use_triggers && sr_sw_limits_check(limits))
 		count = 0;
@@ -1390,12 +1465,53 @@ static void rewind_trig_arm_pos(struct dev_context *devc, size_t count)
 	}
 }
 
+static uint16_t sigma_deinterlace_first(uint16_t indata,
+	size_t samples_per_event);
+
+/*
+ * Read DRAM lines ahead of their interpretation. The thread owns the
+ * FTDI connection while the download is in progress. It stops after
+ * the last line, after read errors (the failing buffer carries the
+ * status), or when asked to.
+ */
+static gpointer fetch_thread(gpointer data)
+{
+	struct dev_context *devc;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_buffer *buf;
+	size_t line, remain, count;
+
+	devc = data;
+	interp = &devc->interp;
+
+	line = interp->start.line;
+	remain = interp->fetch.lines_total;
+	while (remain) {
+		buf = g_async_queue_pop(interp->fetch.free_bufs);
+		if (g_atomic_int_get(&interp->fetch.stop)) {
+			g_async_queue_push(interp->fetch.free_bufs, buf);
+			break;
+		}
+		count = MIN(remain, interp->fetch.lines_per_read);
+		buf->status = interp->fetch.read_dram(devc, line, count,
+			(uint8_t *)buf->lines);
+		buf->count = count;
+		g_async_queue_push(interp->fetch.full_bufs, buf);
+		if (buf->status != SR_OK)
+			break;
+		line += count;
+		line %= ROW_COUNT;
+		remain -= count;
+	}
+
+	return NULL;
+}
+
 static int alloc_sample_buffer(struct dev_context *devc,
 	size_t stop_pos, size_t trig_pos, uint8_t mode)
 {
 	struct sigma_sample_interp *interp;
 	gboolean wrapped;
-	size_t alloc_size;
 
 	interp = &devc->interp;
 
@@ -1447,25 +1563,63 @@ static int alloc_sample_buffer(struct dev_context *devc,
 	interp->fetch.lines_total %= ROW_COUNT;
 	interp->fetch.lines_done = 0;
 
-	/* Arrange for chunked download, N lines per USB request. */
+	interp->fetch.read_dram = sigma_read_dram;
+
+	return sigma_fetch_start(devc);
+}
+
+/*
+ * Start the download of the DRAM lines which alloc_sample_buffer()
+ * has determined, via the fetch.read_dram() routine. Resources get
+ * released by free_sample_buffer(), also when this routine fails.
+ */
+SR_PRIV int sigma_fetch_start(struct dev_context *devc)
+{
+	struct sigma_sample_interp *interp;
+	size_t alloc_size, idx;
+	struct sigma_fetch_buffer *buf;
+	GError *error;
+
+	interp = &devc->interp;
+	error = NULL;
+
+	/*
+	 * Arrange for chunked download, N lines per USB request. A
+	 * thread reads ahead into a set of buffers while previously
+	 * received lines get decoded.
+	 */
+	sigma_deinterlace_init();
 	interp->fetch.lines_per_read = 32;
-	alloc_size = sizeof(devc->interp.fetch.rcvd_lines[0]);
-	alloc_size *= devc->interp.fetch.lines_per_read;
-	devc->interp.fetch.rcvd_lines = g_try_malloc0(alloc_size);
-	if (!devc->interp.fetch.rcvd_lines)
-		return SR_ERR_MALLOC;
+	alloc_size = sizeof(struct sigma_dram_line);
+	alloc_size *= interp->fetch.lines_per_read;
+	interp->fetch.free_bufs = g_async_queue_new();
+	interp->fetch.full_bufs = g_async_queue_new();
+	for (idx = 0; idx < FETCH_BUFFER_COUNT; idx++) {
+		buf = g_malloc0(sizeof(*buf));
+		buf->lines = g_try_malloc0(alloc_size);
+		if (!buf->lines) {
+			g_free(buf);
+			return SR_ERR_MALLOC;
+		}
+		g_async_queue_push(interp->fetch.free_bufs, buf);
+	}
+	interp->fetch.stop = 0;
+	interp->fetch.thread = g_thread_try_new("sigma-dram",
+		fetch_thread, devc, &error);
+	if (!interp->fetch.thread) {
+		sr_err("Cannot start DRAM download thread: %s.",
+			error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
 
 	return SR_OK;
 }
 
-static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx);
-static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx);
-
 static int fetch_sample_buffer(struct dev_context *devc)
 {
 	struct sigma_sample_interp *interp;
-	size_t count;
-	int ret;
+	struct sigma_fetch_buffer *buf;
 	const uint8_t *rdptr;
 	uint16_t ts, data;
 
@@ -1476,27 +1630,25 @@ static int fetch_sample_buffer(struct dev_context *devc)
 		interp->iter = interp->start;
 	}
 
-	/* Get another set of DRAM lines in one read call. */
-	count = interp->fetch.lines_total - interp->fetch.lines_done;
-	if (count > interp->fetch.lines_per_read)
-		count = interp->fetch.lines_per_read;
-	ret = sigma_read_dram(devc, interp->iter.line, count,
-		(uint8_t *)interp->fetch.rcvd_lines);
-	if (ret != SR_OK)
-		return ret;
-	interp->fetch.lines_rcvd = count;
-	interp->fetch.curr_line = &interp->fetch.rcvd_lines[0];
+	/* Hand back the previous buffer, get the next set of lines. */
+	if (interp->fetch.curr_buf) {
+		g_async_queue_push(interp->fetch.free_bufs,
+			interp->fetch.curr_buf);
+		interp->fetch.curr_buf = NULL;
+	}
+	buf = g_async_queue_pop(interp->fetch.full_bufs);
+	interp->fetch.curr_buf = buf;
+	if (buf->status != SR_OK)
+		return buf->status;
+	interp->fetch.lines_rcvd = buf->count;
+	interp->fetch.curr_line = &buf->lines[0];
 
 	/* First invocation? Get initial timestamp and sample data. */
 	if (!interp->fetch.lines_done) {
 		rdptr = (void *)interp->fetch.curr_line;
 		ts = read_u16le_inc(&rdptr);
 		data = read_u16le_inc(&rdptr);
-		if (interp->samples_per_event == 4) {
-			data = sigma_deinterlace_data_4x4(data, 0);
-		} else if (interp->samples_per_event == 2) {
-			data = sigma_deinterlace_data_2x8(data, 0);
-		}
+		data = sigma_deinterlace_first(data, interp->samples_per_event);
 		interp->last.ts = ts;
 		interp->last.sample = data;
 	}
@@ -1506,9 +1658,47 @@ static int fetch_sample_buffer(struct dev_context *devc)
 
 static void free_sample_buffer(struct dev_context *devc)
 {
-	g_free(devc->interp.fetch.rcvd_lines);
-	devc->interp.fetch.rcvd_lines = NULL;
-	devc->interp.fetch.lines_per_read = 0;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_buffer *buf;
+
+	interp = &devc->interp;
+
+	/*
+	 * Terminate the download thread. It may wait for a free buffer,
+	 * so return all buffers which it has filled and which were not
+	 * consumed yet.
+	 */
+	if (interp->fetch.thread) {
+		g_atomic_int_set(&interp->fetch.stop, 1);
+		if (interp->fetch.curr_buf)
+			g_async_queue_push(interp->fetch.free_bufs,
+				interp->fetch.curr_buf);
+		interp->fetch.curr_buf = NULL;
+		while ((buf = g_async_queue_try_pop(interp->fetch.full_bufs)))
+			g_async_queue_push(interp->fetch.free_bufs, buf);
+		g_thread_join(interp->fetch.thread);
+		interp->fetch.thread = NULL;
+	}
+
+	if (interp->fetch.curr_buf)
+		g_async_queue_push(interp->fetch.free_bufs,
+			interp->fetch.curr_buf);
+	interp->fetch.curr_buf = NULL;
+	if (interp->fetch.full_bufs) {
+		while ((buf = g_async_queue_try_pop(interp->fetch.full_bufs)))
+			g_async_queue_push(interp->fetch.free_bufs, buf);
+		g_async_queue_unref(interp->fetch.full_bufs);
+		interp->fetch.full_bufs = NULL;
+	}
+	if (interp->fetch.free_bufs) {
+		while ((buf = g_async_queue_try_pop(interp->fetch.free_bufs))) {
+			g_free(buf->lines);
+			g_free(buf);
+		}
+		g_async_queue_unref(interp->fetch.free_bufs);
+		interp->fetch.free_bufs = NULL;
+	}
+	interp->fetch.lines_per_read = 0;
 }
 
 /*
@@ -1809,52 +1999,118 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 }
 
 /*
- * Deinterlace sample data that was retrieved at 100MHz samplerate.
- * One 16bit item contains two samples of 8bits each. The bits of
- * multiple samples are interleaved.
+ * Deinterlace sample data that was retrieved at 100MHz and 200MHz
+ * samplerates. One 16bit item contains two samples of 8bits each, or
+ * four samples of 4bits each. The bits of multiple samples are
+ * interleaved: Bit N of sample K is at position K + N * (samples per
+ * item) of the 16bit item.
+ *
+ * Lookup tables translate each byte of the item. Entries hold the
+ * respective bits for all samples, in separate 8bit (2x8) or 4bit (4x4)
+ * fields. The item's high byte carries the upper bits of all samples,
+ * its table entry gets shifted to the fields' upper half.
  */
-static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
+static uint16_t deinterlace_lut_2x8[256];
+static uint16_t deinterlace_lut_4x4[256];
+
+SR_PRIV void sigma_deinterlace_init(void)
+{
+	static gsize initialized;
+	size_t byte, bit, idx;
+	uint16_t entry;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+
+	for (byte = 0; byte < 256; byte++) {
+		entry = 0;
+		for (bit = 0; bit < 8; bit++) {
+			if (!(byte & (1 << bit)))
+				continue;
+			idx = bit % 2;
+			entry |= 1 << (idx * 8 + bit / 2);
+		}
+		deinterlace_lut_2x8[byte] = entry;
+
+		entry = 0;
+		for (bit = 0; bit < 8; bit++) {
+			if (!(byte & (1 << bit)))
+				continue;
+			idx = bit % 4;
+			entry |= 1 << (idx * 4 + bit / 4);
+		}
+		deinterlace_lut_4x4[byte] = entry;
+	}
+
+	g_once_init_leave(&initialized, 1);
+}
+
+static uint16_t sigma_deinterlace_2x8(uint16_t indata)
+{
+	return deinterlace_lut_2x8[indata & 0xff] |
+		deinterlace_lut_2x8[indata >> 8] << 4;
+}
+
+static uint16_t sigma_deinterlace_4x4(uint16_t indata)
 {
-	uint16_t outdata;
+	return deinterlace_lut_4x4[indata & 0xff] |
+		deinterlace_lut_4x4[indata >> 8] << 2;
+}
 
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
-	return outdata;
+/* Get the first sample of a 16bit item. */
+static uint16_t sigma_deinterlace_first(uint16_t indata,
+	size_t samples_per_event)
+{
+	if (samples_per_event == 4)
+		return sigma_deinterlace_4x4(indata) & 0x0f;
+	if (samples_per_event == 2)
+		return sigma_deinterlace_2x8(indata) & 0xff;
+	return indata;
 }
 
 /*
- * Deinterlace sample data that was retrieved at 200MHz samplerate.
- * One 16bit item contains four samples of 4bits each. The bits of
- * multiple samples are interleaved.
+ * Deinterlace all events of a cluster at once. Returns the number of
+ * samples which were written to the output array.
  */
-static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
+SR_PRIV size_t sigma_deinterlace_cluster(struct sigma_dram_cluster *dram_cluster,
+	size_t events_in_cluster, size_t samples_per_event, uint16_t *samples)
 {
-	uint16_t outdata;
+	uint16_t item16, fields;
+	size_t evt;
+	uint16_t *wrptr;
+
+	wrptr = samples;
+	for (evt = 0; evt < events_in_cluster; evt++) {
+		item16 = sigma_dram_cluster_data(dram_cluster, evt);
+		if (samples_per_event == 4) {
+			fields = sigma_deinterlace_4x4(item16);
+			*wrptr++ = (fields >> 0) & 0x0f;
+			*wrptr++ = (fields >> 4) & 0x0f;
+			*wrptr++ = (fields >> 8) & 0x0f;
+			*wrptr++ = (fields >> 12) & 0x0f;
+		} else if (samples_per_event == 2) {
+			fields = sigma_deinterlace_2x8(item16);
+			*wrptr++ = (fields >> 0) & 0xff;
+			*wrptr++ = (fields >> 8) & 0xff;
+		} else {
+			*wrptr++ = item16;
+		}
+	}
 
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
-	return outdata;
+	return wrptr - samples;
 }
 
 static void sigma_decode_dram_cluster(struct dev_context *devc,
 	struct sigma_dram_cluster *dram_cluster,
 	size_t events_in_cluster)
 {
-	uint16_t tsdiff, ts, sample, item16;
-	size_t count;
-	size_t evt;
+	uint16_t tsdiff, ts, sample;
+	uint16_t samples[EVENTS_PER_CLUSTER * 4];
+	size_t count, samples_per_event, samples_per_item;
+	size_t evt, idx;
+	const uint16_t *rdptr;
+
+	samples_per_event = devc->interp.samples_per_event;
 
 	/*
 	 * If this cluster is not adjacent to the previously received
@@ -1870,7 +2126,7 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	tsdiff = ts - devc->interp.last.ts;
 	if (tsdiff > 0) {
 		sample = devc->interp.last.sample;
-		count = tsdiff * devc->interp.samples_per_event;
+		count = tsdiff * samples_per_event;
 		(void)check_and_submit_sample(devc, sample, count);
 	}
 	devc->interp.last.ts = ts + EVENTS_PER_CLUSTER;
@@ -1882,31 +2138,15 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	 * before submission is transparent to this code path, specific
 	 * buffer depth is neither assumed nor required here.
 	 */
-	sample = 0;
+	if (!events_in_cluster)
+		return;
+	count = sigma_deinterlace_cluster(dram_cluster, events_in_cluster,
+		samples_per_event, samples);
+	samples_per_item = count / events_in_cluster;
+	rdptr = samples;
 	for (evt = 0; evt < events_in_cluster; evt++) {
-		item16 = sigma_dram_cluster_data(dram_cluster, evt);
-		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-		} else {
-			sample = item16;
+		for (idx = 0; idx < samples_per_item; idx++) {
+			sample = *rdptr++;
 			check_and_submit_sample(devc, sample, 1);
 			devc->interp.last.sample = sample;
 		}
@@ -1969,51 +2209,54 @@ static int download_capture(struct sr_dev_inst *sdi)
 	interp = &devc->interp;
 
 	/*
-	 * Check the mode register. Force stop the current acquisition
-	 * if it has not yet terminated before. Will block until the
-	 * acquisition stops, assuming that this won't take long. Should
-	 * execute exactly once, then keep finding its condition met.
-	 *
-	 * Ask the hardware to stop data acquisition. Reception of the
-	 * FORCESTOP request makes the hardware "disable RLE" (store
-	 * clusters to DRAM regardless of whether pin state changes) and
-	 * raise the POSTTRIGGERED flag.
+	 * Stop the acquisition and prepare the download in the first
+	 * invocation. The DRAM read thread owns the FTDI connection
+	 * after that, so don't touch registers in later invocations.
 	 */
-	ret = sigma_get_register(devc, READ_MODE, &modestatus);
-	if (ret != SR_OK) {
-		sr_err("Could not determine current device state.");
-		return FALSE;
-	}
-	if (!(modestatus & RMR_POSTTRIGGERED)) {
-		sr_info("Downloading sample data.");
-		devc->state = SIGMA_DOWNLOAD;
-
-		modestatus = WMR_FORCESTOP | WMR_SDRAMWRITEEN;
-		ret = sigma_set_register(devc, WRITE_MODE, modestatus);
-		if (ret != SR_OK)
+	if (devc->state != SIGMA_DOWNLOAD) {
+		/*
+		 * Check the mode register. Force stop the current
+		 * acquisition if it has not yet terminated before. Will
+		 * block until the acquisition stops, assuming that this
+		 * won't take long.
+		 *
+		 * Ask the hardware to stop data acquisition. Reception
+		 * of the FORCESTOP request makes the hardware "disable
+		 * RLE" (store clusters to DRAM regardless of whether pin
+		 * state changes) and raise the POSTTRIGGERED flag.
+		 */
+		ret = sigma_get_register(devc, READ_MODE, &modestatus);
+		if (ret != SR_OK) {
+			sr_err("Could not determine current device state.");
 			return FALSE;
-		do {
-			ret = sigma_get_register(devc, READ_MODE, &modestatus);
-			if (ret != SR_OK) {
-				sr_err("Could not poll for post-trigger state.");
+		}
+		if (!(modestatus & RMR_POSTTRIGGERED)) {
+			modestatus = WMR_FORCESTOP | WMR_SDRAMWRITEEN;
+			ret = sigma_set_register(devc, WRITE_MODE, modestatus);
+			if (ret != SR_OK)
 				return FALSE;
-			}
-		} while (!(modestatus & RMR_POSTTRIGGERED));
-	}
+			do {
+				ret = sigma_get_register(devc, READ_MODE,
+					&modestatus);
+				if (ret != SR_OK) {
+					sr_err("Could not poll for post-trigger state.");
+					return FALSE;
+				}
+			} while (!(modestatus & RMR_POSTTRIGGERED));
+		}
 
-	/*
-	 * Switch the hardware from DRAM write (data acquisition) to
-	 * DRAM read (sample memory download). Prepare resources for
-	 * sample memory content retrieval. Should execute exactly once,
-	 * then keep finding its condition met.
-	 *
-	 * Get the current positions (acquisition write pointer, and
-	 * trigger match location). With disabled triggers, use a value
-	 * for the location that will never match during interpretation.
-	 * Determine which area of the sample memory to retrieve,
-	 * allocate a receive buffer, and setup counters/pointers.
-	 */
-	if (!interp->fetch.lines_per_read) {
+		/*
+		 * Switch the hardware from DRAM write (data acquisition)
+		 * to DRAM read (sample memory download). Prepare resources
+		 * for sample memory content retrieval.
+		 *
+		 * Get the current positions (acquisition write pointer,
+		 * and trigger match location). With disabled triggers,
+		 * use a value for the location that will never match
+		 * during interpretation. Determine which area of the
+		 * sample memory to retrieve, allocate a receive buffer,
+		 * and setup counters/pointers.
+		 */
 		ret = sigma_set_register(devc, WRITE_MODE, WMR_SDRAMREADEN);
 		if (ret != SR_OK)
 			return FALSE;
@@ -2028,6 +2271,9 @@ static int download_capture(struct sr_dev_inst *sdi)
 		if (!(modestatus & RMR_TRIGGERED))
 			triggerpos = ~0;
 
+		/* Failed setup gets cleaned up by sigma_abort_download(). */
+		sr_info("Downloading sample data.");
+		devc->state = SIGMA_DOWNLOAD;
 		ret = alloc_sample_buffer(devc, stoppos, triggerpos, modestatus);
 		if (ret != SR_OK)
 			return FALSE;
@@ -2102,6 +2348,20 @@ static int download_capture(struct sr_dev_inst *sdi)
 	return TRUE;
 }
 
+/*
+ * Release download resources when the acquisition gets stopped before
+ * all of the sample memory was retrieved. Terminates the DRAM read
+ * thread, which otherwise would keep using the FTDI connection.
+ */
+SR_PRIV void sigma_abort_download(struct dev_context *devc)
+{
+	if (!devc)
+		return;
+
+	free_sample_buffer(devc);
+	free_submit_buffer(devc);
+}
+
 /*
  * Periodically check the Sigma status when in CAPTURE mode. This routine
  * checks whether the configured sample count or sample time have passed,
@@ -251,6 +251,18 @@ struct sigma_dram_line {
 	} cluster[CLUSTERS_PER_ROW];
 };
 
+/*
+ * Number of DRAM read buffers which the download thread cycles through.
+ * Lets USB transfers for later lines overlap with decoding earlier ones.
+ */
+#define FETCH_BUFFER_COUNT	4
+
+struct sigma_fetch_buffer {
+	struct sigma_dram_line *lines;
+	size_t count;
+	int status;
+};
+
 /* The effect of all these are still a bit unclear. */
 struct triggerinout {
 	gboolean trgout_resistor_enable, trgout_resistor_pullup;
@@ -367,8 +379,14 @@ struct dev_context {
 			size_t lines_total, lines_done;
 			size_t lines_per_read; /* USB transfer limit */
 			size_t lines_rcvd;
-			struct sigma_dram_line *rcvd_lines;
 			struct sigma_dram_line *curr_line;
+			/* DRAM reads run ahead of decoding in a thread. */
+			int (*read_dram)(struct dev_context *devc,
+				size_t line, size_t count, uint8_t *data);
+			GThread *thread;
+			GAsyncQueue *free_bufs, *full_bufs;
+			struct sigma_fetch_buffer *curr_buf;
+			int stop;
 		} fetch;
 		struct {
 			gboolean armed;
@@ -409,6 +427,15 @@ SR_PRIV int sigma_set_register(struct dev_context *devc,
 SR_PRIV int sigma_write_trigger_lut(struct dev_context *devc,
 	struct triggerlut *lut);
 
+/* Sample memory download and interpretation. */
+SR_PRIV int sigma_fetch_start(struct dev_context *devc);
+SR_PRIV void sigma_deinterlace_init(void);
+SR_PRIV size_t sigma_deinterlace_cluster(struct sigma_dram_cluster *dram_cluster,
+	size_t events_in_cluster, size_t samples_per_event, uint16_t *samples);
+
+/* Terminate a sample memory download which has not completed. */
+SR_PRIV void sigma_abort_download(struct dev_context *devc);
+
 /* Samplerate constraints check, get/set/list helpers. */
 SR_PRIV int sigma_normalize_samplerate(uint64_t want_rate, uint64_t *have_rate);
 SR_PRIV GVariant *sigma_get_samplerates_list(void);
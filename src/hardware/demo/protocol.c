@@ -31,6 +31,11 @@
 
 #define ANALOG_SAMPLES_PER_PERIOD 20
 
+/* Periodic logic patterns up to this size (in bytes) get precomputed. */
+#define LOGIC_PERIOD_MAX	(1024 * 1024)
+/* Gray code counters up to this width repeat within LOGIC_PERIOD_MAX. */
+#define LOGIC_PERIOD_MAX_BITS	16
+
 static const uint8_t pattern_sigrok[] = {
 	0x4c, 0x92, 0x92, 0x92, 0x64, 0x00, 0x00, 0x00,
 	0x82, 0xfe, 0xfe, 0x82, 0x00, 0x00, 0x00, 0x00,
@@ -274,45 +279,54 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+/* The "xorshift64*" generator, fast and good enough for test data. */
+static uint64_t prng_next(uint64_t *state)
 {
-	struct dev_context *devc;
-	uint64_t i, j;
+	uint64_t x;
+
+	x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+static void logic_fill(struct dev_context *devc, uint8_t *data, uint64_t size)
+{
+	uint64_t i, j, value;
 	uint8_t pat;
 	uint8_t *sample;
 	const uint8_t *image_col;
 	size_t col_count, col_height;
 	uint64_t gray;
 
-	devc = sdi->priv;
-
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				data[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+		for (i = 0; i < size; i += sizeof(value)) {
+			value = prng_next(&devc->prng_state);
+			memcpy(&data[i], &value, MIN(sizeof(value), size - i));
+		}
 		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
-			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
-			devc->step++;
-		}
+		for (i = 0; i < size; i++)
+			data[i] = devc->step++;
 		break;
 	case PATTERN_WALKING_ONE:
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = 1ULL << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			data[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -325,9 +339,9 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	case PATTERN_WALKING_ZERO:
 		/* Same as walking one, only with inverted output */
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = 1ULL << (devc->num_logic_channels - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			data[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -338,15 +352,16 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(data, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(data, 0xff, size);
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &data[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +377,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &data[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -371,6 +386,65 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	}
 }
 
+/*
+ * Determine after how many bytes a logic pattern repeats, such that
+ * the period also is a multiple of the sample size. Returns 0 for
+ * random data, and for periods that are too large to keep around.
+ */
+static size_t logic_period_size(struct dev_context *devc)
+{
+	size_t unitsize, period, size;
+	uint64_t step, top;
+
+	unitsize = devc->logic_unitsize;
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		period = sizeof(pattern_sigrok) * unitsize;
+		break;
+	case PATTERN_INC:
+		period = 256;
+		break;
+	case PATTERN_WALKING_ONE:
+	case PATTERN_WALKING_ZERO:
+		/* Count the states until the walking bit wraps around. */
+		top = 1ULL << (devc->num_logic_channels - 1);
+		step = 0;
+		period = 0;
+		do {
+			if (step == 0)
+				step = 1;
+			else if (step == top)
+				step = 0;
+			else
+				step <<= 1;
+			period++;
+		} while (step != 0);
+		break;
+	case PATTERN_ALL_LOW:
+	case PATTERN_ALL_HIGH:
+		period = 1;
+		break;
+	case PATTERN_SQUID:
+		period = ARRAY_SIZE(pattern_squid) * unitsize;
+		break;
+	case PATTERN_GRAYCODE:
+		if (devc->num_logic_channels > LOGIC_PERIOD_MAX_BITS)
+			return 0;
+		period = (devc->all_logic_channels_mask + 1) * unitsize;
+		break;
+	default:
+		return 0;
+	}
+
+	size = period;
+	while (size % unitsize)
+		size += period;
+	if (size > LOGIC_PERIOD_MAX)
+		return 0;
+
+	return size;
+}
+
 /*
  * Fixup a memory image of generated logic data before it gets sent to
  * the session's datafeed. Mask out content from disabled channels.
@@ -399,6 +473,71 @@ static void logic_fixup_feed(struct dev_context *devc,
 	}
 }
 
+/*
+ * Prepare the logic pattern for an acquisition. Periodic patterns get
+ * generated for one period plus one chunk of data, with the disabled
+ * channels already masked out. Chunks then are sent right from that
+ * table, at any position in the period.
+ */
+SR_PRIV void demo_prepare_logic_pattern(struct dev_context *devc)
+{
+	struct sr_datafeed_logic logic;
+	size_t period, size;
+
+	demo_free_logic_pattern(devc);
+	devc->step = 0;
+	devc->prng_state = ((uint64_t)g_random_int() << 32) | g_random_int() | 1;
+
+	if (devc->num_logic_channels <= 0 || !devc->logic_unitsize)
+		return;
+	if (!(period = logic_period_size(devc)))
+		return;
+
+	size = period + devc->logic_bufsize;
+	size += devc->logic_unitsize - 1;
+	size -= size % devc->logic_unitsize;
+	devc->logic_period = g_malloc(size);
+	logic_fill(devc, devc->logic_period, size);
+	logic.unitsize = devc->logic_unitsize;
+	logic.length = size;
+	logic.data = devc->logic_period;
+	logic_fixup_feed(devc, &logic);
+
+	devc->logic_period_size = period;
+	devc->logic_period_pos = 0;
+	devc->step = 0;
+}
+
+SR_PRIV void demo_free_logic_pattern(struct dev_context *devc)
+{
+	g_free(devc->logic_period);
+	devc->logic_period = NULL;
+	devc->logic_period_size = 0;
+	devc->logic_period_pos = 0;
+}
+
+/* Get the next @a size bytes of logic data, ready for submission. */
+static uint8_t *logic_generator(struct dev_context *devc, uint64_t size)
+{
+	struct sr_datafeed_logic logic;
+	uint8_t *data;
+
+	if (devc->logic_period) {
+		data = devc->logic_period + devc->logic_period_pos;
+		devc->logic_period_pos += size;
+		devc->logic_period_pos %= devc->logic_period_size;
+		return data;
+	}
+
+	logic_fill(devc, devc->logic_data, size);
+	logic.unitsize = devc->logic_unitsize;
+	logic.length = size;
+	logic.data = devc->logic_data;
+	logic_fixup_feed(devc, &logic);
+
+	return devc->logic_data;
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
@@ -515,7 +654,7 @@ static void send_analog_packet(struct analog_gen *ag,
 			data = ag->packet.data;
 			for (i = 0; i < sending_now; i++) {
 				if (ag->pattern == PATTERN_ANALOG_RANDOM)
-					data[i] = (rand() % 1000) * amplitude + offset;
+					data[i] = (prng_next(&devc->prng_state) % 1000) * amplitude + offset;
 				else
 					data[i] = pattern->data[ag_pattern_pos + i] * amplitude + offset;
 			}
@@ -541,7 +680,7 @@ static void send_analog_packet(struct analog_gen *ag,
 
 		for (i = 0; i < to_avg; i++) {
 			if (ag->pattern == PATTERN_ANALOG_RANDOM)
-				value = (rand() % 1000) * amplitude + offset;
+				value = (prng_next(&devc->prng_state) % 1000) * amplitude + offset;
 			else
 				value = *(pattern->data + ag_pattern_pos + i) * amplitude + offset;
 			ag->avg_val = (ag->avg_val + value) / 2;
@@ -584,6 +723,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	void *value;
 	uint64_t samples_todo, logic_done, analog_done, analog_sent, sending_now;
 	int64_t elapsed_us, limit_us, todo_us;
+	uint8_t *logic_data;
 	int64_t trigger_offset;
 	int pre_trigger_samples;
 
@@ -601,17 +741,32 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		return G_SOURCE_CONTINUE;
 	}
 
-	/* What time span should we send samples for? */
-	elapsed_us = g_get_monotonic_time() - devc->start_us;
 	limit_us = 1000 * devc->limit_msec;
-	if (limit_us > 0 && limit_us < elapsed_us)
-		todo_us = MAX(0, limit_us - devc->spent_us);
-	else
-		todo_us = MAX(0, elapsed_us - devc->spent_us);
-
-	/* How many samples are outstanding since the last round? */
-	samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
-			/ G_USEC_PER_SEC;
+	if (devc->unthrottled) {
+		/*
+		 * Don't wait for the wall clock. Send a fixed amount of
+		 * samples per round, the time limit still applies to the
+		 * time span which the samples cover.
+		 */
+		samples_todo = UNTHROTTLED_SAMPLES_PER_RUN;
+		if (limit_us > 0) {
+			todo_us = MAX(0, limit_us - devc->spent_us);
+			samples_todo = MIN(samples_todo,
+				(todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
+				/ G_USEC_PER_SEC);
+		}
+	} else {
+		/* What time span should we send samples for? */
+		elapsed_us = g_get_monotonic_time() - devc->start_us;
+		if (limit_us > 0 && limit_us < elapsed_us)
+			todo_us = MAX(0, limit_us - devc->spent_us);
+		else
+			todo_us = MAX(0, elapsed_us - devc->spent_us);
+
+		/* How many samples are outstanding since the last round? */
+		samples_todo = (todo_us * devc->cur_samplerate + G_USEC_PER_SEC - 1)
+				/ G_USEC_PER_SEC;
+	}
 
 	if (devc->limit_samples > 0) {
 		if (devc->limit_samples < devc->sent_samples)
@@ -649,12 +804,13 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		/* Logic */
 		if (logic_done < samples_todo) {
 			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+					devc->logic_bufsize / devc->logic_unitsize);
+			logic_data = logic_generator(devc,
+					sending_now * devc->logic_unitsize);
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
-						devc->logic_data, sending_now * devc->logic_unitsize,
+						logic_data, sending_now * devc->logic_unitsize,
 						&pre_trigger_samples);
 				if (trigger_offset > -1) {
 					devc->trigger_fired = TRUE;
@@ -672,8 +828,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				if (devc->trigger_fired && (trigger_offset < (int)sending_now)) {
 					/* Send after-trigger data */
 					logic.length = (sending_now - trigger_offset) * devc->logic_unitsize;
-					logic.data = devc->logic_data + trigger_offset * devc->logic_unitsize;
-					logic_fixup_feed(devc, &logic);
+					logic.data = logic_data + trigger_offset * devc->logic_unitsize;
 					sr_session_send(sdi, &packet);
 					logic_done += sending_now - trigger_offset;
 					/* End acquisition */
@@ -687,8 +842,7 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 			} else if (!devc->stl) {
 				/* No trigger defined, send logic samples */
 				logic.length = sending_now * devc->logic_unitsize;
-				logic.data = devc->logic_data;
-				logic_fixup_feed(devc, &logic);
+				logic.data = logic_data;
 				sr_session_send(sdi, &packet);
 				logic_done += sending_now;
 			}
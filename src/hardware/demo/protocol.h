@@ -32,6 +32,10 @@
 
 /* The size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE			4096
+/* The chunk size in bytes when sending samples as fast as possible. */
+#define LOGIC_BUFSIZE_UNTHROTTLED	(64 * 1024)
+/* The number of samples per round when sending as fast as possible. */
+#define UNTHROTTLED_SAMPLES_PER_RUN	(1024 * 1024)
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
@@ -121,13 +125,21 @@ struct dev_context {
 	int64_t start_us;
 	int64_t spent_us;
 	uint64_t step;
+	uint64_t prng_state;
+	/* Send samples as fast as possible, regardless of the samplerate. */
+	gboolean unthrottled;
 	/* Logic */
 	int32_t num_logic_channels;
 	size_t logic_unitsize;
 	uint64_t all_logic_channels_mask;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
-	uint8_t logic_data[LOGIC_BUFSIZE];
+	size_t logic_bufsize;
+	uint8_t logic_data[LOGIC_BUFSIZE_UNTHROTTLED];
+	/* Periodic patterns: one period plus one chunk, ready for sending. */
+	uint8_t *logic_period;
+	size_t logic_period_size;
+	size_t logic_period_pos;
 	/* Analog */
 	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
@@ -162,6 +174,8 @@ struct analog_gen {
 
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV void demo_prepare_logic_pattern(struct dev_context *devc);
+SR_PRIV void demo_free_logic_pattern(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
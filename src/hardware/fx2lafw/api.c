@@ -132,6 +132,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_EVENT_THREAD | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_ADAPTIVE_TRANSFERS | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -538,6 +540,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_USB_EVENT_THREAD:
+		*data = g_variant_new_boolean(devc->usb_event_thread);
+		break;
+	case SR_CONF_ADAPTIVE_TRANSFERS:
+		*data = g_variant_new_boolean(devc->adaptive_transfers);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -573,6 +581,12 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_USB_EVENT_THREAD:
+		devc->usb_event_thread = g_variant_get_boolean(data);
+		break;
+	case SR_CONF_ADAPTIVE_TRANSFERS:
+		devc->adaptive_transfers = g_variant_get_boolean(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
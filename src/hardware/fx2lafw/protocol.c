@@ -273,6 +273,8 @@ SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 	int i;
 
 	devc->acq_aborted = TRUE;
+	if (devc->usb_queue)
+		usb_queue_stop(devc->usb_queue);
 
 	for (i = devc->num_transfers - 1; i >= 0; i--) {
 		if (devc->transfers[i])
@@ -280,6 +282,95 @@ SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 	}
 }
 
+static unsigned int to_bytes_per_ms(unsigned int samplerate)
+{
+	return samplerate / 1000;
+}
+
+static size_t get_buffer_size(struct dev_context *devc)
+{
+	size_t s;
+
+	/*
+	 * The buffer should be large enough to hold 10ms of data and
+	 * a multiple of 512.
+	 */
+	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
+	return (s + 511) & ~511;
+}
+
+static unsigned int get_number_of_transfers(struct dev_context *devc)
+{
+	unsigned int n;
+
+	/* Total buffer size should be able to hold about 500ms of data. */
+	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
+		get_buffer_size(devc));
+
+	if (n > NUM_SIMUL_TRANSFERS)
+		return NUM_SIMUL_TRANSFERS;
+
+	return n;
+}
+
+static unsigned int get_layout_timeout(struct dev_context *devc,
+	size_t size, unsigned int num_transfers)
+{
+	size_t total_size;
+	unsigned int timeout;
+
+	total_size = size * num_transfers;
+	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
+	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+}
+
+static unsigned int get_timeout(struct dev_context *devc)
+{
+	return get_layout_timeout(devc, get_buffer_size(devc),
+			get_number_of_transfers(devc));
+}
+
+/* Time it takes the device to fill a buffer of the given size. */
+static int64_t buffer_duration_us(struct dev_context *devc, size_t size)
+{
+	uint64_t bytes_per_ms;
+
+	bytes_per_ms = to_bytes_per_ms(devc->cur_samplerate);
+	if (devc->sample_wide)
+		bytes_per_ms *= 2;
+	if (!bytes_per_ms)
+		return 0;
+
+	return size * 1000 / bytes_per_ms;
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer);
+static void LIBUSB_CALL receive_transfer_threaded(struct libusb_transfer *transfer);
+
+static void report_transfer_stats(struct dev_context *devc)
+{
+	struct transfer_stats *st;
+	int64_t avg_jitter_us;
+
+	st = &devc->stats;
+	if (!st->completed)
+		return;
+
+	avg_jitter_us = 0;
+	if (st->completed > 1)
+		avg_jitter_us = st->sum_jitter_us / (int64_t)(st->completed - 1);
+
+	sr_info("USB transfers: %" PRIu64 " completed, %" PRIu64 " empty, "
+		"%" PRIu64 " late, %" PRIu64 " processed slower than realtime.",
+		st->completed, st->empty, st->late, st->slow);
+	sr_info("Completion jitter: avg %" PRId64 " us, max %" PRId64 " us. "
+		"Processing time: avg %" PRId64 " us, max %" PRId64 " us.",
+		avg_jitter_us, st->max_jitter_us,
+		st->sum_proc_us / (int64_t)st->completed, st->max_proc_us);
+	sr_info("Transfer layout: %u x %zu bytes, grown %u times.",
+		devc->num_transfers, devc->transfer_size, st->grown);
+}
+
 static void finish_acquisition(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -288,7 +379,15 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
-	usb_source_remove(sdi->session, devc->ctx);
+	report_transfer_stats(devc);
+
+	if (devc->usb_queue) {
+		usb_queue_free(devc->usb_queue);
+		devc->usb_queue = NULL;
+		usb_event_thread_stop(devc->ctx);
+	} else {
+		usb_source_remove(sdi->session, devc->ctx);
+	}
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
@@ -332,8 +431,24 @@ static void free_transfer(struct libusb_transfer *transfer)
 
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	unsigned char *buf;
 	int ret;
 
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	/* Pick up a grown transfer layout. */
+	if ((size_t)transfer->length < devc->transfer_size) {
+		buf = g_try_realloc(transfer->buffer, devc->transfer_size);
+		if (buf) {
+			transfer->buffer = buf;
+			transfer->length = devc->transfer_size;
+		}
+	}
+	transfer->timeout = devc->transfer_timeout;
+
 	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
@@ -411,64 +526,188 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+static struct libusb_transfer *new_transfer(const struct sr_dev_inst *sdi,
+	size_t size)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	gboolean packet_has_error = FALSE;
-	unsigned int num_samples;
-	int trigger_offset, cur_sample_count, unitsize, processed_samples;
-	int pre_trigger_samples;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	unsigned char *buf;
 
-	sdi = transfer->user_data;
 	devc = sdi->priv;
+	usb = sdi->conn;
 
-	/*
-	 * If acquisition has already ended, just free any queued up
-	 * transfer that come in.
-	 */
-	if (devc->acq_aborted) {
-		free_transfer(transfer);
-		return;
+	if (!(buf = g_try_malloc(size))) {
+		sr_err("USB transfer buffer malloc failed.");
+		return NULL;
 	}
+	transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(transfer, usb->devhdl,
+			2 | LIBUSB_ENDPOINT_IN, buf, size,
+			devc->usb_queue ? receive_transfer_threaded
+			: receive_transfer, (void *)sdi, devc->transfer_timeout);
 
-	sr_dbg("receive_transfer(): status %s received %d bytes.",
-		libusb_error_name(transfer->status), transfer->actual_length);
+	return transfer;
+}
 
-	/* Save incoming transfer before reusing the transfer struct. */
-	unitsize = devc->sample_wide ? 2 : 1;
-	cur_sample_count = transfer->actual_length / unitsize;
-	processed_samples = 0;
+static gboolean resize_mso_buffers(struct dev_context *devc, size_t size)
+{
+	uint8_t *logic_buffer;
+	float *analog_buffer;
 
-	switch (transfer->status) {
-	case LIBUSB_TRANSFER_NO_DEVICE:
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
+	logic_buffer = g_try_realloc(devc->logic_buffer, size / 2);
+	if (!logic_buffer)
+		return FALSE;
+	devc->logic_buffer = logic_buffer;
+
+	analog_buffer = g_try_realloc(devc->analog_buffer,
+		sizeof(float) * size / 2);
+	if (!analog_buffer)
+		return FALSE;
+	devc->analog_buffer = analog_buffer;
+
+	return TRUE;
+}
+
+/*
+ * Add transfers, and let the existing ones grow when they get
+ * resubmitted. Transfers complete in the order of submission, so
+ * the sample order is kept.
+ */
+static void grow_transfers(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct libusb_transfer **transfers, *transfer;
+	unsigned int i, prev_num_transfers, num_transfers;
+	size_t size;
+	int ret;
+
+	devc = sdi->priv;
+
+	/* Larger buffers would not fit the USB queue's buffer pool. */
+	size = devc->transfer_size;
+	if (!devc->usb_queue && size < MAX_ADAPTIVE_BUF_SIZE) {
+		size = MIN(2 * size, MAX_ADAPTIVE_BUF_SIZE);
+		if (devc->enabled_analog_channels
+				&& !resize_mso_buffers(devc, size))
+			size = devc->transfer_size;
+	}
+	num_transfers = devc->num_transfers + MAX(devc->num_transfers / 2, 1);
+	num_transfers = MIN(num_transfers, MAX_ADAPTIVE_TRANSFERS);
+	if (size == devc->transfer_size && num_transfers <= devc->num_transfers)
 		return;
-	case LIBUSB_TRANSFER_COMPLETED:
-	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
-		break;
-	default:
-		packet_has_error = TRUE;
-		break;
+
+	transfers = g_try_realloc(devc->transfers,
+		sizeof(*transfers) * num_transfers);
+	if (!transfers)
+		return;
+	devc->transfers = transfers;
+
+	prev_num_transfers = devc->num_transfers;
+	for (i = prev_num_transfers; i < num_transfers; i++)
+		transfers[i] = NULL;
+	devc->num_transfers = MAX(num_transfers, prev_num_transfers);
+	devc->transfer_size = size;
+	devc->transfer_timeout = get_layout_timeout(devc, size,
+		devc->num_transfers);
+
+	for (i = prev_num_transfers; i < num_transfers; i++) {
+		if (!(transfer = new_transfer(sdi, size)))
+			break;
+		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+			sr_warn("Failed to submit additional transfer: %s.",
+				libusb_error_name(ret));
+			g_free(transfer->buffer);
+			libusb_free_transfer(transfer);
+			break;
+		}
+		transfers[i] = transfer;
+		devc->submitted_transfers++;
 	}
 
-	if (transfer->actual_length == 0 || packet_has_error) {
-		devc->empty_transfer_count++;
-		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
-			/*
-			 * The FX2 gave up. End the acquisition, the frontend
-			 * will work out that the samplecount is short.
-			 */
-			fx2lafw_abort_acquisition(devc);
-			free_transfer(transfer);
-		} else {
-			resubmit_transfer(transfer);
+	devc->stats.grown++;
+	sr_dbg("Transfer layout grown to %u x %zu bytes.",
+		devc->num_transfers, devc->transfer_size);
+}
+
+/*
+ * Update the transfer statistics after a completed transfer was
+ * processed. In adaptive mode, grow the transfer layout when the
+ * session thread fell behind: the device returned no data, the gap
+ * between completions took half of the queued transfers' duration,
+ * or processing took a quarter of it.
+ */
+static void account_transfer(const struct sr_dev_inst *sdi,
+	int length, int64_t start_us)
+{
+	struct dev_context *devc;
+	struct transfer_stats *st;
+	int64_t proc_us, jitter_us, ring_us;
+	gboolean stalled;
+
+	devc = sdi->priv;
+	st = &devc->stats;
+
+	proc_us = g_get_monotonic_time() - start_us;
+	ring_us = buffer_duration_us(devc, devc->transfer_size)
+			* devc->num_transfers;
+	stalled = FALSE;
+
+	st->completed++;
+	if (length == 0) {
+		st->empty++;
+		stalled = TRUE;
+	}
+
+	st->sum_proc_us += proc_us;
+	st->max_proc_us = MAX(st->max_proc_us, proc_us);
+	if (length > 0 && proc_us > buffer_duration_us(devc, length))
+		st->slow++;
+	if (proc_us > ring_us / 4)
+		stalled = TRUE;
+
+	if (st->last_us) {
+		jitter_us = start_us - st->last_us
+				- buffer_duration_us(devc, length);
+		if (jitter_us < 0)
+			jitter_us = -jitter_us;
+		st->sum_jitter_us += jitter_us;
+		st->max_jitter_us = MAX(st->max_jitter_us, jitter_us);
+		if (start_us - st->last_us > ring_us / 2) {
+			st->late++;
+			stalled = TRUE;
 		}
-		return;
-	} else {
-		devc->empty_transfer_count = 0;
 	}
+	st->last_us = start_us;
+
+	/* Let a grown layout take effect before looking at it again. */
+	st->since_grown++;
+	if (!devc->adaptive_transfers || !stalled || devc->acq_aborted)
+		return;
+	if (st->since_grown < devc->num_transfers)
+		return;
+
+	st->since_grown = 0;
+	grow_transfers(sdi);
+}
+
+/*
+ * Send the samples of a filled transfer buffer to the session bus.
+ * Returns FALSE when the acquisition is complete.
+ */
+static gboolean process_samples(struct sr_dev_inst *sdi,
+	uint8_t *buffer, int length)
+{
+	struct dev_context *devc;
+	unsigned int num_samples;
+	int trigger_offset, cur_sample_count, unitsize, processed_samples;
+	int pre_trigger_samples;
+
+	devc = sdi->priv;
+
+	unitsize = devc->sample_wide ? 2 : 1;
+	cur_sample_count = length / unitsize;
+	processed_samples = 0;
 
 check_trigger:
 	if (devc->trigger_fired) {
@@ -478,15 +717,15 @@ check_trigger:
 			if (devc->limit_samples && devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer + processed_samples * unitsize,
+			devc->send_data_proc(sdi, buffer + processed_samples * unitsize,
 				num_samples * unitsize, unitsize);
 			devc->sent_samples += num_samples;
 			processed_samples += num_samples;
 		}
 	} else {
 		trigger_offset = soft_trigger_logic_check(devc->stl,
-			transfer->buffer + processed_samples * unitsize,
-			transfer->actual_length - processed_samples * unitsize,
+			buffer + processed_samples * unitsize,
+			length - processed_samples * unitsize,
 			&pre_trigger_samples);
 		if (trigger_offset > -1) {
 			std_session_send_df_frame_begin(sdi);
@@ -496,7 +735,7 @@ check_trigger:
 					devc->sent_samples + num_samples > devc->limit_samples)
 				num_samples = devc->limit_samples - devc->sent_samples;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer
+			devc->send_data_proc(sdi, buffer
 					+ processed_samples * unitsize
 					+ trigger_offset * unitsize,
 					num_samples * unitsize, unitsize);
@@ -529,11 +768,116 @@ check_trigger:
 				goto check_trigger;
 		}
 	}
-	if (frame_ended && final_frame) {
+
+	return !(frame_ended && final_frame);
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	gboolean packet_has_error = FALSE;
+	int64_t start_us;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	/*
+	 * If acquisition has already ended, just free any queued up
+	 * transfer that come in.
+	 */
+	if (devc->acq_aborted) {
+		free_transfer(transfer);
+		return;
+	}
+
+	start_us = g_get_monotonic_time();
+
+	sr_dbg("receive_transfer(): status %s received %d bytes.",
+		libusb_error_name(transfer->status), transfer->actual_length);
+
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		fx2lafw_abort_acquisition(devc);
+		free_transfer(transfer);
+		return;
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
+		break;
+	default:
+		packet_has_error = TRUE;
+		break;
+	}
+
+	if (transfer->actual_length == 0 || packet_has_error) {
+		devc->empty_transfer_count++;
+		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
+			/*
+			 * The FX2 gave up. End the acquisition, the frontend
+			 * will work out that the samplecount is short.
+			 */
+			fx2lafw_abort_acquisition(devc);
+			free_transfer(transfer);
+		} else {
+			account_transfer(sdi, 0, start_us);
+			resubmit_transfer(transfer);
+		}
+		return;
+	} else {
+		devc->empty_transfer_count = 0;
+	}
+
+	if (!process_samples(sdi, transfer->buffer, transfer->actual_length)) {
 		fx2lafw_abort_acquisition(devc);
 		free_transfer(transfer);
-	} else
+	} else {
+		account_transfer(sdi, transfer->actual_length, start_us);
 		resubmit_transfer(transfer);
+	}
+}
+
+/*
+ * Transfer callback in the USB event thread. The USB queue resubmits
+ * successful transfers itself and passes the data to receive_queued().
+ */
+static void LIBUSB_CALL receive_transfer_threaded(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	usb_queue_push(devc->usb_queue, transfer);
+}
+
+static void receive_queued(struct libusb_transfer *transfer,
+	uint8_t *data, int length, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	int64_t start_us;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	/* Transfers which were not resubmitted take the regular path. */
+	if (transfer) {
+		receive_transfer(transfer);
+		return;
+	}
+
+	if (devc->acq_aborted)
+		return;
+
+	sr_dbg("receive_queued(): received %d bytes.", length);
+
+	start_us = g_get_monotonic_time();
+	devc->empty_transfer_count = 0;
+	if (!process_samples(sdi, data, length))
+		fx2lafw_abort_acquisition(devc);
+	else
+		account_transfer(sdi, length, start_us);
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -570,48 +914,6 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static unsigned int to_bytes_per_ms(unsigned int samplerate)
-{
-	return samplerate / 1000;
-}
-
-static size_t get_buffer_size(struct dev_context *devc)
-{
-	size_t s;
-
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
-	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
-
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
-
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
-
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
-}
-
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct timeval tv;
@@ -631,16 +933,13 @@ static int receive_data(int fd, int revents, void *cb_data)
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_usb_dev_inst *usb;
 	struct sr_trigger *trigger;
 	struct libusb_transfer *transfer;
 	unsigned int i, num_transfers;
-	int timeout, ret;
-	unsigned char *buf;
+	int ret;
 	size_t size;
 
 	devc = sdi->priv;
-	usb = sdi->conn;
 
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
@@ -670,23 +969,19 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		return SR_ERR_MALLOC;
 	}
 
-	timeout = get_timeout(devc);
+	memset(&devc->stats, 0, sizeof(devc->stats));
+	devc->transfer_size = size;
+	devc->transfer_timeout = get_timeout(devc);
 	devc->num_transfers = num_transfers;
 	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
+		if (!(transfer = new_transfer(sdi, size)))
 			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
 		sr_info("submitting transfer: %d", i);
 		if ((ret = libusb_submit_transfer(transfer)) != 0) {
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
+			g_free(transfer->buffer);
 			libusb_free_transfer(transfer);
-			g_free(buf);
 			fx2lafw_abort_acquisition(devc);
 			return SR_ERR;
 		}
@@ -732,10 +1027,29 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
-
 	size = get_buffer_size(devc);
+	devc->usb_queue = NULL;
+	if (devc->usb_event_thread) {
+		ret = usb_event_thread_start(devc->ctx);
+		if (ret == SR_OK) {
+			devc->usb_queue = usb_queue_new(sdi->session, size,
+				receive_queued, (void *)sdi);
+			if (!devc->usb_queue) {
+				usb_event_thread_stop(devc->ctx);
+				return SR_ERR;
+			}
+		} else if (ret == SR_ERR_NA) {
+			sr_warn("USB event thread not available, using the main loop.");
+		} else {
+			return ret;
+		}
+	}
+	if (!devc->usb_queue) {
+		timeout = get_timeout(devc);
+		usb_source_add(sdi->session, devc->ctx, timeout,
+			receive_data, drvc);
+	}
+
 	/* Prepare for analog sampling. */
 	if (g_slist_length(devc->enabled_analog_channels) > 0) {
 		/* We need a buffer half the size of a transfer. */
@@ -39,6 +39,10 @@
 #define NUM_SIMUL_TRANSFERS	32
 #define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
+/* Limits of the adaptive transfer layout. */
+#define MAX_ADAPTIVE_TRANSFERS	(NUM_SIMUL_TRANSFERS * 4)
+#define MAX_ADAPTIVE_BUF_SIZE	(1024 * 1024)
+
 #define NUM_CHANNELS		16
 
 #define FX2LAFW_REQUIRED_VERSION_MAJOR	1
@@ -87,6 +91,21 @@ struct fx2lafw_profile {
 	const char *usb_product;
 };
 
+/* Transfer statistics, reported at the end of the acquisition. */
+struct transfer_stats {
+	uint64_t completed;
+	uint64_t empty;
+	uint64_t late;
+	uint64_t slow;
+	unsigned int grown;
+	unsigned int since_grown;
+	int64_t last_us;
+	int64_t sum_jitter_us;
+	int64_t max_jitter_us;
+	int64_t sum_proc_us;
+	int64_t max_proc_us;
+};
+
 struct dev_context {
 	const struct fx2lafw_profile *profile;
 	char **channel_names;
@@ -119,7 +138,13 @@ struct dev_context {
 
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+	size_t transfer_size;
+	unsigned int transfer_timeout;
+	gboolean adaptive_transfers;
+	struct transfer_stats stats;
 	struct sr_context *ctx;
+	gboolean usb_event_thread;
+	struct usb_queue *usb_queue;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
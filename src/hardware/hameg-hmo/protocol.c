@@ -1463,6 +1463,39 @@ SR_PRIV void hmo_cleanup_logic_data(struct dev_context *devc)
 	 */
 }
 
+/* Pass on a chunk of a single pod's logic data while it is received. */
+static int hmo_send_logic_chunk(const uint8_t *data, size_t len, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t count;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	/* Truncate acquisition if a smaller number of samples has been requested. */
+	count = len;
+	if (devc->samples_limit > 0) {
+		if (devc->num_samples >= devc->samples_limit)
+			count = 0;
+		else if (count > devc->samples_limit - devc->num_samples)
+			count = devc->samples_limit - devc->num_samples;
+	}
+	devc->num_samples += len;
+	if (!count)
+		return SR_OK;
+
+	packet.type = SR_DF_LOGIC;
+	logic.data = (void *)data;
+	logic.length = count;
+	logic.unitsize = 1;
+	packet.payload = &logic;
+
+	return sr_session_send(sdi, &packet);
+}
+
 SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_channel *ch;
@@ -1475,7 +1508,6 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	struct sr_datafeed_logic logic;
 	size_t group;
 
 	(void)fd;
@@ -1497,6 +1529,14 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	ch = devc->current_channel->data;
 	state = devc->model_state;
 
+	/*
+	 * Waveform data is received into a buffer which is kept across
+	 * channels and frames, and only grows when a larger block arrives.
+	 */
+	if (!devc->block)
+		devc->block = g_byte_array_new();
+	data = devc->block;
+
 	/*
 	 * Send "frame begin" packet upon reception of data for the
 	 * first enabled channel.
@@ -1509,12 +1549,8 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	 */
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
+		if (sr_scpi_get_block_into(sdi->conn, NULL, data, NULL, NULL) != SR_OK)
 			return TRUE;
-		}
 
 		packet.type = SR_DF_ANALOG;
 
@@ -1538,21 +1574,13 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		sr_session_send(sdi, &packet);
 		devc->num_samples = data->len / sizeof(float);
 		g_slist_free(meaning.channels);
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	case SR_CHANNEL_LOGIC:
-		data = NULL;
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-			return TRUE;
-		}
-
 		/*
 		 * If only data from the first pod is involved in the
 		 * acquisition, then the raw input bytes can get passed
-		 * forward for performance reasons. When the second pod
+		 * forward for performance reasons, chunk by chunk while
+		 * the block is being received. When the second pod
 		 * is involved (either alone, or in combination with the
 		 * first pod), then the received bytes need to be put
 		 * into memory in such a layout that all channel groups
@@ -1563,23 +1591,19 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		 * above for analog data.
 		 */
 		if (devc->pod_count == 1) {
-			packet.type = SR_DF_LOGIC;
-			logic.data = data->data;
-			logic.length = data->len;
-			/* Truncate acquisition if a smaller number of samples has been requested. */
-			if (devc->samples_limit > 0 && logic.length > devc->samples_limit)
-				logic.length = devc->samples_limit;
-			logic.unitsize = 1;
-			packet.payload = &logic;
-			sr_session_send(sdi, &packet);
+			devc->num_samples = 0;
+			if (sr_scpi_get_block_into(sdi->conn, NULL, data,
+					hmo_send_logic_chunk, sdi) != SR_OK)
+				return TRUE;
 		} else {
+			if (sr_scpi_get_block_into(sdi->conn, NULL, data,
+					NULL, NULL) != SR_OK)
+				return TRUE;
 			group = ch->index / DIGITAL_CHANNELS_PER_POD;
 			hmo_queue_logic_data(devc, group, data);
 		}
 
 		devc->num_samples = data->len / devc->pod_count;
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	default:
 		sr_err("Invalid channel type.");
@@ -131,6 +131,7 @@ struct dev_context {
 
 	size_t pod_count;
 	GByteArray *logic_data;
+	GByteArray *block;
 };
 
 SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi);
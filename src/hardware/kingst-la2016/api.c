@@ -1070,7 +1070,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			return SR_ERR_ARG;
 		}
 		devc->feed_queue = feed_queue_logic_alloc(sdi,
-			LA2016_CONVBUFFER_SIZE, unitsize);
+			0, unitsize);
 		if (!devc->feed_queue) {
 			sr_err("Cannot allocate buffer for session feed.");
 			return SR_ERR_MALLOC;
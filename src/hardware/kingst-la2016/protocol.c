@@ -581,9 +581,11 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 			continue;
 		channel_mask = 1UL << ch->index;
 		stream->enabled_mask |= channel_mask;
-		stream->channel_masks[stream->enabled_count++] = channel_mask;
+		stream->channel_rows[stream->enabled_count++] = ch->index;
 	}
 	stream->channel_index = 0;
+	stream->unitsize = devc->model->channel_count > 16 ?
+		sizeof(uint32_t) : sizeof(uint16_t);
 }
 
 /*
@@ -1322,6 +1324,9 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Number of runs which get submitted to the session feed at once. */
+#define SEND_CHUNK_RUNS	64
+
 /*
  * A chunk of sample memory was received via USB. These chunks contain
  * transfers of 16 or 32 bytes each (model dependent size and layout).
@@ -1351,7 +1356,10 @@ static void send_chunk(struct sr_dev_inst *sdi,
 	const uint8_t *rp;
 	uint32_t sample_value;
 	size_t repetitions;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint8_t run_values[SEND_CHUNK_RUNS * sizeof(sample_value)];
+	size_t run_counts[SEND_CHUNK_RUNS];
+	uint8_t *wp;
+	size_t run_count;
 
 	devc = sdi->priv;
 
@@ -1374,30 +1382,47 @@ static void send_chunk(struct sr_dev_inst *sdi,
 	else
 		devc->n_bytes_to_read -= data_length;
 
-	/* Process the received chunk of capture data. */
+	/*
+	 * Process the received chunk of capture data. Collect runs
+	 * and submit them in batches. Pending runs get submitted
+	 * before the trigger marker.
+	 */
 	sample_value = 0;
 	rp = data_buffer;
+	wp = run_values;
+	run_count = 0;
 	num_xfers = data_length / devc->transfer_size;
 	while (num_xfers--) {
 		num_pkts = devc->packets_per_chunk;
 		while (num_pkts--) {
 
-			if (devc->model->channel_count == 32)
+			if (devc->model->channel_count == 32) {
 				sample_value = read_u32le_inc(&rp);
-			else if (devc->model->channel_count == 16)
+				write_u32le_inc(&wp, sample_value);
+			} else if (devc->model->channel_count == 16) {
 				sample_value = read_u16le_inc(&rp);
+				write_u16le_inc(&wp, sample_value);
+			}
 			repetitions = read_u8_inc(&rp);
+			run_counts[run_count++] = repetitions;
 
 			devc->total_samples += repetitions;
-
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, repetitions);
 			sr_sw_limits_update_samples_read(&devc->sw_limits,
 				repetitions);
 
+			if (run_count == SEND_CHUNK_RUNS) {
+				feed_queue_logic_submit_runs(devc->feed_queue,
+					run_values, run_counts, run_count);
+				wp = run_values;
+				run_count = 0;
+			}
+
 			if (devc->trigger_involved && !devc->trigger_marked) {
 				if (!--devc->n_reps_until_trigger) {
+					feed_queue_logic_submit_runs(devc->feed_queue,
+						run_values, run_counts, run_count);
+					wp = run_values;
+					run_count = 0;
 					feed_queue_logic_send_trigger(devc->feed_queue);
 					devc->trigger_marked = TRUE;
 					sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
@@ -1411,6 +1436,8 @@ static void send_chunk(struct sr_dev_inst *sdi,
 		while (num_seqs--)
 			(void)read_u8_inc(&rp);
 	}
+	feed_queue_logic_submit_runs(devc->feed_queue,
+		run_values, run_counts, run_count);
 
 	/*
 	 * Check for several conditions which shall terminate the
@@ -1452,11 +1479,15 @@ static void send_chunk(struct sr_dev_inst *sdi,
  * Implementor's note: This routine is inspired by convert_sample_data()
  * in the https://github.com/AlexUg/sigrok implementation. Which in turn
  * appears to have been derived from the saleae-logic16 sigrok driver.
- * The code is phrased conservatively to verify the layout as discussed
- * above, performance was not a priority. Operation was verified with an
- * LA2016 device. The LA5032 reportedly shares the 16 samples per channel
- * layout, just round-robins through a potentially larger set of enabled
- * channels before returning to the first of the channels.
+ * Operation was verified with an LA2016 device. The LA5032 reportedly
+ * shares the 16 samples per channel layout, just round-robins through
+ * a potentially larger set of enabled channels before returning to the
+ * first of the channels.
+ *
+ * Each channel's entity is kept in the bit matrix row of the channel's
+ * number (rows of disabled channels remain zero). Transposing the matrix
+ * after all enabled channels were seen yields one row per sample point,
+ * the first sample in the first row.
  */
 static void stream_data(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
@@ -1465,10 +1496,10 @@ static void stream_data(struct sr_dev_inst *sdi,
 	struct stream_state_t *stream;
 	size_t bit_count;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint32_t sample_data[32];
+	uint8_t sample_buff[16 * sizeof(uint32_t)];
+	uint8_t *wp;
 	size_t bit_idx;
-	uint32_t ch_mask;
 
 	devc = sdi->priv;
 	stream = &devc->stream;
@@ -1486,17 +1517,10 @@ static void stream_data(struct sr_dev_inst *sdi,
 	data_length /= sizeof(uint16_t);
 
 	rp = data_buffer;
-	sample_value = 0;
 	while (data_length--) {
-		/* Get another entity. */
-		sample_value = read_u16le_inc(&rp);
-
-		/* Map the entity's bits to a channel's samples. */
-		ch_mask = stream->channel_masks[stream->channel_index];
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			if (sample_value & (1UL << bit_idx))
-				stream->sample_data[bit_idx] |= ch_mask;
-		}
+		/* Get another entity, keep it in the channel's row. */
+		stream->channel_data[stream->channel_rows[stream->channel_index]] =
+			read_u16le_inc(&rp);
 
 		/*
 		 * Advance to the next channel. Submit a block of
@@ -1505,15 +1529,18 @@ static void stream_data(struct sr_dev_inst *sdi,
 		stream->channel_index++;
 		if (stream->channel_index != stream->enabled_count)
 			continue;
+		sr_transpose_bits32(sample_data, stream->channel_data);
+		wp = sample_buff;
 		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, 1);
+			if (stream->unitsize == sizeof(uint32_t))
+				write_u32le_inc(&wp, sample_data[bit_idx]);
+			else
+				write_u16le_inc(&wp, sample_data[bit_idx]);
 		}
+		feed_queue_logic_submit_many(devc->feed_queue,
+			sample_buff, bit_count);
 		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
 		devc->total_samples += bit_count;
-		memset(stream->sample_data, 0, sizeof(stream->sample_data));
 		stream->channel_index = 0;
 	}
 
@@ -639,12 +639,12 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	if (ch->type != SR_CHANNEL_ANALOG)
 		return SR_ERR;
 
-	data = NULL;
-	if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-		if (data)
-			g_byte_array_free(data, TRUE);
+	/* Re-use the receive buffer across channels and frames. */
+	if (!devc->block)
+		devc->block = g_byte_array_new();
+	data = devc->block;
+	if (sr_scpi_get_block_into(sdi->conn, NULL, data, NULL, NULL) != SR_OK)
 		return TRUE;
-	}
 
 	analog.encoding = &encoding;
 	analog.meaning = &meaning;
@@ -655,7 +655,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 
 	if (analog.num_samples == 0) {
 		g_free(analog.data);
-		g_byte_array_free(data, TRUE);
 
 		/* No data available, we have to acquire data first. */
 		g_snprintf(command, sizeof(command), "ARM;WAIT;*OPC;C%d:WAVEFORM?", ch->index + 1);
@@ -668,7 +667,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 		if (state->sample_rate == 0)
 			if (lecroy_xstream_update_sample_rate(sdi, analog.num_samples) != SR_OK) {
 				g_free(analog.data);
-				g_byte_array_free(data, TRUE);
 				return SR_ERR;
 			}
 	}
@@ -685,9 +683,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	packet.type = SR_DF_ANALOG;
 	sr_session_send(sdi, &packet);
 
-	g_byte_array_free(data, TRUE);
-	data = NULL;
-
 	g_slist_free(meaning.channels);
 	g_free(analog.data);
 
@@ -88,6 +88,7 @@ struct dev_context {
 	uint64_t num_frames;
 
 	uint64_t frame_limit;
+	GByteArray *block;
 };
 
 SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi);
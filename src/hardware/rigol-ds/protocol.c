@@ -856,128 +856,172 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
+/*
+ * The DS1000 and VS5000 predate IEEE 488.2 compound queries, all later
+ * series accept them. Either way the device's reply is checked, a batch
+ * falls back to one query per round trip if the count doesn't match.
+ */
+static struct sr_scpi_batch *rigol_ds_batch_new(const struct dev_context *devc)
+{
+	if (devc->model->series->protocol >= PROTOCOL_V3)
+		return sr_scpi_batch_new(SCPI_BATCH_JOINED);
+
+	return sr_scpi_batch_new(SCPI_BATCH_SEQUENTIAL);
+}
+
+static void rigol_ds_queue_vertical(struct dev_context *devc,
+		struct sr_scpi_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_scpi_batch_get_float(batch, &devc->vdiv[i],
+			":CHAN%d:SCAL?", i + 1);
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_scpi_batch_get_float(batch, &devc->vert_offset[i],
+			":CHAN%d:OFFS?", i + 1);
+}
+
+static void rigol_ds_log_vertical(const struct dev_context *devc)
+{
+	unsigned int i;
+
+	sr_dbg("Current vertical gain:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %g", i + 1, devc->vdiv[i]);
+	sr_dbg("Current vertical offset:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %g", i + 1, devc->vert_offset[i]);
+}
+
 SR_PRIV int rigol_ds_get_dev_cfg(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_channel *ch;
-	char *cmd;
+	struct sr_scpi_batch *batch;
+	char *probe[MAX_ANALOG_CHANNELS];
 	unsigned int i;
-	int res;
+	int len, res;
 
 	devc = sdi->priv;
 
+	/*
+	 * Queue all queries first, so that the configuration readback
+	 * takes few round trips instead of one per setting.
+	 */
+	batch = rigol_ds_batch_new(devc);
+
 	/* Analog channel state. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:DISP?", i + 1);
-		res = sr_scpi_get_bool(sdi->conn, cmd, &devc->analog_channels[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-		ch = g_slist_nth_data(sdi->channels, i);
-		ch->enabled = devc->analog_channels[i];
-	}
-	sr_dbg("Current analog channel state:");
 	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %s", i + 1, devc->analog_channels[i] ? "on" : "off");
+		sr_scpi_batch_get_bool(batch, &devc->analog_channels[i],
+			":CHAN%d:DISP?", i + 1);
 
 	/* Digital channel state. */
 	if (devc->model->has_digital) {
-		if (sr_scpi_get_bool(sdi->conn,
-				devc->model->series->protocol >= PROTOCOL_V3 ?
-					":LA:STAT?" : ":LA:DISP?",
-				&devc->la_enabled) != SR_OK)
-			return SR_ERR;
-		sr_dbg("Logic analyzer %s, current digital channel state:",
-				devc->la_enabled ? "enabled" : "disabled");
+		sr_scpi_batch_get_bool(batch, &devc->la_enabled, "%s",
+			devc->model->series->protocol >= PROTOCOL_V3 ?
+				":LA:STAT?" : ":LA:DISP?");
 		for (i = 0; i < ARRAY_SIZE(devc->digital_channels); i++) {
 			if (devc->model->series->protocol >= PROTOCOL_V5)
-				cmd = g_strdup_printf(":LA:DISP? D%d", i);
+				sr_scpi_batch_get_bool(batch,
+					&devc->digital_channels[i],
+					":LA:DISP? D%d", i);
 			else if (devc->model->series->protocol >= PROTOCOL_V3)
-				cmd = g_strdup_printf(":LA:DIG%d:DISP?", i);
+				sr_scpi_batch_get_bool(batch,
+					&devc->digital_channels[i],
+					":LA:DIG%d:DISP?", i);
 			else
-				cmd = g_strdup_printf(":DIG%d:TURN?", i);
-			res = sr_scpi_get_bool(sdi->conn, cmd, &devc->digital_channels[i]);
-			g_free(cmd);
-			if (res != SR_OK)
-				return SR_ERR;
-			ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
-			ch->enabled = devc->digital_channels[i];
-			sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "on" : "off");
+				sr_scpi_batch_get_bool(batch,
+					&devc->digital_channels[i],
+					":DIG%d:TURN?", i);
 		}
 	}
 
 	/* Timebase. */
-	if (sr_scpi_get_float(sdi->conn, ":TIM:SCAL?", &devc->timebase) != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current timebase %g", devc->timebase);
+	sr_scpi_batch_get_float(batch, &devc->timebase, ":TIM:SCAL?");
 
-	/* Probe attenuation. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:PROB?", i + 1);
-
-		/* DSO1000B series prints an X after the probe factor, so
-		 * we get a string and check for that instead of only handling
-		 * floats. */
-		char *response;
-		res = sr_scpi_get_string(sdi->conn, cmd, &response);
-		if (res != SR_OK)
-			return SR_ERR;
-
-		int len = strlen(response);
-		if (response[len-1] == 'X')
-			response[len-1] = 0;
-
-		res = sr_atof_ascii(response, &devc->attenuation[i]);
-		g_free(response);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
-	sr_dbg("Current probe attenuation:");
+	/*
+	 * Probe attenuation. DSO1000B series prints an X after the probe
+	 * factor, so we get a string and check for that instead of only
+	 * handling floats.
+	 */
 	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %g", i + 1, devc->attenuation[i]);
+		sr_scpi_batch_get_string(batch, &probe[i],
+			":CHAN%d:PROB?", i + 1);
 
 	/* Vertical gain and offset. */
-	if (rigol_ds_get_dev_cfg_vertical(sdi) != SR_OK)
-		return SR_ERR;
+	rigol_ds_queue_vertical(devc, batch);
 
 	/* Coupling. */
 	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:COUP?", i + 1);
 		g_free(devc->coupling[i]);
-		devc->coupling[i] = NULL;
-		res = sr_scpi_get_string(sdi->conn, cmd, &devc->coupling[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_get_string(batch, &devc->coupling[i],
+			":CHAN%d:COUP?", i + 1);
 	}
-	sr_dbg("Current coupling:");
-	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %s", i + 1, devc->coupling[i]);
 
 	/* Trigger source. */
 	g_free(devc->trigger_source);
-	devc->trigger_source = NULL;
-	if (sr_scpi_get_string(sdi->conn, ":TRIG:EDGE:SOUR?", &devc->trigger_source) != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current trigger source %s", devc->trigger_source);
+	sr_scpi_batch_get_string(batch, &devc->trigger_source,
+		":TRIG:EDGE:SOUR?");
 
 	/* Horizontal trigger position. */
-	if (sr_scpi_get_float(sdi->conn, devc->model->cmds[CMD_GET_HORIZ_TRIGGERPOS].str,
-			&devc->horiz_triggerpos) != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current horizontal trigger position %g", devc->horiz_triggerpos);
+	sr_scpi_batch_get_float(batch, &devc->horiz_triggerpos, "%s",
+		devc->model->cmds[CMD_GET_HORIZ_TRIGGERPOS].str);
 
 	/* Trigger slope. */
 	g_free(devc->trigger_slope);
-	devc->trigger_slope = NULL;
-	if (sr_scpi_get_string(sdi->conn, ":TRIG:EDGE:SLOP?", &devc->trigger_slope) != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current trigger slope %s", devc->trigger_slope);
+	sr_scpi_batch_get_string(batch, &devc->trigger_slope,
+		":TRIG:EDGE:SLOP?");
 
 	/* Trigger level. */
-	if (sr_scpi_get_float(sdi->conn, ":TRIG:EDGE:LEV?", &devc->trigger_level) != SR_OK)
+	sr_scpi_batch_get_float(batch, &devc->trigger_level, ":TRIG:EDGE:LEV?");
+
+	res = sr_scpi_batch_run(sdi->conn, batch);
+	sr_scpi_batch_free(batch);
+
+	for (i = 0; res == SR_OK && i < devc->model->analog_channels; i++) {
+		len = strlen(probe[i]);
+		if (len > 0 && probe[i][len - 1] == 'X')
+			probe[i][len - 1] = 0;
+		res = sr_atof_ascii(probe[i], &devc->attenuation[i]);
+	}
+	for (i = 0; i < devc->model->analog_channels; i++)
+		g_free(probe[i]);
+	if (res != SR_OK)
 		return SR_ERR;
+
+	sr_dbg("Current analog channel state:");
+	for (i = 0; i < devc->model->analog_channels; i++) {
+		ch = g_slist_nth_data(sdi->channels, i);
+		ch->enabled = devc->analog_channels[i];
+		sr_dbg("CH%d %s", i + 1, devc->analog_channels[i] ? "on" : "off");
+	}
+
+	if (devc->model->has_digital) {
+		sr_dbg("Logic analyzer %s, current digital channel state:",
+				devc->la_enabled ? "enabled" : "disabled");
+		for (i = 0; i < ARRAY_SIZE(devc->digital_channels); i++) {
+			ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
+			ch->enabled = devc->digital_channels[i];
+			sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "on" : "off");
+		}
+	}
+
+	sr_dbg("Current timebase %g", devc->timebase);
+
+	sr_dbg("Current probe attenuation:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %g", i + 1, devc->attenuation[i]);
+
+	rigol_ds_log_vertical(devc);
+
+	sr_dbg("Current coupling:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %s", i + 1, devc->coupling[i]);
+
+	sr_dbg("Current trigger source %s", devc->trigger_source);
+	sr_dbg("Current horizontal trigger position %g", devc->horiz_triggerpos);
+	sr_dbg("Current trigger slope %s", devc->trigger_slope);
 	sr_dbg("Current trigger level %g", devc->trigger_level);
 
 	return SR_OK;
@@ -986,35 +1030,19 @@ SR_PRIV int rigol_ds_get_dev_cfg(const struct sr_dev_inst *sdi)
 SR_PRIV int rigol_ds_get_dev_cfg_vertical(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	char *cmd;
-	unsigned int i;
+	struct sr_scpi_batch *batch;
 	int res;
 
 	devc = sdi->priv;
 
-	/* Vertical gain. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:SCAL?", i + 1);
-		res = sr_scpi_get_float(sdi->conn, cmd, &devc->vdiv[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
-	sr_dbg("Current vertical gain:");
-	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %g", i + 1, devc->vdiv[i]);
+	batch = rigol_ds_batch_new(devc);
+	rigol_ds_queue_vertical(devc, batch);
+	res = sr_scpi_batch_run(sdi->conn, batch);
+	sr_scpi_batch_free(batch);
+	if (res != SR_OK)
+		return SR_ERR;
 
-	/* Vertical offset. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf(":CHAN%d:OFFS?", i + 1);
-		res = sr_scpi_get_float(sdi->conn, cmd, &devc->vert_offset[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
-	sr_dbg("Current vertical offset:");
-	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %g", i + 1, devc->vert_offset[i]);
+	rigol_ds_log_vertical(devc);
 
 	return SR_OK;
 }
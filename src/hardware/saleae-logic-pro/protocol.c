@@ -578,7 +578,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 			continue;
 
 		mask = 1 << c->index;
-		devc->dig_channel_masks[devc->dig_channel_cnt++] = mask;
+		devc->dig_channel_rows[devc->dig_channel_cnt++] = c->index;
 		devc->dig_channel_mask |= mask;
 
 	}
@@ -797,6 +797,7 @@ SR_PRIV int saleae_logic_pro_start(const struct sr_dev_inst *sdi)
 
 	devc->conv_size = 0;
 	devc->batch_index = 0;
+	memset(devc->batch_rows, 0, sizeof(devc->batch_rows));
 
 	write_reg(sdi, 0x00, 0x01);
 
@@ -844,42 +845,33 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
 /*
  * One batch from the device consists of 32 samples per active digital channel.
  * This stream of batches is packed into USB packets with 16384 bytes each.
+ *
+ * Each channel's word goes to the bit matrix row of its channel number,
+ * rows of disabled channels remain zero. The transposed matrix has the
+ * samples in its rows, the first sample (MSB) in the last row.
  */
 static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
 					 const uint32_t *src, size_t srccnt)
 {
 	struct dev_context *devc = sdi->priv;
-	uint8_t *dst = devc->conv_buffer;
-	uint32_t samples;
-	uint16_t channel_mask;
+	uint16_t *dst = (uint16_t *)devc->conv_buffer;
+	uint32_t samples[32];
 	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
 
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
 	/* Reset converted size. */
 	devc->conv_size = 0;
 
 	batch_index = devc->batch_index;
 	while (srccnt--) {
-		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
-
-		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
+		devc->batch_rows[devc->dig_channel_rows[batch_index]] = *src++;
 
 		/* Last index of the batch. */
 		if (++batch_index == devc->dig_channel_cnt) {
+			sr_transpose_bits32(samples, devc->batch_rows);
+			for (sample_index = 0; sample_index < 32; sample_index++)
+				*dst++ = samples[31 - sample_index];
 			devc->conv_size += CONV_BATCH_SIZE;
 			batch_index = 0;
-			dst += CONV_BATCH_SIZE;
 		}
 	}
 	devc->batch_index = batch_index;
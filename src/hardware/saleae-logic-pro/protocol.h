@@ -31,15 +31,15 @@
 #define CONV_BATCH_SIZE (2 * 32)
 
 /*
- * One packet + one partial conversion: Worst case is only one active
- * channel converted to 2 bytes per sample, with 8 * 16384 samples per packet.
+ * One packet's conversion: Worst case is only one active channel
+ * converted to 2 bytes per sample, with 8 * 16384 samples per packet.
  */
-#define CONV_BUFFER_SIZE (2 * 8 * 16384 + CONV_BATCH_SIZE)
+#define CONV_BUFFER_SIZE (2 * 8 * 16384)
 
 struct dev_context {
 	unsigned int dig_channel_cnt;
 	uint16_t dig_channel_mask;
-	uint16_t dig_channel_masks[16];
+	uint8_t dig_channel_rows[16];
 	uint64_t dig_samplerate;
 
 	uint32_t lfsr;
@@ -51,6 +51,7 @@ struct dev_context {
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
 	unsigned int batch_index;
+	uint32_t batch_rows[32];
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
@@ -585,10 +585,10 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		 * To speed things up during conversion, do the switcharoo
 		 * here instead.
 		 */
-		channel_bit = 1 << (ch->index ^ 8);
+		devc->channel_rows[devc->num_channels++] = ch->index ^ 8;
+#else
+		devc->channel_rows[devc->num_channels++] = ch->index;
 #endif
-
-		devc->channel_masks[devc->num_channels++] = channel_bit;
 	}
 
 	return SR_OK;
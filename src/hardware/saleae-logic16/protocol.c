@@ -803,13 +803,19 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 }
 
+/*
+ * Each 16bit word carries 16 samples of one channel, the first sample
+ * in the most significant bit. Collect one word per enabled channel in
+ * the bit matrix row of that channel, then transpose the matrix to get
+ * the samples. Rows of disabled channels remain zero.
+ */
 static size_t convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
 	uint16_t *channel_data;
+	uint16_t samples[16], output[16];
 	int i, cur_channel;
 	size_t ret = 0;
-	uint16_t sample, channel_mask;
 
 	srccnt /= 2;
 
@@ -817,23 +823,20 @@ static size_t convert_sample_data(struct dev_context *devc,
 	cur_channel = devc->cur_channel;
 
 	while (srccnt--) {
-		sample = src[0] | (src[1] << 8);
+		channel_data[devc->channel_rows[cur_channel]] =
+			src[0] | (src[1] << 8);
 		src += 2;
 
-		channel_mask = devc->channel_masks[cur_channel];
-
-		for (i = 15; i >= 0; --i, sample >>= 1)
-			if (sample & 1)
-				channel_data[i] |= channel_mask;
-
 		if (++cur_channel == devc->num_channels) {
 			cur_channel = 0;
 			if (destcnt < 16 * 2) {
 				sr_err("Conversion buffer too small!");
 				break;
 			}
-			memcpy(dest, channel_data, 16 * 2);
-			memset(channel_data, 0, 16 * 2);
+			sr_transpose_bits16(samples, channel_data);
+			for (i = 0; i < 16; i++)
+				output[i] = samples[15 - i];
+			memcpy(dest, output, 16 * 2);
 			dest += 16 * 2;
 			ret += 16;
 			destcnt -= 16 * 2;
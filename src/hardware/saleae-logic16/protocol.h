@@ -79,7 +79,7 @@ struct dev_context {
 	int empty_transfer_count;
 	int num_channels;
 	int cur_channel;
-	uint16_t channel_masks[16];
+	uint8_t channel_rows[16];
 	uint16_t channel_data[16];
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
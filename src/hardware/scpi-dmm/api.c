@@ -48,6 +48,11 @@ static const uint32_t devopts_generic_range[] = {
 	SR_CONF_RANGE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
+/* Under autorange the meter reports its present range, don't cache it. */
+static const uint32_t uncached_keys[] = {
+	SR_CONF_RANGE,
+};
+
 static const struct scpi_command cmdset_agilent[] = {
 	{ DMM_CMD_SETUP_REMOTE, "\n", },
 	{ DMM_CMD_SETUP_LOCAL, "SYST:LOC", },
@@ -435,6 +440,10 @@ static int dev_open(struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	/* Serve repeated config_get() calls without bus traffic. */
+	sr_config_cache_enable(sdi, SCPI_CONFIG_CACHE_TTL_US,
+		ARRAY_AND_SIZE(uncached_keys));
+
 	return SR_OK;
 }
 
@@ -36,6 +36,18 @@ static const uint32_t drvopts[] = {
 	SR_CONF_POWER_SUPPLY,
 };
 
+/* Readings and protection status, which config_get() must not cache. */
+static const uint32_t uncached_keys[] = {
+	SR_CONF_ENABLED,
+	SR_CONF_VOLTAGE,
+	SR_CONF_CURRENT,
+	SR_CONF_OUTPUT_FREQUENCY,
+	SR_CONF_REGULATION,
+	SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
+	SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
+	SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
+};
+
 static const struct pps_channel_instance pci[] = {
 	{ SR_MQ_VOLTAGE, SCPI_CMD_GET_MEAS_VOLTAGE, "V" },
 	{ SR_MQ_CURRENT, SCPI_CMD_GET_MEAS_CURRENT, "I" },
@@ -294,6 +306,10 @@ static int dev_open(struct sr_dev_inst *sdi)
 		g_variant_unref(beeper);
 	}
 
+	/* Serve repeated config_get() calls without bus traffic. */
+	sr_config_cache_enable(sdi, SCPI_CONFIG_CACHE_TTL_US,
+		ARRAY_AND_SIZE(uncached_keys));
+
 	return SR_OK;
 }
 
@@ -679,126 +679,128 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
+static void siglent_sds_queue_vertical(struct dev_context *devc,
+		struct sr_scpi_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_scpi_batch_get_float(batch, &devc->vdiv[i],
+			"C%d:VDIV?", i + 1);
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_scpi_batch_get_float(batch, &devc->vert_offset[i],
+			"C%d:OFST?", i + 1);
+}
+
+static void siglent_sds_log_vertical(const struct dev_context *devc)
+{
+	unsigned int i;
+
+	sr_dbg("Current vertical gain:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %g", i + 1, devc->vdiv[i]);
+	sr_dbg("Current vertical offset:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %g", i + 1, devc->vert_offset[i]);
+}
+
 SR_PRIV int siglent_sds_get_dev_cfg(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_channel *ch;
-	char *cmd, *response;
+	struct sr_scpi_batch *batch;
+	char *response;
 	unsigned int i;
 	int res, num_tokens;
 	gchar **tokens;
 	int len;
 	float trigger_pos;
+	gboolean status;
 
 	devc = sdi->priv;
 
+	/*
+	 * Settings are read back in two batches of queries: the first
+	 * one yields the trigger source, which the second one depends on.
+	 */
+	batch = sr_scpi_batch_new(SCPI_BATCH_JOINED);
+
 	/* Analog channel state. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf("C%i:TRA?", i + 1);
-		res = sr_scpi_get_bool(sdi->conn, cmd, &devc->analog_channels[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-		ch = g_slist_nth_data(sdi->channels, i);
-		ch->enabled = devc->analog_channels[i];
-	}
-	sr_dbg("Current analog channel state:");
 	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %s", i + 1, devc->analog_channels[i] ? "On" : "Off");
+		sr_scpi_batch_get_bool(batch, &devc->analog_channels[i],
+			"C%i:TRA?", i + 1);
 
-	/* Digital channel state. */
-	if (devc->model->has_digital) {
-		gboolean status;
-
-		sr_dbg("Check logic analyzer channel state.");
-		devc->la_enabled = FALSE;
-		cmd = g_strdup_printf("DI:SW?");
-		res = sr_scpi_get_bool(sdi->conn, cmd, &status);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-		sr_dbg("Logic analyzer status: %s", status ? "On" : "Off");
-		if (status) {
-			devc->la_enabled = TRUE;
-			for (i = 0; i < ARRAY_SIZE(devc->digital_channels); i++) {
-				cmd = g_strdup_printf("D%i:TRA?", i);
-				res = sr_scpi_get_bool(sdi->conn, cmd, &devc->digital_channels[i]);
-				g_free(cmd);
-				if (res != SR_OK)
-					return SR_ERR;
-				ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
-				ch->enabled = devc->digital_channels[i];
-				sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "On" : "Off");
-			}
-		} else {
-			for (i = 0; i < ARRAY_SIZE(devc->digital_channels); i++) {
-				ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
-				devc->digital_channels[i] = FALSE;
-				ch->enabled = devc->digital_channels[i];
-				sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "On" : "Off");
-			}
-		}
-	}
+	/* Logic analyzer state. */
+	status = FALSE;
+	if (devc->model->has_digital)
+		sr_scpi_batch_get_bool(batch, &status, "DI:SW?");
 
 	/* Timebase. */
-	if (sr_scpi_get_float(sdi->conn, ":TDIV?", &devc->timebase) != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current timebase: %g.", devc->timebase);
+	sr_scpi_batch_get_float(batch, &devc->timebase, ":TDIV?");
 
 	/* Probe attenuation. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf("C%d:ATTN?", i + 1);
-		res = sr_scpi_get_float(sdi->conn, cmd, &devc->attenuation[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
-	sr_dbg("Current probe attenuation:");
 	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %g", i + 1, devc->attenuation[i]);
+		sr_scpi_batch_get_float(batch, &devc->attenuation[i],
+			"C%d:ATTN?", i + 1);
 
 	/* Vertical gain and offset. */
-	if (siglent_sds_get_dev_cfg_vertical(sdi) != SR_OK)
-		return SR_ERR;
+	siglent_sds_queue_vertical(devc, batch);
 
 	/* Coupling. */
 	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf("C%d:CPL?", i + 1);
 		g_free(devc->coupling[i]);
-		devc->coupling[i] = NULL;
-		res = sr_scpi_get_string(sdi->conn, cmd, &devc->coupling[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
+		sr_scpi_batch_get_string(batch, &devc->coupling[i],
+			"C%d:CPL?", i + 1);
+	}
+
+	/* Trigger source. */
+	sr_scpi_batch_get_string(batch, &response, "TRSE?");
+
+	res = sr_scpi_batch_run(sdi->conn, batch);
+	sr_scpi_batch_free(batch);
+	if (res != SR_OK) {
+		g_free(response);
+		return SR_ERR;
 	}
 
+	sr_dbg("Current analog channel state:");
+	for (i = 0; i < devc->model->analog_channels; i++) {
+		ch = g_slist_nth_data(sdi->channels, i);
+		ch->enabled = devc->analog_channels[i];
+		sr_dbg("CH%d %s", i + 1, devc->analog_channels[i] ? "On" : "Off");
+	}
+
+	if (devc->model->has_digital)
+		sr_dbg("Logic analyzer status: %s", status ? "On" : "Off");
+	devc->la_enabled = status;
+
+	sr_dbg("Current timebase: %g.", devc->timebase);
+
+	sr_dbg("Current probe attenuation:");
+	for (i = 0; i < devc->model->analog_channels; i++)
+		sr_dbg("CH%d %g", i + 1, devc->attenuation[i]);
+
+	siglent_sds_log_vertical(devc);
+
 	sr_dbg("Current coupling:");
 	for (i = 0; i < devc->model->analog_channels; i++)
 		sr_dbg("CH%d %s", i + 1, devc->coupling[i]);
 
-	/* Trigger source. */
-	response = NULL;
-	tokens = NULL;
-	if (sr_scpi_get_string(sdi->conn, "TRSE?", &response) != SR_OK)
-		return SR_ERR;
 	tokens = g_strsplit(response, ",", 0);
 	num_tokens = g_strv_length(tokens);
-	if (num_tokens < 4) {
-		sr_dbg("IDN response not according to spec: %80.s.", response);
+	if (num_tokens < 5) {
+		sr_dbg("TRSE response not according to spec: %.80s.", response);
 		g_strfreev(tokens);
 		g_free(response);
 		return SR_ERR_DATA;
 	}
 	g_free(response);
+	g_free(devc->trigger_source);
 	devc->trigger_source = g_strstrip(g_strdup(tokens[2]));
 	sr_dbg("Current trigger source: %s.", devc->trigger_source);
 
 	/* TODO: Horizontal trigger position. */
-	response = "";
 	trigger_pos = 0;
-	// if (sr_scpi_get_string(sdi->conn, g_strdup_printf("%s:TRDL?", devc->trigger_source), &response) != SR_OK)
-	// 	return SR_ERR;
-	// len = strlen(response);
 	len = strlen(tokens[4]);
 	if (!g_ascii_strcasecmp(tokens[4] + (len - 2), "us")) {
 		trigger_pos = atof(tokens[4]) / SR_GHZ(1);
@@ -817,61 +819,65 @@ SR_PRIV int siglent_sds_get_dev_cfg(const struct sr_dev_inst *sdi)
 
 	sr_dbg("Current horizontal trigger position %.10f.", devc->horiz_triggerpos);
 
+	batch = sr_scpi_batch_new(SCPI_BATCH_JOINED);
+
+	/* Digital channel state. */
+	for (i = 0; devc->la_enabled && i < ARRAY_SIZE(devc->digital_channels); i++)
+		sr_scpi_batch_get_bool(batch, &devc->digital_channels[i],
+			"D%i:TRA?", i);
+
 	/* Trigger slope. */
-	cmd = g_strdup_printf("%s:TRSL?", devc->trigger_source);
 	g_free(devc->trigger_slope);
-	devc->trigger_slope = NULL;
-	res = sr_scpi_get_string(sdi->conn, cmd, &devc->trigger_slope);
-	g_free(cmd);
-	if (res != SR_OK)
-		return SR_ERR;
-	sr_dbg("Current trigger slope: %s.", devc->trigger_slope);
+	sr_scpi_batch_get_string(batch, &devc->trigger_slope,
+		"%s:TRSL?", devc->trigger_source);
 
 	/* Trigger level, only when analog channel. */
-	if (g_str_has_prefix(tokens[2], "C")) {
-		cmd = g_strdup_printf("%s:TRLV?", devc->trigger_source);
-		res = sr_scpi_get_float(sdi->conn, cmd, &devc->trigger_level);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-		sr_dbg("Current trigger level: %g.", devc->trigger_level);
+	if (g_str_has_prefix(tokens[2], "C"))
+		sr_scpi_batch_get_float(batch, &devc->trigger_level,
+			"%s:TRLV?", devc->trigger_source);
+
+	res = sr_scpi_batch_run(sdi->conn, batch);
+	sr_scpi_batch_free(batch);
+	if (res != SR_OK) {
+		g_strfreev(tokens);
+		return SR_ERR;
+	}
+
+	if (devc->model->has_digital) {
+		sr_dbg("Current digital channel state:");
+		for (i = 0; i < ARRAY_SIZE(devc->digital_channels); i++) {
+			ch = g_slist_nth_data(sdi->channels, i + devc->model->analog_channels);
+			if (!devc->la_enabled)
+				devc->digital_channels[i] = FALSE;
+			ch->enabled = devc->digital_channels[i];
+			sr_dbg("D%d: %s", i, devc->digital_channels[i] ? "On" : "Off");
+		}
 	}
 
+	sr_dbg("Current trigger slope: %s.", devc->trigger_slope);
+	if (g_str_has_prefix(tokens[2], "C"))
+		sr_dbg("Current trigger level: %g.", devc->trigger_level);
+	g_strfreev(tokens);
+
 	return SR_OK;
 }
 
 SR_PRIV int siglent_sds_get_dev_cfg_vertical(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	char *cmd;
-	unsigned int i;
+	struct sr_scpi_batch *batch;
 	int res;
 
 	devc = sdi->priv;
 
-	/* Vertical gain. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf("C%d:VDIV?", i + 1);
-		res = sr_scpi_get_float(sdi->conn, cmd, &devc->vdiv[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
-	sr_dbg("Current vertical gain:");
-	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %g", i + 1, devc->vdiv[i]);
+	batch = sr_scpi_batch_new(SCPI_BATCH_JOINED);
+	siglent_sds_queue_vertical(devc, batch);
+	res = sr_scpi_batch_run(sdi->conn, batch);
+	sr_scpi_batch_free(batch);
+	if (res != SR_OK)
+		return SR_ERR;
 
-	/* Vertical offset. */
-	for (i = 0; i < devc->model->analog_channels; i++) {
-		cmd = g_strdup_printf("C%d:OFST?", i + 1);
-		res = sr_scpi_get_float(sdi->conn, cmd, &devc->vert_offset[i]);
-		g_free(cmd);
-		if (res != SR_OK)
-			return SR_ERR;
-	}
-	sr_dbg("Current vertical offset:");
-	for (i = 0; i < devc->model->analog_channels; i++)
-		sr_dbg("CH%d %g", i + 1, devc->vert_offset[i]);
+	siglent_sds_log_vertical(devc);
 
 	return SR_OK;
 }
@@ -232,6 +232,18 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_SAMPLE_RANGE, SR_T_UINT64_RANGE, "sample_range",
+		"Sample range", NULL},
+	{SR_CONF_READ_AHEAD, SR_T_UINT64, "read_ahead",
+		"Read-ahead depth", NULL},
+	{SR_CONF_CAPTURE_CODEC, SR_T_STRING, "capture_codec",
+		"Capture codec", NULL},
+	{SR_CONF_USB_EVENT_THREAD, SR_T_BOOL, "usb_event_thread",
+		"USB event thread", NULL},
+	{SR_CONF_ADAPTIVE_TRANSFERS, SR_T_BOOL, "adaptive_transfers",
+		"Adaptive USB transfers", NULL},
+	{SR_CONF_UNTHROTTLED, SR_T_BOOL, "unthrottled",
+		"Unthrottled acquisition", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -657,6 +669,8 @@ SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Starting acquisition.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi);
+
 	return sdi->driver->dev_acquisition_start(sdi);
 }
 
@@ -676,6 +690,8 @@ SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Stopping acquisition.", sdi->driver->name);
 
+	sr_config_cache_invalidate(sdi);
+
 	return sdi->driver->dev_acquisition_stop(sdi);
 }
 
@@ -776,6 +792,208 @@ static int check_key(const struct sr_dev_driver *driver,
 	return SR_OK;
 }
 
+/*
+ * Per device instance cache of config_get() results. Drivers which
+ * have to talk to the device to answer config_get() (typically SCPI
+ * instruments) enable it, so that repeated sr_config_get() calls for
+ * the same key don't cause bus traffic. Entries expire after a driver
+ * specified time, and all of them are dropped when the configuration
+ * is changed, when the device is opened or closed, and when an
+ * acquisition starts or stops. Keys which report measurements or
+ * status (rather than settings) are never cached. Drivers which answer
+ * config_get() from state in memory don't need the cache.
+ *
+ * Frontends may call sr_config_get() from several threads, the mutex
+ * protects the entries. It is not held while the driver runs. Every
+ * invalidation bumps the generation, results which the driver returned
+ * are only stored when no invalidation happened since the lookup.
+ */
+struct sr_config_cache {
+	GMutex mutex;
+	GHashTable *entries;
+	guint64 generation;
+	gint64 ttl_us;
+	const uint32_t *uncached_keys;
+	size_t num_uncached_keys;
+};
+
+struct config_cache_entry {
+	uint32_t key;
+	const struct sr_channel_group *cg;
+	GVariant *data;
+	gint64 expires_us;
+};
+
+static guint config_cache_hash(gconstpointer p)
+{
+	const struct config_cache_entry *entry;
+
+	entry = p;
+
+	return g_direct_hash(entry->cg) ^ entry->key;
+}
+
+static gboolean config_cache_equal(gconstpointer a, gconstpointer b)
+{
+	const struct config_cache_entry *entry_a, *entry_b;
+
+	entry_a = a;
+	entry_b = b;
+
+	return entry_a->key == entry_b->key && entry_a->cg == entry_b->cg;
+}
+
+static void config_cache_entry_free(gpointer p)
+{
+	struct config_cache_entry *entry;
+
+	entry = p;
+	g_variant_unref(entry->data);
+	g_free(entry);
+}
+
+/**
+ * Enable caching of config_get() results for a device instance.
+ *
+ * @param sdi The device instance.
+ * @param ttl_us How long a result may be served from the cache, in
+ *               microseconds. Zero disables the cache.
+ * @param uncached_keys Keys whose values are measurements or status
+ *                      information, which always get passed to the
+ *                      driver. Must remain valid while the cache is
+ *                      enabled. Can be NULL.
+ * @param num_uncached_keys Number of keys in @a uncached_keys.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_cache_enable(struct sr_dev_inst *sdi, gint64 ttl_us,
+	const uint32_t *uncached_keys, size_t num_uncached_keys)
+{
+	struct sr_config_cache *cache;
+
+	if (!sdi)
+		return;
+
+	if (ttl_us <= 0) {
+		sr_config_cache_free(sdi);
+		return;
+	}
+	if (!sdi->config_cache) {
+		cache = g_malloc0(sizeof(*cache));
+		g_mutex_init(&cache->mutex);
+		cache->entries = g_hash_table_new_full(config_cache_hash,
+			config_cache_equal, config_cache_entry_free, NULL);
+		sdi->config_cache = cache;
+	}
+	cache = sdi->config_cache;
+	g_mutex_lock(&cache->mutex);
+	g_hash_table_remove_all(cache->entries);
+	cache->generation++;
+	cache->ttl_us = ttl_us;
+	cache->uncached_keys = uncached_keys;
+	cache->num_uncached_keys = num_uncached_keys;
+	g_mutex_unlock(&cache->mutex);
+}
+
+/**
+ * Drop all cached config_get() results of a device instance.
+ *
+ * Drivers need to call this when the device's configuration changes
+ * by other means than sr_config_set().
+ *
+ * @param sdi The device instance.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi)
+{
+	struct sr_config_cache *cache;
+
+	if (!sdi || !(cache = sdi->config_cache))
+		return;
+
+	g_mutex_lock(&cache->mutex);
+	g_hash_table_remove_all(cache->entries);
+	cache->generation++;
+	g_mutex_unlock(&cache->mutex);
+}
+
+/** @private */
+SR_PRIV void sr_config_cache_free(struct sr_dev_inst *sdi)
+{
+	struct sr_config_cache *cache;
+
+	if (!sdi || !(cache = sdi->config_cache))
+		return;
+
+	sdi->config_cache = NULL;
+	g_hash_table_destroy(cache->entries);
+	g_mutex_clear(&cache->mutex);
+	g_free(cache);
+}
+
+static gboolean config_cache_allowed(const struct sr_config_cache *cache,
+	uint32_t key)
+{
+	size_t i;
+
+	for (i = 0; i < cache->num_uncached_keys; i++) {
+		if (cache->uncached_keys[i] == key)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Get a cached result, or NULL. Also returns the cache's generation,
+ * which a subsequent config_cache_store() needs to pass in.
+ */
+static GVariant *config_cache_lookup(struct sr_config_cache *cache,
+	const struct sr_channel_group *cg, uint32_t key, guint64 *generation)
+{
+	struct config_cache_entry *entry, lookup;
+	GVariant *data;
+
+	lookup.key = key;
+	lookup.cg = cg;
+	data = NULL;
+	g_mutex_lock(&cache->mutex);
+	*generation = cache->generation;
+	entry = g_hash_table_lookup(cache->entries, &lookup);
+	if (entry && g_get_monotonic_time() > entry->expires_us)
+		g_hash_table_remove(cache->entries, entry);
+	else if (entry)
+		data = g_variant_ref(entry->data);
+	g_mutex_unlock(&cache->mutex);
+
+	return data;
+}
+
+/*
+ * Store a result unless the cache got invalidated since the lookup,
+ * the result then may predate a configuration change.
+ */
+static void config_cache_store(struct sr_config_cache *cache,
+	const struct sr_channel_group *cg, uint32_t key, GVariant *data,
+	guint64 generation)
+{
+	struct config_cache_entry *entry;
+
+	g_mutex_lock(&cache->mutex);
+	if (cache->generation != generation) {
+		g_mutex_unlock(&cache->mutex);
+		return;
+	}
+	entry = g_malloc(sizeof(*entry));
+	entry->key = key;
+	entry->cg = cg;
+	entry->data = g_variant_ref(data);
+	entry->expires_us = g_get_monotonic_time() + cache->ttl_us;
+	g_hash_table_add(cache->entries, entry);
+	g_mutex_unlock(&cache->mutex);
+}
+
 /**
  * Query value of a configuration key at the given driver or device instance.
  *
@@ -806,6 +1024,8 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant **data)
 {
+	struct sr_config_cache *cache;
+	guint64 generation;
 	int ret;
 
 	if (!driver || !data)
@@ -822,11 +1042,20 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		return SR_ERR;
 	}
 
+	cache = sdi ? sdi->config_cache : NULL;
+	if (cache && !config_cache_allowed(cache, key))
+		cache = NULL;
+	generation = 0;
+	if (cache && (*data = config_cache_lookup(cache, cg, key, &generation)))
+		return SR_OK;
+
 	if ((ret = driver->config_get(key, data, sdi, cg)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_GET, *data);
 		/* Got a floating reference from the driver. Sink it here,
 		 * caller will need to unref when done with it. */
 		g_variant_ref_sink(*data);
+		if (cache)
+			config_cache_store(cache, cg, key, *data, generation);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -877,6 +1106,7 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 	else if ((ret = sr_variant_type_check(key, data)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_SET, data);
 		ret = sdi->driver->config_set(key, data, sdi, cg);
+		sr_config_cache_invalidate(sdi);
 	}
 
 	g_variant_unref(data);
@@ -909,8 +1139,10 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
 		sr_err("%s: Device instance not active, can't commit config.",
 			sdi->driver->name);
 		ret = SR_ERR_DEV_CLOSED;
-	} else
+	} else {
 		ret = sdi->driver->config_commit(sdi);
+		sr_config_cache_invalidate(sdi);
+	}
 
 	return ret;
 }
@@ -21,10 +21,15 @@
 #include "config.h"
 
 #include <ctype.h>
+#include <float.h>
 #include <glib.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CSV_X86_KERNELS 1
+#include <immintrin.h>
+#endif
 
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -202,6 +207,11 @@ struct column_details {
 	GString **channel_names;
 };
 
+struct column_view {
+	const char *text;
+	size_t length;
+};
+
 struct context {
 	gboolean started;
 
@@ -253,6 +263,9 @@ struct context {
 	/* Current line number. */
 	size_t line_number;
 
+	/* Columns' text in the current line, references the input buffer. */
+	struct column_view *column_views;
+
 	/* List of previously created sigrok channels. */
 	GSList *prev_sr_channels;
 	GSList **prev_df_channels;
@@ -295,20 +308,33 @@ static void clear_logic_samples(struct context *inc)
 	memset(inc->sample_buffer, 0, inc->sample_unit_size);
 }
 
-static void set_logic_level(struct context *inc, size_t ch_idx, int on)
+/*
+ * Sets a run of logic levels. Bit 0 of the value corresponds to the
+ * channel index, higher bits to subsequent channels. The sample set
+ * was cleared before, levels get OR-ed into it a byte at a time. The
+ * loop depends on the channel count and not on the data, which keeps
+ * random input data from defeating branch prediction.
+ */
+static void set_logic_bits(struct context *inc, size_t ch_idx,
+	uint64_t bits, size_t count)
 {
-	size_t byte_idx, bit_idx;
-	uint8_t bit_mask;
+	size_t shift, take;
 
 	if (ch_idx >= inc->logic_channels)
 		return;
-	if (!on)
-		return;
-
-	byte_idx = ch_idx / 8;
-	bit_idx = ch_idx % 8;
-	bit_mask = 1 << bit_idx;
-	inc->sample_buffer[byte_idx] |= bit_mask;
+	if (count > inc->logic_channels - ch_idx)
+		count = inc->logic_channels - ch_idx;
+	if (count < 64)
+		bits &= ((uint64_t)1 << count) - 1;
+
+	while (count) {
+		shift = ch_idx % 8;
+		take = MIN(8 - shift, count);
+		inc->sample_buffer[ch_idx / 8] |= (uint8_t)(bits << shift);
+		bits >>= take;
+		ch_idx += take;
+		count -= take;
+	}
 }
 
 static int flush_logic_samples(const struct sr_input *in)
@@ -772,10 +798,303 @@ static char **split_line(char *buf, struct context *inc)
 	return fields;
 }
 
+/*
+ * Text scanning for the bulk of the input data. Text gets inspected
+ * in blocks of 64 bytes, a bitmask holds the positions of characters
+ * which could start a line termination, a column separator, or a
+ * comment leader. Call sites verify the candidate positions and skip
+ * everything else. Which compares the text once per block and not
+ * once per column, and avoids copies of the text lines and columns.
+ * Columns are kept as references into the input buffer ("views").
+ *
+ * The vector kernels and the scalar fallback yield identical masks,
+ * the vector kernels are used for full blocks on capable machines.
+ */
+
+#define SCAN_BLOCK_SIZE	64
+#define SCAN_CHARS_MAX	3
+
+struct scan_chars {
+	size_t count;
+	uint8_t chars[SCAN_CHARS_MAX];
+	gboolean is_member[256];
+};
+
+typedef uint64_t (*scan_block_cb)(const uint8_t *text,
+	const struct scan_chars *chars);
+
+struct scanner {
+	const char *text;
+	size_t size;
+	const struct scan_chars *chars;
+	scan_block_cb scan_full;	/* Kernel for full blocks. */
+	size_t block;		/* Offset of the block which the mask covers. */
+	size_t block_len;
+	uint64_t mask;		/* Candidate positions within the block. */
+};
+
+/* Collect the leading characters of up to three text sequences. */
+static void scan_chars_init(struct scan_chars *chars,
+	const char *seq1, const char *seq2, const char *seq3)
+{
+	const char *seqs[SCAN_CHARS_MAX];
+	size_t idx;
+	uint8_t c;
+
+	memset(chars, 0, sizeof(*chars));
+	seqs[0] = seq1;
+	seqs[1] = seq2;
+	seqs[2] = seq3;
+	for (idx = 0; idx < SCAN_CHARS_MAX; idx++) {
+		if (!seqs[idx] || !seqs[idx][0])
+			continue;
+		c = seqs[idx][0];
+		if (chars->is_member[c])
+			continue;
+		chars->is_member[c] = TRUE;
+		chars->chars[chars->count++] = c;
+	}
+	/* Vector kernels always compare against all slots. */
+	for (idx = chars->count; idx < SCAN_CHARS_MAX; idx++)
+		chars->chars[idx] = chars->chars[0];
+}
+
+static uint64_t scan_block_scalar(const uint8_t *text, size_t length,
+	const struct scan_chars *chars)
+{
+	uint64_t mask;
+	size_t idx;
+
+	mask = 0;
+	for (idx = 0; idx < length; idx++) {
+		if (chars->is_member[text[idx]])
+			mask |= (uint64_t)1 << idx;
+	}
+
+	return mask;
+}
+
+#ifdef CSV_X86_KERNELS
+
+__attribute__((target("sse2")))
+static uint64_t scan_block_sse2(const uint8_t *text,
+	const struct scan_chars *chars)
+{
+	__m128i c0, c1, c2, data, hit;
+	uint64_t mask;
+	size_t idx;
+
+	c0 = _mm_set1_epi8((char)chars->chars[0]);
+	c1 = _mm_set1_epi8((char)chars->chars[1]);
+	c2 = _mm_set1_epi8((char)chars->chars[2]);
+	mask = 0;
+	for (idx = 0; idx < SCAN_BLOCK_SIZE / 16; idx++) {
+		data = _mm_loadu_si128((const __m128i *)&text[16 * idx]);
+		hit = _mm_or_si128(_mm_cmpeq_epi8(data, c0),
+			_mm_cmpeq_epi8(data, c1));
+		hit = _mm_or_si128(hit, _mm_cmpeq_epi8(data, c2));
+		mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << (16 * idx);
+	}
+
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t scan_block_avx2(const uint8_t *text,
+	const struct scan_chars *chars)
+{
+	__m256i c0, c1, c2, data, hit;
+	uint64_t mask;
+	size_t idx;
+
+	c0 = _mm256_set1_epi8((char)chars->chars[0]);
+	c1 = _mm256_set1_epi8((char)chars->chars[1]);
+	c2 = _mm256_set1_epi8((char)chars->chars[2]);
+	mask = 0;
+	for (idx = 0; idx < SCAN_BLOCK_SIZE / 32; idx++) {
+		data = _mm256_loadu_si256((const __m256i *)&text[32 * idx]);
+		hit = _mm256_or_si256(_mm256_cmpeq_epi8(data, c0),
+			_mm256_cmpeq_epi8(data, c1));
+		hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(data, c2));
+		mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hit) << (32 * idx);
+	}
+
+	return mask;
+}
+
+#endif
+
+static uint64_t scan_block_full_scalar(const uint8_t *text,
+	const struct scan_chars *chars)
+{
+	return scan_block_scalar(text, SCAN_BLOCK_SIZE, chars);
+}
+
+static void scanner_init(struct scanner *scan, const char *text, size_t size,
+	const struct scan_chars *chars)
+{
+#ifdef CSV_X86_KERNELS
+	int features;
+#endif
+
+	memset(scan, 0, sizeof(*scan));
+	scan->text = text;
+	scan->size = size;
+	scan->chars = chars;
+	scan->scan_full = scan_block_full_scalar;
+#ifdef CSV_X86_KERNELS
+	features = sr_cpu_features();
+	if (features & SR_CPU_AVX2)
+		scan->scan_full = scan_block_avx2;
+	else if (features & SR_CPU_SSE2)
+		scan->scan_full = scan_block_sse2;
+#endif
+}
+
+/*
+ * Get the position of the next candidate character at or after the
+ * given position. Returns the text size when there is none. Callers
+ * are expected to advance through the text, the mask of a block gets
+ * determined only once then.
+ */
+static size_t scanner_next(struct scanner *scan, size_t pos)
+{
+	uint64_t mask;
+
+	for (;;) {
+		if (pos >= scan->block && pos < scan->block + scan->block_len) {
+			mask = scan->mask >> (pos - scan->block);
+			if (mask)
+				return pos + sr_lowest_bit(mask);
+			pos = scan->block + scan->block_len;
+		}
+		if (pos >= scan->size)
+			return scan->size;
+		scan->block = pos;
+		scan->block_len = MIN(SCAN_BLOCK_SIZE, scan->size - pos);
+		if (scan->block_len == SCAN_BLOCK_SIZE)
+			scan->mask = scan->scan_full((const uint8_t *)&scan->text[pos],
+				scan->chars);
+		else
+			scan->mask = scan_block_scalar((const uint8_t *)&scan->text[pos],
+				scan->block_len, scan->chars);
+	}
+}
+
+static gboolean text_matches(const struct scanner *scan, size_t pos,
+	size_t limit, const char *seq, size_t length)
+{
+	if (pos + length > limit)
+		return FALSE;
+	if (scan->text[pos] != seq[0])
+		return FALSE;
+
+	return length == 1 || memcmp(&scan->text[pos], seq, length) == 0;
+}
+
+/**
+ * Find the end of a text line, and an optional comment in it.
+ *
+ * @param[in] inc	The input module's context.
+ * @param[in] scan	Scanner for line termination and comment leader.
+ * @param[in] pos	The position where the text line starts.
+ * @param[in] limit	The end of the text to process.
+ * @param[out] comment	The position of the comment leader (if any).
+ *
+ * @returns The position of the text line's termination.
+ *
+ * The comment position equals the line's end in the absence of a
+ * comment leader. Like strstr(3) on the text line would have found.
+ */
+static size_t scan_line(const struct context *inc, struct scanner *scan,
+	size_t pos, size_t limit, size_t *comment)
+{
+	size_t term_len, comment_len, comment_pos;
+
+	term_len = strlen(inc->termination);
+	comment_len = inc->comment->len;
+	comment_pos = limit;
+	for (pos = scanner_next(scan, pos); pos < limit;
+			pos = scanner_next(scan, pos + 1)) {
+		if (text_matches(scan, pos, scan->size, inc->termination, term_len))
+			break;
+		if (comment_len && comment_pos == limit &&
+				text_matches(scan, pos, scan->size,
+				inc->comment->str, comment_len))
+			comment_pos = pos;
+	}
+	if (pos > limit)
+		pos = limit;
+	if (comment_pos + comment_len > pos)
+		comment_pos = pos;
+	*comment = comment_pos;
+
+	return pos;
+}
+
+/**
+ * Split a text line into columns, without copying the text.
+ *
+ * @param[in] inc	The input module's context.
+ * @param[in] scan	Scanner for the column separator.
+ * @param[in] pos	The position where the text line starts.
+ * @param[in] limit	The position where the text line ends.
+ *
+ * @returns The number of columns found (at most the wanted count).
+ *
+ * Fills in the context's column views. Trailing whitespace is not
+ * part of the columns' text. Columns beyond those which are of interest
+ * to the input module are not inspected.
+ */
+static size_t split_columns(struct context *inc, struct scanner *scan,
+	size_t pos, size_t limit)
+{
+	struct column_view *view;
+	size_t count, delim_len, end;
+
+	delim_len = inc->delimiter->len;
+	count = 0;
+	while (count < inc->column_want_count) {
+		end = scanner_next(scan, pos);
+		while (end < limit && !text_matches(scan, end, limit,
+				inc->delimiter->str, delim_len))
+			end = scanner_next(scan, end + 1);
+		if (end > limit)
+			end = limit;
+		view = &inc->column_views[count++];
+		view->text = &scan->text[pos];
+		view->length = end - pos;
+		while (view->length && g_ascii_isspace(view->text[view->length - 1]))
+			view->length--;
+		if (end == limit)
+			break;
+		pos = end + delim_len;
+	}
+
+	return count;
+}
+
+/*
+ * Column text decoders. Take the column's text and length, there is
+ * no NUL termination.
+ */
+
+static int logic_digit_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c |= 0x20;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
 /**
  * Parse a multi-bit field into several logic channels.
  *
  * @param[in] column	The input text, a run of bin/hex/oct digits.
+ * @param[in] length	The input text's length.
  * @param[in] inc	The input module's context.
  * @param[in] details	The column processing details.
  *
@@ -785,92 +1104,70 @@ static char **split_line(char *buf, struct context *inc)
  * This routine modifies the logic levels in the current sample set,
  * based on the text input and a user provided format spec.
  */
-static int parse_logic(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_logic(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
-	size_t length, ch_rem, ch_idx, ch_inc;
+	size_t ch_rem, ch_idx, digit_bits, take;
 	const char *rdptr;
-	char c;
-	gboolean valid;
-	const char *type_text;
-	uint8_t bits;
+	int digit;
+	uint64_t word;
+	size_t word_bits;
+
+	if (!format_is_logic(details->text_format))
+		return SR_ERR_BUG;
 
 	/*
-	 * Prepare to read the digits from the text end towards the start.
-	 * A digit corresponds to a variable number of channels (depending
-	 * on the value's radix). Prepare the mapping of text digits to
-	 * (a number of) logic channels.
+	 * Read the digits from the text end towards the start. A digit
+	 * corresponds to a variable number of channels (depending on the
+	 * value's radix). Collect the digits' bits in a word, and update
+	 * the logic channels when the word is full or all digits were
+	 * seen. Make sure to not process more bits than the column has
+	 * channels associated with it.
 	 */
-	length = strlen(column);
 	if (!length) {
 		sr_err("Column %zu in line %zu is empty.", details->col_nr,
 			inc->line_number);
 		return SR_ERR;
 	}
+	switch (details->text_format) {
+	case FORMAT_HEX:
+		digit_bits = 4;
+		break;
+	case FORMAT_OCT:
+		digit_bits = 3;
+		break;
+	default:
+		digit_bits = 1;
+		break;
+	}
 	rdptr = &column[length];
 	ch_idx = details->channel_offset;
 	ch_rem = details->channel_count;
-
-	/*
-	 * Get another digit and derive up to four logic channels' state from
-	 * it. Make sure to not process more bits than the column has channels
-	 * associated with it.
-	 */
+	word = 0;
+	word_bits = 0;
 	while (rdptr > column && ch_rem) {
 		/* Check for valid digits according to the input radix. */
-		c = *(--rdptr);
-		switch (details->text_format) {
-		case FORMAT_BIN:
-			valid = g_ascii_isxdigit(c) && c < '2';
-			ch_inc = 1;
-			break;
-		case FORMAT_OCT:
-			valid = g_ascii_isxdigit(c) && c < '8';
-			ch_inc = 3;
-			break;
-		case FORMAT_HEX:
-			valid = g_ascii_isxdigit(c);
-			ch_inc = 4;
-			break;
-		default:
-			valid = FALSE;
-			break;
-		}
-		if (!valid) {
-			type_text = col_format_text[details->text_format];
-			sr_err("Invalid text '%s' in %s type column %zu in line %zu.",
-				column, type_text, details->col_nr, inc->line_number);
+		digit = logic_digit_value(*(--rdptr));
+		if (digit < 0 || (digit >> digit_bits)) {
+			sr_err("Invalid text '%.*s' in %s type column %zu in line %zu.",
+				(int)length, column,
+				col_format_text[details->text_format],
+				details->col_nr, inc->line_number);
 			return SR_ERR;
 		}
 		/* Use the digit's bits for logic channels' data. */
-		bits = g_ascii_xdigit_value(c);
-		switch (details->text_format) {
-		case FORMAT_HEX:
-			if (ch_rem >= 4) {
-				ch_rem--;
-				set_logic_level(inc, ch_idx + 3, bits & (1 << 3));
-			}
-			/* FALLTHROUGH */
-		case FORMAT_OCT:
-			if (ch_rem >= 3) {
-				ch_rem--;
-				set_logic_level(inc, ch_idx + 2, bits & (1 << 2));
-			}
-			if (ch_rem >= 2) {
-				ch_rem--;
-				set_logic_level(inc, ch_idx + 1, bits & (1 << 1));
-			}
-			/* FALLTHROUGH */
-		case FORMAT_BIN:
-			ch_rem--;
-			set_logic_level(inc, ch_idx + 0, bits & (1 << 0));
-			break;
-		default:
-			/* ShouldNotHappen(TM), but silences compiler warning. */
-			return SR_ERR;
+		take = MIN(digit_bits, ch_rem);
+		if (word_bits + take > 64) {
+			set_logic_bits(inc, ch_idx, word, word_bits);
+			ch_idx += word_bits;
+			word = 0;
+			word_bits = 0;
 		}
-		ch_idx += ch_inc;
+		word |= (uint64_t)digit << word_bits;
+		word_bits += take;
+		ch_rem -= take;
 	}
+	set_logic_bits(inc, ch_idx, word, word_bits);
 	/*
 	 * TODO Determine whether the availability of extra input data
 	 * for unhandled logic channels is worth warning here. In this
@@ -882,10 +1179,118 @@ static int parse_logic(const char *column, struct context *inc,
 	return SR_OK;
 }
 
+/*
+ * Fast path for the conversion of decimal text to double precision
+ * values, which is what instruments export. When the mantissa fits
+ * into 53 bits and the power of ten is exactly representable, one
+ * multiplication or division yields the correctly rounded result,
+ * the very value that strtod(3) returns. Other input (many digits,
+ * large exponents, whitespace, "inf", hex notation, syntax errors)
+ * is left to the library routine. Extended precision intermediates
+ * (x87) would break the rounding argument, that's why the fast path
+ * does not apply there.
+ */
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1)
+#define CSV_FAST_DOUBLE 1
+#endif
+
+#ifdef CSV_FAST_DOUBLE
+static gboolean parse_double_fast(const char *text, size_t length,
+	double *value)
+{
+	static const double pow10_exact[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+	const char *end;
+	gboolean negative, exp_negative;
+	uint64_t mantissa;
+	size_t digits, exp_digits;
+	int exponent, frac_digits;
+	double result;
+
+	end = &text[length];
+	negative = FALSE;
+	if (text < end && (*text == '-' || *text == '+'))
+		negative = *text++ == '-';
+	mantissa = 0;
+	digits = 0;
+	frac_digits = 0;
+	while (text < end && g_ascii_isdigit(*text)) {
+		if (++digits > 19)
+			return FALSE;
+		mantissa = mantissa * 10 + (*text++ - '0');
+	}
+	if (text < end && *text == '.') {
+		text++;
+		while (text < end && g_ascii_isdigit(*text)) {
+			if (++digits > 19)
+				return FALSE;
+			mantissa = mantissa * 10 + (*text++ - '0');
+			frac_digits++;
+		}
+	}
+	if (!digits)
+		return FALSE;
+	exponent = 0;
+	if (text < end && (*text == 'e' || *text == 'E')) {
+		text++;
+		exp_negative = FALSE;
+		if (text < end && (*text == '-' || *text == '+'))
+			exp_negative = *text++ == '-';
+		exp_digits = 0;
+		while (text < end && g_ascii_isdigit(*text)) {
+			if (++exp_digits > 3)
+				return FALSE;
+			exponent = exponent * 10 + (*text++ - '0');
+		}
+		if (!exp_digits)
+			return FALSE;
+		if (exp_negative)
+			exponent = -exponent;
+	}
+	if (text != end)
+		return FALSE;
+	if (mantissa > ((uint64_t)1 << 53))
+		return FALSE;
+	exponent -= frac_digits;
+	if (exponent < -22 || exponent > 22)
+		return FALSE;
+
+	result = mantissa;
+	if (exponent < 0)
+		result /= pow10_exact[-exponent];
+	else
+		result *= pow10_exact[exponent];
+	*value = negative ? -result : result;
+
+	return TRUE;
+}
+#endif
+
+static int parse_double(const char *text, size_t length, double *value)
+{
+	char *copy;
+	int ret;
+
+#ifdef CSV_FAST_DOUBLE
+	if (parse_double_fast(text, length, value))
+		return SR_OK;
+#endif
+
+	copy = g_strndup(text, length);
+	ret = sr_atod_ascii(copy, value);
+	g_free(copy);
+
+	return ret;
+}
+
 /**
  * Parse a floating point text into an analog value.
  *
  * @param[in] column	The input text, a floating point number.
+ * @param[in] length	The input text's length.
  * @param[in] inc	The input module's context.
  * @param[in] details	The column processing details.
  *
@@ -895,35 +1300,36 @@ static int parse_logic(const char *column, struct context *inc,
  * This routine modifies the analog values in the current sample set,
  * based on the text input and a user provided format spec.
  */
-static int parse_analog(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_analog(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
-	size_t length;
 	double dvalue; float fvalue;
 	csv_analog_t value;
+	char *copy;
 	int ret;
 
 	if (!format_is_analog(details->text_format))
 		return SR_ERR_BUG;
 
-	length = strlen(column);
 	if (!length) {
 		sr_err("Column %zu in line %zu is empty.", details->col_nr,
 			inc->line_number);
 		return SR_ERR;
 	}
 	if (sizeof(value) == sizeof(double)) {
-		ret = sr_atod_ascii(column, &dvalue);
+		ret = parse_double(column, length, &dvalue);
 		value = dvalue;
 	} else if (sizeof(value) == sizeof(float)) {
-		ret = sr_atof_ascii(column, &fvalue);
+		copy = g_strndup(column, length);
+		ret = sr_atof_ascii(copy, &fvalue);
+		g_free(copy);
 		value = fvalue;
 	} else {
 		ret = SR_ERR_BUG;
 	}
 	if (ret != SR_OK) {
-		sr_err("Cannot parse analog text %s in column %zu in line %zu.",
-			column, details->col_nr, inc->line_number);
+		sr_err("Cannot parse analog text %.*s in column %zu in line %zu.",
+			(int)length, column, details->col_nr, inc->line_number);
 		return SR_ERR_DATA;
 	}
 	set_analog_value(inc, details->channel_offset, value);
@@ -935,6 +1341,7 @@ static int parse_analog(const char *column, struct context *inc,
  * Parse a timestamp text, auto-determine samplerate.
  *
  * @param[in] column	The input text, a floating point number.
+ * @param[in] length	The input text's length.
  * @param[in] inc	The input module's context.
  * @param[in] details	The column processing details.
  *
@@ -945,8 +1352,8 @@ static int parse_analog(const char *column, struct context *inc,
  * samplerate from text rows' timestamp values. Only simple formats are
  * supported, user provided values always take precedence.
  */
-static int parse_timestamp(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_timestamp(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
 	double ts, rate;
 	int ret;
@@ -985,12 +1392,12 @@ static int parse_timestamp(const char *column, struct context *inc,
 	 */
 	if (inc->calc_samplerate)
 		return SR_OK;
-	ret = sr_atod_ascii(column, &ts);
+	ret = parse_double(column, length, &ts);
 	if (ret != SR_OK)
 		ts = 0.0;
 	if (!ts) {
-		sr_info("Cannot convert timestamp text %s in line %zu (or zero value).",
-			column, inc->line_number);
+		sr_info("Cannot convert timestamp text %.*s in line %zu (or zero value).",
+			(int)length, column, inc->line_number);
 		inc->prev_timestamp = 0.0;
 		return SR_OK;
 	}
@@ -1026,18 +1433,19 @@ static int parse_timestamp(const char *column, struct context *inc,
  * This routine exists to unify dispatch code paths, mapping input file
  * columns' data types to their respective parse routines.
  */
-static int parse_ignore(const char *column, struct context *inc,
-	const struct column_details *details)
+static int parse_ignore(const char *column, size_t length,
+	struct context *inc, const struct column_details *details)
 {
 	(void)column;
+	(void)length;
 	(void)inc;
 	(void)details;
 
 	return SR_OK;
 }
 
-typedef int (*col_parse_cb)(const char *column, struct context *inc,
-	const struct column_details *details);
+typedef int (*col_parse_cb)(const char *column, size_t length,
+	struct context *inc, const struct column_details *details);
 
 static const col_parse_cb col_parse_funcs[] = {
 	[FORMAT_NONE] = parse_ignore,
@@ -1418,6 +1826,8 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 		ret = SR_ERR_DATA;
 		goto out;
 	}
+	inc->column_views = g_malloc0(inc->column_want_count *
+		sizeof(inc->column_views[0]));
 
 	/*
 	 * Allocate buffer memory for datafeed submission of sample data.
@@ -1530,13 +1940,18 @@ static int initial_receive(const struct sr_input *in)
 static int process_buffer(struct sr_input *in, gboolean is_eof)
 {
 	struct context *inc;
-	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
+	struct scan_chars line_chars, delim_chars;
+	struct scanner line_scan, delim_scan;
+	const struct column_view *view;
+	size_t num_columns;
+	size_t col_idx, col_nr;
+	size_t data_end, processed_up_to, term_len;
+	size_t line_start, line_end, comment_pos, text_start, text_end;
 	const struct column_details *details;
 	col_parse_cb parse_func;
+	const char *text;
+	char *term_pos;
 	int ret;
-	char *processed_up_to;
-	char **lines, *line, **columns, *column;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1559,36 +1974,59 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	 */
 	if (!in->buf->len)
 		return SR_OK;
+	text = in->buf->str;
+	term_len = strlen(inc->termination);
 	if (is_eof) {
-		processed_up_to = in->buf->str + in->buf->len;
+		data_end = in->buf->len;
+		processed_up_to = data_end;
 	} else {
-		processed_up_to = g_strrstr_len(in->buf->str, in->buf->len,
+		term_pos = g_strrstr_len(in->buf->str, in->buf->len,
 			inc->termination);
-		if (!processed_up_to)
+		if (!term_pos)
 			return SR_OK;
-		*processed_up_to = '\0';
-		processed_up_to += strlen(inc->termination);
+		data_end = term_pos - text;
+		processed_up_to = data_end + term_len;
 	}
 
-	/* Split input text lines and process their columns. */
+	/*
+	 * Find input text lines and process their columns. Lines as well
+	 * as columns reference the input buffer, which is only modified
+	 * after all of its complete lines were processed.
+	 */
+	scan_chars_init(&line_chars, inc->termination, inc->comment->str, NULL);
+	scanner_init(&line_scan, text, in->buf->len, &line_chars);
+	scan_chars_init(&delim_chars, inc->delimiter->str, NULL, NULL);
+	scanner_init(&delim_scan, text, in->buf->len, &delim_chars);
 	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
+	line_start = 0;
+	do {
+		line_end = scan_line(inc, &line_scan, line_start, data_end,
+			&comment_pos);
+		text_start = line_start;
+		text_end = line_end;
+		line_start = line_end + term_len;
+
 		inc->line_number++;
 		if (inc->line_number < inc->start_line) {
 			sr_spew("Line %zu skipped (before start).", inc->line_number);
 			continue;
 		}
-		if (line[0] == '\0') {
+		if (text_start == text_end) {
 			sr_spew("Blank line %zu skipped.", inc->line_number);
 			continue;
 		}
 
-		/* Remove trailing comment. */
-		strip_comment(line, inc->comment);
-		if (line[0] == '\0') {
-			sr_spew("Comment-only line %zu skipped.", inc->line_number);
-			continue;
+		/* Remove trailing comment, and surrounding whitespace. */
+		if (comment_pos < text_end) {
+			text_end = comment_pos;
+			while (text_start < text_end && g_ascii_isspace(text[text_start]))
+				text_start++;
+			while (text_end > text_start && g_ascii_isspace(text[text_end - 1]))
+				text_end--;
+			if (text_start == text_end) {
+				sr_spew("Comment-only line %zu skipped.", inc->line_number);
+				continue;
+			}
 		}
 
 		/* Skip the header line, its content was used as the channel names. */
@@ -1599,18 +2037,10 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		}
 
 		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
+		num_columns = split_columns(inc, &delim_scan, text_start, text_end);
 		if (num_columns < inc->column_want_count) {
 			sr_err("Insufficient column count %zu in line %zu.",
 				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
 
@@ -1618,7 +2048,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		clear_logic_samples(inc);
 		clear_analog_samples(inc);
 		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
+			view = &inc->column_views[col_idx];
 			col_nr = col_idx + 1;
 			details = lookup_column_details(inc, col_nr);
 			if (!details || !details->text_format)
@@ -1626,12 +2056,9 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 			parse_func = col_parse_funcs[details->text_format];
 			if (!parse_func)
 				continue;
-			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
+			ret = parse_func(view->text, view->length, inc, details);
+			if (ret != SR_OK)
 				return SR_ERR;
-			}
 		}
 
 		/* Send sample data to the session bus (buffered). */
@@ -1639,15 +2066,10 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		ret += queue_analog_samples(in);
 		if (ret != SR_OK) {
 			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
 			return SR_ERR;
 		}
-
-		g_strfreev(columns);
-	}
-	g_strfreev(lines);
-	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
+	} while (line_end < data_end);
+	g_string_erase(in->buf, 0, processed_up_to);
 
 	return ret;
 }
@@ -1724,6 +2146,8 @@ static void cleanup(struct sr_input *in)
 	/* TODO Release channel names (before releasing details). */
 	g_free(inc->column_details);
 	inc->column_details = NULL;
+	g_free(inc->column_views);
+	inc->column_views = NULL;
 
 	/* Clear internal state, but keep what .init() has provided. */
 	save_ctx = *inc;
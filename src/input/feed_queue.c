@@ -20,6 +20,17 @@
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include <string.h>
+#include <unistd.h>
+
+/*
+ * Buffer size for logic queues which let the library pick the sample
+ * count: half the L2 cache when the platform can tell, within sane
+ * limits. Submitted data then still is in the cache when the session
+ * feed's consumers process the packet.
+ */
+#define FEED_QUEUE_CACHE_DEFAULT	(256 * 1024)
+#define FEED_QUEUE_CACHE_MIN		(64 * 1024)
+#define FEED_QUEUE_CACHE_MAX		(4 * 1024 * 1024)
 
 struct feed_queue_logic {
 	const struct sr_dev_inst *sdi;
@@ -27,16 +38,51 @@ struct feed_queue_logic {
 	size_t alloc_count;
 	size_t fill_count;
 	uint8_t *data_bytes;
+	uint64_t *run_lengths;
+	gboolean rle;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle logic_rle;
 };
 
+static size_t feed_queue_cache_size(void)
+{
+	static gsize cache_size;
+	gsize size;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	long l2_size;
+#endif
+
+	if (g_once_init_enter(&cache_size)) {
+		size = FEED_QUEUE_CACHE_DEFAULT;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+		l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+		if (l2_size > 0)
+			size = l2_size / 2;
+#endif
+		size = CLAMP(size, FEED_QUEUE_CACHE_MIN, FEED_QUEUE_CACHE_MAX);
+		g_once_init_leave(&cache_size, size);
+	}
+
+	return cache_size;
+}
+
+/*
+ * A sample_count of zero lets the library size the buffer, which is
+ * the preferred choice unless the caller has specific needs.
+ */
 SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	const struct sr_dev_inst *sdi,
 	size_t sample_count, size_t unit_size)
 {
 	struct feed_queue_logic *q;
 
+	if (!unit_size)
+		return NULL;
+
+	if (!sample_count)
+		sample_count = feed_queue_cache_size() / unit_size;
+
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
 	q->unit_size = unit_size;
@@ -49,30 +95,96 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 
 	memset(&q->packet, 0, sizeof(q->packet));
 	memset(&q->logic, 0, sizeof(q->logic));
+	memset(&q->logic_rle, 0, sizeof(q->logic_rle));
 	q->packet.type = SR_DF_LOGIC;
 	q->packet.payload = &q->logic;
 	q->logic.unitsize = q->unit_size;
 	q->logic.data = q->data_bytes;
+	q->logic_rle.unitsize = q->unit_size;
+	q->logic_rle.values = q->data_bytes;
 
 	return q;
 }
 
+/*
+ * Accumulate (value, run length) pairs instead of samples when the
+ * session's consumers currently accept run-length encoded data. The
+ * fill count then counts runs. Callbacks and transforms can come and
+ * go between packets, so this is checked again for every packet the
+ * queue starts to fill. Packets which were started in RLE mode remain
+ * valid, the session expands them for consumers which need it.
+ */
+static void feed_queue_logic_select_mode(struct feed_queue_logic *q)
+{
+	gboolean rle;
+
+	if (q->fill_count)
+		return;
+
+	rle = q->sdi && sr_session_accepts_logic_rle(q->sdi->session);
+	if (rle && !q->run_lengths) {
+		q->run_lengths = g_try_malloc(q->alloc_count * sizeof(uint64_t));
+		q->logic_rle.lengths = q->run_lengths;
+	}
+	q->rle = rle && q->run_lengths != NULL;
+
+	if (q->rle) {
+		q->packet.type = SR_DF_LOGIC_RLE;
+		q->packet.payload = &q->logic_rle;
+	} else {
+		q->packet.type = SR_DF_LOGIC;
+		q->packet.payload = &q->logic;
+	}
+}
+
+static int feed_queue_logic_submit_run(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count)
+{
+	uint8_t *last;
+
+	if (!count)
+		return SR_OK;
+
+	/* Extend the previous run when the value did not change. */
+	if (q->fill_count) {
+		last = &q->data_bytes[(q->fill_count - 1) * q->unit_size];
+		if (memcmp(last, data, q->unit_size) == 0) {
+			q->run_lengths[q->fill_count - 1] += count;
+			return SR_OK;
+		}
+	}
+
+	memcpy(&q->data_bytes[q->fill_count * q->unit_size],
+		data, q->unit_size);
+	q->run_lengths[q->fill_count] = count;
+	q->fill_count++;
+	if (q->fill_count == q->alloc_count)
+		return feed_queue_logic_flush(q);
+
+	return SR_OK;
+}
+
 SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count)
 {
-	uint8_t *wrptr;
+	size_t space, copy_count;
 	int ret;
 
-	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (repeat_count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	feed_queue_logic_select_mode(q);
+	if (q->rle)
+		return feed_queue_logic_submit_run(q, data, repeat_count);
+
+	while (repeat_count) {
+		space = q->alloc_count - q->fill_count;
+		copy_count = MIN(repeat_count, space);
+		sr_logic_fill(&q->data_bytes[q->fill_count * q->unit_size],
+			data, q->unit_size, copy_count);
+		repeat_count -= copy_count;
+		q->fill_count += copy_count;
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
 	}
 
@@ -86,6 +198,17 @@ SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	size_t space, copy_count;
 	int ret;
 
+	feed_queue_logic_select_mode(q);
+	if (q->rle) {
+		while (samples_count--) {
+			ret = feed_queue_logic_submit_run(q, data, 1);
+			if (ret != SR_OK)
+				return ret;
+			data += q->unit_size;
+		}
+		return SR_OK;
+	}
+
 	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
 	while (samples_count) {
 		space = q->alloc_count - q->fill_count;
@@ -108,6 +231,35 @@ SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	return SR_OK;
 }
 
+/*
+ * Submit a sequence of (value, repeat count) pairs in one call. The
+ * values array holds run_count samples of the queue's unit size. This
+ * suits sources which are run-length encoded themselves, and saves a
+ * call per run when the session feed accepts run-length encoded data.
+ */
+SR_API int feed_queue_logic_submit_runs(struct feed_queue_logic *q,
+	const uint8_t *values, const size_t *counts, size_t run_count)
+{
+	int ret;
+
+	if (!q || (run_count && (!values || !counts)))
+		return SR_ERR_ARG;
+
+	while (run_count--) {
+		feed_queue_logic_select_mode(q);
+		if (q->rle)
+			ret = feed_queue_logic_submit_run(q, values, *counts);
+		else
+			ret = feed_queue_logic_submit_one(q, values, *counts);
+		if (ret != SR_OK)
+			return ret;
+		values += q->unit_size;
+		counts++;
+	}
+
+	return SR_OK;
+}
+
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 {
 	int ret;
@@ -116,6 +268,7 @@ SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 		return SR_OK;
 
 	q->logic.length = q->fill_count * q->unit_size;
+	q->logic_rle.num_runs = q->fill_count;
 	ret = sr_session_send(q->sdi, &q->packet);
 	if (ret != SR_OK)
 		return ret;
@@ -146,6 +299,7 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 		return;
 
 	g_free(q->data_bytes);
+	g_free(q->run_lengths);
 	g_free(q);
 }
 
@@ -42,6 +42,12 @@
  *   only this many timescale ticks. This can speed up operation on long
  *   captures (default 0, don't compress).
  *
+ * mapfile: Name of the input file, when the application wants the data
+ *   section to get read from a memory mapping of that file (default
+ *   empty, process the application's chunks). The application still
+ *   must send the file's content, which paces the import and is checked
+ *   against the mapping.
+ *
  * Based on Verilog standard IEEE Std 1364-2001 Version C
  *
  * Supported features:
@@ -68,6 +74,12 @@
  * factors. This motivated this module's custom code for splitting
  * words on text lines, and pooling previously allocated buffers.
  *
+ * When the application opts in by means of the mapfile option, the data
+ * section gets read from a memory mapping of the file, and gets tokenized
+ * by several threads in parallel. The application's chunks only get
+ * counted then. Line based processing of the received chunks remains
+ * the reference, and serves as a fallback.
+ *
  * TODO (in arbitrary order)
  * - Map VCD scopes to sigrok channel groups?
  *   - Does libsigrok support nested channel groups? Or is this feature
@@ -109,6 +121,7 @@
 #include <config.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 #include <stdio.h>
@@ -120,6 +133,19 @@
 #define CHUNK_SIZE (4 * 1024 * 1024)
 #define SCOPE_SEP '.'
 
+/*
+ * VCD identifiers consist of printable ASCII characters. Interpreting
+ * their text as a base-94 number with digits 1-94 (least significant
+ * character first) results in a unique index per identifier. Popular
+ * generators assign identifiers in sequence, which keeps the indices
+ * dense enough for a direct lookup table. Identifiers beyond the table
+ * size limit get looked up by their text.
+ */
+#define VCD_ID_CHAR_MIN '!'
+#define VCD_ID_CHAR_MAX '~'
+#define VCD_ID_RADIX (VCD_ID_CHAR_MAX + 1 - VCD_ID_CHAR_MIN)
+#define VCD_ID_INDEX_MAX (256 * 1024)
+
 struct context {
 	struct vcd_user_opt {
 		size_t maxchannels; /* sigrok channels (output) */
@@ -127,6 +153,7 @@ struct context {
 		uint64_t compress;
 		uint64_t skip_starttime;
 		gboolean skip_specified;
+		char *mapfile;
 	} options;
 	gboolean use_skip;
 	gboolean started;
@@ -134,7 +161,12 @@ struct context {
 	uint64_t prev_timestamp;
 	uint64_t samplerate;
 	size_t vcdsignals; /* VCD signals (input) */
-	GSList *ignored_signals;
+	GHashTable *signals;
+	struct {
+		struct vcd_signal **table;
+		size_t size;
+		gboolean have_sparse;
+	} signal_index;
 	gboolean data_after_timestamp;
 	gboolean ignore_end_keyword;
 	gboolean skip_until_end;
@@ -168,6 +200,13 @@ struct context {
 		GSList *sr_channels;
 		GSList *sr_groups;
 	} prev;
+	struct {
+		gboolean checked;
+		uint64_t rcvd_bytes;
+		GMappedFile *file;
+		const char *text;
+		size_t size, pos;
+	} mapped;
 };
 
 struct vcd_channel {
@@ -184,6 +223,19 @@ struct vcd_channel {
 	struct feed_queue_analog *feed_analog;
 };
 
+/*
+ * A VCD identifier and the channels which were declared for it. Value
+ * changes in the data section reference identifiers. Several $var
+ * declarations can share one identifier, some declarations get ignored
+ * (unsupported types, channel count limit).
+ */
+struct vcd_signal {
+	char *identifier;
+	gboolean ignored;
+	size_t channel_count;
+	struct vcd_channel **channels;
+};
+
 static void free_channel(void *data)
 {
 	struct vcd_channel *vcd_ch;
@@ -200,6 +252,160 @@ static void free_channel(void *data)
 	g_free(vcd_ch);
 }
 
+static void free_signal(void *data)
+{
+	struct vcd_signal *sig;
+
+	sig = data;
+	if (!sig)
+		return;
+
+	g_free(sig->identifier);
+	g_free(sig->channels);
+
+	g_free(sig);
+}
+
+static struct vcd_signal *get_signal(struct context *inc, const char *id)
+{
+	struct vcd_signal *sig;
+
+	if (!inc->signals) {
+		inc->signals = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, free_signal);
+	}
+	sig = g_hash_table_lookup(inc->signals, id);
+	if (sig)
+		return sig;
+
+	sig = g_malloc0(sizeof(*sig));
+	sig->identifier = g_strdup(id);
+	g_hash_table_insert(inc->signals, sig->identifier, sig);
+
+	return sig;
+}
+
+static void add_signal_channel(struct context *inc, struct vcd_channel *vcd_ch)
+{
+	struct vcd_signal *sig;
+
+	sig = get_signal(inc, vcd_ch->identifier);
+	sig->channels = g_renew(struct vcd_channel *, sig->channels,
+		sig->channel_count + 1);
+	sig->channels[sig->channel_count++] = vcd_ch;
+}
+
+static void ignore_signal(struct context *inc, const char *id)
+{
+	get_signal(inc, id)->ignored = TRUE;
+}
+
+/*
+ * Get an identifier's index into the signal table. Fails for text
+ * which is not a valid identifier, and for indices at or above the
+ * given limit.
+ */
+static gboolean get_signal_index(const char *id, size_t len,
+	size_t limit, size_t *index)
+{
+	size_t value, weight, pos;
+	uint8_t c;
+
+	if (!len)
+		return FALSE;
+
+	value = 0;
+	weight = 1;
+	for (pos = 0; pos < len; pos++) {
+		c = id[pos];
+		if (c < VCD_ID_CHAR_MIN || c > VCD_ID_CHAR_MAX)
+			return FALSE;
+		value += (c + 1 - VCD_ID_CHAR_MIN) * weight;
+		if (value >= limit)
+			return FALSE;
+		weight *= VCD_ID_RADIX;
+	}
+	*index = value;
+
+	return TRUE;
+}
+
+/*
+ * Setup direct lookup of signals by their identifier, after all
+ * declarations were seen in the header.
+ */
+static void build_signal_index(struct context *inc)
+{
+	GHashTableIter iter;
+	gpointer value;
+	struct vcd_signal *sig;
+	size_t index, size;
+
+	if (!inc->signals)
+		return;
+
+	size = 0;
+	g_hash_table_iter_init(&iter, inc->signals);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		sig = value;
+		if (get_signal_index(sig->identifier, strlen(sig->identifier),
+				VCD_ID_INDEX_MAX, &index))
+			size = MAX(size, index + 1);
+	}
+	inc->signal_index.table = g_malloc0(size * sizeof(sig));
+	inc->signal_index.size = size;
+	inc->signal_index.have_sparse = FALSE;
+
+	g_hash_table_iter_init(&iter, inc->signals);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		sig = value;
+		if (get_signal_index(sig->identifier, strlen(sig->identifier),
+				size, &index))
+			inc->signal_index.table[index] = sig;
+		else
+			inc->signal_index.have_sparse = TRUE;
+	}
+	sr_dbg("Signal index size %zu, %s sparse identifiers.", size,
+		inc->signal_index.have_sparse ? "with" : "without");
+}
+
+/*
+ * Lookup a signal by its identifier (not necessarily NUL terminated).
+ * Identifiers which are not in the index can only be found by their
+ * text when sparse identifiers exist, unknown identifiers (or those
+ * of ignored signals) don't involve string compares.
+ */
+static struct vcd_signal *lookup_signal_len(struct context *inc,
+	const char *id, size_t len)
+{
+	char text[32], *long_text;
+	struct vcd_signal *sig;
+	size_t index;
+
+	if (get_signal_index(id, len, inc->signal_index.size, &index))
+		return inc->signal_index.table[index];
+	if (!inc->signal_index.have_sparse && inc->signal_index.table)
+		return NULL;
+	if (!inc->signals)
+		return NULL;
+
+	if (len < sizeof(text)) {
+		memcpy(text, id, len);
+		text[len] = '\0';
+		return g_hash_table_lookup(inc->signals, text);
+	}
+	long_text = g_strndup(id, len);
+	sig = g_hash_table_lookup(inc->signals, long_text);
+	g_free(long_text);
+
+	return sig;
+}
+
+static struct vcd_signal *lookup_signal(struct context *inc, const char *id)
+{
+	return lookup_signal_len(inc, id, strlen(id));
+}
+
 /*
  * Another timestamp delta was observed, update statistics: Update the
  * sorted list of minimum values, and increment the occurance counter.
@@ -715,8 +921,7 @@ static int parse_header_var(struct context *inc, char *contents)
 	} else if (is_str) {
 		sr_warn("Skipping id %s, name '%s%s', unsupported type '%s'.",
 			id, ref, idx ? idx : "", type);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		ignore_signal(inc, id);
 		return SR_OK;
 	} else {
 		sr_err("Unsupported signal type: '%s'", type);
@@ -753,8 +958,7 @@ static int parse_header_var(struct context *inc, char *contents)
 	if (inc->options.maxchannels && next_size > inc->options.maxchannels) {
 		sr_warn("Skipping '%s%s', exceeds requested channel count %zu.",
 			ref, idx ? idx : "", inc->options.maxchannels);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		ignore_signal(inc, id);
 		return SR_OK;
 	}
 
@@ -783,6 +987,7 @@ static int parse_header_var(struct context *inc, char *contents)
 		vcd_ch->type == SR_CHANNEL_ANALOG ? "A" : "L",
 		vcd_ch->array_index);
 	inc->channels = g_slist_append(inc->channels, vcd_ch);
+	add_signal_channel(inc, vcd_ch);
 
 	return SR_OK;
 }
@@ -955,7 +1160,7 @@ static void create_feeds(const struct sr_input *in)
 	if (inc->logic_count) {
 		inc->unit_size = (inc->logic_count + 7) / 8;
 		inc->feed_logic = feed_queue_logic_alloc(in->sdi,
-			CHUNK_SIZE / inc->unit_size, inc->unit_size);
+			0, inc->unit_size);
 	}
 
 	/* Create one feed per analog channel. */
@@ -1092,6 +1297,8 @@ done_section:
 	if (!inc->got_header)
 		return SR_ERR_DATA;
 
+	build_signal_index(inc);
+
 	/* Create sigrok channels here, late, logic before analog. */
 	create_channels(in, in->sdi, SR_CHANNEL_LOGIC);
 	create_channels(in, in->sdi, SR_CHANNEL_ANALOG);
@@ -1171,17 +1378,12 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
-{
-	return strcmp((const char *)a, (const char *)b);
-}
-
 static gboolean is_ignored(struct context *inc, const char *id)
 {
-	GSList *ignored;
+	struct vcd_signal *sig;
 
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
+	sig = lookup_signal(inc, id);
+	return sig && sig->ignored;
 }
 
 /*
@@ -1191,7 +1393,7 @@ static gboolean is_ignored(struct context *inc, const char *id)
  * channels may further constraint the number of significant digits
  * (current asumption: float -> 23bit).
  */
-static float get_int_val(uint8_t *in_bits_data, size_t in_bits_count)
+static float get_int_val(const uint8_t *in_bits_data, size_t in_bits_count)
 {
 	uint64_t int_value;
 	size_t byte_count, byte_idx;
@@ -1211,30 +1413,30 @@ static float get_int_val(uint8_t *in_bits_data, size_t in_bits_count)
 }
 
 /*
- * Set a logic channel's level depending on the VCD signal's identifier
- * and parsed value. Multi-bit VCD values will affect several sigrok
- * channels. One VCD signal name can translate to several sigrok channels.
+ * Set a logic channel's level depending on the VCD signal's parsed
+ * value. Multi-bit VCD values will affect several sigrok channels. One
+ * VCD signal name can translate to several sigrok channels. Returns
+ * whether the signal has channels which took the value.
  */
-static void process_bits(struct context *inc, char *identifier,
-	uint8_t *in_bits_data, size_t in_bits_count)
+static gboolean signal_set_bits(struct context *inc, struct vcd_signal *sig,
+	const uint8_t *in_bits_data, size_t in_bits_count)
 {
 	size_t size;
 	gboolean have_int;
-	GSList *l;
+	size_t ch_idx;
 	struct vcd_channel *vcd_ch;
 	float int_val;
 	size_t bit_idx;
-	uint8_t *in_bit_ptr, in_bit_mask;
+	const uint8_t *in_bit_ptr;
+	uint8_t in_bit_mask;
 	uint8_t *out_bit_ptr, out_bit_mask;
 	uint8_t bit_val;
 
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
-		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
+	for (ch_idx = 0; ch_idx < sig->channel_count; ch_idx++) {
+		vcd_ch = sig->channels[ch_idx];
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1249,7 +1451,7 @@ static void process_bits(struct context *inc, char *identifier,
 			continue;
 		sr_spew("Processing %s data, id '%s', ch %zu sz %zu",
 			(size == 1) ? "bit" : "vector",
-			identifier, vcd_ch->array_index, vcd_ch->size);
+			sig->identifier, vcd_ch->array_index, vcd_ch->size);
 
 		/* Found our (logic) channel. Setup in/out bit positions. */
 		size = vcd_ch->size;
@@ -1290,35 +1492,58 @@ static void process_bits(struct context *inc, char *identifier,
 			}
 		}
 	}
-	if (!size && !is_ignored(inc, identifier))
-		sr_warn("VCD signal not found for ID '%s'.", identifier);
+
+	return size != 0;
 }
 
 /*
  * Set an analog channel's value from a floating point number. One
- * VCD signal name can translate to several sigrok channels.
+ * VCD signal name can translate to several sigrok channels. Returns
+ * whether the signal has analog channels.
  */
-static void process_real(struct context *inc, char *identifier, float real_val)
+static gboolean signal_set_real(struct context *inc, struct vcd_signal *sig,
+	float real_val)
 {
 	gboolean found;
-	GSList *l;
+	size_t ch_idx;
 	struct vcd_channel *vcd_ch;
 
 	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
-		vcd_ch = l->data;
+	for (ch_idx = 0; ch_idx < sig->channel_count; ch_idx++) {
+		vcd_ch = sig->channels[ch_idx];
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
 		found = TRUE;
 		sr_spew("Processing real data, id '%s', ch %zu, val %.16g",
-			identifier, vcd_ch->array_index, real_val);
+			sig->identifier, vcd_ch->array_index, real_val);
 		inc->current_floats[vcd_ch->array_index] = real_val;
 	}
-	if (!found && !is_ignored(inc, identifier))
+
+	return found;
+}
+
+static void process_bits(struct context *inc, char *identifier,
+	uint8_t *in_bits_data, size_t in_bits_count)
+{
+	struct vcd_signal *sig;
+
+	sig = lookup_signal(inc, identifier);
+	if (sig && signal_set_bits(inc, sig, in_bits_data, in_bits_count))
+		return;
+	if (!sig || !sig->ignored)
+		sr_warn("VCD signal not found for ID '%s'.", identifier);
+}
+
+static void process_real(struct context *inc, char *identifier, float real_val)
+{
+	struct vcd_signal *sig;
+
+	sig = lookup_signal(inc, identifier);
+	if (sig && signal_set_real(inc, sig, real_val))
+		return;
+	if (!sig || !sig->ignored)
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
@@ -1456,6 +1681,88 @@ static gboolean vcd_string_valid(const char *s)
 	return TRUE;
 }
 
+/*
+ * Numbers prefixed by '#' are timestamps, which translate to sigrok
+ * sample numbers. Apply optional downsampling, and apply the 'skip'
+ * logic. Check the recent timestamp for plausibility. Submit the
+ * corresponding number of samples of previously accumulated data
+ * values to the session feed.
+ */
+static int process_timestamp(const struct sr_input *in, uint64_t timestamp)
+{
+	struct context *inc;
+	size_t count;
+	int ret;
+
+	inc = in->priv;
+
+	sr_spew("Got timestamp: %" PRIu64, timestamp);
+	ret = ts_stats_check(&inc->ts_stats, timestamp);
+	if (ret != SR_OK)
+		return ret;
+	if (inc->options.downsample > 1) {
+		timestamp /= inc->options.downsample;
+		sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
+	}
+
+	/*
+	 * Skip < 0 => skip until first timestamp.
+	 * Skip = 0 => don't skip
+	 * Skip > 0 => skip until timestamp >= skip.
+	 */
+	if (inc->options.skip_specified && !inc->use_skip) {
+		sr_dbg("Seeding skip from user spec %" PRIu64,
+			inc->options.skip_starttime);
+		inc->prev_timestamp = inc->options.skip_starttime;
+		inc->use_skip = TRUE;
+	}
+	if (!inc->use_skip) {
+		sr_dbg("Seeding skip from first timestamp");
+		inc->options.skip_starttime = timestamp;
+		inc->prev_timestamp = timestamp;
+		inc->use_skip = TRUE;
+		return SR_OK;
+	}
+	if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
+		sr_spew("Timestamp skipped, before user spec");
+		inc->prev_timestamp = inc->options.skip_starttime;
+		return SR_OK;
+	}
+	if (timestamp == inc->prev_timestamp) {
+		/*
+		 * Ignore repeated timestamps (e.g. sigrok outputs
+		 * these). Can also happen when downsampling makes
+		 * distinct input values end up at the same scaled
+		 * down value. Also transparently covers the initial
+		 * timestamp.
+		 */
+		sr_spew("Timestamp is identical to previous timestamp");
+		return SR_OK;
+	}
+	if (timestamp < inc->prev_timestamp) {
+		sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
+		return SR_ERR_DATA;
+	}
+	if (inc->options.compress) {
+		/* Compress long idle periods */
+		count = timestamp - inc->prev_timestamp;
+		if (count > inc->options.compress) {
+			sr_dbg("Long idle period, compressing");
+			count = timestamp - inc->options.compress;
+			inc->prev_timestamp = count;
+		}
+	}
+
+	/* Generate samples from prev_timestamp up to timestamp - 1. */
+	count = timestamp - inc->prev_timestamp;
+	sr_spew("Got a new timestamp, feeding %zu samples", count);
+	add_samples(in, count, FALSE);
+	inc->prev_timestamp = timestamp;
+	inc->data_after_timestamp = FALSE;
+
+	return SR_OK;
+}
+
 /* Parse one text line of the data section. */
 static int parse_textline(const struct sr_input *in, char *line)
 {
@@ -1466,7 +1773,6 @@ static int parse_textline(const struct sr_input *in, char *line)
 	gboolean is_real, is_multibit, is_singlebit, is_string;
 	uint64_t timestamp;
 	char *identifier, *endptr;
-	size_t count;
 
 	inc = in->priv;
 
@@ -1552,14 +1858,7 @@ static int parse_textline(const struct sr_input *in, char *line)
 			continue;
 		}
 
-		/*
-		 * Numbers prefixed by '#' are timestamps, which translate
-		 * to sigrok sample numbers. Apply optional downsampling,
-		 * and apply the 'skip' logic. Check the recent timestamp
-		 * for plausibility. Submit the corresponding number of
-		 * samples of previously accumulated data values to the
-		 * session feed.
-		 */
+		/* Numbers prefixed by '#' are timestamps. */
 		is_timestamp = curr_first == '#' && g_ascii_isdigit(curr_word[1]);
 		if (is_timestamp) {
 			endptr = NULL;
@@ -1569,71 +1868,9 @@ static int parse_textline(const struct sr_input *in, char *line)
 				ret = SR_ERR_DATA;
 				break;
 			}
-			sr_spew("Got timestamp: %" PRIu64, timestamp);
-			ret = ts_stats_check(&inc->ts_stats, timestamp);
+			ret = process_timestamp(in, timestamp);
 			if (ret != SR_OK)
 				break;
-			if (inc->options.downsample > 1) {
-				timestamp /= inc->options.downsample;
-				sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
-			}
-
-			/*
-			 * Skip < 0 => skip until first timestamp.
-			 * Skip = 0 => don't skip
-			 * Skip > 0 => skip until timestamp >= skip.
-			 */
-			if (inc->options.skip_specified && !inc->use_skip) {
-				sr_dbg("Seeding skip from user spec %" PRIu64,
-					inc->options.skip_starttime);
-				inc->prev_timestamp = inc->options.skip_starttime;
-				inc->use_skip = TRUE;
-			}
-			if (!inc->use_skip) {
-				sr_dbg("Seeding skip from first timestamp");
-				inc->options.skip_starttime = timestamp;
-				inc->prev_timestamp = timestamp;
-				inc->use_skip = TRUE;
-				continue;
-			}
-			if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
-				sr_spew("Timestamp skipped, before user spec");
-				inc->prev_timestamp = inc->options.skip_starttime;
-				continue;
-			}
-			if (timestamp == inc->prev_timestamp) {
-				/*
-				 * Ignore repeated timestamps (e.g. sigrok
-				 * outputs these). Can also happen when
-				 * downsampling makes distinct input values
-				 * end up at the same scaled down value.
-				 * Also transparently covers the initial
-				 * timestamp.
-				 */
-				sr_spew("Timestamp is identical to previous timestamp");
-				continue;
-			}
-			if (timestamp < inc->prev_timestamp) {
-				sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
-				ret = SR_ERR_DATA;
-				break;
-			}
-			if (inc->options.compress) {
-				/* Compress long idle periods */
-				count = timestamp - inc->prev_timestamp;
-				if (count > inc->options.compress) {
-					sr_dbg("Long idle period, compressing");
-					count = timestamp - inc->options.compress;
-					inc->prev_timestamp = count;
-				}
-			}
-
-			/* Generate samples from prev_timestamp up to timestamp - 1. */
-			count = timestamp - inc->prev_timestamp;
-			sr_spew("Got a new timestamp, feeding %zu samples", count);
-			add_samples(in, count, FALSE);
-			inc->prev_timestamp = timestamp;
-			inc->data_after_timestamp = FALSE;
 			continue;
 		}
 		inc->data_after_timestamp = TRUE;
@@ -1853,11 +2090,31 @@ static int parse_textline(const struct sr_input *in, char *line)
 	return ret;
 }
 
-static int process_buffer(struct sr_input *in, gboolean is_eof)
+/* Send feed header and samplerate (once) before sample data. */
+static void start_feed(const struct sr_input *in)
 {
 	struct context *inc;
 	uint64_t samplerate;
 	GVariant *gvar;
+
+	inc = in->priv;
+	if (inc->started)
+		return;
+
+	std_session_send_df_header(in->sdi);
+
+	samplerate = inc->samplerate / inc->options.downsample;
+	if (samplerate) {
+		gvar = g_variant_new_uint64(samplerate);
+		sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE, gvar);
+	}
+
+	inc->started = TRUE;
+}
+
+static int process_buffer(struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
 	int ret;
 	char *rdptr, *line;
 	size_t taken, rdlen;
@@ -1867,18 +2124,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	if (!inc->got_header)
 		return SR_ERR_DATA;
 
-	/* Send feed header and samplerate (once) before sample data. */
-	if (!inc->started) {
-		std_session_send_df_header(in->sdi);
-
-		samplerate = inc->samplerate / inc->options.downsample;
-		if (samplerate) {
-			gvar = g_variant_new_uint64(samplerate);
-			sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE, gvar);
-		}
-
-		inc->started = TRUE;
-	}
+	start_feed(in);
 
 	/*
 	 * Workaround broken generators which output incomplete text
@@ -1908,6 +2154,618 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 	return ret;
 }
 
+/*
+ * Import from a memory mapped input file. When the application passed
+ * the file name, the data section gets taken from the mapping instead
+ * of the application's chunks. Which still pace the import: only text
+ * which the application has sent so far gets processed, and control
+ * returns to the application between batches of chunks. The text gets
+ * split into chunks at timestamp lines. Worker
+ * threads tokenize chunks and resolve identifiers, the main thread
+ * applies the value changes in their original order and feeds the
+ * session. Text which does not tokenize, or section state which spans
+ * chunk boundaries, is handed to the line based parser. Which remains
+ * the reference implementation, including diagnostics.
+ */
+
+#define MAPPED_CHUNK_SIZE (512 * 1024)
+#define MAPPED_MAX_THREADS 8
+#define MAPPED_WORD_MAX 64
+
+enum vcd_token_type {
+	TOKEN_TIMESTAMP,
+	TOKEN_BITS,
+	TOKEN_REAL,
+	TOKEN_OTHER,	/* Value without effect (string, ignored signal). */
+	TOKEN_UNKNOWN,	/* Value for an unknown identifier. */
+	TOKEN_ERROR,	/* Text needs the line based parser. */
+};
+
+struct vcd_token {
+	enum vcd_token_type type;
+	uint32_t count;	/* Bit count, or identifier length. */
+	struct vcd_signal *signal;
+	union {
+		uint64_t timestamp;
+		float real;
+		uint8_t bit;
+		size_t bits_pos;
+		const char *text;
+	} u;
+};
+
+struct vcd_chunk_job {
+	const char *start, *end;
+	gboolean skip_until_end, ignore_end_keyword;
+	struct vcd_token *tokens;
+	size_t token_count, token_alloc;
+	uint8_t *bits;
+	size_t bits_len, bits_alloc;
+	gboolean done;
+};
+
+struct vcd_mapped_import {
+	struct context *inc;
+	GThreadPool *pool;
+	GQueue *jobs;
+	GSList *free_jobs;
+	GMutex mutex;
+	GCond cond;
+};
+
+static int num_processors(void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	return g_get_num_processors();
+#else
+	return 1;
+#endif
+}
+
+/*
+ * Get the next space separated word, without modifying the input text.
+ * Optionally does not advance to the next text line, for words which
+ * must follow another word on the same line.
+ */
+static const char *mapped_next_word(const char *p, const char *end,
+	gboolean same_line, size_t *len)
+{
+	const char *word;
+
+	while (p < end && g_ascii_isspace(*p)) {
+		if (same_line && *p == '\n')
+			return NULL;
+		p++;
+	}
+	if (p == end)
+		return NULL;
+	word = p;
+	while (p < end && *p && !g_ascii_isspace(*p))
+		p++;
+	*len = p - word;
+
+	return word;
+}
+
+static gboolean mapped_word_is(const char *word, size_t len, const char *text)
+{
+	return len == strlen(text) && memcmp(word, text, len) == 0;
+}
+
+static struct vcd_token *mapped_add_token(struct vcd_chunk_job *job)
+{
+	if (job->token_count == job->token_alloc) {
+		job->token_alloc = MAX(1024, 2 * job->token_alloc);
+		job->tokens = g_renew(struct vcd_token, job->tokens,
+			job->token_alloc);
+	}
+
+	return &job->tokens[job->token_count++];
+}
+
+static uint8_t *mapped_add_bits(struct vcd_chunk_job *job, size_t size)
+{
+	uint8_t *bits;
+
+	if (job->bits_len + size > job->bits_alloc) {
+		job->bits_alloc = MAX(job->bits_len + size, 2 * job->bits_alloc);
+		job->bits_alloc = MAX(job->bits_alloc, 4096);
+		job->bits = g_realloc(job->bits, job->bits_alloc);
+	}
+	bits = &job->bits[job->bits_len];
+	job->bits_len += size;
+	memset(bits, 0, size);
+
+	return bits;
+}
+
+/*
+ * Tokenize a chunk of the data section. Follows the logic of the line
+ * based parse_textline() routine, but stops at the first word which
+ * that routine would have to complain about, or which would take more
+ * effort to handle here than it's worth. The section state at the end
+ * of the chunk (or at the error location) is kept in the job.
+ */
+static void tokenize_chunk(struct context *inc, struct vcd_chunk_job *job)
+{
+	const char *p, *end, *word, *id;
+	size_t len, id_len, bit_count, bit_idx;
+	char first, text[MAPPED_WORD_MAX + 1], *str_value;
+	struct vcd_token *tok;
+	struct vcd_signal *sig;
+	uint64_t timestamp;
+	uint8_t *bits, bit_value;
+	float real_val;
+	gboolean valid;
+
+	job->token_count = 0;
+	job->bits_len = 0;
+	p = job->start;
+	end = job->end;
+	while ((word = mapped_next_word(p, end, FALSE, &len))) {
+		p = word + len;
+		tok = mapped_add_token(job);
+		tok->type = TOKEN_ERROR;
+		tok->u.text = word;
+		if (p < end && !*p)
+			return;
+		first = g_ascii_tolower(word[0]);
+
+		if (job->skip_until_end) {
+			if (mapped_word_is(word, len, "$end"))
+				job->skip_until_end = FALSE;
+			job->token_count--;
+			continue;
+		}
+		if (job->ignore_end_keyword && mapped_word_is(word, len, "$end")) {
+			job->ignore_end_keyword = FALSE;
+			job->token_count--;
+			continue;
+		}
+		if (first == '$' && len > 1) {
+			if (mapped_word_is(word, len, "$dumpvars") ||
+			    mapped_word_is(word, len, "$dumpon") ||
+			    mapped_word_is(word, len, "$dumpoff"))
+				job->ignore_end_keyword = TRUE;
+			else
+				job->skip_until_end = TRUE;
+			job->token_count--;
+			continue;
+		}
+
+		if (first == '#' && len > 1 && g_ascii_isdigit(word[1])) {
+			timestamp = 0;
+			for (bit_idx = 1; bit_idx < len; bit_idx++) {
+				if (!g_ascii_isdigit(word[bit_idx]))
+					return;
+				if (timestamp > (UINT64_MAX - 9) / 10)
+					return;
+				timestamp *= 10;
+				timestamp += word[bit_idx] - '0';
+			}
+			tok->type = TOKEN_TIMESTAMP;
+			tok->u.timestamp = timestamp;
+			continue;
+		}
+
+		if (first == 'r' && len > 1) {
+			id = mapped_next_word(p, end, TRUE, &id_len);
+			if (!id || len - 1 > MAPPED_WORD_MAX)
+				return;
+			memcpy(text, &word[1], len - 1);
+			text[len - 1] = '\0';
+			if (sr_atof_ascii(text, &real_val) != SR_OK)
+				return;
+			p = id + id_len;
+			sig = lookup_signal_len(inc, id, id_len);
+			if (!sig) {
+				tok->type = TOKEN_UNKNOWN;
+				tok->u.text = id;
+				tok->count = id_len;
+				continue;
+			}
+			tok->type = TOKEN_REAL;
+			tok->signal = sig;
+			tok->u.real = real_val;
+			continue;
+		}
+
+		if (first == 'b' && len > 1) {
+			id = mapped_next_word(p, end, TRUE, &id_len);
+			bit_count = len - 1;
+			if (!id || bit_count > inc->conv_bits.max_bits)
+				return;
+			bits = (bit_count == 1) ? &tok->u.bit : NULL;
+			if (bits)
+				*bits = 0;
+			else
+				bits = mapped_add_bits(job, (bit_count + 7) / 8);
+			for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
+				bit_value = vcd_char_to_value(word[len - 1 - bit_idx], NULL);
+				if (bit_value > 1)
+					return;
+				bits[bit_idx / 8] |= bit_value << (bit_idx % 8);
+			}
+			p = id + id_len;
+			sig = lookup_signal_len(inc, id, id_len);
+			if (!sig) {
+				tok->type = TOKEN_UNKNOWN;
+				tok->u.text = id;
+				tok->count = id_len;
+				continue;
+			}
+			tok->type = TOKEN_BITS;
+			tok->signal = sig;
+			tok->count = bit_count;
+			if (bit_count > 1)
+				tok->u.bits_pos = bits - job->bits;
+			continue;
+		}
+
+		if (first == '0' || first == '1' || first == 'l' || first == 'h' ||
+		    first == 'x' || first == 'z' || first == 'u' || first == '-') {
+			id = &word[1];
+			id_len = len - 1;
+			if (!id_len) {
+				id = mapped_next_word(p, end, TRUE, &id_len);
+				if (!id)
+					return;
+				p = id + id_len;
+			}
+			sig = lookup_signal_len(inc, id, id_len);
+			if (!sig) {
+				tok->type = TOKEN_UNKNOWN;
+				tok->u.text = id;
+				tok->count = id_len;
+				continue;
+			}
+			tok->type = TOKEN_BITS;
+			tok->signal = sig;
+			tok->count = 1;
+			tok->u.bit = vcd_char_to_value(word[0], NULL);
+			continue;
+		}
+
+		if (first == 's') {
+			id = mapped_next_word(p, end, TRUE, &id_len);
+			str_value = g_strndup(&word[1], len - 1);
+			valid = vcd_string_valid(str_value);
+			g_free(str_value);
+			if (!valid || !id)
+				return;
+			sig = lookup_signal_len(inc, id, id_len);
+			if (!sig || !sig->ignored)
+				return;
+			p = id + id_len;
+			tok->type = TOKEN_OTHER;
+			continue;
+		}
+
+		/* Unknown token, have the line based parser complain. */
+		return;
+	}
+}
+
+/* Run the line based parser on a copy of read-only input text. */
+static int parse_text_copy(const struct sr_input *in,
+	const char *start, const char *end)
+{
+	GString *text;
+	char *rdptr, *line;
+	size_t rdlen;
+	int ret;
+
+	text = g_string_new_len(start, end - start);
+	g_string_append_c(text, '\n');
+
+	ret = SR_OK;
+	rdptr = text->str;
+	while (rdptr) {
+		rdlen = &text->str[text->len] - rdptr;
+		line = sr_text_next_line(rdptr, rdlen, &rdptr, NULL);
+		if (!line)
+			break;
+		if (!*line)
+			continue;
+		ret = parse_textline(in, line);
+		if (ret != SR_OK)
+			break;
+	}
+	g_string_free(text, TRUE);
+
+	return ret;
+}
+
+/* Apply a tokenized chunk's value changes, in the original order. */
+static int apply_tokens(const struct sr_input *in, struct vcd_chunk_job *job)
+{
+	struct context *inc;
+	struct vcd_token *tok;
+	const uint8_t *bits;
+	size_t idx;
+	gboolean found;
+	int ret;
+
+	inc = in->priv;
+
+	for (idx = 0; idx < job->token_count; idx++) {
+		tok = &job->tokens[idx];
+		switch (tok->type) {
+		case TOKEN_TIMESTAMP:
+			ret = process_timestamp(in, tok->u.timestamp);
+			if (ret != SR_OK)
+				return ret;
+			continue;
+		case TOKEN_BITS:
+			inc->data_after_timestamp = TRUE;
+			bits = (tok->count == 1) ? &tok->u.bit : &job->bits[tok->u.bits_pos];
+			found = signal_set_bits(inc, tok->signal, bits, tok->count);
+			if (!found && !tok->signal->ignored)
+				sr_warn("VCD signal not found for ID '%s'.",
+					tok->signal->identifier);
+			continue;
+		case TOKEN_REAL:
+			inc->data_after_timestamp = TRUE;
+			found = signal_set_real(inc, tok->signal, tok->u.real);
+			if (!found && !tok->signal->ignored)
+				sr_warn("VCD signal not found for ID '%s'.",
+					tok->signal->identifier);
+			continue;
+		case TOKEN_OTHER:
+			inc->data_after_timestamp = TRUE;
+			continue;
+		case TOKEN_UNKNOWN:
+			inc->data_after_timestamp = TRUE;
+			sr_warn("VCD signal not found for ID '%.*s'.",
+				(int)tok->count, tok->u.text);
+			continue;
+		case TOKEN_ERROR:
+			inc->skip_until_end = job->skip_until_end;
+			inc->ignore_end_keyword = job->ignore_end_keyword;
+			return parse_text_copy(in, tok->u.text, job->end);
+		}
+	}
+	inc->skip_until_end = job->skip_until_end;
+	inc->ignore_end_keyword = job->ignore_end_keyword;
+
+	return SR_OK;
+}
+
+static void chunk_worker(gpointer data, gpointer user_data)
+{
+	struct vcd_chunk_job *job;
+	struct vcd_mapped_import *imp;
+
+	job = data;
+	imp = user_data;
+
+	tokenize_chunk(imp->inc, job);
+
+	g_mutex_lock(&imp->mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&imp->cond);
+	g_mutex_unlock(&imp->mutex);
+}
+
+static void free_chunk_job(void *data)
+{
+	struct vcd_chunk_job *job;
+
+	job = data;
+	g_free(job->tokens);
+	g_free(job->bits);
+	g_free(job);
+}
+
+/* Find a chunk's end, at the start of a timestamp line. */
+static const char *mapped_chunk_end(const char *pos, const char *end)
+{
+	const char *p;
+
+	if ((size_t)(end - pos) <= MAPPED_CHUNK_SIZE)
+		return end;
+	p = pos + MAPPED_CHUNK_SIZE;
+	while ((p = memchr(p, '\n', end - p))) {
+		p++;
+		if (p == end || *p == '#')
+			return p;
+	}
+
+	return end;
+}
+
+static int process_mapped(const struct sr_input *in,
+	const char *text, size_t len)
+{
+	struct context *inc;
+	struct vcd_mapped_import imp;
+	struct vcd_chunk_job *job;
+	const char *pos, *end;
+	size_t depth;
+	int num_threads, ret;
+
+	inc = in->priv;
+
+	memset(&imp, 0, sizeof(imp));
+	imp.inc = inc;
+	imp.jobs = g_queue_new();
+	g_mutex_init(&imp.mutex);
+	g_cond_init(&imp.cond);
+
+	num_threads = MIN(num_processors(), MAPPED_MAX_THREADS);
+	if (len > MAPPED_CHUNK_SIZE && num_threads > 1) {
+		imp.pool = g_thread_pool_new(chunk_worker, &imp,
+			num_threads, FALSE, NULL);
+	}
+	depth = imp.pool ? num_threads + 1 : 1;
+	sr_dbg("Importing %zu bytes of mapped data, %d threads.",
+		len, imp.pool ? num_threads : 0);
+
+	pos = text;
+	end = text + len;
+	ret = SR_OK;
+	while (ret == SR_OK) {
+		/* Have the workers tokenize upcoming chunks. */
+		while (g_queue_get_length(imp.jobs) < depth && pos < end) {
+			job = imp.free_jobs ? imp.free_jobs->data : NULL;
+			if (job)
+				imp.free_jobs = g_slist_delete_link(imp.free_jobs, imp.free_jobs);
+			else
+				job = g_malloc0(sizeof(*job));
+			job->start = pos;
+			job->end = mapped_chunk_end(pos, end);
+			job->skip_until_end = FALSE;
+			job->ignore_end_keyword = FALSE;
+			job->done = FALSE;
+			pos = job->end;
+			g_queue_push_tail(imp.jobs, job);
+			if (imp.pool)
+				g_thread_pool_push(imp.pool, job, NULL);
+		}
+
+		job = g_queue_pop_head(imp.jobs);
+		if (!job)
+			break;
+		if (imp.pool) {
+			g_mutex_lock(&imp.mutex);
+			while (!job->done)
+				g_cond_wait(&imp.cond, &imp.mutex);
+			g_mutex_unlock(&imp.mutex);
+		} else {
+			tokenize_chunk(inc, job);
+		}
+
+		/* A section which spans chunks invalidates the tokens. */
+		if (inc->skip_until_end || inc->ignore_end_keyword)
+			ret = parse_text_copy(in, job->start, job->end);
+		else
+			ret = apply_tokens(in, job);
+		imp.free_jobs = g_slist_prepend(imp.free_jobs, job);
+	}
+
+	/* Drop jobs which did not start yet, wait for running jobs. */
+	if (imp.pool)
+		g_thread_pool_free(imp.pool, TRUE, TRUE);
+	g_queue_free_full(imp.jobs, free_chunk_job);
+	g_slist_free_full(imp.free_jobs, free_chunk_job);
+	g_mutex_clear(&imp.mutex);
+	g_cond_clear(&imp.cond);
+
+	return ret;
+}
+
+/* Find the last timestamp line's start in the text. */
+static const char *mapped_last_boundary(const char *pos, const char *end)
+{
+	const char *p;
+
+	for (p = end - 1; p > pos; p--) {
+		if (*p == '#' && p[-1] == '\n')
+			return p;
+	}
+
+	return pos;
+}
+
+/*
+ * Map the input file which the application has specified, when its
+ * content matches the previously received data. Returns SR_ERR_NA
+ * when the application's chunks need to get processed instead.
+ */
+static int map_input_file(const struct sr_input *in)
+{
+	struct context *inc;
+	const char *filename;
+	GMappedFile *file;
+	GError *error;
+	const char *text;
+	size_t size, offset;
+
+	inc = in->priv;
+
+	filename = inc->options.mapfile;
+	if (!filename || !*filename)
+		return SR_ERR_NA;
+
+	error = NULL;
+	file = g_mapped_file_new(filename, FALSE, &error);
+	if (!file) {
+		sr_warn("Cannot map %s: %s", filename, error->message);
+		g_error_free(error);
+		return SR_ERR_NA;
+	}
+	text = g_mapped_file_get_contents(file);
+	size = g_mapped_file_get_length(file);
+
+	/* Locate the received but unprocessed data in the file. */
+	offset = inc->mapped.rcvd_bytes - in->buf->len;
+	if (inc->mapped.rcvd_bytes < in->buf->len ||
+	    inc->mapped.rcvd_bytes > size ||
+	    memcmp(&text[offset], in->buf->str, in->buf->len) != 0) {
+		sr_warn("File %s differs from received data, not mapping.",
+			filename);
+		g_mapped_file_unref(file);
+		return SR_ERR_NA;
+	}
+
+	inc->mapped.file = file;
+	inc->mapped.text = text;
+	inc->mapped.size = size;
+	inc->mapped.pos = offset;
+	g_string_truncate(in->buf, 0);
+	start_feed(in);
+
+	return SR_OK;
+}
+
+/*
+ * Process the mapped file's text which the application has sent so far.
+ * Accumulates a chunk's worth of text, and stops at a timestamp line
+ * before EOF. Never accesses text beyond the received byte count, and
+ * checks that the file still holds that text. Pages beyond a truncated
+ * file's end would raise SIGBUS.
+ */
+static int process_mapped_file(const struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
+	GStatBuf st;
+	const char *pos, *end;
+	uint64_t limit;
+	int ret;
+
+	inc = in->priv;
+
+	limit = inc->mapped.rcvd_bytes;
+	if (limit > inc->mapped.size) {
+		sr_err("Received more data than mapped file %s holds.",
+			inc->options.mapfile);
+		return SR_ERR_DATA;
+	}
+	if (is_eof && limit < inc->mapped.size) {
+		sr_warn("Received %" PRIu64 " of %zu bytes of mapped file %s.",
+			limit, inc->mapped.size, inc->options.mapfile);
+	}
+	if (!is_eof && limit - inc->mapped.pos < MAPPED_CHUNK_SIZE)
+		return SR_OK;
+
+	if (g_stat(inc->options.mapfile, &st) != 0 ||
+	    (uint64_t)st.st_size < limit) {
+		sr_err("Mapped file %s was truncated.", inc->options.mapfile);
+		return SR_ERR_IO;
+	}
+
+	pos = &inc->mapped.text[inc->mapped.pos];
+	end = &inc->mapped.text[limit];
+	if (!is_eof)
+		end = mapped_last_boundary(pos, end);
+	if (end == pos)
+		return SR_OK;
+	ret = process_mapped(in, pos, end - pos);
+	inc->mapped.pos += end - pos;
+
+	return ret;
+}
+
 static int format_match(GHashTable *metadata, unsigned int *confidence)
 {
 	GString *buf, *tmpbuf;
@@ -1965,6 +2823,9 @@ static int init(struct sr_input *in, GHashTable *options)
 		inc->options.skip_starttime /= inc->options.downsample;
 	}
 
+	data = g_hash_table_lookup(options, "mapfile");
+	inc->options.mapfile = g_strdup(g_variant_get_string(data, NULL));
+
 	in->sdi = g_malloc0(sizeof(*in->sdi));
 	in->priv = inc;
 
@@ -1980,6 +2841,11 @@ static int receive(struct sr_input *in, GString *buf)
 
 	inc = in->priv;
 
+	/* Data section gets taken from the mapped file, count chunks. */
+	inc->mapped.rcvd_bytes += buf->len;
+	if (inc->mapped.file)
+		return process_mapped_file(in, FALSE);
+
 	/* Collect all input chunks, potential deferred processing. */
 	g_string_append_len(in->buf, buf->str, buf->len);
 	if (!inc->got_header && in->buf->len == buf->len)
@@ -1997,7 +2863,15 @@ static int receive(struct sr_input *in, GString *buf)
 		return SR_OK;
 	}
 
-	/* Process sample data. */
+	/* Process sample data. Prefer the mapped file when requested. */
+	if (!inc->mapped.checked) {
+		inc->mapped.checked = TRUE;
+		ret = map_input_file(in);
+		if (ret == SR_OK)
+			return process_mapped_file(in, FALSE);
+		if (ret != SR_ERR_NA)
+			return ret;
+	}
 	ret = process_buffer(in, FALSE);
 
 	return ret;
@@ -2012,7 +2886,9 @@ static int end(struct sr_input *in)
 	inc = in->priv;
 
 	/* Must complete processing of previously received chunks. */
-	if (in->sdi_ready)
+	if (in->sdi_ready && inc->mapped.file)
+		ret = process_mapped_file(in, TRUE);
+	else if (in->sdi_ready)
 		ret = process_buffer(in, TRUE);
 	else
 		ret = SR_OK;
@@ -2054,8 +2930,17 @@ static void cleanup(struct sr_input *in)
 	inc->current_floats = NULL;
 	g_string_free(inc->scope_prefix, TRUE);
 	inc->scope_prefix = NULL;
-	g_slist_free_full(inc->ignored_signals, g_free);
-	inc->ignored_signals = NULL;
+	g_free(inc->signal_index.table);
+	inc->signal_index.table = NULL;
+	inc->signal_index.size = 0;
+	if (inc->signals)
+		g_hash_table_destroy(inc->signals);
+	inc->signals = NULL;
+	if (inc->mapped.file)
+		g_mapped_file_unref(inc->mapped.file);
+	inc->mapped.file = NULL;
+	g_free(inc->options.mapfile);
+	inc->options.mapfile = NULL;
 }
 
 static int reset(struct sr_input *in)
@@ -2067,11 +2952,12 @@ static int reset(struct sr_input *in)
 	inc = in->priv;
 
 	/* Relase previously allocated resources. */
+	save = inc->options;
+	inc->options.mapfile = NULL;
 	cleanup(in);
 	g_string_truncate(in->buf, 0);
 
 	/* Restore part of the context, init() won't run again. */
-	save = inc->options;
 	prev = inc->prev;
 	memset(inc, 0, sizeof(*inc));
 	inc->options = save;
@@ -2086,6 +2972,7 @@ enum vcd_option_t {
 	OPT_DOWN_SAMPLE,
 	OPT_SKIP_COUNT,
 	OPT_COMPRESS,
+	OPT_MAPFILE,
 	OPT_MAX,
 };
 
@@ -2113,6 +3000,12 @@ static struct sr_option options[] = {
 		"Compress idle periods which are longer than the specified number of timescale ticks.",
 		NULL, NULL,
 	},
+	[OPT_MAPFILE] = {
+		"mapfile", "Memory mapped input file",
+		"Read the data section from a memory mapping of the specified file. "
+		"The file's content still must be sent, it is checked against the mapping.",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -2123,6 +3016,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_DOWN_SAMPLE].def = g_variant_ref_sink(g_variant_new_uint64(1));
 		options[OPT_SKIP_COUNT].def = g_variant_ref_sink(g_variant_new_uint64(~UINT64_C(0)));
 		options[OPT_COMPRESS].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[OPT_MAPFILE].def = g_variant_ref_sink(g_variant_new_string(""));
 	}
 
 	return options;
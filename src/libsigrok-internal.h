@@ -41,6 +41,7 @@
 #include <stdlib.h>
 
 struct zip;
+struct zip_file;
 struct zip_stat;
 
 /**
@@ -1095,6 +1096,25 @@ static inline void write_dblle_inc(uint8_t **p, double x)
 	*p += sizeof(x);
 }
 
+/**
+ * Get the position of the lowest set bit.
+ * @param[in] value Bit mask, must not be zero.
+ * @return Bit position, 0 for the LSB.
+ */
+static inline int sr_lowest_bit(uint64_t value)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(value);
+#else
+	int bit;
+
+	for (bit = 0; !(value & 1); bit++)
+		value >>= 1;
+
+	return bit;
+#endif
+}
+
 /* Portability fixes for FreeBSD. */
 #ifdef __FreeBSD__
 #define LIBUSB_CLASS_APPLICATION 0xfe
@@ -1208,6 +1228,9 @@ struct sr_context {
 	struct sr_dev_driver **driver_list;
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *libusb_ctx;
+	struct usb_event_thread *usb_event_thread;
+	/* Number of existing usb_source_add() event sources (atomic). */
+	int usb_sources;
 #endif
 	sr_resource_open_callback resource_open_cb;
 	sr_resource_close_callback resource_close_cb;
@@ -1758,6 +1781,8 @@ struct sr_dev_inst {
 	void *priv;
 	/** Session to which this device is currently assigned. */
 	struct sr_session *session;
+	/** Cached config_get() results, NULL unless enabled by the driver. */
+	struct sr_config_cache *config_cache;
 };
 
 /* Generic device instances */
@@ -1813,6 +1838,10 @@ SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *data);
 SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx);
 SR_PRIV struct sr_config *sr_config_new(uint32_t key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
+SR_PRIV void sr_config_cache_enable(struct sr_dev_inst *sdi, gint64 ttl_us,
+	const uint32_t *uncached_keys, size_t num_uncached_keys);
+SR_PRIV void sr_config_cache_invalidate(const struct sr_dev_inst *sdi);
+SR_PRIV void sr_config_cache_free(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
@@ -1848,8 +1877,29 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Pool of sample data buffers which drivers can send. */
+	struct sr_buffer_pool *buffer_pool;
+	/** Feed queue depth (packets), zero for synchronous delivery. */
+	size_t feed_queue_depth;
+	/** How to handle packets when the feed queue is full. */
+	int feed_queue_policy;
+	/** Whether the feed queue merges the devices' packets by time. */
+	gboolean feed_queue_merge;
+	/** Feed queue and its consumer thread, while the session runs. */
+	struct session_feed_queue *feed_queue;
+	/** Highest feed queue fill level seen during the session run (atomic). */
+	gint feed_queue_high_water;
+	/** Number of packets dropped during the session run (atomic). */
+	gint feed_queue_dropped;
+	/** Number of packets merged delivery passed on out of order (atomic). */
+	gint feed_queue_unordered;
+	/** Scratch buffer for expanding run-length encoded logic data. */
+	uint8_t *rle_scratch;
 };
 
+SR_PRIV struct sr_buffer *sr_session_buffer_new(struct sr_session *session,
+		size_t size);
+
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 		void *key, GSource *source);
 SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
@@ -1874,10 +1924,19 @@ SR_PRIV int sr_session_source_remove_pollfd(struct sr_session *session,
 SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
 		GIOChannel *channel);
 
+typedef int (*sr_logic_rle_expand_callback)(
+		const struct sr_datafeed_packet *packet, void *cb_data);
+SR_PRIV gboolean sr_session_accepts_logic_rle(struct sr_session *session);
+SR_PRIV int sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		sr_logic_rle_expand_callback cb, void *cb_data);
+SR_PRIV void sr_logic_fill(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count);
 SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
@@ -1893,6 +1952,35 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/*
+ * Session file format versions. Archives with lzo1x compressed capture
+ * files carry a version which older readers refuse.
+ */
+#define SR_SESSIONFILE_VERSION 2
+#define SR_SESSIONFILE_VERSION_LZO 3
+
+/* Uncompressed size of a frame in lzo1x compressed capture files. */
+#define SR_SESSIONFILE_LZO_FRAME_SIZE (256 * 1024)
+
+/** Reader state for an lzo1x compressed capture file. */
+struct sr_sessionfile_lzo_reader {
+	struct zip_file *zf;
+	uint64_t size;
+	uint8_t *frame;
+	size_t frame_len;
+	size_t frame_pos;
+	uint8_t *packed;
+};
+
+SR_PRIV int sr_sessionfile_lzo_pack(GByteArray *out,
+			const void *data, size_t length);
+SR_PRIV int sr_sessionfile_lzo_size(struct zip_file *zf, uint64_t *size);
+SR_PRIV int sr_sessionfile_lzo_open(struct sr_sessionfile_lzo_reader *rd,
+			struct zip_file *zf);
+SR_PRIV int sr_sessionfile_lzo_read(struct sr_sessionfile_lzo_reader *rd,
+			void *buf, size_t length);
+SR_PRIV void sr_sessionfile_lzo_close(struct sr_sessionfile_lzo_reader *rd);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -2009,12 +2097,16 @@ SR_PRIV void sr_hexdump_free(GString *s);
 
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+struct soft_trigger_logic_stage;
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
-	int count;
+	gboolean evaluated;
 	int unitsize;
 	int cur_stage;
+	int num_stages;
+	struct soft_trigger_logic_stage *stages;
 	uint8_t *prev_sample;
 	uint8_t *pre_trigger_buffer;
 	uint8_t *pre_trigger_head;
@@ -2218,6 +2310,17 @@ SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
+SR_PRIV int usb_event_thread_start(struct sr_context *ctx);
+SR_PRIV void usb_event_thread_stop(struct sr_context *ctx);
+struct usb_queue;
+typedef void (*usb_queue_callback)(struct libusb_transfer *transfer,
+		uint8_t *data, int length, void *cb_data);
+SR_PRIV struct usb_queue *usb_queue_new(struct sr_session *session,
+		size_t buffer_size, usb_queue_callback cb, void *cb_data);
+SR_PRIV void usb_queue_push(struct usb_queue *queue,
+		struct libusb_transfer *transfer);
+SR_PRIV void usb_queue_stop(struct usb_queue *queue);
+SR_PRIV void usb_queue_free(struct usb_queue *queue);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
@@ -2309,6 +2412,21 @@ SR_PRIV int bv_get_value(float *out, const struct binary_value_spec *spec,
  */
 SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len);
 
+/*--- backend.c -------------------------------------------------------------*/
+
+/* Vector instruction sets, see sr_cpu_features(). */
+#define SR_CPU_SSE2	(1 << 0)
+#define SR_CPU_AVX2	(1 << 1)
+
+SR_PRIV int sr_cpu_features(void);
+SR_PRIV void sr_cpu_features_limit(int features);
+
+/*--- transpose.c -----------------------------------------------------------*/
+
+SR_PRIV void sr_transpose_bits8(uint8_t *dst, const uint8_t *src);
+SR_PRIV void sr_transpose_bits16(uint16_t *dst, const uint16_t *src);
+SR_PRIV void sr_transpose_bits32(uint32_t *dst, const uint32_t *src);
+
 /*--- modbus/modbus.c -------------------------------------------------------*/
 
 struct sr_modbus_dev_inst {
@@ -2858,6 +2976,8 @@ SR_API int feed_queue_logic_submit_one(struct feed_queue_logic *q,
 	const uint8_t *data, size_t repeat_count);
 SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
 	const uint8_t *data, size_t samples_count);
+SR_API int feed_queue_logic_submit_runs(struct feed_queue_logic *q,
+	const uint8_t *values, const size_t *counts, size_t run_count);
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q);
 SR_API int feed_queue_logic_send_trigger(struct feed_queue_logic *q);
 SR_API void feed_queue_logic_free(struct feed_queue_logic *q);
@@ -51,6 +51,11 @@
  *
  * dedup:   Don't output duplicate rows. Defaults to FALSE. If time is off, then
  *          this is forced to be off.
+ *
+ * changes: Only output rows where at least one value differs from the
+ *          previously written row, across packet boundaries. Rows which
+ *          carry a trigger mark are always written. Defaults to FALSE.
+ *          Most useful in combination with the time column.
  */
 
 #include <config.h>
@@ -63,10 +68,22 @@
 
 #define LOG_PREFIX "output/csv"
 
+/*
+ * Rows get formatted into a text buffer of fixed size which is flushed
+ * to the caller's GString when it runs out of space for another row.
+ * Upper bounds for the text length of individual values determine the
+ * maximum row length.
+ */
+#define CSV_TEXT_BUFFER_SIZE	(64 * 1024)
+#define CSV_TIME_MAX_LEN	20
+#define CSV_VALUE_MAX_LEN	G_ASCII_DTOSTR_BUF_SIZE
+
 struct ctx_channel {
 	struct sr_channel *ch;
 	char *label;
 	float min, max;
+	size_t logic_byte;
+	uint8_t logic_mask;
 };
 
 struct context {
@@ -82,6 +99,7 @@ struct context {
 	gboolean time;
 	gboolean do_trigger;
 	gboolean dedup;
+	gboolean changes;
 
 	/* Plot data */
 	unsigned int num_analog_channels;
@@ -95,10 +113,31 @@ struct context {
 	uint32_t channels_seen;
 	uint64_t sample_rate;
 	uint64_t sample_scale;
+	uint64_t time_ratio;
 	uint64_t out_sample_count;
-	uint8_t *previous_sample;
+
+	/* Sample data of the current frame, buffers get reused. */
+	gboolean have_analog, have_logic;
 	float *analog_samples;
-	uint8_t *logic_samples;
+	size_t analog_alloc;
+	const uint8_t *logic_samples;
+	uint8_t *logic_buffer;
+	size_t logic_alloc;
+	size_t logic_count, logic_unitsize;
+	uint8_t *logic_mask;
+
+	/* Values of the previously written row (dedup, changes). */
+	gboolean have_previous;
+	uint8_t *previous_logic;
+	float *previous_analog;
+
+	/* Formatted text, flushed to the output GString. */
+	struct {
+		char *data;
+		size_t len, size;
+		size_t row_size;
+	} text;
+
 	const char *xlabel;	/* Don't free: will point to a static string. */
 	const char *title;	/* Don't free: will point into the driver struct. */
 
@@ -117,6 +156,7 @@ struct context {
 static int init(struct sr_output *o, GHashTable *options)
 {
 	unsigned int i, analog_channels, logic_channels;
+	size_t num_columns;
 	struct context *ctx;
 	struct sr_channel *ch;
 	const char *label_string;
@@ -147,6 +187,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		g_hash_table_lookup(options, "label"), NULL);
 	ctx->dedup = g_variant_get_boolean(g_hash_table_lookup(options, "dedup"));
 	ctx->dedup &= ctx->time;
+	ctx->changes = g_variant_get_boolean(g_hash_table_lookup(options, "changes"));
 
 	if (*ctx->gnuplot && g_strcmp0(ctx->record, "\n"))
 		sr_warn("gnuplot record separator must be newline.");
@@ -160,8 +201,9 @@ static int init(struct sr_output *o, GHashTable *options)
 	sr_dbg("gnuplot = '%s', scale = %d", ctx->gnuplot, ctx->scale);
 	sr_dbg("value = '%s', record = '%s', frame = '%s', comment = '%s'",
 	       ctx->value, ctx->record, ctx->frame, ctx->comment);
-	sr_dbg("header = %d, time = %d, do_trigger = %d, dedup = %d",
-	       ctx->header, ctx->time, ctx->do_trigger, ctx->dedup);
+	sr_dbg("header = %d, time = %d, do_trigger = %d, dedup = %d, changes = %d",
+	       ctx->header, ctx->time, ctx->do_trigger, ctx->dedup,
+	       ctx->changes);
 	sr_dbg("label_do = %d, label_names = %d", ctx->label_do, ctx->label_names);
 
 	analog_channels = logic_channels = 0;
@@ -198,6 +240,8 @@ static int init(struct sr_output *o, GHashTable *options)
 			} else if (ch->type == SR_CHANNEL_LOGIC) {
 				ctx->channels[i].min = 0;
 				ctx->channels[i].max = 1;
+				ctx->channels[i].logic_byte = ch->index / 8;
+				ctx->channels[i].logic_mask = 1 << (ch->index % 8);
 			} else {
 				sr_warn("Unknown channel type %d.", ch->type);
 			}
@@ -207,6 +251,20 @@ static int init(struct sr_output *o, GHashTable *options)
 		}
 	}
 
+	/* Upper bound for the length of one row including separators. */
+	num_columns = ctx->num_analog_channels + ctx->num_logic_channels;
+	num_columns += ctx->time ? 1 : 0;
+	num_columns += ctx->do_trigger ? 1 : 0;
+	ctx->text.row_size = num_columns * strlen(ctx->value);
+	ctx->text.row_size += strlen(ctx->record);
+	ctx->text.row_size += ctx->time ? CSV_TIME_MAX_LEN : 0;
+	ctx->text.row_size += ctx->num_analog_channels * CSV_VALUE_MAX_LEN;
+	ctx->text.row_size += ctx->num_logic_channels;
+	ctx->text.row_size += ctx->do_trigger ? 1 : 0;
+	ctx->text.size = MAX(CSV_TEXT_BUFFER_SIZE, 4 * ctx->text.row_size);
+	ctx->text.data = g_malloc(ctx->text.size);
+	ctx->text.len = 0;
+
 	return SR_OK;
 }
 
@@ -244,6 +302,9 @@ static GString *gen_header(const struct sr_output *o,
 		}
 		if (i < ARRAY_SIZE(xlabels))
 			ctx->xlabel = xlabels[i];
+		ctx->time_ratio = 0;
+		if (ctx->sample_rate && !(ctx->sample_scale % ctx->sample_rate))
+			ctx->time_ratio = ctx->sample_scale / ctx->sample_rate;
 		sr_info("Set sample rate, scale to %" PRIu64 ", %" PRIu64 " %s",
 			ctx->sample_rate, ctx->sample_scale, ctx->xlabel);
 	}
@@ -319,7 +380,7 @@ static void process_analog(struct context *ctx,
 			   const struct sr_datafeed_analog *analog)
 {
 	int ret;
-	size_t num_rcvd_ch, num_have_ch;
+	size_t num_rcvd_ch, num_have_ch, num_copy;
 	size_t idx_have, idx_smpl, idx_rcvd;
 	size_t idx_send;
 	struct sr_analog_meaning *meaning;
@@ -327,15 +388,20 @@ static void process_analog(struct context *ctx,
 	float *fdata = NULL;
 	struct sr_channel *ch;
 
-	if (!ctx->analog_samples) {
-		ctx->analog_samples = g_malloc(analog->num_samples
-			* sizeof(float) * ctx->num_analog_channels);
+	if (!ctx->have_analog) {
+		ctx->have_analog = TRUE;
 		if (!ctx->num_samples)
 			ctx->num_samples = analog->num_samples;
 	}
 	if (ctx->num_samples != analog->num_samples)
 		sr_warn("Expecting %u analog samples, got %u.",
 			ctx->num_samples, analog->num_samples);
+	if (ctx->analog_alloc < ctx->num_samples * ctx->num_analog_channels) {
+		ctx->analog_alloc = ctx->num_samples * ctx->num_analog_channels;
+		g_free(ctx->analog_samples);
+		ctx->analog_samples = g_malloc0(ctx->analog_alloc * sizeof(float));
+	}
+	num_copy = MIN(analog->num_samples, ctx->num_samples);
 
 	meaning = analog->meaning;
 	num_rcvd_ch = g_slist_length(meaning->channels);
@@ -361,7 +427,7 @@ static void process_analog(struct context *ctx,
 				sr_analog_unit_to_string(analog,
 					&ctx->channels[idx_have].label);
 			}
-			for (idx_smpl = 0; idx_smpl < analog->num_samples; idx_smpl++)
+			for (idx_smpl = 0; idx_smpl < num_copy; idx_smpl++)
 				ctx->analog_samples[idx_smpl * ctx->num_analog_channels + idx_send] = fdata[idx_smpl * num_rcvd_ch + idx_rcvd];
 			break;
 		}
@@ -373,19 +439,24 @@ static void process_analog(struct context *ctx,
 /*
  * We treat logic packets the same as analog packets, though it's not
  * strictly required. This allows us to process mixed signals properly.
+ *
+ * Logic data is kept in its raw form, bits get extracted while rows
+ * are formatted. When the packet completes a set of samples (which is
+ * always the case for logic only input), the packet's memory is used
+ * directly. Otherwise the data is copied to a buffer which is kept
+ * across frames.
  */
 static void process_logic(struct context *ctx,
 			  const struct sr_datafeed_logic *logic)
 {
-	unsigned int i, j, ch, num_samples;
-	int idx;
-	uint8_t *sample;
+	unsigned int i, num_samples;
+	struct ctx_channel *channel;
 
 	num_samples = logic->length / logic->unitsize;
 	ctx->channels_seen += ctx->logic_channel_count;
 	sr_dbg("Logic packet had %d channels", logic->unitsize * 8);
-	if (!ctx->logic_samples) {
-		ctx->logic_samples = g_malloc(num_samples * ctx->num_logic_channels);
+	if (!ctx->have_logic) {
+		ctx->have_logic = TRUE;
 		if (!ctx->num_samples)
 			ctx->num_samples = num_samples;
 	}
@@ -393,31 +464,281 @@ static void process_logic(struct context *ctx,
 		sr_warn("Expecting %u samples, got %u",
 			ctx->num_samples, num_samples);
 
-	for (j = ch = 0; ch < ctx->num_logic_channels; j++) {
-		if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-			for (i = 0; i < num_samples; i++) {
-				sample = logic->data + i * logic->unitsize;
-				idx = ctx->channels[j].ch->index;
-				if (ctx->label_do && !ctx->label_names)
-					ctx->channels[j].label = "logic";
-				ctx->logic_samples[i * ctx->num_logic_channels + ch] = sample[idx / 8] & (1 << (idx % 8));
-			}
-			ch++;
+	if (ctx->logic_unitsize != logic->unitsize) {
+		ctx->logic_unitsize = logic->unitsize;
+		g_free(ctx->logic_mask);
+		ctx->logic_mask = g_malloc0(logic->unitsize);
+		for (i = 0; i < ctx->num_analog_channels + ctx->num_logic_channels; i++) {
+			channel = &ctx->channels[i];
+			if (channel->ch->type != SR_CHANNEL_LOGIC)
+				continue;
+			if (channel->logic_byte >= logic->unitsize)
+				continue;
+			ctx->logic_mask[channel->logic_byte] |= channel->logic_mask;
+		}
+		g_free(ctx->previous_logic);
+		ctx->previous_logic = g_malloc0(logic->unitsize);
+		ctx->have_previous = FALSE;
+	}
+
+	if (ctx->label_do && !ctx->label_names) {
+		for (i = 0; i < ctx->num_analog_channels + ctx->num_logic_channels; i++) {
+			if (ctx->channels[i].ch->type == SR_CHANNEL_LOGIC)
+				ctx->channels[i].label = "logic";
 		}
 	}
+
+	ctx->logic_count = num_samples;
+	if (ctx->channels_seen >= ctx->channel_count) {
+		ctx->logic_samples = logic->data;
+		return;
+	}
+	if (ctx->logic_alloc < logic->length) {
+		ctx->logic_alloc = logic->length;
+		g_free(ctx->logic_buffer);
+		ctx->logic_buffer = g_malloc(ctx->logic_alloc);
+	}
+	memcpy(ctx->logic_buffer, logic->data, logic->length);
+	ctx->logic_samples = ctx->logic_buffer;
 }
 
-static void dump_saved_values(struct context *ctx, GString **out)
+static char *format_u64(char *p, uint64_t value)
+{
+	char digits[CSV_TIME_MAX_LEN];
+	size_t len;
+
+	len = 0;
+	do {
+		digits[len++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	while (len)
+		*p++ = digits[--len];
+
+	return p;
+}
+
+/*
+ * Format a value like printf("%g") would, but independently of the
+ * locale and without the cost of the generic printf() machinery.
+ *
+ * The common case of values which get printed without an exponent
+ * is handled here. The value is scaled to six significant digits by
+ * an exact power of ten, which introduces at most one rounding step.
+ * Values which are too close to a rounding tie for this to be safe,
+ * and values which need exponent notation are passed to the GLib
+ * routine.
+ */
+static char *format_float(char *p, float value)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	};
+	double v, scaled, frac;
+	uint32_t number;
+	int exp, pos, last;
+	char digits[6];
+
+	v = value;
+	if (fpclassify(v) == FP_ZERO) {
+		if (signbit(v))
+			*p++ = '-';
+		*p++ = '0';
+		return p;
+	}
+	if (!isfinite(v))
+		goto fallback;
+	if (v < 0)
+		v = -v;
+	if (v < 1e-4 || v >= 999999.5)
+		goto fallback;
+
+	/* Determine the decimal exponent of the rounded value. */
+	for (exp = 5; exp > -4 && v * pow10[4] < pow10[exp + 4]; exp--)
+		;
+	while (1) {
+		scaled = v * pow10[5 - exp];
+		frac = scaled - floor(scaled);
+		if (fabs(frac - 0.5) < 1e-6)
+			goto fallback;
+		number = (uint32_t)(scaled + 0.5);
+		if (number >= 1000000 && exp < 5) {
+			exp++;
+			continue;
+		}
+		if (number < 100000 && exp > -4) {
+			exp--;
+			continue;
+		}
+		if (number < 100000 || number >= 1000000)
+			goto fallback;
+		break;
+	}
+
+	for (pos = 5; pos >= 0; pos--) {
+		digits[pos] = '0' + number % 10;
+		number /= 10;
+	}
+	for (last = 5; last > 0 && digits[last] == '0'; last--)
+		;
+
+	if (value < 0)
+		*p++ = '-';
+	if (exp >= 0) {
+		for (pos = 0; pos <= exp; pos++)
+			*p++ = digits[pos];
+		if (last > exp)
+			*p++ = '.';
+	} else {
+		*p++ = '0';
+		*p++ = '.';
+		for (pos = exp + 1; pos < 0; pos++)
+			*p++ = '0';
+		pos = 0;
+	}
+	for (; pos <= last; pos++)
+		*p++ = digits[pos];
+
+	return p;
+
+fallback:
+	g_ascii_formatd(p, CSV_VALUE_MAX_LEN, "%g", value);
+	while (*p)
+		p++;
+
+	return p;
+}
+
+static void text_flush(struct context *ctx, GString *out)
+{
+	if (!ctx->text.len)
+		return;
+	g_string_append_len(out, ctx->text.data, ctx->text.len);
+	ctx->text.len = 0;
+}
+
+static char *append_separator(char *p, const char *sep)
+{
+	while (*sep)
+		*p++ = *sep++;
+
+	return p;
+}
+
+static uint64_t sample_time(struct context *ctx, uint64_t snum)
 {
-	unsigned int i, j, analog_size, num_channels;
 	double sample_time_dbl;
-	uint64_t sample_time_u64;
-	float *analog_sample, value;
-	uint8_t *logic_sample;
+
+	if (ctx->time_ratio)
+		return snum * ctx->time_ratio;
+
+	sample_time_dbl = snum;
+	sample_time_dbl /= ctx->sample_rate;
+	sample_time_dbl *= ctx->sample_scale;
+
+	return sample_time_dbl;
+}
+
+static gboolean row_changed(struct context *ctx,
+	const uint8_t *logic_sample, const float *analog_sample)
+{
+	size_t i;
+
+	if (!ctx->have_previous)
+		return TRUE;
+	if (logic_sample) {
+		for (i = 0; i < ctx->logic_unitsize; i++) {
+			if ((logic_sample[i] ^ ctx->previous_logic[i]) & ctx->logic_mask[i])
+				return TRUE;
+		}
+	}
+	if (analog_sample && memcmp(analog_sample, ctx->previous_analog,
+			ctx->num_analog_channels * sizeof(float)))
+		return TRUE;
+
+	return FALSE;
+}
+
+static void row_keep(struct context *ctx,
+	const uint8_t *logic_sample, const float *analog_sample)
+{
+	if (logic_sample)
+		memcpy(ctx->previous_logic, logic_sample, ctx->logic_unitsize);
+	if (analog_sample) {
+		if (!ctx->previous_analog)
+			ctx->previous_analog = g_malloc(ctx->num_analog_channels * sizeof(float));
+		memcpy(ctx->previous_analog, analog_sample,
+			ctx->num_analog_channels * sizeof(float));
+	}
+	ctx->have_previous = TRUE;
+}
+
+/* Format one row into the text buffer, which has room for it. */
+static void format_row(struct context *ctx, uint64_t snum,
+	const uint8_t *logic_sample, const float *analog_sample)
+{
+	unsigned int j, num_channels, idx_analog;
+	struct ctx_channel *channel;
+	float value;
+	char *p;
+
+	p = &ctx->text.data[ctx->text.len];
+	num_channels = ctx->num_logic_channels + ctx->num_analog_channels;
+
+	if (ctx->time && !ctx->sample_rate) {
+		*p++ = '0';
+		p = append_separator(p, ctx->value);
+	} else if (ctx->time) {
+		p = format_u64(p, sample_time(ctx, snum));
+		p = append_separator(p, ctx->value);
+	}
+
+	idx_analog = 0;
+	for (j = 0; j < num_channels; j++) {
+		channel = &ctx->channels[j];
+		if (channel->ch->type == SR_CHANNEL_ANALOG) {
+			value = analog_sample ? analog_sample[idx_analog++] : 0;
+			channel->max = fmax(value, channel->max);
+			channel->min = fmin(value, channel->min);
+			p = format_float(p, value);
+		} else if (channel->ch->type == SR_CHANNEL_LOGIC) {
+			if (logic_sample && channel->logic_byte < ctx->logic_unitsize &&
+			    (logic_sample[channel->logic_byte] & channel->logic_mask))
+				*p++ = '1';
+			else
+				*p++ = '0';
+		} else {
+			sr_warn("Unexpected channel type: %d",
+				channel->ch->type);
+			continue;
+		}
+		p = append_separator(p, ctx->value);
+	}
+
+	if (ctx->do_trigger) {
+		*p++ = ctx->trigger ? '1' : '0';
+		p = append_separator(p, ctx->value);
+		ctx->trigger = FALSE;
+	}
+	/* Drop last separator. */
+	if (p != &ctx->text.data[ctx->text.len])
+		p -= strlen(ctx->value);
+	p = append_separator(p, ctx->record);
+
+	ctx->text.len = p - ctx->text.data;
+}
+
+static void dump_saved_values(struct context *ctx, GString **out)
+{
+	unsigned int i, num_channels, num_samples;
+	uint64_t snum;
+	gboolean changed;
+	const uint8_t *logic_sample;
+	const float *analog_sample;
 
 	/* If we haven't seen samples we're expecting, skip them. */
-	if ((ctx->num_analog_channels && !ctx->analog_samples) ||
-	    (ctx->num_logic_channels && !ctx->logic_samples)) {
+	if ((ctx->num_analog_channels && !ctx->have_analog) ||
+	    (ctx->num_logic_channels && !ctx->have_logic)) {
 		sr_warn("Discarding partial packet");
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
@@ -443,86 +764,51 @@ static void dump_saved_values(struct context *ctx, GString **out)
 				g_string_append_printf(*out, "Trigger%s",
 						       ctx->value);
 			/* Drop last separator. */
-			g_string_truncate(*out, (*out)->len - 1);
+			g_string_truncate(*out, (*out)->len - strlen(ctx->value));
 			g_string_append(*out, ctx->record);
 
 			ctx->label_do = FALSE;
 		}
 
-		analog_size = ctx->num_analog_channels * sizeof(float);
-		if (ctx->dedup && !ctx->previous_sample)
-			ctx->previous_sample = g_malloc0(analog_size + ctx->num_logic_channels);
-
-		for (i = 0; i < ctx->num_samples; i++) {
-			analog_sample =
-			    &ctx->analog_samples[i * ctx->num_analog_channels];
-			logic_sample =
-			    &ctx->logic_samples[i * ctx->num_logic_channels];
-
-			if (ctx->dedup) {
-				if (i > 0 && i < ctx->num_samples - 1 &&
-				    !memcmp(logic_sample, ctx->previous_sample,
-					    ctx->num_logic_channels) &&
-				    !memcmp(analog_sample,
-					    ctx->previous_sample +
-					    ctx->num_logic_channels,
-					    analog_size))
+		num_samples = ctx->num_samples;
+		if (ctx->have_logic)
+			num_samples = MIN(num_samples, ctx->logic_count);
+		logic_sample = NULL;
+		analog_sample = NULL;
+		for (i = 0; i < num_samples; i++) {
+			if (ctx->have_analog && ctx->num_analog_channels)
+				analog_sample = &ctx->analog_samples[i * ctx->num_analog_channels];
+			if (ctx->have_logic)
+				logic_sample = &ctx->logic_samples[i * ctx->logic_unitsize];
+			snum = ctx->out_sample_count++;
+
+			if (ctx->dedup || ctx->changes) {
+				changed = row_changed(ctx, logic_sample, analog_sample);
+				if (ctx->dedup && !changed &&
+				    i > 0 && i < num_samples - 1)
 					continue;
-				memcpy(ctx->previous_sample, logic_sample,
-				       ctx->num_logic_channels);
-				memcpy(ctx->previous_sample
-				       + ctx->num_logic_channels,
-				       analog_sample, analog_size);
-			}
-
-			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
-			} else if (ctx->time) {
-				sample_time_dbl = ctx->out_sample_count++;
-				sample_time_dbl /= ctx->sample_rate;
-				sample_time_dbl *= ctx->sample_scale;
-				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
-			}
-
-			for (j = 0; j < num_channels; j++) {
-				if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
-					value = ctx->analog_samples[i * ctx->num_analog_channels + j];
-					ctx->channels[j].max =
-					    fmax(value, ctx->channels[j].max);
-					ctx->channels[j].min =
-					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
-				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
-				} else {
-					sr_warn("Unexpected channel type: %d",
-						ctx->channels[i].ch->type);
-				}
+				if (ctx->changes && !changed &&
+				    !(ctx->do_trigger && ctx->trigger))
+					continue;
+				row_keep(ctx, logic_sample, analog_sample);
 			}
 
-			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
-				ctx->trigger = FALSE;
-			}
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			if (ctx->text.size - ctx->text.len < ctx->text.row_size)
+				text_flush(ctx, *out);
+			format_row(ctx, snum, logic_sample, analog_sample);
 		}
+		text_flush(ctx, *out);
 	}
 
-	/* Discard all of the working space. */
-	g_free(ctx->previous_sample);
-	g_free(ctx->analog_samples);
-	g_free(ctx->logic_samples);
+	/* Prepare for the next set of samples, buffers get reused. */
 	ctx->channels_seen = 0;
 	ctx->num_samples = 0;
-	ctx->previous_sample = NULL;
-	ctx->analog_samples = NULL;
+	ctx->have_analog = FALSE;
+	ctx->have_logic = FALSE;
 	ctx->logic_samples = NULL;
+	ctx->logic_count = 0;
+	if (!ctx->changes)
+		ctx->have_previous = FALSE;
 }
 
 static void save_gnuplot(struct context *ctx)
@@ -684,7 +970,7 @@ static int receive(const struct sr_output *o,
 		*out = g_string_sized_new(512);
 		logic = packet->payload;
 		ctx->pkt_snums = logic->length;
-		ctx->pkt_snums /= logic->length;
+		ctx->pkt_snums /= logic->unitsize;
 		check_input_constraints(ctx);
 		process_logic(ctx, logic);
 		break;
@@ -698,6 +984,7 @@ static int receive(const struct sr_output *o,
 		break;
 	case SR_DF_FRAME_BEGIN:
 		ctx->have_frames = TRUE;
+		ctx->have_previous = FALSE;
 		*out = g_string_new(ctx->frame);
 		/* Fallthrough */
 	case SR_DF_END:
@@ -730,7 +1017,12 @@ static int cleanup(struct sr_output *o)
 		g_free((gpointer)ctx->comment);
 		g_free((gpointer)ctx->gnuplot);
 		g_free((gpointer)ctx->value);
-		g_free(ctx->previous_sample);
+		g_free(ctx->analog_samples);
+		g_free(ctx->logic_buffer);
+		g_free(ctx->logic_mask);
+		g_free(ctx->previous_logic);
+		g_free(ctx->previous_analog);
+		g_free(ctx->text.data);
 		g_free(ctx->channels);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -751,6 +1043,7 @@ static struct sr_option options[] = {
 	{"time", "Time column", "Output sample time as column 1", NULL, NULL},
 	{"trigger", "Trigger column", "Output trigger indicator as last column ", NULL, NULL},
 	{"dedup", "Dedup rows", "Set to false to output duplicate rows", NULL, NULL},
+	{"changes", "Changes only", "Only output rows where a value changed", NULL, NULL},
 	ALL_ZERO
 };
 
@@ -774,6 +1067,7 @@ static const struct sr_option *get_options(void)
 		options[8].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 		options[9].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 		options[10].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[11].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 	}
 
 	return options;
@@ -325,18 +325,62 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/** @private */
+struct output_expand {
+	const struct sr_output *o;
+	GString *out;
+};
+
+static int output_send_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	struct output_expand *exp;
+	GString *out;
+	int ret;
+
+	exp = cb_data;
+
+	out = NULL;
+	ret = exp->o->module->receive(exp->o, packet, &out);
+	if (!out)
+		return ret;
+	if (exp->out) {
+		g_string_append_len(exp->out, out->str, out->len);
+		g_string_free(out, TRUE);
+	} else {
+		exp->out = out;
+	}
+
+	return ret;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
  * which must be freed by the caller.
  *
+ * SR_DF_LOGIC_RLE packets get expanded for output modules which don't
+ * have the SR_OUTPUT_LOGIC_RLE flag.
+ *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	struct output_expand exp;
+	int ret;
+
+	if (packet->type != SR_DF_LOGIC_RLE ||
+			sr_output_test_flag(o->module, SR_OUTPUT_LOGIC_RLE))
+		return o->module->receive(o, packet, out);
+
+	exp.o = o;
+	exp.out = NULL;
+	ret = sr_logic_rle_expand(packet->payload, output_send_expanded, &exp);
+	*out = exp.out;
+
+	return ret;
 }
 
 /**
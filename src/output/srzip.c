@@ -24,16 +24,86 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <zip.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+/*
+ * Compression methods for sample data chunks. Most are handled by
+ * libzip, and get decoded by libzip when the archive gets read. The
+ * lzo1x method is done by sigrok itself, because libzip does not
+ * support it. It is fast enough for high sample rates, and still
+ * compresses sparse logic data well.
+ */
+static const struct {
+	const char *name;
+	int32_t method;
+	gboolean lzo;
+} codecs[] = {
+	{ "deflate", ZIP_CM_DEFLATE, FALSE, },
+	{ "store", ZIP_CM_STORE, FALSE, },
+	{ "bzip2", ZIP_CM_BZIP2, FALSE, },
+#ifdef ZIP_CM_XZ
+	{ "xz", ZIP_CM_XZ, FALSE, },
+#endif
+#ifdef ZIP_CM_ZSTD
+	{ "zstd", ZIP_CM_ZSTD, FALSE, },
+#endif
+	{ "lzo", ZIP_CM_STORE, TRUE, },
+};
+
+/*
+ * Streaming mode writes the ZIP archive by itself instead of through
+ * libzip. Each chunk gets compressed when it arrives and is written
+ * together with its local header, the central directory is written
+ * when the capture ends. Offsets beyond 4 GiB and more than 65535
+ * members are expressed by means of ZIP64 records.
+ */
+#define ZIP_SIG_LOCAL_HEADER	0x04034b50
+#define ZIP_SIG_CENTRAL_HEADER	0x02014b50
+#define ZIP_SIG_ZIP64_END	0x06064b50
+#define ZIP_SIG_ZIP64_LOCATOR	0x07064b50
+#define ZIP_SIG_END		0x06054b50
+#define ZIP_VERSION_DEFAULT	20
+#define ZIP_VERSION_ZIP64	45
+#define ZIP_HOST_UNIX		3
+
+struct stream_member {
+	char *name;
+	uint16_t method;
+	uint32_t crc;
+	uint32_t size;
+	uint32_t csize;
+	uint64_t offset;
+};
+
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
+	gboolean stream;
+	int32_t zip_method;
+	uint32_t zip_level;
+	gboolean lzo;
+	GByteArray *packed;
+	GKeyFile *meta;
+	FILE *stream_file;
+	uint64_t stream_pos;
+	GArray *stream_members;
+	uint16_t stream_time, stream_date;
+#ifdef HAVE_ZLIB
+	z_stream zstrm;
+	gboolean zstrm_init;
+#endif
+	GByteArray *deflated;
+	gboolean unitsize_stored;
+	unsigned int logic_chunk_num;
+	unsigned int *analog_chunk_num;
 	size_t first_analog_index;
 	size_t analog_ch_count;
 	gint *analog_index_map;
@@ -50,24 +120,318 @@ struct out_context {
 	} *analog_buff;
 };
 
+static gboolean zip_method_supported(int32_t method)
+{
+#ifdef HAVE_ZIP_COMPRESSION_METHOD_SUPPORTED
+	return zip_compression_method_supported(method, 1);
+#elif defined(HAVE_ZIP_SET_FILE_COMPRESSION)
+	return method == ZIP_CM_DEFLATE || method == ZIP_CM_STORE;
+#else
+	return method == ZIP_CM_DEFLATE;
+#endif
+}
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
-
-	(void)options;
+	const char *codec;
+	uint32_t level;
+	size_t idx;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	codec = g_variant_get_string(g_hash_table_lookup(options, "compression"), NULL);
+	for (idx = 0; idx < ARRAY_SIZE(codecs); idx++) {
+		if (!strcmp(codec, codecs[idx].name))
+			break;
+	}
+	if (idx == ARRAY_SIZE(codecs)) {
+		sr_err("Unknown compression method '%s'.", codec);
+		return SR_ERR_ARG;
+	}
+	if (!codecs[idx].lzo && !zip_method_supported(codecs[idx].method)) {
+		sr_err("Compression method '%s' not supported by libzip.", codec);
+		return SR_ERR_ARG;
+	}
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "level"));
+	if (level > 9) {
+		sr_err("Invalid compression level %u.", level);
+		return SR_ERR_ARG;
+	}
+
 	outc = g_malloc0(sizeof(*outc));
 	outc->filename = g_strdup(o->filename);
+	outc->stream = g_variant_get_boolean(g_hash_table_lookup(options, "stream"));
+	if (outc->stream) {
+#ifdef HAVE_ZLIB
+		if (!codecs[idx].lzo && codecs[idx].method != ZIP_CM_DEFLATE &&
+				codecs[idx].method != ZIP_CM_STORE) {
+			sr_err("Streaming supports deflate, store and lzo only.");
+			g_free(outc->filename);
+			g_free(outc);
+			return SR_ERR_ARG;
+		}
+#else
+		sr_err("Streaming mode requires zlib support.");
+		g_free(outc->filename);
+		g_free(outc);
+		return SR_ERR_NA;
+#endif
+	}
+	outc->zip_method = codecs[idx].method;
+	outc->zip_level = level;
+	outc->lzo = codecs[idx].lzo;
+	if (outc->lzo)
+		outc->packed = g_byte_array_new();
 	o->priv = outc;
 
 	return SR_OK;
 }
 
+#ifdef HAVE_ZLIB
+
+static int stream_write(struct out_context *outc, const void *buf, size_t len)
+{
+	if (fwrite(buf, 1, len, outc->stream_file) != len) {
+		sr_err("Failed to write '%s': %s",
+			outc->filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->stream_pos += len;
+
+	return SR_OK;
+}
+
+/**
+ * Create the file for a streamed srzip archive.
+ *
+ * @param[in] outc Output module context.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int stream_open(struct out_context *outc)
+{
+	GDateTime *now;
+	int level;
+
+	outc->stream_file = g_fopen(outc->filename, "wb");
+	if (!outc->stream_file) {
+		sr_err("Cannot create '%s': %s",
+			outc->filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	outc->stream_pos = 0;
+	outc->stream_members = g_array_new(FALSE, FALSE,
+		sizeof(struct stream_member));
+	outc->deflated = g_byte_array_new();
+
+	/* All members share the archive's creation time, in DOS format. */
+	now = g_date_time_new_now_local();
+	outc->stream_time = g_date_time_get_hour(now) << 11;
+	outc->stream_time |= g_date_time_get_minute(now) << 5;
+	outc->stream_time |= g_date_time_get_second(now) / 2;
+	outc->stream_date = (g_date_time_get_year(now) - 1980) << 9;
+	outc->stream_date |= g_date_time_get_month(now) << 5;
+	outc->stream_date |= g_date_time_get_day_of_month(now);
+	g_date_time_unref(now);
+
+	/* Raw deflate streams, one per member, like ZIP_CM_DEFLATE. */
+	if (outc->zip_method == ZIP_CM_DEFLATE && !outc->lzo) {
+		level = outc->zip_level ? (int)outc->zip_level : Z_DEFAULT_COMPRESSION;
+		if (deflateInit2(&outc->zstrm, level, Z_DEFLATED, -MAX_WBITS,
+				8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			sr_err("Cannot initialize deflate: %s",
+				outc->zstrm.msg ? outc->zstrm.msg : "unknown error");
+			return SR_ERR;
+		}
+		outc->zstrm_init = TRUE;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Compress and write a member of a streamed srzip archive.
+ *
+ * The local header is followed by the (compressed) data. The member's
+ * properties are kept for the central directory.
+ *
+ * @param[in] outc Output module context.
+ * @param[in] name The archive member's name.
+ * @param[in] buf The member's content.
+ * @param[in] length The content's length in bytes.
+ * @param[in] compress Whether to deflate the content.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int stream_add_member(struct out_context *outc, const char *name,
+	const void *buf, size_t length, gboolean compress)
+{
+	struct stream_member m;
+	uint8_t hdr[30];
+	const void *data;
+	size_t namelen;
+	uLong bound;
+	int ret;
+
+	if (length > G_MAXUINT32) {
+		sr_err("Member '%s' is too large.", name);
+		return SR_ERR_ARG;
+	}
+	compress = compress && outc->zstrm_init;
+
+	m.method = compress ? ZIP_CM_DEFLATE : ZIP_CM_STORE;
+	m.crc = crc32(crc32(0L, Z_NULL, 0), buf, length);
+	m.size = length;
+	m.offset = outc->stream_pos;
+	data = buf;
+	m.csize = length;
+	if (compress) {
+		bound = deflateBound(&outc->zstrm, length);
+		g_byte_array_set_size(outc->deflated, bound);
+		deflateReset(&outc->zstrm);
+		outc->zstrm.next_in = (Bytef *)buf;
+		outc->zstrm.avail_in = length;
+		outc->zstrm.next_out = outc->deflated->data;
+		outc->zstrm.avail_out = bound;
+		if (deflate(&outc->zstrm, Z_FINISH) != Z_STREAM_END) {
+			sr_err("Failed to compress '%s'.", name);
+			return SR_ERR;
+		}
+		data = outc->deflated->data;
+		m.csize = outc->zstrm.total_out;
+	}
+
+	namelen = strlen(name);
+	WL32(&hdr[0], ZIP_SIG_LOCAL_HEADER);
+	WL16(&hdr[4], m.offset >= G_MAXUINT32 ?
+		ZIP_VERSION_ZIP64 : ZIP_VERSION_DEFAULT);
+	WL16(&hdr[6], 0);
+	WL16(&hdr[8], m.method);
+	WL16(&hdr[10], outc->stream_time);
+	WL16(&hdr[12], outc->stream_date);
+	WL32(&hdr[14], m.crc);
+	WL32(&hdr[18], m.csize);
+	WL32(&hdr[22], m.size);
+	WL16(&hdr[26], namelen);
+	WL16(&hdr[28], 0);
+	if ((ret = stream_write(outc, hdr, sizeof(hdr))) != SR_OK)
+		return ret;
+	if ((ret = stream_write(outc, name, namelen)) != SR_OK)
+		return ret;
+	if ((ret = stream_write(outc, data, m.csize)) != SR_OK)
+		return ret;
+
+	m.name = g_strdup(name);
+	g_array_append_val(outc->stream_members, m);
+
+	return SR_OK;
+}
+
+/**
+ * Write the central directory of a streamed srzip archive, and close it.
+ *
+ * @param[in] outc Output module context.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int stream_close(struct out_context *outc)
+{
+	struct stream_member *m;
+	uint8_t hdr[56], extra[12];
+	uint64_t cd_offset, cd_size, zip64_offset;
+	gboolean zip64;
+	size_t idx, count, namelen;
+	int ret;
+
+	cd_offset = outc->stream_pos;
+	count = outc->stream_members->len;
+	for (idx = 0; idx < count; idx++) {
+		m = &g_array_index(outc->stream_members, struct stream_member, idx);
+		zip64 = m->offset >= G_MAXUINT32;
+		namelen = strlen(m->name);
+		WL32(&hdr[0], ZIP_SIG_CENTRAL_HEADER);
+		WL16(&hdr[4], (ZIP_HOST_UNIX << 8) | ZIP_VERSION_ZIP64);
+		WL16(&hdr[6], zip64 ? ZIP_VERSION_ZIP64 : ZIP_VERSION_DEFAULT);
+		WL16(&hdr[8], 0);
+		WL16(&hdr[10], m->method);
+		WL16(&hdr[12], outc->stream_time);
+		WL16(&hdr[14], outc->stream_date);
+		WL32(&hdr[16], m->crc);
+		WL32(&hdr[20], m->csize);
+		WL32(&hdr[24], m->size);
+		WL16(&hdr[28], namelen);
+		WL16(&hdr[30], zip64 ? sizeof(extra) : 0);
+		WL16(&hdr[32], 0);
+		WL16(&hdr[34], 0);
+		WL16(&hdr[36], 0);
+		WL32(&hdr[38], 0100644 << 16);
+		WL32(&hdr[42], zip64 ? G_MAXUINT32 : m->offset);
+		if ((ret = stream_write(outc, hdr, 46)) != SR_OK)
+			return ret;
+		if ((ret = stream_write(outc, m->name, namelen)) != SR_OK)
+			return ret;
+		if (zip64) {
+			WL16(&extra[0], 0x0001);
+			WL16(&extra[2], 8);
+			WL64(&extra[4], m->offset);
+			ret = stream_write(outc, extra, sizeof(extra));
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+	cd_size = outc->stream_pos - cd_offset;
+
+	if (count >= G_MAXUINT16 || cd_size >= G_MAXUINT32 ||
+			cd_offset >= G_MAXUINT32) {
+		zip64_offset = outc->stream_pos;
+		WL32(&hdr[0], ZIP_SIG_ZIP64_END);
+		WL64(&hdr[4], 56 - 12);
+		WL16(&hdr[12], (ZIP_HOST_UNIX << 8) | ZIP_VERSION_ZIP64);
+		WL16(&hdr[14], ZIP_VERSION_ZIP64);
+		WL32(&hdr[16], 0);
+		WL32(&hdr[20], 0);
+		WL64(&hdr[24], count);
+		WL64(&hdr[32], count);
+		WL64(&hdr[40], cd_size);
+		WL64(&hdr[48], cd_offset);
+		if ((ret = stream_write(outc, hdr, 56)) != SR_OK)
+			return ret;
+		WL32(&hdr[0], ZIP_SIG_ZIP64_LOCATOR);
+		WL32(&hdr[4], 0);
+		WL64(&hdr[8], zip64_offset);
+		WL32(&hdr[16], 1);
+		if ((ret = stream_write(outc, hdr, 20)) != SR_OK)
+			return ret;
+	}
+
+	WL32(&hdr[0], ZIP_SIG_END);
+	WL16(&hdr[4], 0);
+	WL16(&hdr[6], 0);
+	WL16(&hdr[8], MIN(count, G_MAXUINT16));
+	WL16(&hdr[10], MIN(count, G_MAXUINT16));
+	WL32(&hdr[12], MIN(cd_size, G_MAXUINT32));
+	WL32(&hdr[16], MIN(cd_offset, G_MAXUINT32));
+	WL16(&hdr[20], 0);
+	if ((ret = stream_write(outc, hdr, 22)) != SR_OK)
+		return ret;
+
+	ret = fclose(outc->stream_file);
+	outc->stream_file = NULL;
+	if (ret != 0) {
+		sr_err("Failed to close '%s': %s",
+			outc->filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+
+	return SR_OK;
+}
+
+#endif
+
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
@@ -76,6 +440,7 @@ static int zip_create(const struct sr_output *o)
 	struct sr_channel *ch;
 	size_t ch_nr;
 	size_t alloc_size;
+	const char *version;
 	GVariant *gvar;
 	GKeyFile *meta;
 	GSList *l;
@@ -85,6 +450,7 @@ static int zip_create(const struct sr_output *o)
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
+	int ret;
 
 	outc = o->priv;
 
@@ -96,18 +462,44 @@ static int zip_create(const struct sr_output *o)
 
 	/* Quietly delete it first, libzip wants replace ops otherwise. */
 	g_unlink(outc->filename);
-	zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
-	if (!zipfile)
-		return SR_ERR;
 
-	/* "version" */
-	versrc = zip_source_buffer(zipfile, "2", 1, FALSE);
-	if (zip_add(zipfile, "version", versrc) < 0) {
-		sr_err("Error saving version into zipfile: %s",
-			zip_strerror(zipfile));
-		zip_source_free(versrc);
-		zip_discard(zipfile);
-		return SR_ERR;
+	/* Readers which don't know about lzo1x must refuse the archive. */
+	if (outc->lzo)
+		version = G_STRINGIFY(SR_SESSIONFILE_VERSION_LZO);
+	else
+		version = G_STRINGIFY(SR_SESSIONFILE_VERSION);
+
+	/*
+	 * In streaming mode the file remains open for the whole session,
+	 * and members get written as they arrive.
+	 */
+	zipfile = NULL;
+	if (outc->stream) {
+#ifdef HAVE_ZLIB
+		if ((ret = stream_open(outc)) != SR_OK)
+			return ret;
+		ret = stream_add_member(outc, "version",
+			version, strlen(version), FALSE);
+		if (ret != SR_OK)
+			return ret;
+#else
+		(void)ret;
+		return SR_ERR_NA;
+#endif
+	} else {
+		zipfile = zip_open(outc->filename, ZIP_CREATE, NULL);
+		if (!zipfile)
+			return SR_ERR;
+
+		/* "version" */
+		versrc = zip_source_buffer(zipfile, version, strlen(version), FALSE);
+		if (zip_add(zipfile, "version", versrc) < 0) {
+			sr_err("Error saving version into zipfile: %s",
+				zip_strerror(zipfile));
+			zip_source_free(versrc);
+			zip_discard(zipfile);
+			return SR_ERR;
+		}
 	}
 
 	/* init "metadata" */
@@ -157,9 +549,15 @@ static int zip_create(const struct sr_output *o)
 
 	g_key_file_set_integer(meta, devgroup, "total analog", enabled_analog_channels);
 
+	/* Readers need to know when sigrok compressed the sample data. */
+	if (outc->lzo)
+		g_key_file_set_string(meta, devgroup, "codec", "lzo1x");
+
 	outc->analog_ch_count = enabled_analog_channels;
 	alloc_size = sizeof(gint) * outc->analog_ch_count + 1;
 	outc->analog_index_map = g_malloc0(alloc_size);
+	alloc_size = sizeof(outc->analog_chunk_num[0]) * outc->analog_ch_count + 1;
+	outc->analog_chunk_num = g_malloc0(alloc_size);
 
 	index = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
@@ -227,6 +625,12 @@ static int zip_create(const struct sr_output *o)
 		outc->analog_buff[index].fill_size = 0;
 	}
 
+	/* Streaming mode writes metadata when the archive gets closed. */
+	if (outc->stream) {
+		outc->meta = meta;
+		return SR_OK;
+	}
+
 	metabuf = g_key_file_to_data(meta, &metalen, NULL);
 	g_key_file_free(meta);
 
@@ -251,9 +655,141 @@ static int zip_create(const struct sr_output *o)
 	return SR_OK;
 }
 
+/**
+ * Add a chunk of sample data to an srzip archive.
+ *
+ * Regular mode references the caller's buffer, which must remain valid
+ * until the archive gets closed. Streaming mode compresses the data and
+ * writes the member right away, so that the caller's buffer can get
+ * re-used immediately.
+ *
+ * With lzo1x compression, the compressed data is kept in the output
+ * module's context until the next chunk gets added, and is stored in
+ * the archive as is.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] archive The ZIP archive to add the chunk to (NULL when streaming).
+ * @param[in] name The archive member's name.
+ * @param[in] buf Sample data as byte sequence.
+ * @param[in] length Byte sequence length.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_add_chunk(const struct sr_output *o, struct zip *archive,
+	const char *name, const void *buf, size_t length)
+{
+	struct out_context *outc;
+	struct zip_source *src;
+	zip_int64_t index;
+	int ret;
+
+	outc = o->priv;
+
+	if (outc->lzo) {
+		ret = sr_sessionfile_lzo_pack(outc->packed, buf, length);
+		if (ret != SR_OK)
+			return ret;
+		buf = outc->packed->data;
+		length = outc->packed->len;
+	}
+
+	if (outc->stream) {
+#ifdef HAVE_ZLIB
+		return stream_add_member(outc, name, buf, length, TRUE);
+#else
+		return SR_ERR_NA;
+#endif
+	}
+
+	src = zip_source_buffer(archive, buf, length, FALSE);
+	if (!src) {
+		sr_err("Failed to create source for '%s': %s",
+			name, zip_strerror(archive));
+		return SR_ERR;
+	}
+	if ((index = zip_add(archive, name, src)) < 0) {
+		sr_err("Failed to add chunk '%s': %s",
+			name, zip_strerror(archive));
+		zip_source_free(src);
+		return SR_ERR;
+	}
+
+#ifdef HAVE_ZIP_SET_FILE_COMPRESSION
+	if (outc->zip_method != ZIP_CM_DEFLATE || outc->zip_level) {
+		if (zip_set_file_compression(archive, index,
+				outc->zip_method, outc->zip_level) < 0) {
+			sr_err("Failed to set compression for '%s': %s",
+				name, zip_strerror(archive));
+			return SR_ERR;
+		}
+	}
+#else
+	(void)index;
+#endif
+
+	return SR_OK;
+}
+
+/**
+ * Store the logic data unit size in the archive's metadata.
+ *
+ * Regular mode updates the archive's "metadata" member, the returned
+ * buffer must be released after the archive was closed. Streaming mode
+ * only updates the metadata which gets written at the end.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] archive The ZIP archive.
+ * @param[in] unitsize Logic data unit size (bytes per sample).
+ * @param[out] metabuf Buffer which backs the updated archive member.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_store_unitsize(const struct sr_output *o, struct zip *archive,
+	size_t unitsize, char **metabuf)
+{
+	struct out_context *outc;
+	struct zip_stat zs;
+	struct zip_source *metasrc;
+	GKeyFile *kf;
+	gsize metalen;
+
+	outc = o->priv;
+	*metabuf = NULL;
+
+	if (outc->stream) {
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize", unitsize);
+		return SR_OK;
+	}
+
+	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
+		sr_err("Failed to open metadata: %s", zip_strerror(archive));
+		return SR_ERR;
+	}
+	kf = sr_sessionfile_read_metadata(archive, &zs);
+	if (!kf)
+		return SR_ERR_DATA;
+
+	g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
+	*metabuf = g_key_file_to_data(kf, &metalen, NULL);
+	g_key_file_free(kf);
+	metasrc = zip_source_buffer(archive, *metabuf, metalen, FALSE);
+	if (zip_replace(archive, zs.index, metasrc) < 0) {
+		sr_err("Failed to replace metadata: %s", zip_strerror(archive));
+		zip_source_free(metasrc);
+		g_free(*metabuf);
+		*metabuf = NULL;
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Append a block of logic data to an srzip archive.
  *
+ * Chunk numbers are tracked in the output module's context, neither
+ * the archive's metadata nor its member names need to get scanned.
+ *
  * @param[in] o Output module instance.
  * @param[in] buf Logic data samples as byte sequence.
  * @param[in] unitsize Logic data unit size (bytes per sample).
@@ -266,94 +802,26 @@ static int zip_append(const struct sr_output *o,
 {
 	struct out_context *outc;
 	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
 	char *metabuf;
-	gsize metalen;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	int ret;
 
 	if (!length)
 		return SR_OK;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
+	archive = NULL;
+	if (!outc->stream && !(archive = zip_open(outc->filename, 0, NULL)))
 		return SR_ERR;
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
-	}
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
+	/* Add the unitsize field when the first logic data is seen. */
 	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
-		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
-		}
-	}
-	g_key_file_free(kf);
-
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
-			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
+	if (!outc->unitsize_stored) {
+		ret = zip_store_unitsize(o, archive, unitsize, &metabuf);
+		if (ret != SR_OK) {
+			if (!outc->stream)
 				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
+			return ret;
 		}
 	}
 
@@ -361,25 +829,24 @@ static int zip_append(const struct sr_output *o,
 		sr_warn("Chunk size %zu not a multiple of the"
 			" unit size %zu.", length, unitsize);
 	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
+	chunkname = g_strdup_printf("logic-1-%u", outc->logic_chunk_num + 1);
+	ret = zip_add_chunk(o, archive, chunkname, buf, length);
 	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
+	if (ret != SR_OK) {
+		if (!outc->stream)
+			zip_discard(archive);
 		g_free(metabuf);
-		return SR_ERR;
+		return ret;
 	}
-	if (zip_close(archive) < 0) {
+	if (!outc->stream && zip_close(archive) < 0) {
 		sr_err("Error saving session file: %s", zip_strerror(archive));
 		zip_discard(archive);
 		g_free(metabuf);
 		return SR_ERR;
 	}
 	g_free(metabuf);
+	outc->unitsize_stored = TRUE;
+	outc->logic_chunk_num++;
 
 	return SR_OK;
 }
@@ -505,77 +972,81 @@ static int zip_append_queue(const struct sr_output *o,
  * @param[in] o Output module instance.
  * @param[in] values Sample data as array of floating point values.
  * @param[in] count Number of samples (float items, not bytes).
- * @param[in] ch_nr 1-based channel number.
+ * @param[in] idx 0-based index into the list of enabled analog channels.
  *
  * @returns SR_OK et al error codes.
  */
 static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+	const float *values, size_t count, size_t idx)
 {
 	struct out_context *outc;
 	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
+	size_t ch_nr;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	int ret;
 
 	outc = o->priv;
 
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
+	archive = NULL;
+	if (!outc->stream && !(archive = zip_open(outc->filename, 0, NULL)))
 		return SR_ERR;
-	}
 
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
-	}
-
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
-		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
-	}
+	ch_nr = outc->first_analog_index + idx;
+	chunkname = g_strdup_printf("analog-1-%zu-%u",
+		ch_nr, outc->analog_chunk_num[idx] + 1);
+	ret = zip_add_chunk(o, archive, chunkname,
+		values, sizeof(values[0]) * count);
 	g_free(chunkname);
-	if (zip_close(archive) < 0) {
+	if (ret != SR_OK) {
+		if (!outc->stream)
+			zip_discard(archive);
+		return ret;
+	}
+	if (!outc->stream && zip_close(archive) < 0) {
 		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
 		zip_discard(archive);
 		return SR_ERR;
 	}
-
-	g_free(basename);
+	outc->analog_chunk_num[idx]++;
 
 	return SR_OK;
 }
 
+/**
+ * Finish a streamed srzip archive.
+ *
+ * Adds the metadata and writes the central directory.
+ *
+ * @param[in] o Output module instance.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_finish(const struct sr_output *o)
+{
+#ifdef HAVE_ZLIB
+	struct out_context *outc;
+	char *metabuf;
+	gsize metalen;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->stream_file)
+		return SR_OK;
+
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	ret = stream_add_member(outc, "metadata", metabuf, metalen, TRUE);
+	g_free(metabuf);
+	if (ret != SR_OK)
+		return ret;
+
+	return stream_close(outc);
+#else
+	(void)o;
+
+	return SR_ERR_NA;
+#endif
+}
+
 /**
  * Queue analog data of a channel for srzip archive writes.
  *
@@ -590,7 +1061,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 {
 	struct out_context *outc;
 	const struct sr_channel *ch;
-	size_t idx, nr;
+	size_t idx;
 	struct analog_buff *buff;
 	float *values, *wrptr, *rdptr;
 	size_t send_size, remain, copy_size;
@@ -601,12 +1072,11 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	/* Is this the DF_END flush call without samples submission? */
 	if (!analog && flush) {
 		for (idx = 0; idx < outc->analog_ch_count; idx++) {
-			nr = outc->first_analog_index + idx;
 			buff = &outc->analog_buff[idx];
 			if (!buff->fill_size)
 				continue;
 			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+				buff->samples, buff->fill_size, idx);
 			if (ret != SR_OK)
 				return ret;
 			buff->fill_size = 0;
@@ -627,7 +1097,6 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	}
 	if (idx == outc->analog_ch_count)
 		return SR_ERR_ARG;
-	nr = outc->first_analog_index + idx;
 	buff = &outc->analog_buff[idx];
 
 	/* Convert the analog data to an array of float values. */
@@ -659,7 +1128,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 		}
 		if (send_size && !remain) {
 			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+				buff->samples, buff->fill_size, idx);
 			if (ret != SR_OK) {
 				g_free(values);
 				return ret;
@@ -672,7 +1141,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append_analog(o, buff->samples, buff->fill_size, nr);
+		ret = zip_append_analog(o, buff->samples, buff->fill_size, idx);
 		if (ret != SR_OK)
 			return ret;
 		buff->fill_size = 0;
@@ -738,6 +1207,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			if (outc->stream) {
+				ret = zip_finish(o);
+				if (ret != SR_OK)
+					return ret;
+			}
 		}
 		break;
 	}
@@ -746,11 +1220,31 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{"stream", "Streaming", "Keep the archive open and write the central directory at the end of the capture", NULL, NULL},
+	{"compression", "Compression", "Compression method for sample data", NULL, NULL},
+	{"level", "Compression level", "Compression level (1-9, 0 for the method's default)", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	GSList *l;
+	size_t idx;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("deflate"));
+		l = NULL;
+		for (idx = 0; idx < ARRAY_SIZE(codecs); idx++) {
+			if (!codecs[idx].lzo && !zip_method_supported(codecs[idx].method))
+				continue;
+			l = g_slist_append(l, g_variant_ref_sink(
+				g_variant_new_string(codecs[idx].name)));
+		}
+		options[1].values = l;
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(0));
+	}
+
 	return options;
 }
 
@@ -761,7 +1255,31 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+	/* Discard an incomplete streamed archive. */
+	if (outc->stream_file) {
+		fclose(outc->stream_file);
+		g_unlink(outc->filename);
+	}
+	if (outc->stream_members) {
+		for (idx = 0; idx < outc->stream_members->len; idx++) {
+			g_free(g_array_index(outc->stream_members,
+				struct stream_member, idx).name);
+		}
+		g_array_free(outc->stream_members, TRUE);
+	}
+	if (outc->deflated)
+		g_byte_array_free(outc->deflated, TRUE);
+#ifdef HAVE_ZLIB
+	if (outc->zstrm_init)
+		deflateEnd(&outc->zstrm);
+#endif
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	if (outc->packed)
+		g_byte_array_free(outc->packed, TRUE);
+
 	g_free(outc->analog_index_map);
+	g_free(outc->analog_chunk_num);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
 	for (idx = 0; idx < outc->analog_ch_count; idx++)
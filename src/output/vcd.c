@@ -72,9 +72,27 @@ struct context {
 	GList *vcd_queue_list;
 	GList *vcd_queue_last;
 	gboolean immediate_write;
-	uint8_t *last_logic;
+	struct {
+		size_t unit_size;
+		size_t word_count;
+		uint64_t *last;
+		uint64_t *curr;
+		uint64_t *diff;
+		uint64_t *masks;
+		struct vcd_channel_desc **descs;
+		size_t per_word;
+		uint64_t pattern;
+	} logic;
+	struct {
+		char *data;
+		size_t len, size;
+	} text;
 };
 
+/* Size of the text buffer which logic value changes get formatted into. */
+#define VCD_TEXT_BUFFER_SIZE	(64 * 1024)
+#define VCD_TIMESTAMP_MAX_LEN	64
+
 /*
  * Construct VCD signal identifiers from a sigrok channel index. The
  * routine returns a GString which the caller is supposed to release.
@@ -106,6 +124,7 @@ struct context {
 #define VCD_IDENT_COUNT_2CHAR	(VCD_IDENT_COUNT_ALPHA * VCD_IDENT_COUNT_ALPHA)
 #define VCD_IDENT_COUNT_3CHAR	(VCD_IDENT_COUNT_2CHAR * VCD_IDENT_COUNT_ALPHA)
 #define VCD_IDENT_COUNT		(VCD_IDENT_COUNT_1CHAR + VCD_IDENT_COUNT_2CHAR + VCD_IDENT_COUNT_3CHAR)
+#define VCD_IDENT_MAX_LEN	3
 
 static GString *vcd_identifier(size_t idx)
 {
@@ -287,17 +306,6 @@ static int init(struct sr_output *o, GHashTable *options)
 	if (ctx->logic_count == 0 && ctx->analog_count == 1)
 		ctx->immediate_write = TRUE;
 
-	/*
-	 * Keep a copy of the last logic data bitmap around. To avoid
-	 * iterating over individual bits when nothing in the set has
-	 * changed. The overhead of two byte array compares should
-	 * outweight the tenfold bit count compared to byte counts.
-	 */
-	alloc_size = (ctx->logic_count + 7) / 8;
-	ctx->last_logic = g_malloc0(alloc_size);
-	if (ctx->logic_count && !ctx->last_logic)
-		return SR_ERR_MALLOC;
-
 	return SR_OK;
 }
 
@@ -979,6 +987,255 @@ static int write_completed_changes(struct context *ctx, GString *out)
 	return SR_OK;
 }
 
+/*
+ * Logic data gets checked for changes in 64bit words. The last sample
+ * is kept as an array of words, as is the set of bits which correspond
+ * to enabled logic channels, and their channel descriptions by bit
+ * position. For unit sizes which evenly divide 64bit words, the last
+ * sample is replicated to a full word. Which allows to skip runs of
+ * unchanged samples several at a time. Changed channels get extracted
+ * by bit position from the XOR of the current and the last sample.
+ */
+
+static void logic_release(struct context *ctx)
+{
+	g_free(ctx->logic.last);
+	g_free(ctx->logic.curr);
+	g_free(ctx->logic.diff);
+	g_free(ctx->logic.masks);
+	g_free(ctx->logic.descs);
+	memset(&ctx->logic, 0, sizeof(ctx->logic));
+}
+
+static void logic_setup(struct context *ctx, size_t unit_size)
+{
+	size_t words, i, index;
+	struct vcd_channel_desc *desc;
+
+	if (ctx->logic.unit_size == unit_size)
+		return;
+	logic_release(ctx);
+
+	words = (unit_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	ctx->logic.unit_size = unit_size;
+	ctx->logic.word_count = words;
+	ctx->logic.last = g_malloc0(words * sizeof(uint64_t));
+	ctx->logic.curr = g_malloc0(words * sizeof(uint64_t));
+	ctx->logic.diff = g_malloc0(words * sizeof(uint64_t));
+	ctx->logic.masks = g_malloc0(words * sizeof(uint64_t));
+	ctx->logic.descs = g_malloc0(words * 64 * sizeof(ctx->logic.descs[0]));
+	ctx->logic.per_word = 0;
+	if (sizeof(uint64_t) % unit_size == 0)
+		ctx->logic.per_word = sizeof(uint64_t) / unit_size;
+
+	for (i = 0; i < ctx->enabled_count; i++) {
+		desc = &ctx->channels[i];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		index = desc->index;
+		if (index >= unit_size * 8)
+			continue;
+		ctx->logic.masks[index / 64] |= UINT64_C(1) << (index % 64);
+		ctx->logic.descs[index] = desc;
+	}
+}
+
+/* Get a sample's bits in words, bit N of the sample is bit N % 64. */
+static void logic_load(struct context *ctx, const uint8_t *sample,
+	uint64_t *words)
+{
+	size_t i;
+
+	words[ctx->logic.word_count - 1] = 0;
+	memcpy(words, sample, ctx->logic.unit_size);
+	for (i = 0; i < ctx->logic.word_count; i++)
+		words[i] = GUINT64_FROM_LE(words[i]);
+}
+
+/* Replicate the last sample's raw image to a full word. */
+static void logic_update_pattern(struct context *ctx, const uint8_t *sample)
+{
+	uint8_t image[sizeof(uint64_t)];
+	size_t i;
+
+	if (!ctx->logic.per_word)
+		return;
+	for (i = 0; i < ctx->logic.per_word; i++)
+		memcpy(&image[i * ctx->logic.unit_size], sample,
+			ctx->logic.unit_size);
+	memcpy(&ctx->logic.pattern, image, sizeof(image));
+}
+
+static void text_flush(struct context *ctx, GString *out)
+{
+	if (!ctx->text.len)
+		return;
+	g_string_append_len(out, ctx->text.data, ctx->text.len);
+	ctx->text.len = 0;
+}
+
+static char *text_reserve(struct context *ctx, GString *out, size_t len)
+{
+	if (ctx->text.len + len > ctx->text.size) {
+		text_flush(ctx, out);
+		if (len > ctx->text.size) {
+			ctx->text.size = MAX(len, VCD_TEXT_BUFFER_SIZE);
+			g_free(ctx->text.data);
+			ctx->text.data = g_malloc(ctx->text.size);
+		}
+	}
+
+	return &ctx->text.data[ctx->text.len];
+}
+
+/*
+ * Format a timestamp the same way as append_vcd_timestamp() does.
+ * Avoids floating point formatting when the timescale is an integer
+ * multiple of the samplerate, which is the common case.
+ */
+static size_t format_vcd_timestamp(struct context *ctx, char *p, uint64_t snum)
+{
+	char digits[24], *d;
+	size_t len;
+	uint64_t ts;
+	int ret;
+
+	if (!ctx->samplerate || ctx->period % ctx->samplerate) {
+		ret = snprintf(p, VCD_TIMESTAMP_MAX_LEN, "\n#%.0f ",
+			snum_to_ts(ctx, snum));
+		return MIN((size_t)MAX(ret, 0), VCD_TIMESTAMP_MAX_LEN - 1);
+	}
+
+	ts = snum * (ctx->period / ctx->samplerate);
+	d = &digits[sizeof(digits)];
+	do {
+		*--d = '0' + ts % 10;
+		ts /= 10;
+	} while (ts);
+	len = &digits[sizeof(digits)] - d;
+	p[0] = '\n';
+	p[1] = '#';
+	memcpy(&p[2], d, len);
+	p[2 + len] = ' ';
+
+	return 3 + len;
+}
+
+/*
+ * Check one logic sample against the last seen sample. Emit or queue
+ * the value changes of enabled channels. The first sample of the
+ * acquisition has all channels' values emitted.
+ */
+static void logic_sample_changes(struct context *ctx, GString *out,
+	const uint8_t *sample, uint64_t snum)
+{
+	size_t i, bit;
+	uint64_t any, diff;
+	struct vcd_channel_desc *desc;
+	uint8_t curbit;
+	char *p;
+	GString *s_val;
+
+	logic_load(ctx, sample, ctx->logic.curr);
+	any = snum == 0;
+	for (i = 0; i < ctx->logic.word_count; i++)
+		any |= ctx->logic.curr[i] ^ ctx->logic.last[i];
+	if (!any)
+		return;
+
+	/* Only changes of enabled channels are of interest. */
+	any = 0;
+	for (i = 0; i < ctx->logic.word_count; i++) {
+		diff = ctx->logic.curr[i] ^ ctx->logic.last[i];
+		if (snum == 0)
+			diff = ~UINT64_C(0);
+		diff &= ctx->logic.masks[i];
+		ctx->logic.diff[i] = diff;
+		any |= diff;
+		ctx->logic.last[i] = ctx->logic.curr[i];
+	}
+	logic_update_pattern(ctx, sample);
+	if (!any)
+		return;
+
+	/*
+	 * Start or continue tracking that sample number. Avoid string
+	 * copies for logic-only setups, format into the text buffer.
+	 */
+	p = NULL;
+	if (ctx->immediate_write) {
+		p = text_reserve(ctx, out, VCD_TIMESTAMP_MAX_LEN +
+			ctx->logic_count * (2 + VCD_IDENT_MAX_LEN));
+		p += format_vcd_timestamp(ctx, p, snum);
+	} else {
+		queue_samplenum(ctx, snum);
+	}
+
+	for (i = 0; i < ctx->logic.word_count; i++) {
+		diff = ctx->logic.diff[i];
+		while (diff) {
+			bit = sr_lowest_bit(diff);
+			diff &= diff - 1;
+			desc = ctx->logic.descs[i * 64 + bit];
+			curbit = (ctx->logic.curr[i] >> bit) & 1;
+			desc->last.logic = curbit;
+			if (ctx->immediate_write) {
+				*p++ = ' ';
+				*p++ = curbit ? '1' : '0';
+				memcpy(p, desc->name->str, desc->name->len);
+				p += desc->name->len;
+				continue;
+			}
+			s_val = queue_value_text_prep(ctx);
+			if (!s_val)
+				return;
+			format_vcd_value_bit(s_val, curbit, desc->name);
+		}
+	}
+	if (p)
+		ctx->text.len = p - ctx->text.data;
+}
+
+/* Process a logic packet's samples, skip unchanged runs in bulk. */
+static void receive_logic(struct context *ctx, GString *out,
+	const uint8_t *sample, size_t unit_size, size_t count,
+	uint64_t snum)
+{
+	size_t per_word, skip, check;
+	uint64_t word;
+
+	logic_setup(ctx, unit_size);
+	per_word = ctx->logic.per_word;
+
+	while (count) {
+		if (per_word && snum) {
+			skip = 0;
+			while (count - skip >= per_word) {
+				memcpy(&word, &sample[skip * unit_size],
+					sizeof(word));
+				if (word != ctx->logic.pattern)
+					break;
+				skip += per_word;
+			}
+			sample += skip * unit_size;
+			snum += skip;
+			count -= skip;
+			if (!count)
+				break;
+		}
+
+		/* Check individual samples, up to one word's worth. */
+		check = MIN(count, MAX(per_word, 1));
+		while (check--) {
+			logic_sample_changes(ctx, out, sample, snum);
+			sample += unit_size;
+			snum++;
+			count--;
+		}
+	}
+	text_flush(ctx, out);
+}
+
 /* Get packets from the session feed, generate output text. */
 static int receive(const struct sr_output *o,
 	const struct sr_datafeed_packet *packet, GString **out)
@@ -990,11 +1247,12 @@ static int receive(const struct sr_output *o,
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	const struct sr_datafeed_logic_rle *logic_rle;
+	uint64_t snum_curr, run;
+	size_t count, index, unit_size;
 	gboolean changed;
 	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	const uint8_t *sample;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
@@ -1020,75 +1278,36 @@ static int receive(const struct sr_output *o,
 		*out = chk_header(o);
 
 		logic = packet->payload;
-		sample = logic->data;
 		unit_size = logic->unitsize;
+		if (!unit_size)
+			return SR_ERR_ARG;
 		count = logic->length / unit_size;
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
+		receive_logic(ctx, *out, logic->data, unit_size, count,
+			snum_curr);
+		write_completed_changes(ctx, *out);
+		break;
+	case SR_DF_LOGIC_RLE:
+		*out = chk_header(o);
 
-		last_logic = ctx->last_logic;
-		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
-			}
-
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
-			}
-
-			/* Advance to next set of logic samples. */
-			snum_curr++;
+		/* Only the first sample of each run can carry changes. */
+		logic_rle = packet->payload;
+		unit_size = logic_rle->unitsize;
+		if (!unit_size)
+			return SR_ERR_ARG;
+		logic_setup(ctx, unit_size);
+		snum_curr = get_last_snum_logic(ctx);
+		sample = logic_rle->values;
+		for (run = 0; run < logic_rle->num_runs; run++) {
+			if (!logic_rle->lengths[run])
+				continue;
+			logic_sample_changes(ctx, *out, sample, snum_curr);
 			sample += unit_size;
+			snum_curr += logic_rle->lengths[run];
+			upd_last_snum_logic(ctx, logic_rle->lengths[run]);
 		}
+		text_flush(ctx, *out);
 		write_completed_changes(ctx, *out);
 		break;
 	case SR_DF_ANALOG:
@@ -1193,6 +1412,9 @@ static int cleanup(struct sr_output *o)
 		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
 			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
 
+	logic_release(ctx);
+	g_free(ctx->text.data);
+
 	while (ctx->enabled_count--) {
 		desc = &ctx->channels[ctx->enabled_count];
 		g_string_free(desc->name, TRUE);
@@ -1208,7 +1430,7 @@ struct sr_output_module output_vcd = {
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
+	.flags = SR_OUTPUT_LOGIC_RLE,
 	.options = NULL,
 	.init = init,
 	.receive = receive,
@@ -28,6 +28,12 @@
 #define SCPI_CMD_IDN "*IDN?"
 #define SCPI_CMD_OPC "*OPC?"
 
+/*
+ * How long config_get() results of SCPI instruments may be served from
+ * the device instance's cache, see sr_config_cache_enable().
+ */
+#define SCPI_CONFIG_CACHE_TTL_US (500 * 1000)
+
 enum {
 	SCPI_CMD_GET_TIMEBASE = 1,
 	SCPI_CMD_SET_TIMEBASE,
@@ -80,6 +86,13 @@ struct scpi_command {
 	const char *string;
 };
 
+/*
+ * Invoked for each chunk of a binary block as it is received, see
+ * sr_scpi_get_block_into().
+ */
+typedef int (*sr_scpi_block_cb)(const uint8_t *data, size_t len,
+		void *cb_data);
+
 struct sr_scpi_hw_info {
 	char *manufacturer;
 	char *model;
@@ -160,10 +173,53 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_get_block_into(struct sr_scpi_dev_inst *scpi,
+			const char *command, GByteArray *block,
+			sr_scpi_block_cb cb, void *cb_data);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
 
+/*
+ * Batched queries. Collect a set of queries and their destinations,
+ * then have sr_scpi_batch_run() transfer them in as few round trips
+ * as the device permits. Queries which return block data cannot be
+ * part of a batch.
+ */
+enum scpi_batch_mode {
+	/* One round trip per query, like the sr_scpi_get_*() routines. */
+	SCPI_BATCH_SEQUENTIAL,
+	/*
+	 * IEEE 488.2 compound program message, ';' separated responses.
+	 * When a compound query gets no response, *CLS gets sent (which
+	 * resets the status and event registers) before the queries are
+	 * retried one by one.
+	 */
+	SCPI_BATCH_JOINED,
+};
+
+struct sr_scpi_batch;
+
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(enum scpi_batch_mode mode);
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch);
+SR_PRIV void sr_scpi_batch_get_string(struct sr_scpi_batch *batch,
+			char **scpi_response, const char *format, ...)
+			ATTR_FMT_PRINTF(3, 4);
+SR_PRIV void sr_scpi_batch_get_bool(struct sr_scpi_batch *batch,
+			gboolean *scpi_response, const char *format, ...)
+			ATTR_FMT_PRINTF(3, 4);
+SR_PRIV void sr_scpi_batch_get_int(struct sr_scpi_batch *batch,
+			int *scpi_response, const char *format, ...)
+			ATTR_FMT_PRINTF(3, 4);
+SR_PRIV void sr_scpi_batch_get_float(struct sr_scpi_batch *batch,
+			float *scpi_response, const char *format, ...)
+			ATTR_FMT_PRINTF(3, 4);
+SR_PRIV void sr_scpi_batch_get_double(struct sr_scpi_batch *batch,
+			double *scpi_response, const char *format, ...)
+			ATTR_FMT_PRINTF(3, 4);
+SR_PRIV int sr_scpi_batch_run(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_batch *batch);
+
 SR_PRIV const char *sr_scpi_unquote_string(char *s);
 
 SR_PRIV const char *sr_vendor_alias(const char *raw_vendor);
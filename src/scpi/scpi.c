@@ -961,32 +961,81 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/**
+ * Read an exact number of bytes from the device, without mutex.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to store the data.
+ * @param len Number of bytes to read.
+ * @param timeout Absolute timeout, gets extended when data arrives.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+static int scpi_read_exact(struct sr_scpi_dev_inst *scpi,
+	char *buf, size_t len, gint64 *timeout)
+{
+	int ret;
+
+	while (len) {
+		ret = scpi_read_data(scpi, buf, len);
+		if (ret < 0) {
+			sr_err("Incompletely read SCPI response.");
+			return SR_ERR;
+		}
+		if (ret > 0) {
+			buf += ret;
+			len -= ret;
+			*timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+			continue;
+		}
+		if (g_get_monotonic_time() > *timeout) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR_TIMEOUT;
+		}
+	}
+
+	return SR_OK;
+}
+
 /**
  * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
+ * "definite length block" header and store the data bytes in a caller
+ * provided byte array.
  *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
+ * The length spec gets parsed first. The array is then resized to the
+ * exact block length, and the data bytes are received directly into it.
+ * Re-using the same array for subsequent calls avoids any allocation
+ * once its capacity suffices.
+ *
+ * The optional callback is invoked for each chunk of data as it arrives,
+ * which allows to process the data while the transfer is in progress.
+ * block->len holds the total length of the data block at that time. The
+ * SCPI mutex is held, the callback must not communicate with the device.
+ * When the callback returns an error, the read is aborted.
  *
  * @param[in] scpi Previously initialised SCPI device structure.
  * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
- *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+ * @param[in,out] block Byte array which receives the data bytes.
+ * @param[in] cb Callback for each received chunk of data (can be NULL).
+ * @param[in] cb_data Opaque pointer passed to the callback.
+ *
+ * @return SR_OK upon successfully reading the block, SR_ERR* upon a parsing
+ *         error or upon no response. When the device stops sending before
+ *         the block is complete, the array is truncated to the received data.
+ *         An empty block ("#10") leaves the array empty.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+SR_PRIV int sr_scpi_get_block_into(struct sr_scpi_dev_inst *scpi,
+	const char *command, GByteArray *block,
+	sr_scpi_block_cb cb, void *cb_data)
 {
 	int ret;
-	GString* response;
-	gsize oldlen;
 	char buf[10];
 	long llen;
 	long datalen;
+	gsize received;
 	gint64 timeout;
 
-	*scpi_response = NULL;
+	g_byte_array_set_size(block, 0);
 
 	g_mutex_lock(&scpi->scpi_mutex);
 
@@ -1001,24 +1050,8 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 		return SR_ERR;
 	}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
-
 	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
 
-	/* Get (the first chunk of) the response. */
-	do {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
-		}
-	} while (response->len < 2);
-
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
 	 * The length spec consists of a '#' marker, one digit which
@@ -1027,15 +1060,19 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 	 * length. Raw data bytes follow (thus one must no longer assume
 	 * that the received input stream would be an ASCIIZ string).
 	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
+	 * Only receive the length spec here, so that the data bytes can
+	 * go straight to their final location.
 	 */
-	if (response->str[0] != '#') {
+	ret = scpi_read_exact(scpi, buf, 2, &timeout);
+	if (ret != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return ret;
+	}
+	if (buf[0] != '#') {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return SR_ERR_DATA;
 	}
-	buf[0] = response->str[1];
+	buf[0] = buf[1];
 	buf[1] = '\0';
 	ret = sr_atol(buf, &llen);
 	/*
@@ -1060,66 +1097,105 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 		sr_err("unsupported INDEFINITE LENGTH ARBITRARY BLOCK RESPONSE");
 		ret = SR_ERR_NA;
 	}
+	if (ret == SR_OK)
+		ret = scpi_read_exact(scpi, buf, llen, &timeout);
 	if (ret != SR_OK) {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return ret;
 	}
+	buf[llen] = '\0';
+	ret = sr_atol(buf, &datalen);
+	if (ret != SR_OK || datalen < 0) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return SR_ERR_DATA;
+	}
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
+	/* Receive the data bytes into their final location. */
+	g_byte_array_set_size(block, datalen);
+	received = 0;
+	while (received < block->len) {
+		ret = scpi_read_data(scpi, (char *)&block->data[received],
+			MIN(block->len - received, G_MAXINT));
 		if (ret < 0) {
+			sr_err("Incompletely read SCPI response.");
 			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
+			return SR_ERR;
+		}
+		if (ret > 0) {
+			if (cb && cb(&block->data[received], ret, cb_data) != SR_OK) {
+				g_mutex_unlock(&scpi->scpi_mutex);
+				return SR_ERR;
+			}
+			received += ret;
+			timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+			continue;
+		}
+		/* On timeout truncate the buffer and send the partial response
+		 * instead of getting stuck on timeouts...
+		 */
+		if (g_get_monotonic_time() > timeout) {
+			sr_warn("Timed out after %" G_GSIZE_FORMAT " of %u block bytes.",
+				received, block->len);
+			g_byte_array_set_size(block, received);
+			break;
 		}
 	}
 
-	memcpy(buf, &response->str[2], llen);
-	buf[llen] = '\0';
-	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
-		return ret;
-	}
-	g_string_erase(response, 0, 2 + llen);
-
 	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
+	 * Consume the response message terminator which follows the data
+	 * bytes, so that it does not precede the next response. Transports
+	 * which strip the terminator report the response as complete.
 	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
-
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
-
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
-			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
+	while (received == block->len && !sr_scpi_read_complete(scpi)) {
+		ret = scpi_read_data(scpi, buf, 1);
+		if (ret < 0)
+			break;
+		if (ret > 0) {
+			if (buf[0] == '\n')
 				break;
-			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
-			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
+			continue;
+		}
+		if (g_get_monotonic_time() > timeout) {
+			sr_dbg("No message terminator after the block data.");
+			break;
+		}
 	}
 
 	g_mutex_unlock(&scpi->scpi_mutex);
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	return SR_OK;
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response. An empty block ("#10") is no error,
+ *         the result is NULL then.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	GByteArray *block;
+	int ret;
+
+	*scpi_response = NULL;
+
+	block = g_byte_array_new();
+	ret = sr_scpi_get_block_into(scpi, command, block, NULL, NULL);
+	if (ret != SR_OK || !block->len) {
+		g_byte_array_free(block, TRUE);
+		return ret;
+	}
+	*scpi_response = block;
 
 	return SR_OK;
 }
@@ -1219,6 +1295,453 @@ SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info)
 	g_free(hw_info);
 }
 
+/** Upper bound for the size of one batched program message. */
+#define SCPI_BATCH_MAX_LEN 512
+/** Time to wait for the rest of a failed compound query's response. */
+#define SCPI_BATCH_DRAIN_US (100 * 1000)
+
+enum scpi_batch_type {
+	SCPI_BATCH_STRING,
+	SCPI_BATCH_BOOL,
+	SCPI_BATCH_INT,
+	SCPI_BATCH_FLOAT,
+	SCPI_BATCH_DOUBLE,
+};
+
+struct scpi_batch_query {
+	char *command;
+	enum scpi_batch_type type;
+	void *dest;
+};
+
+struct sr_scpi_batch {
+	enum scpi_batch_mode mode;
+	GPtrArray *queries;
+};
+
+static void scpi_batch_query_free(void *data)
+{
+	struct scpi_batch_query *query;
+
+	query = data;
+	g_free(query->command);
+	g_free(query);
+}
+
+/**
+ * Create an empty batch of SCPI queries.
+ *
+ * @param mode How the queries get transferred to the device.
+ *
+ * @return The new batch. Free it with sr_scpi_batch_free().
+ */
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(enum scpi_batch_mode mode)
+{
+	struct sr_scpi_batch *batch;
+
+	batch = g_malloc0(sizeof(*batch));
+	batch->mode = mode;
+	batch->queries = g_ptr_array_new_with_free_func(scpi_batch_query_free);
+
+	return batch;
+}
+
+/**
+ * Free a batch of SCPI queries. Previously retrieved responses are
+ * owned by the caller and are not affected.
+ *
+ * @param batch The batch to free. If NULL, this function does nothing.
+ */
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch)
+{
+	if (!batch)
+		return;
+
+	g_ptr_array_free(batch->queries, TRUE);
+	g_free(batch);
+}
+
+static void scpi_batch_add(struct sr_scpi_batch *batch,
+	enum scpi_batch_type type, void *dest,
+	const char *format, va_list args)
+{
+	struct scpi_batch_query *query;
+	va_list args_copy;
+	int len;
+
+	va_copy(args_copy, args);
+	len = sr_vsnprintf_ascii(NULL, 0, format, args_copy);
+	va_end(args_copy);
+
+	query = g_malloc0(sizeof(*query));
+	query->command = g_malloc0(len + 1);
+	sr_vsprintf_ascii(query->command, format, args);
+	query->type = type;
+	query->dest = dest;
+	g_ptr_array_add(batch->queries, query);
+}
+
+/**
+ * Queue a query whose response gets stored as a string. The caller
+ * must free the string, the destination is NULL when the query fails.
+ *
+ * @param batch The batch to add the query to.
+ * @param scpi_response Where to store the response during sr_scpi_batch_run().
+ * @param format Format string for the query, followed by its arguments.
+ */
+SR_PRIV void sr_scpi_batch_get_string(struct sr_scpi_batch *batch,
+	char **scpi_response, const char *format, ...)
+{
+	va_list args;
+
+	*scpi_response = NULL;
+	va_start(args, format);
+	scpi_batch_add(batch, SCPI_BATCH_STRING, scpi_response, format, args);
+	va_end(args);
+}
+
+/**
+ * Queue a query whose response gets parsed as a bool value.
+ *
+ * @param batch The batch to add the query to.
+ * @param scpi_response Where to store the result during sr_scpi_batch_run().
+ * @param format Format string for the query, followed by its arguments.
+ */
+SR_PRIV void sr_scpi_batch_get_bool(struct sr_scpi_batch *batch,
+	gboolean *scpi_response, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	scpi_batch_add(batch, SCPI_BATCH_BOOL, scpi_response, format, args);
+	va_end(args);
+}
+
+/**
+ * Queue a query whose response gets parsed as an integer.
+ *
+ * @param batch The batch to add the query to.
+ * @param scpi_response Where to store the result during sr_scpi_batch_run().
+ * @param format Format string for the query, followed by its arguments.
+ */
+SR_PRIV void sr_scpi_batch_get_int(struct sr_scpi_batch *batch,
+	int *scpi_response, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	scpi_batch_add(batch, SCPI_BATCH_INT, scpi_response, format, args);
+	va_end(args);
+}
+
+/**
+ * Queue a query whose response gets parsed as a float.
+ *
+ * @param batch The batch to add the query to.
+ * @param scpi_response Where to store the result during sr_scpi_batch_run().
+ * @param format Format string for the query, followed by its arguments.
+ */
+SR_PRIV void sr_scpi_batch_get_float(struct sr_scpi_batch *batch,
+	float *scpi_response, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	scpi_batch_add(batch, SCPI_BATCH_FLOAT, scpi_response, format, args);
+	va_end(args);
+}
+
+/**
+ * Queue a query whose response gets parsed as a double.
+ *
+ * @param batch The batch to add the query to.
+ * @param scpi_response Where to store the result during sr_scpi_batch_run().
+ * @param format Format string for the query, followed by its arguments.
+ */
+SR_PRIV void sr_scpi_batch_get_double(struct sr_scpi_batch *batch,
+	double *scpi_response, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	scpi_batch_add(batch, SCPI_BATCH_DOUBLE, scpi_response, format, args);
+	va_end(args);
+}
+
+/* Parse one response text and store it in the query's destination. */
+static int scpi_batch_store(struct scpi_batch_query *query, const char *text)
+{
+	struct sr_rational rational;
+	int ret;
+
+	switch (query->type) {
+	case SCPI_BATCH_STRING:
+		*(char **)query->dest = g_strdup(text);
+		return SR_OK;
+	case SCPI_BATCH_BOOL:
+		ret = parse_strict_bool(text, query->dest);
+		break;
+	case SCPI_BATCH_INT:
+		ret = sr_parse_rational(text, &rational);
+		if (ret == SR_OK && (rational.p % rational.q) == 0)
+			*(int *)query->dest = rational.p / rational.q;
+		else
+			ret = SR_ERR;
+		break;
+	case SCPI_BATCH_FLOAT:
+		ret = sr_atof_ascii(text, query->dest);
+		break;
+	case SCPI_BATCH_DOUBLE:
+		ret = sr_atod_ascii(text, query->dest);
+		break;
+	default:
+		ret = SR_ERR_BUG;
+		break;
+	}
+	if (ret != SR_OK) {
+		sr_dbg("Cannot parse response '%s' to '%s'.",
+			text, query->command);
+		return SR_ERR_DATA;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Split a compound response at separators which are not part of
+ * quoted strings. The text after the last separator is the last item.
+ */
+static GPtrArray *scpi_batch_split(const char *str, char separator)
+{
+	GPtrArray *items;
+	const char *start, *p;
+	char quote;
+
+	items = g_ptr_array_new_with_free_func(g_free);
+	quote = '\0';
+	for (start = p = str; *p; p++) {
+		if (quote) {
+			if (*p == quote)
+				quote = '\0';
+			continue;
+		}
+		if (*p == '"' || *p == '\'') {
+			quote = *p;
+			continue;
+		}
+		if (*p != separator)
+			continue;
+		g_ptr_array_add(items, g_strstrip(g_strndup(start, p - start)));
+		start = p + 1;
+	}
+	g_ptr_array_add(items, g_strstrip(g_strdup(start)));
+
+	return items;
+}
+
+/* Number of queries which make up the next program message. */
+static guint scpi_batch_chunk(struct sr_scpi_batch *batch, guint first)
+{
+	struct scpi_batch_query *query;
+	size_t len;
+	guint i;
+
+	if (batch->mode == SCPI_BATCH_SEQUENTIAL)
+		return 1;
+
+	len = 0;
+	for (i = first; i < batch->queries->len; i++) {
+		query = g_ptr_array_index(batch->queries, i);
+		len += strlen(query->command) + 2;
+		if (i > first && len > SCPI_BATCH_MAX_LEN)
+			break;
+	}
+
+	return i - first;
+}
+
+static int scpi_batch_run_sequential(struct sr_scpi_dev_inst *scpi,
+	struct sr_scpi_batch *batch, guint first, guint count)
+{
+	struct scpi_batch_query *query;
+	GString *response;
+	guint i;
+	int ret;
+
+	ret = SR_OK;
+	response = g_string_sized_new(1024);
+	for (i = first; ret == SR_OK && i < first + count; i++) {
+		query = g_ptr_array_index(batch->queries, i);
+		g_string_truncate(response, 0);
+		ret = scpi_get_data(scpi, query->command, &response);
+		if (ret != SR_OK)
+			break;
+		ret = scpi_batch_store(query, g_strstrip(response->str));
+	}
+	g_string_free(response, TRUE);
+
+	return ret;
+}
+
+/*
+ * Get the device and the transport back into a known state after a
+ * compound query failed. Discard what is left of its response, and
+ * clear the errors which the compound message may have caused. *CLS
+ * also clears the status and event registers, which is worth a warning
+ * since applications may watch them.
+ */
+static void scpi_batch_recover(struct sr_scpi_dev_inst *scpi)
+{
+	char buf[256];
+	gint64 timeout;
+	int len;
+
+	if (sr_scpi_read_begin(scpi) == SR_OK) {
+		timeout = g_get_monotonic_time() + SCPI_BATCH_DRAIN_US;
+		while (!sr_scpi_read_complete(scpi)) {
+			len = scpi->read_data(scpi->priv, buf, sizeof(buf));
+			if (len < 0)
+				break;
+			if (len > 0)
+				timeout = g_get_monotonic_time() + SCPI_BATCH_DRAIN_US;
+			else if (g_get_monotonic_time() > timeout)
+				break;
+		}
+	}
+	sr_warn("Compound query failed, clearing the device status (*CLS).");
+	scpi_send(scpi, "*CLS");
+}
+
+/* Release strings which were stored before a compound query failed. */
+static void scpi_batch_unstore(struct sr_scpi_batch *batch,
+	guint first, guint count)
+{
+	struct scpi_batch_query *query;
+	guint i;
+
+	for (i = first; i < first + count; i++) {
+		query = g_ptr_array_index(batch->queries, i);
+		if (query->type != SCPI_BATCH_STRING)
+			continue;
+		g_free(*(char **)query->dest);
+		*(char **)query->dest = NULL;
+	}
+}
+
+static int scpi_batch_run_joined(struct sr_scpi_dev_inst *scpi,
+	struct sr_scpi_batch *batch, guint first, guint count)
+{
+	struct scpi_batch_query *query;
+	GString *message, *response;
+	GPtrArray *items;
+	guint i;
+	int ret;
+
+	/*
+	 * Headers in a compound message are relative to the previous
+	 * one's path unless they start with a colon. Anchor each query
+	 * at the root so that it means the same as when sent alone.
+	 */
+	message = g_string_sized_new(SCPI_BATCH_MAX_LEN);
+	for (i = first; i < first + count; i++) {
+		query = g_ptr_array_index(batch->queries, i);
+		if (i > first)
+			g_string_append_c(message, ';');
+		if (query->command[0] != ':' && query->command[0] != '*')
+			g_string_append_c(message, ':');
+		g_string_append(message, query->command);
+	}
+	ret = scpi_send(scpi, "%s", message->str);
+	g_string_free(message, TRUE);
+	if (ret != SR_OK)
+		return SR_ERR;
+
+	/*
+	 * A device which does not support compound queries (or not all
+	 * of the queries in one) may not respond at all, or respond with
+	 * fewer or unexpected items. Retry the queries one by one then.
+	 */
+	response = g_string_sized_new(1024);
+	ret = scpi_get_data(scpi, NULL, &response);
+	items = NULL;
+	if (ret == SR_OK)
+		items = scpi_batch_split(response->str, ';');
+	g_string_free(response, TRUE);
+	if (!items) {
+		sr_dbg("Compound query failed (%d), retrying one by one.", ret);
+		scpi_batch_recover(scpi);
+		return scpi_batch_run_sequential(scpi, batch, first, count);
+	}
+	if (items->len != count) {
+		sr_dbg("Expected %u responses, got %u, retrying one by one.",
+			count, items->len);
+		g_ptr_array_free(items, TRUE);
+		return scpi_batch_run_sequential(scpi, batch, first, count);
+	}
+	for (i = 0; i < count; i++) {
+		query = g_ptr_array_index(batch->queries, first + i);
+		ret = scpi_batch_store(query, g_ptr_array_index(items, i));
+		if (ret != SR_OK)
+			break;
+	}
+	g_ptr_array_free(items, TRUE);
+	if (ret != SR_OK) {
+		sr_dbg("Unexpected response to '%s', retrying one by one.",
+			query->command);
+		scpi_batch_unstore(batch, first, i);
+		return scpi_batch_run_sequential(scpi, batch, first, count);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Send the queries of a batch and store the responses in the locations
+ * which were registered for them. The mutex is held for the whole batch
+ * so that responses cannot get mixed up with other commands.
+ *
+ * Long batches are split into several program messages to not overrun
+ * the device's input buffer. A batch can be run several times, e.g. to
+ * poll a set of values.
+ *
+ * In SCPI_BATCH_JOINED mode, a compound query which gets no readable
+ * response is followed by *CLS before its queries are retried one by
+ * one. This resets the device's status byte, and its event and error
+ * registers. Drivers which depend on these should use
+ * SCPI_BATCH_SEQUENTIAL mode.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param batch The batch of queries to run.
+ *
+ * @return SR_OK on success, SR_ERR* on failure. Destinations of queries
+ *         after the failing one are left untouched.
+ */
+SR_PRIV int sr_scpi_batch_run(struct sr_scpi_dev_inst *scpi,
+	struct sr_scpi_batch *batch)
+{
+	guint first, count;
+	int ret;
+
+	ret = SR_OK;
+	g_mutex_lock(&scpi->scpi_mutex);
+	for (first = 0; first < batch->queries->len; first += count) {
+		count = scpi_batch_chunk(batch, first);
+		switch (batch->mode) {
+		case SCPI_BATCH_JOINED:
+			ret = scpi_batch_run_joined(scpi, batch, first, count);
+			break;
+		default:
+			ret = scpi_batch_run_sequential(scpi, batch, first, count);
+			break;
+		}
+		if (ret != SR_OK)
+			break;
+	}
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
+}
+
 /**
  * Remove potentially enclosing pairs of quotes, un-escape content.
  * This implementation modifies the caller's buffer when quotes are found
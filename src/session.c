@@ -49,8 +49,118 @@
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+	uint32_t flags;
 };
 
+/** @cond PRIVATE */
+/* Largest SR_DF_LOGIC packet which run-length expansion produces. */
+#define LOGIC_RLE_EXPAND_SIZE (1024 * 1024)
+/* Pattern block size when writing long runs of logic samples. */
+#define LOGIC_FILL_BLOCK (4 * 1024)
+
+/* Maximum number of unused buffers which a session's pool keeps. */
+#define BUFFER_POOL_MAX_FREE 16
+
+/* Per device feed queue depth for merged delivery, unless configured. */
+#define FEED_QUEUE_MERGE_DEPTH 64
+/** @endcond */
+
+/**
+ * Pool of sample data buffers, owned by a session.
+ *
+ * The pool is reference counted. The session holds one reference, and
+ * every buffer which was handed out holds another. Buffers which are
+ * no longer referenced get returned to the pool for re-use, unless the
+ * session was destroyed already.
+ */
+struct sr_buffer_pool {
+	gint refcount;
+	GMutex mutex;
+	GSList *free_buffers;
+	size_t free_count;
+	gboolean closed;
+};
+
+struct sr_buffer {
+	gint refcount;
+	void *data;
+	size_t size;
+	struct sr_buffer_pool *pool;
+};
+
+/**
+ * Bounded queues of datafeed packets, and the thread which delivers
+ * them to the session's transforms and datafeed callbacks.
+ *
+ * Packets are kept in rings of slots with sequence numbers. Producers
+ * (the acquisition drivers) reserve a slot by advancing the ring's
+ * tail position with an atomic compare-and-exchange, one consumer
+ * takes packets from the head. Neither side takes a lock unless it
+ * needs to sleep because there is nothing to deliver (consumer) or a
+ * ring is full (producers with the blocking policy).
+ *
+ * By default all devices share one ring, packets get delivered in the
+ * order in which they were sent. With merged delivery every device of
+ * the session has a ring of its own. The consumer tracks the devices'
+ * positions in their sample streams, and delivers the packet which
+ * starts at the earliest point in time next. Ties get resolved in the
+ * order of the session's devices. Senders which were not part of the
+ * session when it started use the shared ring, which is not tracked.
+ *
+ * Merged delivery only waits for a device's packet while no ring is
+ * full. Producers are not blocked on behalf of other devices, a thread
+ * which serves several devices (like the session's main loop) would
+ * then wait for itself. Packets which get delivered while a running
+ * device has none queued are counted, their order depends on timing.
+ */
+struct feed_queue_slot {
+	gint sequence;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+struct feed_queue_ring {
+	struct feed_queue_slot *slots;
+	guint mask;
+	gint head;
+	gint tail;
+	/* Merged delivery: the device, and its position in the stream. */
+	const struct sr_dev_inst *sdi;
+	gboolean ended;
+	uint64_t samplerate;
+	uint64_t samples;
+	uint64_t logic_samples;
+	GHashTable *analog_samples;
+};
+
+struct session_feed_queue {
+	struct feed_queue_ring *rings;
+	size_t ring_count;
+	gboolean merge;
+	double position;
+	gint consumer_waiting;
+	gint producers_waiting;
+	gint quit;
+	GMutex wait_mutex;
+	GCond wait_cond;
+	GThread *thread;
+};
+
+/*
+ * Datafeed packet payloads carry plain data pointers. The buffer which
+ * backs a packet's data travels next to the packet instead: senders
+ * name it in sr_session_send_buffer(), copies of packets keep it after
+ * the packet, and the session tracks the buffer of the packet which a
+ * thread currently sends or delivers. sr_packet_free() relies on this
+ * layout, and accepts packets from sr_packet_copy() only.
+ */
+struct packet_copy {
+	struct sr_datafeed_packet packet;
+	struct sr_buffer *buf;
+};
+
+static GPrivate current_buffer;
+
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
  */
@@ -199,6 +309,586 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	return source;
 }
 
+/* Get the buffer which backs @a data, when it's the current packet's. */
+static struct sr_buffer *buffer_lookup(const void *data)
+{
+	struct sr_buffer *buf;
+	const uint8_t *start;
+
+	buf = g_private_get(&current_buffer);
+	if (!buf || !data)
+		return NULL;
+
+	start = buf->data;
+	if ((const uint8_t *)data < start || (const uint8_t *)data >= start + buf->size)
+		return NULL;
+
+	return buf;
+}
+
+static void buffer_free(struct sr_buffer *buf)
+{
+	g_free(buf->data);
+	g_free(buf);
+}
+
+static void buffer_pool_unref(struct sr_buffer_pool *pool)
+{
+	if (!g_atomic_int_dec_and_test(&pool->refcount))
+		return;
+
+	g_mutex_clear(&pool->mutex);
+	g_free(pool);
+}
+
+/* Release the session's reference, and all currently unused buffers. */
+static void buffer_pool_close(struct sr_buffer_pool *pool)
+{
+	GSList *free_buffers;
+
+	g_mutex_lock(&pool->mutex);
+	pool->closed = TRUE;
+	free_buffers = pool->free_buffers;
+	pool->free_buffers = NULL;
+	pool->free_count = 0;
+	g_mutex_unlock(&pool->mutex);
+
+	g_slist_free_full(free_buffers, (GDestroyNotify)buffer_free);
+	buffer_pool_unref(pool);
+}
+
+/**
+ * Get a sample data buffer from a session's buffer pool.
+ *
+ * Acquisition drivers can use the buffer's data as the payload of
+ * logic or analog datafeed packets, and send these packets with
+ * sr_session_send_buffer(). Consumers which want to keep the data can
+ * take a reference instead of copying it. The driver releases its
+ * reference after sending the packet, and must not modify the data
+ * afterwards.
+ *
+ * Previously used buffers get re-used when they are large enough,
+ * otherwise a new buffer gets allocated.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param size The minimum size of the buffer's data (in bytes).
+ *
+ * @returns A buffer which holds one reference, or NULL upon allocation
+ *          failure. Release with sr_buffer_unref().
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer *sr_session_buffer_new(struct sr_session *session,
+		size_t size)
+{
+	struct sr_buffer_pool *pool;
+	struct sr_buffer *buf;
+	GSList *l;
+
+	if (!session || !size)
+		return NULL;
+
+	pool = session->buffer_pool;
+	buf = NULL;
+	g_mutex_lock(&pool->mutex);
+	for (l = pool->free_buffers; l; l = l->next) {
+		buf = l->data;
+		if (buf->size >= size) {
+			pool->free_buffers = g_slist_delete_link(pool->free_buffers, l);
+			pool->free_count--;
+			break;
+		}
+		buf = NULL;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (!buf) {
+		buf = g_malloc0(sizeof(*buf));
+		buf->data = g_try_malloc(size);
+		if (!buf->data) {
+			g_free(buf);
+			return NULL;
+		}
+		buf->size = size;
+		buf->pool = pool;
+	}
+	buf->refcount = 1;
+	g_atomic_int_inc(&pool->refcount);
+
+	return buf;
+}
+
+static void feed_ring_init(struct feed_queue_ring *ring, guint size,
+		const struct sr_dev_inst *sdi)
+{
+	guint idx;
+
+	ring->slots = g_malloc0(size * sizeof(ring->slots[0]));
+	ring->mask = size - 1;
+	for (idx = 0; idx < size; idx++)
+		ring->slots[idx].sequence = (gint)idx;
+	ring->sdi = sdi;
+	if (sdi)
+		ring->analog_samples = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+}
+
+static void feed_ring_clear(struct feed_queue_ring *ring)
+{
+	g_free(ring->slots);
+	if (ring->analog_samples)
+		g_hash_table_destroy(ring->analog_samples);
+}
+
+static gboolean feed_ring_push(struct feed_queue_ring *ring,
+		const struct sr_dev_inst *sdi, struct sr_datafeed_packet *packet)
+{
+	struct feed_queue_slot *slot;
+	guint pos, seq;
+
+	pos = (guint)g_atomic_int_get(&ring->tail);
+	while (1) {
+		slot = &ring->slots[pos & ring->mask];
+		seq = (guint)g_atomic_int_get(&slot->sequence);
+		if (seq == pos) {
+			if (g_atomic_int_compare_and_exchange(&ring->tail,
+					(gint)pos, (gint)(pos + 1)))
+				break;
+		} else if ((gint)(seq - pos) < 0) {
+			/* Slot still holds an unconsumed packet, ring full. */
+			return FALSE;
+		}
+		pos = (guint)g_atomic_int_get(&ring->tail);
+	}
+	slot->sdi = sdi;
+	slot->packet = packet;
+	g_atomic_int_set(&slot->sequence, (gint)(pos + 1));
+
+	return TRUE;
+}
+
+static gboolean feed_ring_pop(struct feed_queue_ring *ring,
+		const struct sr_dev_inst **sdi, struct sr_datafeed_packet **packet)
+{
+	struct feed_queue_slot *slot;
+	guint pos;
+
+	pos = (guint)ring->head;
+	slot = &ring->slots[pos & ring->mask];
+	if ((guint)g_atomic_int_get(&slot->sequence) != pos + 1)
+		return FALSE;
+	g_atomic_int_set(&ring->head, (gint)(pos + 1));
+	*sdi = slot->sdi;
+	*packet = slot->packet;
+	g_atomic_int_set(&slot->sequence, (gint)(pos + ring->mask + 1));
+
+	return TRUE;
+}
+
+/* Get the packet which the next pop would return, NULL when empty. */
+static struct sr_datafeed_packet *feed_ring_peek(struct feed_queue_ring *ring)
+{
+	struct feed_queue_slot *slot;
+	guint pos;
+
+	pos = (guint)ring->head;
+	slot = &ring->slots[pos & ring->mask];
+	if ((guint)g_atomic_int_get(&slot->sequence) != pos + 1)
+		return NULL;
+
+	return slot->packet;
+}
+
+static size_t feed_ring_fill(struct feed_queue_ring *ring)
+{
+	return (guint)g_atomic_int_get(&ring->tail) -
+		(guint)g_atomic_int_get(&ring->head);
+}
+
+static gboolean feed_ring_is_full(struct feed_queue_ring *ring)
+{
+	return feed_ring_fill(ring) > ring->mask;
+}
+
+static struct feed_queue_ring *feed_queue_ring_get(
+		struct session_feed_queue *queue, const struct sr_dev_inst *sdi)
+{
+	size_t idx;
+
+	for (idx = 0; idx + 1 < queue->ring_count; idx++) {
+		if (queue->rings[idx].sdi == sdi)
+			return &queue->rings[idx];
+	}
+
+	return &queue->rings[queue->ring_count - 1];
+}
+
+static gpointer analog_packet_channel(const struct sr_datafeed_analog *analog)
+{
+	if (!analog->meaning || !analog->meaning->channels)
+		return NULL;
+
+	return analog->meaning->channels->data;
+}
+
+/*
+ * Get the point in time where a packet starts, in seconds. Logic data
+ * and each analog channel are separate streams of samples. Other
+ * packets are located after the furthest stream. Packets of devices
+ * with unknown samplerate are due immediately.
+ */
+static double feed_ring_time(const struct session_feed_queue *queue,
+		const struct feed_queue_ring *ring,
+		const struct sr_datafeed_packet *packet)
+{
+	uint64_t samples, *count;
+
+	if (!ring->sdi || !ring->samplerate)
+		return queue->position;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+		samples = ring->logic_samples;
+		break;
+	case SR_DF_ANALOG:
+		count = g_hash_table_lookup(ring->analog_samples,
+			analog_packet_channel(packet->payload));
+		samples = count ? *count : 0;
+		break;
+	default:
+		samples = ring->samples;
+		break;
+	}
+
+	return (double)samples / ring->samplerate;
+}
+
+/* Update a device's stream position after delivery of a packet. */
+static void feed_ring_advance(struct feed_queue_ring *ring,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_config *src;
+	uint64_t *count, samples, run;
+	gpointer channel;
+	GSList *l;
+
+	if (!ring->sdi)
+		return;
+
+	samples = 0;
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				ring->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (logic->unitsize)
+			ring->logic_samples += logic->length / logic->unitsize;
+		samples = ring->logic_samples;
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		for (run = 0; run < rle->num_runs; run++)
+			ring->logic_samples += rle->lengths[run];
+		samples = ring->logic_samples;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		channel = analog_packet_channel(analog);
+		count = g_hash_table_lookup(ring->analog_samples, channel);
+		if (!count) {
+			count = g_malloc0(sizeof(*count));
+			g_hash_table_insert(ring->analog_samples, channel, count);
+		}
+		*count += analog->num_samples;
+		samples = *count;
+		break;
+	case SR_DF_END:
+		ring->ended = TRUE;
+		break;
+	}
+	if (samples > ring->samples)
+		ring->samples = samples;
+}
+
+/*
+ * Pick the ring with the packet which is to get delivered next, NULL
+ * when there is none yet. Merged delivery needs to wait until every
+ * device which still runs has a packet queued. Unless a ring is full
+ * (its producer would wait for the consumer, which might wait for a
+ * device that is served by the very same thread), or the session
+ * stops (drain). The pick is "forced" when it did not wait for a
+ * running device because of a full ring.
+ */
+static struct feed_queue_ring *feed_queue_next(
+		struct session_feed_queue *queue, gboolean drain,
+		gboolean *forced)
+{
+	struct feed_queue_ring *ring, *best;
+	struct sr_datafeed_packet *packet;
+	double time, best_time;
+	gboolean pressure;
+	size_t idx;
+
+	*forced = FALSE;
+	if (!queue->merge) {
+		ring = &queue->rings[0];
+		return feed_ring_peek(ring) ? ring : NULL;
+	}
+
+	pressure = g_atomic_int_get(&queue->producers_waiting) != 0;
+	for (idx = 0; !pressure && idx < queue->ring_count; idx++) {
+		if (feed_ring_is_full(&queue->rings[idx]))
+			pressure = TRUE;
+	}
+
+	best = NULL;
+	best_time = 0.0;
+	for (idx = 0; idx < queue->ring_count; idx++) {
+		ring = &queue->rings[idx];
+		packet = feed_ring_peek(ring);
+		if (!packet) {
+			if (ring->sdi && !ring->ended && !drain) {
+				if (!pressure)
+					return NULL;
+				*forced = TRUE;
+			}
+			continue;
+		}
+		time = feed_ring_time(queue, ring, packet);
+		if (!best || time < best_time) {
+			best = ring;
+			best_time = time;
+		}
+	}
+
+	return best;
+}
+
+static void feed_queue_wakeup(struct session_feed_queue *queue)
+{
+	g_mutex_lock(&queue->wait_mutex);
+	g_cond_broadcast(&queue->wait_cond);
+	g_mutex_unlock(&queue->wait_mutex);
+}
+
+static int session_deliver(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+
+static gpointer feed_queue_thread(gpointer data)
+{
+	struct sr_session *session;
+	struct session_feed_queue *queue;
+	struct feed_queue_ring *ring;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	gboolean drain, forced;
+	double time;
+
+	session = data;
+	queue = session->feed_queue;
+
+	while (1) {
+		drain = g_atomic_int_get(&queue->quit);
+		ring = feed_queue_next(queue, drain, &forced);
+		if (ring) {
+			time = feed_ring_time(queue, ring, feed_ring_peek(ring));
+			feed_ring_pop(ring, &sdi, &packet);
+			if (g_atomic_int_get(&queue->producers_waiting))
+				feed_queue_wakeup(queue);
+			if (forced)
+				g_atomic_int_inc(&session->feed_queue_unordered);
+			if (queue->merge) {
+				if (time > queue->position)
+					queue->position = time;
+				feed_ring_advance(ring, packet);
+			}
+			g_private_set(&current_buffer,
+				((struct packet_copy *)packet)->buf);
+			session_deliver(sdi, packet);
+			g_private_set(&current_buffer, NULL);
+			sr_packet_free(packet);
+			continue;
+		}
+		/* All rings are empty, and the session stops. */
+		if (drain)
+			break;
+
+		/* Nothing to deliver. Sleep until packets arrive, or stop. */
+		g_mutex_lock(&queue->wait_mutex);
+		g_atomic_int_set(&queue->consumer_waiting, 1);
+		while (!feed_queue_next(queue, FALSE, &forced) &&
+				!g_atomic_int_get(&queue->quit))
+			g_cond_wait(&queue->wait_cond, &queue->wait_mutex);
+		g_atomic_int_set(&queue->consumer_waiting, 0);
+		g_mutex_unlock(&queue->wait_mutex);
+	}
+
+	return NULL;
+}
+
+static void feed_queue_free(struct session_feed_queue *queue)
+{
+	size_t idx;
+
+	g_mutex_clear(&queue->wait_mutex);
+	g_cond_clear(&queue->wait_cond);
+	for (idx = 0; idx < queue->ring_count; idx++)
+		feed_ring_clear(&queue->rings[idx]);
+	g_free(queue->rings);
+	g_free(queue);
+}
+
+static int feed_queue_start(struct sr_session *session)
+{
+	struct session_feed_queue *queue;
+	size_t depth, idx;
+	guint size;
+	GSList *l;
+	GError *error;
+
+	g_atomic_int_set(&session->feed_queue_high_water, 0);
+	g_atomic_int_set(&session->feed_queue_dropped, 0);
+	g_atomic_int_set(&session->feed_queue_unordered, 0);
+	depth = session->feed_queue_depth;
+	if (!depth && !session->feed_queue_merge)
+		return SR_OK;
+	if (!depth)
+		depth = FEED_QUEUE_MERGE_DEPTH;
+
+	/* Round the depth up to a power of two, for cheap slot lookup. */
+	size = 1;
+	while (size < depth)
+		size <<= 1;
+
+	/* A ring per device for merged delivery, and the shared ring. */
+	queue = g_malloc0(sizeof(*queue));
+	queue->merge = session->feed_queue_merge;
+	queue->ring_count = 1;
+	if (queue->merge)
+		queue->ring_count += g_slist_length(session->devs);
+	queue->rings = g_malloc0(queue->ring_count * sizeof(queue->rings[0]));
+	idx = 0;
+	if (queue->merge) {
+		for (l = session->devs; l; l = l->next)
+			feed_ring_init(&queue->rings[idx++], size, l->data);
+	}
+	feed_ring_init(&queue->rings[idx], size, NULL);
+	g_mutex_init(&queue->wait_mutex);
+	g_cond_init(&queue->wait_cond);
+	g_atomic_pointer_set(&session->feed_queue, queue);
+
+	error = NULL;
+	queue->thread = g_thread_try_new("sr-session-feed",
+		feed_queue_thread, session, &error);
+	if (!queue->thread) {
+		sr_err("Cannot create feed queue thread: %s.", error->message);
+		g_error_free(error);
+		g_atomic_pointer_set(&session->feed_queue, NULL);
+		feed_queue_free(queue);
+		return SR_ERR;
+	}
+	sr_dbg("Started feed queue thread, %zu ring(s) of %u packets.",
+		queue->ring_count, size);
+
+	return SR_OK;
+}
+
+/* Have the consumer thread deliver all pending packets, and terminate. */
+static void feed_queue_stop(struct sr_session *session)
+{
+	struct session_feed_queue *queue;
+
+	queue = session->feed_queue;
+	if (!queue)
+		return;
+
+	g_atomic_int_set(&queue->quit, 1);
+	feed_queue_wakeup(queue);
+	g_thread_join(queue->thread);
+	g_atomic_pointer_set(&session->feed_queue, NULL);
+
+	sr_dbg("Stopped feed queue thread, high water mark %u, "
+		"%u packets dropped, %u unordered.",
+		(guint)g_atomic_int_get(&session->feed_queue_high_water),
+		(guint)g_atomic_int_get(&session->feed_queue_dropped),
+		(guint)g_atomic_int_get(&session->feed_queue_unordered));
+
+	feed_queue_free(queue);
+}
+
+static int feed_queue_send(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct session_feed_queue *queue;
+	struct feed_queue_ring *ring;
+	struct sr_datafeed_packet *copy;
+	gboolean droppable, dropped;
+	gint fill, high_water;
+	int ret;
+
+	queue = session->feed_queue;
+	ring = feed_queue_ring_get(queue, sdi);
+	droppable = packet->type == SR_DF_LOGIC || packet->type == SR_DF_ANALOG ||
+			packet->type == SR_DF_LOGIC_RLE;
+	droppable = droppable && session->feed_queue_policy == SR_FEED_QUEUE_DROP;
+
+	/* The packet's payload is only valid during this call. */
+	copy = NULL;
+	dropped = droppable && feed_ring_is_full(ring);
+	if (!dropped) {
+		ret = sr_packet_copy(packet, &copy);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	while (!dropped && !feed_ring_push(ring, sdi, copy)) {
+		if (droppable) {
+			dropped = TRUE;
+			break;
+		}
+		/*
+		 * Wait for the consumer to catch up. Wake it up first,
+		 * with merged delivery it may wait for other devices.
+		 */
+		g_mutex_lock(&queue->wait_mutex);
+		g_atomic_int_inc(&queue->producers_waiting);
+		g_cond_broadcast(&queue->wait_cond);
+		while (feed_ring_is_full(ring) && !g_atomic_int_get(&queue->quit))
+			g_cond_wait(&queue->wait_cond, &queue->wait_mutex);
+		g_atomic_int_add(&queue->producers_waiting, -1);
+		g_mutex_unlock(&queue->wait_mutex);
+	}
+
+	if (dropped) {
+		g_atomic_int_inc(&session->feed_queue_dropped);
+		if (copy)
+			sr_packet_free(copy);
+	} else {
+		fill = (gint)feed_ring_fill(ring);
+		high_water = g_atomic_int_get(&session->feed_queue_high_water);
+		while (fill > high_water && !g_atomic_int_compare_and_exchange(
+				&session->feed_queue_high_water, high_water, fill))
+			high_water = g_atomic_int_get(&session->feed_queue_high_water);
+	}
+	/* A full ring also lets merged delivery proceed. */
+	if (g_atomic_int_get(&queue->consumer_waiting))
+		feed_queue_wakeup(queue);
+
+	return SR_OK;
+}
+
 /**
  * Create a new session.
  *
@@ -231,6 +921,12 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	 */
 	session->event_sources = g_hash_table_new(NULL, NULL);
 
+	session->feed_queue_policy = SR_FEED_QUEUE_BLOCK;
+
+	session->buffer_pool = g_malloc0(sizeof(*session->buffer_pool));
+	session->buffer_pool->refcount = 1;
+	g_mutex_init(&session->buffer_pool->mutex);
+
 	*new_session = session;
 
 	return SR_OK;
@@ -261,6 +957,9 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	g_hash_table_unref(session->event_sources);
 
+	buffer_pool_close(session->buffer_pool);
+	g_free(session->rle_scratch);
+
 	g_mutex_clear(&session->main_mutex);
 
 	g_free(session);
@@ -444,6 +1143,20 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 	return SR_OK;
 }
 
+/*
+ * The feed queue's consumer thread walks the list of datafeed callbacks
+ * without a lock, the list must not change while the thread runs.
+ */
+static gboolean datafeed_callbacks_locked(struct sr_session *session)
+{
+	if (!g_atomic_pointer_get(&session->feed_queue))
+		return FALSE;
+
+	sr_err("Cannot change datafeed callbacks while the feed queue runs.");
+
+	return TRUE;
+}
+
 /**
  * Remove all datafeed callbacks in a session.
  *
@@ -451,6 +1164,7 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
  *
  * @retval SR_OK Success.
  * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session runs with a feed queue.
  *
  * @since 0.4.0
  */
@@ -461,6 +1175,9 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
+	if (datafeed_callbacks_locked(session))
+		return SR_ERR;
+
 	g_slist_free_full(session->datafeed_callbacks, g_free);
 	session->datafeed_callbacks = NULL;
 
@@ -477,11 +1194,41 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
  *
  * @retval SR_OK Success.
  * @retval SR_ERR_BUG No session exists.
+ * @retval SR_ERR The session runs with a feed queue.
  *
  * @since 0.3.0
  */
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data)
+{
+	return sr_session_datafeed_callback_add_full(session, cb, cb_data, 0);
+}
+
+/**
+ * Add a datafeed callback to a session, with flags.
+ *
+ * The flags declare which optional packet types the callback accepts,
+ * see enum sr_datafeed_callback_flag. The session converts packets
+ * for callbacks which did not opt in, e.g. SR_DF_LOGIC_RLE packets
+ * get expanded to SR_DF_LOGIC packets.
+ *
+ * While the session runs with a feed queue (see sr_session_feed_queue_set()),
+ * its datafeed callbacks cannot be changed.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param flags Bitwise OR of SR_DATAFEED_* flags.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ * @retval SR_ERR The session runs with a feed queue.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_callback_add_full(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t flags)
 {
 	struct datafeed_callback *cb_struct;
 
@@ -495,9 +1242,13 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		return SR_ERR_ARG;
 	}
 
+	if (datafeed_callbacks_locked(session))
+		return SR_ERR;
+
 	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
 	cb_struct->cb = cb;
 	cb_struct->cb_data = cb_data;
+	cb_struct->flags = flags;
 
 	session->datafeed_callbacks =
 	    g_slist_append(session->datafeed_callbacks, cb_struct);
@@ -690,6 +1441,7 @@ static gboolean delayed_stop_check(void *data)
 		return G_SOURCE_REMOVE;
 
 	session->running = FALSE;
+	feed_queue_stop(session);
 	unset_main_context(session);
 
 	sr_info("Stopped.");
@@ -806,10 +1558,16 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
-	sr_info("Starting.");
-
-	session->running = TRUE;
-
+	ret = feed_queue_start(session);
+	if (ret != SR_OK) {
+		unset_main_context(session);
+		return ret;
+	}
+
+	sr_info("Starting.");
+
+	session->running = TRUE;
+
 	/* Have all devices start acquisition. */
 	for (l = session->devs; l; l = l->next) {
 		if (!(sdi = l->data)) {
@@ -837,6 +1595,7 @@ SR_API int sr_session_start(struct sr_session *session)
 		 * sources... */
 		session->running = FALSE;
 
+		feed_queue_stop(session);
 		unset_main_context(session);
 		return ret;
 	}
@@ -1026,6 +1785,147 @@ SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 	return SR_OK;
 }
 
+/**
+ * Configure the session's feed queue.
+ *
+ * By default, datafeed packets are passed to the session's transforms
+ * and datafeed callbacks synchronously, in the context of the driver
+ * which sends them. With a feed queue, packets are queued and get
+ * delivered by a separate consumer thread instead. Slow consumers then
+ * don't delay the acquisition drivers' I/O handling.
+ *
+ * Transforms and datafeed callbacks execute in the consumer thread.
+ * All queued packets are delivered before the session is considered
+ * stopped. The datafeed callbacks cannot be changed while the queue
+ * runs.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param depth The queue depth in packets, zero for synchronous delivery.
+ * @param policy How to handle packets when the queue is full, one of
+ *               the enum sr_feed_queue_policy values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_feed_queue_set(struct sr_session *session,
+		size_t depth, int policy)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (policy != SR_FEED_QUEUE_BLOCK && policy != SR_FEED_QUEUE_DROP) {
+		sr_err("%s: invalid policy %d", __func__, policy);
+		return SR_ERR_ARG;
+	}
+
+	if (depth > G_MAXINT / 2) {
+		sr_err("%s: queue depth %zu too large", __func__, depth);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change the feed queue while the session runs.");
+		return SR_ERR;
+	}
+
+	session->feed_queue_depth = depth;
+	session->feed_queue_policy = policy;
+
+	return SR_OK;
+}
+
+/**
+ * Configure merged delivery of several devices' packets.
+ *
+ * With merged delivery, every device of the session gets a queue of
+ * its own. Packets are delivered in the order of their position in
+ * time, which is derived from the devices' sample counts and their
+ * samplerates. Packets at the same position are delivered in the order
+ * in which the devices were added to the session.
+ *
+ * Delivery waits until each device which has not yet sent SR_DF_END
+ * has queued a packet, or until a device's queue is full. As long as
+ * no queue fills up, the sequence of packets at the datafeed callbacks
+ * does not depend on how the devices' threads get scheduled. A full
+ * queue does not block the other devices, since drivers may share a
+ * thread. Packets then get delivered without waiting for the devices
+ * which have none queued, their sequence depends on timing, and
+ * sr_session_feed_queue_stats_get() reports them as unordered. Choose
+ * a depth which covers the devices' differences in latency, and check
+ * the count when the order matters. Merged delivery implies
+ * a feed queue, a default depth is used when sr_session_feed_queue_set()
+ * did not configure one. The depth and the policy apply to each
+ * device's queue.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param merge TRUE to merge the devices' packets by time, FALSE to
+ *              deliver packets in the order they were sent.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_feed_queue_merge_set(struct sr_session *session,
+		gboolean merge)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change the feed queue while the session runs.");
+		return SR_ERR;
+	}
+
+	session->feed_queue_merge = merge;
+
+	return SR_OK;
+}
+
+/**
+ * Get the feed queue statistics of the current or most recent run.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param[out] high_water Highest number of queued packets (in one of the
+ *                        devices' queues with merged delivery). Can be NULL.
+ * @param[out] dropped Number of dropped packets. Can be NULL.
+ * @param[out] unordered Number of packets which merged delivery passed on
+ *                       without waiting for all devices, because a queue
+ *                       was full. Zero when the packets were delivered
+ *                       in the order of time. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_feed_queue_stats_get(struct sr_session *session,
+		size_t *high_water, uint64_t *dropped, uint64_t *unordered)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	/* Producers update the counters while the session runs. */
+	if (high_water)
+		*high_water = (guint)g_atomic_int_get(&session->feed_queue_high_water);
+	if (dropped)
+		*dropped = (guint)g_atomic_int_get(&session->feed_queue_dropped);
+	if (unordered)
+		*unordered = (guint)g_atomic_int_get(&session->feed_queue_unordered);
+
+	return SR_OK;
+}
+
 /**
  * Debug helper.
  *
@@ -1035,6 +1935,7 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1066,6 +1967,11 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", rle->num_runs, rle->unitsize);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
@@ -1124,12 +2030,6 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
 {
-	GSList *l;
-	struct datafeed_callback *cb_struct;
-	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
-	int ret;
-
 	if (!sdi) {
 		sr_err("%s: sdi was NULL", __func__);
 		return SR_ERR_ARG;
@@ -1145,6 +2045,300 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	/*
+	 * Hand the packet to the consumer thread when the session runs
+	 * with a feed queue. Packets which the consumer thread sends by
+	 * itself get delivered immediately.
+	 */
+	if (sdi->session->feed_queue &&
+			g_thread_self() != sdi->session->feed_queue->thread)
+		return feed_queue_send(sdi->session, sdi, packet);
+
+	return session_deliver(sdi, packet);
+}
+
+/**
+ * Send a packet whose sample data is backed by a buffer.
+ *
+ * Works like sr_session_send(), but lets consumers and the session's
+ * feed queue take references to @a buf instead of copying the data.
+ *
+ * @param sdi Device instance. Must not be NULL.
+ * @param packet The packet to send. Must not be NULL.
+ * @param buf The buffer which holds the packet's logic or analog data,
+ *            see sr_session_buffer_new(). Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buf)
+{
+	struct sr_buffer *prev;
+	int ret;
+
+	prev = g_private_get(&current_buffer);
+	g_private_set(&current_buffer, buf);
+	ret = sr_session_send(sdi, packet);
+	g_private_set(&current_buffer, prev);
+
+	return ret;
+}
+
+/**
+ * Check whether run-length encoded logic data reaches the session's
+ * datafeed callbacks without getting expanded first.
+ *
+ * Drivers can use this to decide whether sending SR_DF_LOGIC_RLE
+ * packets is worth it. Sending them is always allowed, though.
+ *
+ * @param session The session to use.
+ *
+ * @retval TRUE At least one datafeed callback accepts SR_DF_LOGIC_RLE
+ *              packets, and no transforms are installed.
+ * @retval FALSE Otherwise.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_session_accepts_logic_rle(struct sr_session *session)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+
+	if (!session || session->transforms)
+		return FALSE;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->flags & SR_DATAFEED_LOGIC_RLE)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Write @a count copies of a @a unitsize wide logic sample value.
+ *
+ * The value gets broadcast into a block of up to LOGIC_FILL_BLOCK
+ * bytes by repeated doubling. Long runs then are written in copies
+ * of that block, which remains in the L1 cache and lets memcpy() use
+ * its widest stores. Single byte units are handled by memset().
+ *
+ * @param[out] dst The output buffer, @a count * @a unitsize bytes.
+ * @param[in] value The sample value, @a unitsize bytes.
+ * @param[in] unitsize The sample width in bytes.
+ * @param[in] count The number of samples to write.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_fill(uint8_t *dst, const uint8_t *value,
+		size_t unitsize, uint64_t count)
+{
+	uint64_t filled, chunk, block;
+
+	if (!count || !unitsize)
+		return;
+
+	if (unitsize == 1) {
+		memset(dst, value[0], count);
+		return;
+	}
+
+	/* Double the filled range until it reaches the block size. */
+	block = MAX(LOGIC_FILL_BLOCK / unitsize, 1);
+	memcpy(dst, value, unitsize);
+	filled = 1;
+	while (filled < count && filled < block) {
+		chunk = MIN(filled, MIN(count, block) - filled);
+		memcpy(dst + filled * unitsize, dst, chunk * unitsize);
+		filled += chunk;
+	}
+
+	/* Repeat the cache hot block for the remainder. */
+	while (filled < count) {
+		chunk = MIN(count - filled, block);
+		memcpy(dst + filled * unitsize, dst, chunk * unitsize);
+		filled += chunk;
+	}
+}
+
+/* Expand into a buffer of max_samples samples, see sr_logic_rle_expand(). */
+static int logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		uint8_t *buf, uint64_t max_samples,
+		sr_logic_rle_expand_callback cb, void *cb_data)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	const uint8_t *value;
+	uint64_t run, remain, count, fill;
+	size_t unitsize;
+	int ret;
+
+	unitsize = rle->unitsize;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = unitsize;
+	logic.data = buf;
+
+	ret = SR_OK;
+	fill = 0;
+	for (run = 0; run < rle->num_runs && ret == SR_OK; run++) {
+		value = (const uint8_t *)rle->values + run * unitsize;
+		remain = rle->lengths[run];
+		while (remain) {
+			count = MIN(remain, max_samples - fill);
+			sr_logic_fill(buf + fill * unitsize, value, unitsize, count);
+			fill += count;
+			remain -= count;
+			if (fill < max_samples)
+				continue;
+			logic.length = fill * unitsize;
+			fill = 0;
+			if ((ret = cb(&packet, cb_data)) != SR_OK)
+				break;
+		}
+	}
+	if (ret == SR_OK && fill) {
+		logic.length = fill * unitsize;
+		ret = cb(&packet, cb_data);
+	}
+
+	return ret;
+}
+
+/**
+ * Expand run-length encoded logic data to SR_DF_LOGIC packets.
+ *
+ * The packets get passed to @a cb, each holds at most
+ * LOGIC_RLE_EXPAND_SIZE bytes of sample data. Their payload is only
+ * valid during the callback.
+ *
+ * @param rle The run-length encoded data. Must not be NULL.
+ * @param cb The function to call for each expanded packet.
+ * @param cb_data Opaque pointer passed to @a cb.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Memory allocation failed.
+ * @retval other The first error which @a cb returned.
+ *
+ * @private
+ */
+SR_PRIV int sr_logic_rle_expand(const struct sr_datafeed_logic_rle *rle,
+		sr_logic_rle_expand_callback cb, void *cb_data)
+{
+	uint8_t *buf;
+	uint64_t run, total, max_samples;
+	int ret;
+
+	if (!rle->unitsize)
+		return SR_ERR_ARG;
+
+	total = 0;
+	for (run = 0; run < rle->num_runs; run++)
+		total += rle->lengths[run];
+	if (!total)
+		return SR_OK;
+
+	max_samples = LOGIC_RLE_EXPAND_SIZE / rle->unitsize;
+	if (!max_samples)
+		max_samples = 1;
+	if (max_samples > total)
+		max_samples = total;
+	buf = g_try_malloc(max_samples * rle->unitsize);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	ret = logic_rle_expand(rle, buf, max_samples, cb, cb_data);
+
+	g_free(buf);
+
+	return ret;
+}
+
+/*
+ * Like sr_logic_rle_expand(), but use the session's scratch buffer,
+ * which saves an allocation per packet. The buffer is taken out of
+ * the session while in use, concurrent callers allocate their own.
+ */
+static int session_logic_rle_expand(struct sr_session *session,
+		const struct sr_datafeed_logic_rle *rle,
+		sr_logic_rle_expand_callback cb, void *cb_data)
+{
+	uint8_t *buf;
+	int ret;
+
+	if (!rle->unitsize || rle->unitsize > LOGIC_RLE_EXPAND_SIZE)
+		return sr_logic_rle_expand(rle, cb, cb_data);
+
+	buf = g_atomic_pointer_get(&session->rle_scratch);
+	if (!buf || !g_atomic_pointer_compare_and_exchange(
+			&session->rle_scratch, buf, NULL))
+		buf = g_try_malloc(LOGIC_RLE_EXPAND_SIZE);
+	if (!buf)
+		return SR_ERR_MALLOC;
+
+	ret = logic_rle_expand(rle, buf,
+		LOGIC_RLE_EXPAND_SIZE / rle->unitsize, cb, cb_data);
+
+	if (!g_atomic_pointer_compare_and_exchange(
+			&session->rle_scratch, NULL, buf))
+		g_free(buf);
+
+	return ret;
+}
+
+static int deliver_expanded(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	return session_deliver(cb_data, packet);
+}
+
+/* Pass expanded logic data to the callbacks which don't accept RLE. */
+static int deliver_expanded_legacy(const struct sr_datafeed_packet *packet,
+		void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+
+	sdi = cb_data;
+
+	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->flags & SR_DATAFEED_LOGIC_RLE)
+			continue;
+		if (sr_log_loglevel_get() >= SR_LOG_DBG)
+			datafeed_dump(packet);
+		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Pass a packet through the session's transforms, and to its datafeed
+ * callbacks.
+ */
+static int session_deliver(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+	struct sr_datafeed_packet *packet_in, *packet_out;
+	struct sr_transform *t;
+	gboolean expand;
+	int ret;
+
+	/* Transform modules only know about expanded logic data. */
+	if (packet->type == SR_DF_LOGIC_RLE && sdi->session->transforms)
+		return session_logic_rle_expand(sdi->session, packet->payload,
+			deliver_expanded, (void *)sdi);
+
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
@@ -1178,14 +2372,24 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
+	 * callbacks. Run-length encoded logic data gets expanded once for
+	 * all callbacks which don't accept it.
 	 */
+	expand = FALSE;
 	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (packet->type == SR_DF_LOGIC_RLE &&
+				!(cb_struct->flags & SR_DATAFEED_LOGIC_RLE)) {
+			expand = TRUE;
+			continue;
+		}
 		if (sr_log_loglevel_get() >= SR_LOG_DBG)
 			datafeed_dump(packet);
-		cb_struct = l->data;
 		cb_struct->cb(sdi, packet, cb_struct->cb_data);
 	}
+	if (expand)
+		return session_logic_rle_expand(sdi->session, packet->payload,
+			deliver_expanded_legacy, (void *)sdi);
 
 	return SR_OK;
 }
@@ -1494,6 +2698,22 @@ static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
 	meta_copy->config = g_slist_append(meta_copy->config, item);
 }
 
+/**
+ * Copy a datafeed packet.
+ *
+ * Logic and analog sample data which is backed by a buffer (see
+ * sr_packet_buffer_get()) is shared with the original, the copy holds
+ * a reference to the buffer. Other payloads get duplicated.
+ *
+ * @param packet The packet to copy. Must not be NULL.
+ * @param copy Receives the copy, which the caller must release with
+ *             sr_packet_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unknown packet type.
+ *
+ * @since 0.4.0
+ */
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy)
 {
@@ -1503,17 +2723,25 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	struct sr_datafeed_logic *logic_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_datafeed_logic_rle *rle_copy;
 	struct sr_analog_encoding *encoding_copy;
 	struct sr_analog_meaning *meaning_copy;
 	struct sr_analog_spec *spec_copy;
+	struct packet_copy *pc;
+	struct sr_buffer *buf;
 	uint8_t *payload;
 
-	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
+	/* Copies remember the buffer which backs their data, if any. */
+	pc = g_malloc0(sizeof(*pc));
+	*copy = &pc->packet;
 	(*copy)->type = packet->type;
 
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +2752,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1534,21 +2762,34 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
-		if (!logic_copy->data) {
-			g_free(logic_copy);
-			return SR_ERR;
+		/* Share buffer backed data instead of copying it. */
+		buf = buffer_lookup(logic->data);
+		if (buf) {
+			pc->buf = sr_buffer_ref(buf);
+			logic_copy->data = logic->data;
+		} else {
+			logic_copy->data = g_malloc(logic->length);
+			if (!logic_copy->data) {
+				g_free(logic_copy);
+				return SR_ERR;
+			}
+			memcpy(logic_copy->data, logic->data, logic->length);
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
 		(*copy)->payload = logic_copy;
 		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
 		analog_copy = g_malloc(sizeof(*analog_copy));
-		analog_copy->data = g_malloc(
+		buf = buffer_lookup(analog->data);
+		if (buf) {
+			pc->buf = sr_buffer_ref(buf);
+			analog_copy->data = analog->data;
+		} else {
+			analog_copy->data = g_malloc(
 				analog->encoding->unitsize * analog->num_samples);
-		memcpy(analog_copy->data, analog->data,
+			memcpy(analog_copy->data, analog->data,
 				analog->encoding->unitsize * analog->num_samples);
+		}
 		analog_copy->num_samples = analog->num_samples;
 #if GLIB_CHECK_VERSION(2, 67, 3)
 		encoding_copy = g_memdup2(analog->encoding, sizeof(*analog->encoding));
@@ -1566,6 +2807,19 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		analog_copy->spec = spec_copy;
 		(*copy)->payload = analog_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		rle_copy = g_malloc(sizeof(*rle_copy));
+		rle_copy->num_runs = rle->num_runs;
+		rle_copy->unitsize = rle->unitsize;
+		rle_copy->values = g_malloc(rle->num_runs * rle->unitsize);
+		memcpy(rle_copy->values, rle->values,
+			rle->num_runs * rle->unitsize);
+		rle_copy->lengths = g_malloc(rle->num_runs * sizeof(uint64_t));
+		memcpy(rle_copy->lengths, rle->lengths,
+			rle->num_runs * sizeof(uint64_t));
+		(*copy)->payload = rle_copy;
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 		return SR_ERR;
@@ -1574,17 +2828,35 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	return SR_OK;
 }
 
+/**
+ * Free a copy of a datafeed packet.
+ *
+ * Only packets which sr_packet_copy() returned may be passed in. The
+ * copy carries information beyond struct sr_datafeed_packet, packets
+ * which the caller allocated by other means must be released by the
+ * caller itself.
+ *
+ * @param packet The packet copy. Must not be NULL.
+ *
+ * @since 0.4.0
+ */
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
 	struct sr_config *src;
+	struct sr_buffer *buf;
 	GSList *l;
 
+	buf = ((struct packet_copy *)packet)->buf;
+
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1603,22 +2875,153 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 		break;
 	case SR_DF_LOGIC:
 		logic = packet->payload;
-		g_free(logic->data);
+		if (buf)
+			sr_buffer_unref(buf);
+		else
+			g_free(logic->data);
 		g_free((void *)packet->payload);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
-		g_free(analog->data);
+		if (buf)
+			sr_buffer_unref(buf);
+		else
+			g_free(analog->data);
 		g_free(analog->encoding);
 		g_slist_free(analog->meaning->channels);
 		g_free(analog->meaning);
 		g_free(analog->spec);
 		g_free((void *)packet->payload);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		g_free(rle->values);
+		g_free(rle->lengths);
+		g_free((void *)packet->payload);
+		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
 	}
 	g_free(packet);
 }
 
+/**
+ * Get the buffer which backs a datafeed packet's sample data.
+ *
+ * Datafeed callbacks can use this to keep logic or analog sample data
+ * beyond the callback's return, by taking a reference to the buffer
+ * instead of copying the data. Not all drivers send buffer backed
+ * data, callers must fall back to copying the data (see
+ * sr_packet_copy()) when NULL is returned.
+ *
+ * Only the packet which the calling thread currently receives in a
+ * datafeed callback is considered. Copies keep their buffer reference
+ * by themselves, sr_packet_free() releases it.
+ *
+ * @param packet The datafeed packet. Must not be NULL.
+ *
+ * @returns The buffer (the caller does not own a reference), or NULL
+ *          when the packet has no sample data or the data is not
+ *          backed by a buffer.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_buffer *sr_packet_buffer_get(
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	if (!packet || !packet->payload)
+		return NULL;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return buffer_lookup(logic->data);
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return buffer_lookup(analog->data);
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * Take a reference to a sample data buffer.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @returns The buffer.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_buffer *sr_buffer_ref(struct sr_buffer *buf)
+{
+	g_atomic_int_inc(&buf->refcount);
+
+	return buf;
+}
+
+/**
+ * Release a reference to a sample data buffer.
+ *
+ * When the last reference gets released, the buffer is returned to
+ * the pool of the session which it was taken from for re-use, or is
+ * freed when that session was destroyed already.
+ *
+ * @param buf The buffer. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_buffer_unref(struct sr_buffer *buf)
+{
+	struct sr_buffer_pool *pool;
+
+	if (!buf || !g_atomic_int_dec_and_test(&buf->refcount))
+		return;
+
+	pool = buf->pool;
+	g_mutex_lock(&pool->mutex);
+	if (!pool->closed && pool->free_count < BUFFER_POOL_MAX_FREE) {
+		pool->free_buffers = g_slist_prepend(pool->free_buffers, buf);
+		pool->free_count++;
+		buf = NULL;
+	}
+	g_mutex_unlock(&pool->mutex);
+
+	if (buf)
+		buffer_free(buf);
+	buffer_pool_unref(pool);
+}
+
+/**
+ * Get a sample data buffer's data.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @returns The buffer's data.
+ *
+ * @since 0.6.0
+ */
+SR_API void *sr_buffer_data_get(const struct sr_buffer *buf)
+{
+	return buf->data;
+}
+
+/**
+ * Get a sample data buffer's size.
+ *
+ * @param buf The buffer. Must not be NULL.
+ *
+ * @returns The size of the buffer's data (in bytes). This can exceed
+ *          the size of the sample data in a packet.
+ *
+ * @since 0.6.0
+ */
+SR_API size_t sr_buffer_size_get(const struct sr_buffer *buf)
+{
+	return buf->size;
+}
+
 /** @} */
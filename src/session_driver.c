@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <string.h>
 #include <zip.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -34,21 +35,84 @@
 #define CHUNKSIZE (4 * 1024 * 1024)
 /** @endcond */
 
+/* Upper limit for the read-ahead depth, in chunks. */
+#define READ_AHEAD_MAX 16
+
 SR_PRIV struct sr_dev_driver session_driver_info;
 
+/* A capture file in the archive, and the samples which it holds. */
+struct session_chunk {
+	zip_uint64_t index;
+	uint64_t first_sample;
+	uint64_t num_samples;
+};
+
+/*
+ * All chunks of either the logic data, or one analog channel's data.
+ * Chunks are kept in sample order, such that the chunk which holds a
+ * given sample number can be looked up without decompressing data.
+ */
+struct session_stream {
+	int analog_channel;
+	size_t sample_size;
+	GArray *chunks;
+};
+
+/* Which part of a capture file to read, and for which stream. */
+struct chunk_read {
+	guint stream;
+	zip_uint64_t index;
+	uint64_t skip_bytes;
+	uint64_t send_bytes;
+};
+
+/*
+ * A chunk which gets decompressed ahead of time by a worker thread.
+ * Jobs for files which exceed the buffer size are not handed to the
+ * workers, the main loop streams these files when it gets to them.
+ */
+struct prefetch_job {
+	struct chunk_read rd;
+	gboolean prefetch;
+	gboolean done;
+	struct sr_buffer *sbuf;
+	int length;
+};
+
+/* An open capture file, content optionally compressed by sigrok itself. */
+struct capfile {
+	struct zip_file *zf;
+	gboolean lzo;
+	struct sr_sessionfile_lzo_reader lzo_rd;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
 	struct zip *archive;
-	struct zip_file *capfile;
+	struct capfile *capfile;
+	gboolean lzo;
 	int bytes_read;
 	uint64_t samplerate;
 	int unitsize;
 	int num_logic_channels;
 	int num_analog_channels;
-	int cur_analog_channel;
 	GArray *analog_channels;
-	int cur_chunk;
+	GArray *streams;
+	uint64_t num_samples;
+	uint64_t range_start;
+	uint64_t range_end;
+	guint cur_stream;
+	guint cur_chunk;
+	guint capfile_stream;
+	uint64_t skip_bytes;
+	uint64_t send_bytes;
+	uint64_t read_ahead;
+	GThreadPool *prefetch_pool;
+	GAsyncQueue *prefetch_archives;
+	GQueue *prefetch_jobs;
+	GMutex prefetch_mutex;
+	GCond prefetch_cond;
 	gboolean finished;
 };
 
@@ -59,145 +123,564 @@ static const uint32_t devopts[] = {
 	SR_CONF_NUM_ANALOG_CHANNELS | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET,
+	SR_CONF_SAMPLE_RANGE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_READ_AHEAD | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_CAPTURE_CODEC | SR_CONF_SET,
 };
 
-static gboolean stream_session_data(struct sr_dev_inst *sdi)
+static int num_processors(void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	return g_get_num_processors();
+#else
+	return 1;
+#endif
+}
+
+static struct capfile *capfile_open(struct zip *archive,
+		zip_uint64_t index, gboolean lzo)
+{
+	struct capfile *cf;
+
+	cf = g_malloc0(sizeof(*cf));
+	cf->lzo = lzo;
+	cf->zf = zip_fopen_index(archive, index, 0);
+	if (!cf->zf) {
+		g_free(cf);
+		return NULL;
+	}
+	if (lzo && sr_sessionfile_lzo_open(&cf->lzo_rd, cf->zf) != SR_OK) {
+		zip_fclose(cf->zf);
+		g_free(cf);
+		return NULL;
+	}
+
+	return cf;
+}
+
+static int capfile_read(struct capfile *cf, void *buf, size_t length)
+{
+	if (cf->lzo)
+		return sr_sessionfile_lzo_read(&cf->lzo_rd, buf, length);
+
+	return zip_fread(cf->zf, buf, length);
+}
+
+static void capfile_close(struct capfile *cf)
+{
+	if (cf->lzo)
+		sr_sessionfile_lzo_close(&cf->lzo_rd);
+	zip_fclose(cf->zf);
+	g_free(cf);
+}
+
+/* Get a capture file's uncompressed size. */
+static int capfile_size(struct session_vdev *vdev,
+		const struct zip_stat *zs, uint64_t *size)
+{
+	struct zip_file *zf;
+	int ret;
+
+	if (!vdev->lzo) {
+		*size = zs->size;
+		return SR_OK;
+	}
+
+	if (!(zf = zip_fopen_index(vdev->archive, zs->index, 0)))
+		return SR_ERR;
+	ret = sr_sessionfile_lzo_size(zf, size);
+	zip_fclose(zf);
+
+	return ret;
+}
+
+static void index_free(struct session_vdev *vdev)
+{
+	struct session_stream *stream;
+	guint i;
+
+	if (!vdev->streams)
+		return;
+
+	for (i = 0; i < vdev->streams->len; i++) {
+		stream = &g_array_index(vdev->streams, struct session_stream, i);
+		g_array_free(stream->chunks, TRUE);
+	}
+	g_array_free(vdev->streams, TRUE);
+	vdev->streams = NULL;
+	vdev->num_samples = 0;
+}
+
+/*
+ * Register the capture file(s) of one stream. Data either is in a
+ * single file with the base name, or chunked into files with a "-1",
+ * "-2", etc suffix. Only the archive's directory gets inspected, the
+ * uncompressed size of a file determines its number of samples.
+ */
+static int index_stream(struct session_vdev *vdev, const char *basename,
+		int analog_channel, size_t sample_size)
+{
+	struct session_stream stream;
+	struct session_chunk chunk;
+	struct zip_stat zs;
+	char name[128];
+	uint64_t size;
+	int num, ret;
+
+	stream.analog_channel = analog_channel;
+	stream.sample_size = sample_size;
+	stream.chunks = g_array_new(FALSE, FALSE, sizeof(chunk));
+
+	chunk.first_sample = 0;
+	if (zip_stat(vdev->archive, basename, 0, &zs) != -1) {
+		/* No chunks, just a single capture file. */
+		if ((ret = capfile_size(vdev, &zs, &size)) != SR_OK) {
+			g_array_free(stream.chunks, TRUE);
+			return ret;
+		}
+		chunk.index = zs.index;
+		chunk.num_samples = size / sample_size;
+		g_array_append_val(stream.chunks, chunk);
+		chunk.first_sample += chunk.num_samples;
+	} else {
+		for (num = 1; ; num++) {
+			snprintf(name, sizeof(name), "%s-%d", basename, num);
+			if (zip_stat(vdev->archive, name, 0, &zs) == -1)
+				break;
+			if ((ret = capfile_size(vdev, &zs, &size)) != SR_OK) {
+				g_array_free(stream.chunks, TRUE);
+				return ret;
+			}
+			chunk.index = zs.index;
+			chunk.num_samples = size / sample_size;
+			g_array_append_val(stream.chunks, chunk);
+			chunk.first_sample += chunk.num_samples;
+		}
+	}
+
+	if (!stream.chunks->len) {
+		sr_err("No capture file '%s' in session file '%s'.",
+			basename, vdev->sessionfile);
+		g_array_free(stream.chunks, TRUE);
+		return SR_ERR;
+	}
+
+	/* Past the loop, first_sample is the stream's total sample count. */
+	vdev->num_samples = MAX(vdev->num_samples, chunk.first_sample);
+	g_array_append_val(vdev->streams, stream);
+
+	return SR_OK;
+}
+
+/* Build the sample index for logic data and all analog channels. */
+static int index_build(struct session_vdev *vdev)
+{
+	char *basename;
+	int i, ret;
+
+	if (vdev->streams)
+		return SR_OK;
+
+	vdev->streams = g_array_new(FALSE, FALSE, sizeof(struct session_stream));
+	vdev->num_samples = 0;
+
+	/* unitsize is not defined for purely analog session files. */
+	if (vdev->capturefile && vdev->unitsize) {
+		ret = index_stream(vdev, vdev->capturefile, 0, vdev->unitsize);
+		if (ret != SR_OK) {
+			index_free(vdev);
+			return ret;
+		}
+	}
+
+	for (i = 0; i < vdev->num_analog_channels; i++) {
+		basename = g_strdup_printf("analog-1-%d",
+			vdev->num_logic_channels + i + 1);
+		ret = index_stream(vdev, basename, i + 1, sizeof(float));
+		g_free(basename);
+		if (ret != SR_OK) {
+			index_free(vdev);
+			return ret;
+		}
+	}
+
+	sr_dbg("Indexed %u stream(s), %" PRIu64 " samples.",
+		vdev->streams->len, vdev->num_samples);
+
+	return SR_OK;
+}
+
+/* Find the chunk which holds the given sample (binary search). */
+static guint index_find_chunk(const struct session_stream *stream,
+		uint64_t sample)
+{
+	const struct session_chunk *chunk;
+	guint lo, hi, mid;
+
+	lo = 0;
+	hi = stream->chunks->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		chunk = &g_array_index(stream->chunks, struct session_chunk, mid);
+		if (chunk->first_sample <= sample)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * Determine the next capture file which holds samples of the requested
+ * range. Files before or after the range are skipped without being
+ * decompressed. Returns FALSE when all streams are done.
+ */
+static gboolean next_chunk(struct session_vdev *vdev, struct chunk_read *rd)
+{
+	struct session_stream *stream;
+	struct session_chunk *chunk;
+	uint64_t first, last;
+
+	while (vdev->cur_stream < vdev->streams->len) {
+		stream = &g_array_index(vdev->streams,
+			struct session_stream, vdev->cur_stream);
+		if (vdev->cur_chunk == 0 && vdev->range_start)
+			vdev->cur_chunk = index_find_chunk(stream, vdev->range_start);
+		if (vdev->cur_chunk >= stream->chunks->len) {
+			vdev->cur_stream++;
+			vdev->cur_chunk = 0;
+			continue;
+		}
+		chunk = &g_array_index(stream->chunks,
+			struct session_chunk, vdev->cur_chunk);
+		vdev->cur_chunk++;
+
+		first = MAX(chunk->first_sample, vdev->range_start);
+		last = chunk->first_sample + chunk->num_samples;
+		if (vdev->range_end && vdev->range_end < last)
+			last = vdev->range_end;
+		if (vdev->range_end && chunk->first_sample >= vdev->range_end) {
+			/* Past the range, continue with the next stream. */
+			vdev->cur_chunk = stream->chunks->len;
+			continue;
+		}
+		if (first >= last)
+			continue;
+
+		rd->stream = vdev->cur_stream;
+		rd->index = chunk->index;
+		rd->skip_bytes = (first - chunk->first_sample) * stream->sample_size;
+		rd->send_bytes = (last - first) * stream->sample_size;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static int open_chunk(struct session_vdev *vdev, const struct chunk_read *rd)
+{
+	vdev->capfile = capfile_open(vdev->archive, rd->index, vdev->lzo);
+	if (!vdev->capfile) {
+		sr_err("Cannot open capture file %" PRIu64 " in "
+			"session file '%s'.", (uint64_t)rd->index,
+			vdev->sessionfile);
+		return SR_ERR;
+	}
+	vdev->capfile_stream = rd->stream;
+	vdev->skip_bytes = rd->skip_bytes;
+	vdev->send_bytes = rd->send_bytes;
+	sr_dbg("Opened %s.", zip_get_name(vdev->archive, rd->index, 0));
+
+	return SR_OK;
+}
+
+static void send_chunk_data(struct sr_dev_inst *sdi,
+		const struct session_stream *stream, struct sr_buffer *sbuf, int len)
 {
 	struct session_vdev *vdev;
+	void *buf;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	struct zip_stat zs;
-	int ret, got_data;
-	char capturefile[128];
-	void *buf;
 
-	got_data = FALSE;
 	vdev = sdi->priv;
+	buf = sr_buffer_data_get(sbuf);
+
+	if (stream->analog_channel) {
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		analog.meaning->channels = g_slist_prepend(NULL,
+				g_array_index(vdev->analog_channels,
+					struct sr_channel *, stream->analog_channel - 1));
+		analog.num_samples = len / sizeof(float);
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = SR_MQFLAG_DC;
+		analog.data = (float *) buf;
+	} else {
+		if (len % vdev->unitsize != 0)
+			sr_warn("Read size %d not a multiple of the"
+				" unit size %d.", len, vdev->unitsize);
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = len;
+		logic.unitsize = vdev->unitsize;
+		logic.data = buf;
+	}
+	vdev->bytes_read += len;
+	sr_session_send_buffer(sdi, &packet, sbuf);
+	if (stream->analog_channel)
+		g_slist_free(analog.meaning->channels);
+}
 
-	if (!vdev->capfile) {
-		/* No capture file opened yet, or finished with the last
-		 * chunked one. */
-		if (vdev->capturefile && (vdev->cur_chunk == 0)) {
-			/* capturefile is always the unchunked base name. */
-			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
-				/* No chunks, just a single capture file. */
-				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", vdev->capturefile);
-			} else {
-				/* Try as first chunk filename. */
-				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
-					sr_err("No capture file '%s' in " "session file '%s'.",
-							vdev->capturefile, vdev->sessionfile);
-					return FALSE;
-				}
-			}
+/*
+ * Decompress a chunk in a worker thread. libzip archive handles must
+ * not be shared across threads, workers take a handle of their own
+ * from a set which gets re-used across jobs.
+ */
+static void prefetch_worker(gpointer data, gpointer user_data)
+{
+	struct prefetch_job *job;
+	struct sr_dev_inst *sdi;
+	struct session_vdev *vdev;
+	struct zip *archive;
+	struct capfile *cf;
+	uint8_t *buf;
+	size_t size, pos;
+	int ret;
+
+	job = data;
+	sdi = user_data;
+	vdev = sdi->priv;
+
+	job->length = -1;
+	cf = NULL;
+	archive = g_async_queue_try_pop(vdev->prefetch_archives);
+	if (!archive)
+		archive = zip_open(vdev->sessionfile, 0, &ret);
+	if (archive)
+		cf = capfile_open(archive, job->rd.index, vdev->lzo);
+	job->sbuf = sr_session_buffer_new(sdi->session, CHUNKSIZE);
+	if (cf && job->sbuf) {
+		buf = sr_buffer_data_get(job->sbuf);
+		size = job->rd.skip_bytes + job->rd.send_bytes;
+		pos = 0;
+		while (pos < size) {
+			ret = capfile_read(cf, buf + pos, size - pos);
+			if (ret <= 0)
+				break;
+			pos += ret;
+		}
+		if (pos > job->rd.skip_bytes) {
+			job->length = pos - job->rd.skip_bytes;
+			if (job->rd.skip_bytes)
+				memmove(buf, buf + job->rd.skip_bytes, job->length);
 		} else {
-			/* Capture data is chunked, advance to the next chunk. */
-			vdev->cur_chunk++;
-			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
-					vdev->cur_chunk);
-			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", capturefile);
-			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
-				vdev->capturefile = g_strdup_printf("analog-1-%d",
-						vdev->num_logic_channels + vdev->cur_analog_channel + 1);
-				vdev->cur_analog_channel++;
-				vdev->cur_chunk = 0;
-				return TRUE;
-			} else {
-				/* We got all the chunks, finish up. */
-				g_free(vdev->capturefile);
-
-				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
-				 * once. In order to not mess this mechanism up, we simulate
-				 * this here if needed. For purely analog files, capturefile
-				 * is not set.
-				 */
-				if (vdev->num_logic_channels)
-					vdev->capturefile = g_strdup("logic-1");
-				else
-					vdev->capturefile = NULL;
-				return FALSE;
-			}
+			job->length = 0;
 		}
 	}
+	if (cf)
+		capfile_close(cf);
+	if (archive)
+		g_async_queue_push(vdev->prefetch_archives, archive);
+
+	g_mutex_lock(&vdev->prefetch_mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&vdev->prefetch_cond);
+	g_mutex_unlock(&vdev->prefetch_mutex);
+}
 
-	buf = g_malloc(CHUNKSIZE);
+/* Queue jobs for upcoming chunks, up to the read-ahead depth. */
+static void prefetch_fill(struct session_vdev *vdev)
+{
+	struct prefetch_job *job;
+	struct chunk_read rd;
+
+	while (g_queue_get_length(vdev->prefetch_jobs) < vdev->read_ahead) {
+		if (!next_chunk(vdev, &rd))
+			break;
+		job = g_malloc0(sizeof(*job));
+		job->rd = rd;
+		/* Larger files get streamed by the main loop, as usual. */
+		job->prefetch = rd.skip_bytes + rd.send_bytes <= CHUNKSIZE;
+		g_queue_push_tail(vdev->prefetch_jobs, job);
+		if (job->prefetch)
+			g_thread_pool_push(vdev->prefetch_pool, job, NULL);
+	}
+}
 
-	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
+/*
+ * Send the next chunk's data, in the original order. Returns FALSE
+ * when all data was sent, or an error occurred.
+ */
+static gboolean prefetch_send(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct prefetch_job *job;
+	struct session_stream *stream;
+	gboolean ret;
 
-	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
-		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		}
+	vdev = sdi->priv;
+
+	prefetch_fill(vdev);
+	job = g_queue_pop_head(vdev->prefetch_jobs);
+	if (!job)
+		return FALSE;
+
+	if (!job->prefetch) {
+		ret = open_chunk(vdev, &job->rd) == SR_OK;
+		g_free(job);
+		return ret;
+	}
+
+	g_mutex_lock(&vdev->prefetch_mutex);
+	while (!job->done)
+		g_cond_wait(&vdev->prefetch_cond, &vdev->prefetch_mutex);
+	g_mutex_unlock(&vdev->prefetch_mutex);
+
+	ret = job->length >= 0;
+	if (!ret) {
+		sr_err("Cannot read capture file %" PRIu64 " in "
+			"session file '%s'.", (uint64_t)job->rd.index,
+			vdev->sessionfile);
+	} else if (job->length > 0) {
+		stream = &g_array_index(vdev->streams,
+			struct session_stream, job->rd.stream);
+		send_chunk_data(sdi, stream, job->sbuf, job->length);
+	}
+	if (job->sbuf)
+		sr_buffer_unref(job->sbuf);
+	g_free(job);
+
+	/* Have the workers continue while the frontend processes data. */
+	if (ret)
+		prefetch_fill(vdev);
+
+	return ret;
+}
+
+static void prefetch_start(const struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	int num_threads;
+
+	vdev = sdi->priv;
+	if (!vdev->read_ahead)
+		return;
+
+	num_threads = MIN(vdev->read_ahead, (uint64_t)num_processors());
+	vdev->prefetch_pool = g_thread_pool_new(prefetch_worker, (void *)sdi,
+		num_threads, FALSE, NULL);
+	if (!vdev->prefetch_pool) {
+		sr_warn("Cannot create worker threads, not reading ahead.");
+		return;
+	}
+	vdev->prefetch_archives = g_async_queue_new();
+	vdev->prefetch_jobs = g_queue_new();
+	sr_dbg("Reading ahead %" PRIu64 " chunks, %d threads.",
+		vdev->read_ahead, num_threads);
+}
+
+static void prefetch_stop(struct session_vdev *vdev)
+{
+	struct prefetch_job *job;
+	struct zip *archive;
+
+	if (!vdev->prefetch_pool)
+		return;
+
+	/* Drop jobs which did not start yet, wait for running jobs. */
+	g_thread_pool_free(vdev->prefetch_pool, TRUE, TRUE);
+	vdev->prefetch_pool = NULL;
+
+	while ((job = g_queue_pop_head(vdev->prefetch_jobs))) {
+		if (job->sbuf)
+			sr_buffer_unref(job->sbuf);
+		g_free(job);
+	}
+	g_queue_free(vdev->prefetch_jobs);
+	vdev->prefetch_jobs = NULL;
+
+	while ((archive = g_async_queue_try_pop(vdev->prefetch_archives)))
+		zip_discard(archive);
+	g_async_queue_unref(vdev->prefetch_archives);
+	vdev->prefetch_archives = NULL;
+}
+
+static gboolean stream_session_data(struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct session_stream *stream;
+	struct chunk_read rd;
+	int ret;
+	size_t len;
+	gboolean done;
+	struct sr_buffer *sbuf;
+	void *buf;
+
+	vdev = sdi->priv;
+
+	if (!vdev->capfile) {
+		if (vdev->prefetch_pool)
+			return prefetch_send(sdi);
+		if (!next_chunk(vdev, &rd) || open_chunk(vdev, &rd) != SR_OK)
+			return FALSE;
+	}
+	stream = &g_array_index(vdev->streams,
+		struct session_stream, vdev->capfile_stream);
+
+	/*
+	 * Take the buffer from the session's pool, consumers can keep
+	 * references to it, and the allocation gets re-used otherwise.
+	 */
+	sbuf = sr_session_buffer_new(sdi->session, CHUNKSIZE);
+	if (!sbuf) {
+		sr_err("Cannot allocate sample data buffer.");
+		return FALSE;
+	}
+	buf = sr_buffer_data_get(sbuf);
+
+	/*
+	 * Compressed data cannot get seeked into. Discard the data which
+	 * precedes the requested range in the first chunk, in portions
+	 * which keep the main loop responsive.
+	 */
+	done = FALSE;
+	if (vdev->skip_bytes) {
+		len = MIN(vdev->skip_bytes, CHUNKSIZE);
+		ret = capfile_read(vdev->capfile, buf, len);
+		if (ret > 0)
+			vdev->skip_bytes -= ret;
+		else
+			done = TRUE;
+		ret = 0;
 	} else {
-		/* done with this capture file */
-		zip_fclose(vdev->capfile);
+		len = CHUNKSIZE / stream->sample_size * stream->sample_size;
+		len = MIN(len, vdev->send_bytes);
+		ret = len ? capfile_read(vdev->capfile, buf, len) : 0;
+		if (ret <= 0)
+			done = TRUE;
+	}
+
+	if (ret > 0) {
+		vdev->send_bytes -= ret;
+		send_chunk_data(sdi, stream, sbuf, ret);
+	}
+	if (done) {
+		/* Done with this capture file. */
+		capfile_close(vdev->capfile);
 		vdev->capfile = NULL;
-		if (vdev->cur_chunk != 0) {
-			/* There might be more chunks, so don't fall through
-			 * to the SR_DF_END here. */
-			got_data = TRUE;
-		}
 	}
-	g_free(buf);
+	sr_buffer_unref(sbuf);
 
-	return got_data;
+	return TRUE;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
@@ -216,8 +699,9 @@ static int receive_data(int fd, int revents, void *cb_data)
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
+	prefetch_stop(vdev);
 	if (vdev->capfile) {
-		zip_fclose(vdev->capfile);
+		capfile_close(vdev->capfile);
 		vdev->capfile = NULL;
 	}
 	if (vdev->archive) {
@@ -230,6 +714,22 @@ static int receive_data(int fd, int revents, void *cb_data)
 	return G_SOURCE_REMOVE;
 }
 
+static int archive_open(struct session_vdev *vdev)
+{
+	int ret;
+
+	if (vdev->archive)
+		return SR_OK;
+
+	if (!(vdev->archive = zip_open(vdev->sessionfile, 0, &ret))) {
+		sr_err("Failed to open session file '%s': "
+		       "zip error %d.", vdev->sessionfile, ret);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
 /* driver callbacks */
 
 static int dev_open(struct sr_dev_inst *sdi)
@@ -241,6 +741,10 @@ static int dev_open(struct sr_dev_inst *sdi)
 	di = sdi->driver;
 	drvc = di->context;
 	vdev = g_malloc0(sizeof(struct session_vdev));
+	g_mutex_init(&vdev->prefetch_mutex);
+	g_cond_init(&vdev->prefetch_cond);
+	/* Worker threads only get started when the application asks. */
+	vdev->read_ahead = 0;
 	sdi->priv = vdev;
 	drvc->instances = g_slist_append(drvc->instances, sdi);
 
@@ -249,9 +753,15 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
-	const struct session_vdev *const vdev = sdi->priv;
+	struct session_vdev *vdev = sdi->priv;
+
+	index_free(vdev);
+	if (vdev->analog_channels)
+		g_array_free(vdev->analog_channels, TRUE);
 	g_free(vdev->sessionfile);
 	g_free(vdev->capturefile);
+	g_mutex_clear(&vdev->prefetch_mutex);
+	g_cond_clear(&vdev->prefetch_cond);
 
 	g_free(sdi->priv);
 	sdi->priv = NULL;
@@ -263,6 +773,7 @@ static int config_get(uint32_t key, GVariant **data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
 	struct session_vdev *vdev;
+	int ret;
 
 	(void)cg;
 
@@ -278,6 +789,25 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_UNITSIZE:
 		*data = g_variant_new_uint64(vdev->unitsize);
 		break;
+	case SR_CONF_LIMIT_SAMPLES:
+		/* Only needs the archive's directory, no data gets read. */
+		if (!vdev->streams) {
+			if ((ret = archive_open(vdev)) != SR_OK)
+				return ret;
+			ret = index_build(vdev);
+			zip_discard(vdev->archive);
+			vdev->archive = NULL;
+			if (ret != SR_OK)
+				return ret;
+		}
+		*data = g_variant_new_uint64(vdev->num_samples);
+		break;
+	case SR_CONF_SAMPLE_RANGE:
+		*data = std_gvar_tuple_u64(vdev->range_start, vdev->range_end);
+		break;
+	case SR_CONF_READ_AHEAD:
+		*data = g_variant_new_uint64(vdev->read_ahead);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -289,6 +819,8 @@ static int config_set(uint32_t key, GVariant *data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
 	struct session_vdev *vdev;
+	uint64_t start, end;
+	const char *codec;
 
 	(void)cg;
 
@@ -303,20 +835,50 @@ static int config_set(uint32_t key, GVariant *data,
 		g_free(vdev->sessionfile);
 		vdev->sessionfile = g_strdup(g_variant_get_string(data, NULL));
 		sr_info("Setting sessionfile to '%s'.", vdev->sessionfile);
+		index_free(vdev);
 		break;
 	case SR_CONF_CAPTUREFILE:
 		g_free(vdev->capturefile);
 		vdev->capturefile = g_strdup(g_variant_get_string(data, NULL));
 		sr_info("Setting capturefile to '%s'.", vdev->capturefile);
+		index_free(vdev);
 		break;
 	case SR_CONF_CAPTURE_UNITSIZE:
 		vdev->unitsize = g_variant_get_uint64(data);
+		index_free(vdev);
 		break;
 	case SR_CONF_NUM_LOGIC_CHANNELS:
 		vdev->num_logic_channels = g_variant_get_int32(data);
+		index_free(vdev);
 		break;
 	case SR_CONF_NUM_ANALOG_CHANNELS:
 		vdev->num_analog_channels = g_variant_get_int32(data);
+		index_free(vdev);
+		break;
+	case SR_CONF_SAMPLE_RANGE:
+		g_variant_get(data, "(tt)", &start, &end);
+		if (end && start >= end) {
+			sr_err("Invalid sample range %" PRIu64 "-%" PRIu64 ".",
+				start, end);
+			return SR_ERR_ARG;
+		}
+		vdev->range_start = start;
+		vdev->range_end = end;
+		sr_info("Setting sample range to %" PRIu64 "-%" PRIu64 ".",
+			start, end);
+		break;
+	case SR_CONF_READ_AHEAD:
+		vdev->read_ahead = MIN(g_variant_get_uint64(data), READ_AHEAD_MAX);
+		break;
+	case SR_CONF_CAPTURE_CODEC:
+		codec = g_variant_get_string(data, NULL);
+		if (!strcmp(codec, "lzo1x")) {
+			vdev->lzo = TRUE;
+		} else {
+			sr_err("Unsupported capture codec '%s'.", codec);
+			return SR_ERR_NA;
+		}
+		index_free(vdev);
 		break;
 	default:
 		return SR_ERR_NA;
@@ -340,7 +902,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	vdev = sdi->priv;
 	vdev->bytes_read = 0;
-	vdev->cur_analog_channel = 0;
+	if (vdev->analog_channels)
+		g_array_free(vdev->analog_channels, TRUE);
 	vdev->analog_channels = g_array_sized_new(FALSE, FALSE,
 			sizeof(struct sr_channel *), vdev->num_analog_channels);
 	for (l = sdi->channels; l; l = l->next) {
@@ -348,18 +911,25 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		if (ch->type == SR_CHANNEL_ANALOG)
 			g_array_append_val(vdev->analog_channels, ch);
 	}
+	vdev->cur_stream = 0;
 	vdev->cur_chunk = 0;
+	vdev->skip_bytes = 0;
+	vdev->send_bytes = 0;
 	vdev->finished = FALSE;
 
 	sr_info("Opening archive %s file %s", vdev->sessionfile,
 		vdev->capturefile);
 
-	if (!(vdev->archive = zip_open(vdev->sessionfile, 0, &ret))) {
-		sr_err("Failed to open session file '%s': "
-		       "zip error %d.", vdev->sessionfile, ret);
-		return SR_ERR;
+	if ((ret = archive_open(vdev)) != SR_OK)
+		return ret;
+	if ((ret = index_build(vdev)) != SR_OK) {
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return ret;
 	}
 
+	prefetch_start(sdi);
+
 	std_session_send_df_header(sdi);
 
 	/* freewheeling source */
@@ -26,11 +26,20 @@
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "minilzo/minilzo.h"
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "session-file"
 /** @endcond */
 
+/** @cond PRIVATE */
+#define LZO_MAGIC "SRLZ"
+#define LZO_HEADER_SIZE (4 + 4)
+#define LZO_FRAME_HEADER_SIZE (4 + 4)
+/* Worst case size of incompressible data, see the LZO FAQ. */
+#define LZO_PACKED_MAX(len) ((len) + (len) / 16 + 64 + 3)
+/** @endcond */
+
 /**
  * @file
  *
@@ -111,6 +120,221 @@ SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 	return keyfile;
 }
 
+/**
+ * Compress a capture file's content with the lzo1x method.
+ *
+ * The result starts with a header (magic, uncompressed size), which is
+ * followed by frames of up to SR_SESSIONFILE_LZO_FRAME_SIZE bytes of
+ * uncompressed data. Each frame has a header with the uncompressed and
+ * the compressed size. The frames allow readers to decompress capture
+ * files with bounded memory. The result is supposed to get stored in
+ * the archive without compression at the ZIP level.
+ *
+ * @param[out] out Receives the compressed data, previous content gets
+ *                 replaced.
+ * @param[in] data The capture file's content.
+ * @param[in] length The content's size in bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Compression failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_lzo_pack(GByteArray *out,
+			const void *data, size_t length)
+{
+	const uint8_t *rdptr;
+	uint8_t *wrptr;
+	void *wrkmem;
+	size_t raw_len, pos;
+	lzo_uint packed_len;
+	int ret;
+
+	if (!out || (length && !data) || length > G_MAXUINT32)
+		return SR_ERR_ARG;
+
+	g_byte_array_set_size(out, LZO_HEADER_SIZE);
+	wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+
+	wrptr = out->data;
+	memcpy(wrptr, LZO_MAGIC, 4);
+	write_u32le(&wrptr[4], length);
+	pos = LZO_HEADER_SIZE;
+	rdptr = data;
+	ret = SR_OK;
+	while (length) {
+		raw_len = MIN(length, SR_SESSIONFILE_LZO_FRAME_SIZE);
+		/* Incompressible data expands, reserve the worst case. */
+		g_byte_array_set_size(out,
+			pos + LZO_FRAME_HEADER_SIZE + LZO_PACKED_MAX(raw_len));
+		wrptr = &out->data[pos];
+		packed_len = 0;
+		if (lzo1x_1_compress(rdptr, raw_len,
+				&wrptr[LZO_FRAME_HEADER_SIZE], &packed_len,
+				wrkmem) != LZO_E_OK) {
+			sr_err("lzo1x compression failed.");
+			ret = SR_ERR;
+			break;
+		}
+		write_u32le(&wrptr[0], raw_len);
+		write_u32le(&wrptr[4], packed_len);
+		pos += LZO_FRAME_HEADER_SIZE + packed_len;
+		rdptr += raw_len;
+		length -= raw_len;
+	}
+	g_free(wrkmem);
+	g_byte_array_set_size(out, pos);
+
+	return ret;
+}
+
+/* Read exactly the requested amount of data, or fail. */
+static int lzo_read_exact(struct zip_file *zf, void *buf, size_t length)
+{
+	uint8_t *wrptr;
+	int ret;
+
+	wrptr = buf;
+	while (length) {
+		ret = zip_fread(zf, wrptr, length);
+		if (ret <= 0)
+			return SR_ERR_DATA;
+		wrptr += ret;
+		length -= ret;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get the uncompressed size of an lzo1x compressed capture file.
+ *
+ * Only reads the file's header, which is cheap since the file is
+ * stored without compression at the ZIP level.
+ *
+ * @param[in] zf The opened capture file, positioned at its start.
+ * @param[out] size The uncompressed content's size in bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA Not an lzo1x compressed capture file.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_lzo_size(struct zip_file *zf, uint64_t *size)
+{
+	uint8_t header[LZO_HEADER_SIZE];
+
+	if (lzo_read_exact(zf, header, sizeof(header)) != SR_OK ||
+			memcmp(header, LZO_MAGIC, 4) != 0) {
+		sr_err("Not an lzo1x compressed capture file.");
+		return SR_ERR_DATA;
+	}
+	*size = read_u32le(&header[4]);
+
+	return SR_OK;
+}
+
+/**
+ * Start reading an lzo1x compressed capture file.
+ *
+ * Reads the file's header, rd->size is the uncompressed content's size
+ * afterwards. See sr_sessionfile_lzo_pack() for the file's layout.
+ *
+ * @param[out] rd The reader's state.
+ * @param[in] zf The opened capture file. Remains owned by the caller.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA Not an lzo1x compressed capture file.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_lzo_open(struct sr_sessionfile_lzo_reader *rd,
+			struct zip_file *zf)
+{
+	int ret;
+
+	memset(rd, 0, sizeof(*rd));
+	if ((ret = sr_sessionfile_lzo_size(zf, &rd->size)) != SR_OK)
+		return ret;
+	rd->zf = zf;
+	rd->frame = g_malloc(SR_SESSIONFILE_LZO_FRAME_SIZE);
+	rd->packed = g_malloc(LZO_PACKED_MAX(SR_SESSIONFILE_LZO_FRAME_SIZE));
+
+	return SR_OK;
+}
+
+/**
+ * Read uncompressed data from an lzo1x compressed capture file.
+ *
+ * @param[in,out] rd The reader's state.
+ * @param[out] buf Receives the uncompressed data.
+ * @param[in] length The maximum number of bytes to read.
+ *
+ * @return The number of bytes read, 0 at the end of the file, or a
+ *         negative SR_ERR_* code for corrupt data.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_lzo_read(struct sr_sessionfile_lzo_reader *rd,
+			void *buf, size_t length)
+{
+	uint8_t header[LZO_FRAME_HEADER_SIZE];
+	uint8_t *wrptr;
+	size_t raw_len, packed_len, count;
+	lzo_uint out_len;
+	int ret;
+
+	wrptr = buf;
+	count = 0;
+	while (count < length) {
+		if (rd->frame_pos == rd->frame_len) {
+			ret = zip_fread(rd->zf, header, sizeof(header));
+			if (ret == 0)
+				break;
+			if (ret != sizeof(header))
+				return SR_ERR_DATA;
+			raw_len = read_u32le(&header[0]);
+			packed_len = read_u32le(&header[4]);
+			if (raw_len > SR_SESSIONFILE_LZO_FRAME_SIZE ||
+					packed_len > LZO_PACKED_MAX(raw_len))
+				return SR_ERR_DATA;
+			if (lzo_read_exact(rd->zf, rd->packed, packed_len) != SR_OK)
+				return SR_ERR_DATA;
+			out_len = raw_len;
+			ret = lzo1x_decompress_safe(rd->packed, packed_len,
+				rd->frame, &out_len, NULL);
+			if (ret != LZO_E_OK || out_len != raw_len) {
+				sr_err("lzo1x decompression error %d.", ret);
+				return SR_ERR_DATA;
+			}
+			rd->frame_len = raw_len;
+			rd->frame_pos = 0;
+			continue;
+		}
+		raw_len = MIN(length - count, rd->frame_len - rd->frame_pos);
+		memcpy(&wrptr[count], &rd->frame[rd->frame_pos], raw_len);
+		rd->frame_pos += raw_len;
+		count += raw_len;
+	}
+
+	return count;
+}
+
+/**
+ * Release an lzo1x reader's resources. Does not close the capture file.
+ *
+ * @param[in] rd The reader's state.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_lzo_close(struct sr_sessionfile_lzo_reader *rd)
+{
+	g_free(rd->frame);
+	g_free(rd->packed);
+	memset(rd, 0, sizeof(*rd));
+}
+
 /** @private */
 SR_PRIV int sr_sessionfile_check(const char *filename)
 {
@@ -151,7 +375,7 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 	zip_fclose(zf);
 	s[ret] = '\0';
 	version = g_ascii_strtoull(s, NULL, 10);
-	if (version == 0 || version > 2) {
+	if (version == 0 || version > SR_SESSIONFILE_VERSION_LZO) {
 		sr_dbg("Cannot handle sigrok session file version %" PRIu64 ".",
 			version);
 		zip_discard(archive);
@@ -299,6 +523,18 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 					}
 					sr_config_set(sdi, NULL, SR_CONF_CAPTURE_UNITSIZE,
 							g_variant_new_uint64(unitsize));
+				} else if (!strcmp(keys[j], "codec")) {
+					/* Capture files are compressed by sigrok itself. */
+					val = g_key_file_get_string(kf, sections[i],
+							keys[j], &error);
+					if (!sdi || !val || sr_config_set(sdi, NULL,
+							SR_CONF_CAPTURE_CODEC,
+							g_variant_new_string(val)) != SR_OK) {
+						g_free(val);
+						ret = SR_ERR_DATA;
+						break;
+					}
+					g_free(val);
 				} else if (!strcmp(keys[j], "total probes")) {
 					total_channels = g_key_file_get_integer(kf,
 							sections[i], keys[j], &error);
@@ -19,6 +19,10 @@
 
 #include <config.h>
 #include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SOFT_TRIGGER_X86_KERNELS 1
+#include <immintrin.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -26,6 +30,34 @@
 #define LOG_PREFIX "soft-trigger"
 /** @endcond */
 
+/*
+ * A trigger stage gets compiled into bit masks which cover all logic
+ * channels, and are evaluated word by word for a sample. Masks are
+ * kept in 64bit words in little endian order, bit N corresponds to
+ * logic channel index N like it does in the sample data. For unit
+ * sizes which evenly divide a machine word, the first mask word also
+ * gets replicated into lanes, to check several samples at once.
+ */
+enum {
+	STAGE_MASK_LEVEL,
+	STAGE_MASK_VALUE,
+	STAGE_MASK_RISE,
+	STAGE_MASK_FALL,
+	STAGE_MASK_EDGE,
+	STAGE_MASK_COUNT,
+};
+
+#define STAGE_LANE_BYTES 32
+
+struct soft_trigger_logic_stage {
+	gboolean has_matches;
+	gboolean has_enabled;
+	gboolean first_is_edge;
+	gboolean never;
+	uint64_t *masks[STAGE_MASK_COUNT];
+	uint8_t lanes[STAGE_MASK_COUNT][STAGE_LANE_BYTES];
+};
+
 SR_PRIV int logic_channel_unitsize(GSList *channels)
 {
 	int number = 0;
@@ -41,17 +73,111 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+static size_t stage_word_count(const struct soft_trigger_logic *stl)
+{
+	return (stl->unitsize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+static gboolean stage_lanes_usable(const struct soft_trigger_logic *stl)
+{
+	switch (stl->unitsize) {
+	case 1:
+	case 2:
+	case 4:
+	case 8:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static void stage_compile(struct soft_trigger_logic *stl,
+		struct soft_trigger_logic_stage *cs,
+		const struct sr_trigger_stage *stage)
+{
+	const struct sr_trigger_match *match;
+	const GSList *l;
+	size_t words, word, idx;
+	uint64_t bit;
+	int m;
+
+	words = stage_word_count(stl);
+	for (m = 0; m < STAGE_MASK_COUNT; m++)
+		cs->masks[m] = g_malloc0(words * sizeof(cs->masks[m][0]));
+
+	cs->has_matches = stage->matches != NULL;
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (!match->channel->enabled)
+			continue;
+		idx = match->channel->index;
+		if (!cs->has_enabled) {
+			cs->has_enabled = TRUE;
+			cs->first_is_edge = match->match != SR_TRIGGER_ZERO &&
+				match->match != SR_TRIGGER_ONE;
+		}
+		if (idx >= (size_t)stl->unitsize * 8) {
+			sr_warn("Trigger channel %zu exceeds unit size.", idx);
+			continue;
+		}
+		word = idx / 64;
+		bit = 1ULL << (idx % 64);
+		switch (match->match) {
+		case SR_TRIGGER_ZERO:
+		case SR_TRIGGER_ONE:
+			/* Conflicting level conditions never match. */
+			if (cs->masks[STAGE_MASK_LEVEL][word] & bit) {
+				if (!(cs->masks[STAGE_MASK_VALUE][word] & bit) !=
+						(match->match == SR_TRIGGER_ZERO))
+					cs->never = TRUE;
+			}
+			cs->masks[STAGE_MASK_LEVEL][word] |= bit;
+			if (match->match == SR_TRIGGER_ONE)
+				cs->masks[STAGE_MASK_VALUE][word] |= bit;
+			break;
+		case SR_TRIGGER_RISING:
+			cs->masks[STAGE_MASK_RISE][word] |= bit;
+			break;
+		case SR_TRIGGER_FALLING:
+			cs->masks[STAGE_MASK_FALL][word] |= bit;
+			break;
+		case SR_TRIGGER_EDGE:
+			cs->masks[STAGE_MASK_EDGE][word] |= bit;
+			break;
+		default:
+			/* Analog conditions never match on logic data. */
+			cs->never = TRUE;
+			break;
+		}
+	}
+
+	if (!stage_lanes_usable(stl))
+		return;
+	for (m = 0; m < STAGE_MASK_COUNT; m++) {
+		for (idx = 0; idx < STAGE_LANE_BYTES; idx++) {
+			bit = cs->masks[m][0] >> (8 * (idx % stl->unitsize));
+			cs->lanes[m][idx] = bit & 0xff;
+		}
+	}
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
 {
 	struct soft_trigger_logic *stl;
+	GSList *l;
+	int i;
 
 	stl = g_malloc0(sizeof(struct soft_trigger_logic));
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
 	stl->prev_sample = g_malloc0(stl->unitsize);
+	stl->num_stages = g_slist_length(trigger->stages);
+	stl->stages = g_malloc0(stl->num_stages * sizeof(stl->stages[0]) + 1);
+	for (l = trigger->stages, i = 0; l; l = l->next, i++)
+		stage_compile(stl, &stl->stages[i], l->data);
 	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
 	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
 	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
@@ -75,6 +201,13 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
+	int i, m;
+
+	for (i = 0; i < stl->num_stages; i++) {
+		for (m = 0; m < STAGE_MASK_COUNT; m++)
+			g_free(stl->stages[i].masks[m]);
+	}
+	g_free(stl->stages);
 	g_free(stl->pre_trigger_buffer);
 	g_free(stl->prev_sample);
 	g_free(stl);
@@ -138,36 +271,273 @@ static void pre_trigger_send(struct soft_trigger_logic *stl,
 	}
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+static uint64_t sample_word(const uint8_t *sample, size_t len)
+{
+	uint64_t word;
+	size_t idx;
+
+	if (len >= sizeof(word))
+		return read_u64le(sample);
+	word = 0;
+	for (idx = 0; idx < len; idx++)
+		word |= (uint64_t)sample[idx] << (8 * idx);
+
+	return word;
+}
+
+/*
+ * Returns zero bits for all those positions where the current and the
+ * previous value satisfy the stage's conditions. Works on whole words
+ * as well as on several samples which are packed into lanes.
+ */
+static inline uint64_t stage_word_mismatch(uint64_t cur, uint64_t prev,
+		uint64_t level, uint64_t value,
+		uint64_t rise, uint64_t fall, uint64_t edge)
 {
-	int bit, prev_bit;
-	gboolean result;
+	uint64_t bad;
+
+	bad = (cur ^ value) & level;
+	bad |= (~prev & cur & rise) ^ rise;
+	bad |= (prev & ~cur & fall) ^ fall;
+	bad |= ((prev ^ cur) & edge) ^ edge;
+
+	return bad;
+}
+
+static gboolean stage_match(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs,
+		const uint8_t *sample, const uint8_t *prev)
+{
+	size_t words, word, pos, len;
+	uint64_t bad;
+
+	if (cs->never)
+		return FALSE;
+
+	words = stage_word_count(stl);
+	for (word = 0; word < words; word++) {
+		pos = word * sizeof(uint64_t);
+		len = MIN(sizeof(uint64_t), (size_t)stl->unitsize - pos);
+		bad = stage_word_mismatch(sample_word(&sample[pos], len),
+			sample_word(&prev[pos], len),
+			cs->masks[STAGE_MASK_LEVEL][word],
+			cs->masks[STAGE_MASK_VALUE][word],
+			cs->masks[STAGE_MASK_RISE][word],
+			cs->masks[STAGE_MASK_FALL][word],
+			cs->masks[STAGE_MASK_EDGE][word]);
+		if (bad)
+			return FALSE;
+	}
 
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	return TRUE;
+}
+
+/*
+ * Check a sample against the previously seen sample. Edge conditions
+ * cannot match on the very first check of a trigger's life time (when
+ * the stage's first enabled condition is an edge condition).
+ */
+static gboolean stage_check(struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs, const uint8_t *sample)
+{
+	if (!stl->evaluated && cs->has_enabled) {
+		stl->evaluated = TRUE;
+		if (cs->first_is_edge)
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
 	}
 
-	return result;
+	return stage_match(stl, cs, sample, stl->prev_sample);
+}
+
+/*
+ * Translate a "byte matches" bit mask (one bit per byte, lowest byte
+ * first) into a "sample matches" mask. A sample matches when all of
+ * its bytes match. The result has bits set at each sample's first byte.
+ */
+static inline uint32_t lane_match_bits(uint32_t bytes_ok, int unitsize)
+{
+	switch (unitsize) {
+	case 2:
+		bytes_ok &= bytes_ok >> 1;
+		return bytes_ok & 0x55555555;
+	case 4:
+		bytes_ok &= bytes_ok >> 1;
+		bytes_ok &= bytes_ok >> 2;
+		return bytes_ok & 0x11111111;
+	case 8:
+		bytes_ok &= bytes_ok >> 1;
+		bytes_ok &= bytes_ok >> 2;
+		bytes_ok &= bytes_ok >> 4;
+		return bytes_ok & 0x01010101;
+	default:
+		return bytes_ok;
+	}
+}
+
+#ifdef SOFT_TRIGGER_X86_KERNELS
+__attribute__((target("avx2")))
+static gboolean stage_skip_avx2(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs,
+		const uint8_t *buf, int *pos, int len)
+{
+	__m256i c, p, lv, vv, rv, fv, ev, bad;
+	uint32_t bits;
+	int unitsize;
+
+	unitsize = stl->unitsize;
+	lv = _mm256_loadu_si256((const __m256i *)cs->lanes[STAGE_MASK_LEVEL]);
+	vv = _mm256_loadu_si256((const __m256i *)cs->lanes[STAGE_MASK_VALUE]);
+	rv = _mm256_loadu_si256((const __m256i *)cs->lanes[STAGE_MASK_RISE]);
+	fv = _mm256_loadu_si256((const __m256i *)cs->lanes[STAGE_MASK_FALL]);
+	ev = _mm256_loadu_si256((const __m256i *)cs->lanes[STAGE_MASK_EDGE]);
+	while (*pos + 32 <= len) {
+		c = _mm256_loadu_si256((const __m256i *)&buf[*pos]);
+		p = _mm256_loadu_si256((const __m256i *)&buf[*pos - unitsize]);
+		bad = _mm256_and_si256(_mm256_xor_si256(c, vv), lv);
+		bad = _mm256_or_si256(bad, _mm256_xor_si256(
+			_mm256_and_si256(_mm256_andnot_si256(p, c), rv), rv));
+		bad = _mm256_or_si256(bad, _mm256_xor_si256(
+			_mm256_and_si256(_mm256_andnot_si256(c, p), fv), fv));
+		bad = _mm256_or_si256(bad, _mm256_xor_si256(
+			_mm256_and_si256(_mm256_xor_si256(p, c), ev), ev));
+		bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			bad, _mm256_setzero_si256()));
+		bits = lane_match_bits(bits, unitsize);
+		if (bits) {
+			*pos += sr_lowest_bit(bits);
+			return TRUE;
+		}
+		*pos += 32;
+	}
+
+	return FALSE;
+}
+
+__attribute__((target("sse2")))
+static gboolean stage_skip_sse2(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs,
+		const uint8_t *buf, int *pos, int len)
+{
+	__m128i c, p, lv, vv, rv, fv, ev, bad;
+	uint32_t bits;
+	int unitsize;
+
+	unitsize = stl->unitsize;
+	lv = _mm_loadu_si128((const __m128i *)cs->lanes[STAGE_MASK_LEVEL]);
+	vv = _mm_loadu_si128((const __m128i *)cs->lanes[STAGE_MASK_VALUE]);
+	rv = _mm_loadu_si128((const __m128i *)cs->lanes[STAGE_MASK_RISE]);
+	fv = _mm_loadu_si128((const __m128i *)cs->lanes[STAGE_MASK_FALL]);
+	ev = _mm_loadu_si128((const __m128i *)cs->lanes[STAGE_MASK_EDGE]);
+	while (*pos + 16 <= len) {
+		c = _mm_loadu_si128((const __m128i *)&buf[*pos]);
+		p = _mm_loadu_si128((const __m128i *)&buf[*pos - unitsize]);
+		bad = _mm_and_si128(_mm_xor_si128(c, vv), lv);
+		bad = _mm_or_si128(bad, _mm_xor_si128(
+			_mm_and_si128(_mm_andnot_si128(p, c), rv), rv));
+		bad = _mm_or_si128(bad, _mm_xor_si128(
+			_mm_and_si128(_mm_andnot_si128(c, p), fv), fv));
+		bad = _mm_or_si128(bad, _mm_xor_si128(
+			_mm_and_si128(_mm_xor_si128(p, c), ev), ev));
+		bits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+			bad, _mm_setzero_si128()));
+		bits = lane_match_bits(bits, unitsize);
+		if (bits) {
+			*pos += sr_lowest_bit(bits);
+			return TRUE;
+		}
+		*pos += 16;
+	}
+
+	return FALSE;
+}
+#endif
+
+/*
+ * Skip samples which cannot match the first stage. Returns the byte
+ * offset of the first sample at or after pos which matches, or of the
+ * first sample which was not inspected. Samples are compared against
+ * their predecessor in the buffer, so pos must not be the first sample.
+ */
+static int stage_skip(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_logic_stage *cs,
+		const uint8_t *buf, int pos, int len)
+{
+	const uint8_t *lanes;
+	uint64_t cur, prev, bad, lane_lsb, lane_msb, zero;
+	int unitsize;
+#ifdef SOFT_TRIGGER_X86_KERNELS
+	int features;
+#endif
+
+	unitsize = stl->unitsize;
+	if (cs->never) {
+		while (pos < len)
+			pos += unitsize;
+		return pos;
+	}
+	if (!stage_lanes_usable(stl)) {
+		while (pos + unitsize <= len) {
+			if (stage_match(stl, cs, &buf[pos], &buf[pos - unitsize]))
+				return pos;
+			pos += unitsize;
+		}
+		return pos;
+	}
+
+#ifdef SOFT_TRIGGER_X86_KERNELS
+	features = sr_cpu_features();
+	if (features & SR_CPU_AVX2) {
+		if (stage_skip_avx2(stl, cs, buf, &pos, len))
+			return pos;
+	} else if (features & SR_CPU_SSE2) {
+		if (stage_skip_sse2(stl, cs, buf, &pos, len))
+			return pos;
+	}
+#endif
+
+	/*
+	 * Portable fallback, and the tail of the vector loops above:
+	 * check the samples which are packed into a 64bit word at once.
+	 * Fold each sample's bytes into its first byte, then search for
+	 * the first zero byte at the start of a sample.
+	 */
+	lanes = &cs->lanes[0][0];
+	lane_lsb = 0x0101010101010101ULL;
+	if (unitsize == 2)
+		lane_lsb = 0x0001000100010001ULL;
+	else if (unitsize == 4)
+		lane_lsb = 0x0000000100000001ULL;
+	else if (unitsize == 8)
+		lane_lsb = 0x0000000000000001ULL;
+	lane_msb = lane_lsb << 7;
+	while (pos + (int)sizeof(uint64_t) <= len) {
+		cur = read_u64le(&buf[pos]);
+		prev = read_u64le(&buf[pos - unitsize]);
+		bad = stage_word_mismatch(cur, prev,
+			read_u64le(&lanes[STAGE_MASK_LEVEL * STAGE_LANE_BYTES]),
+			read_u64le(&lanes[STAGE_MASK_VALUE * STAGE_LANE_BYTES]),
+			read_u64le(&lanes[STAGE_MASK_RISE * STAGE_LANE_BYTES]),
+			read_u64le(&lanes[STAGE_MASK_FALL * STAGE_LANE_BYTES]),
+			read_u64le(&lanes[STAGE_MASK_EDGE * STAGE_LANE_BYTES]));
+		if (unitsize >= 2)
+			bad |= bad >> 8;
+		if (unitsize >= 4)
+			bad |= bad >> 16;
+		if (unitsize >= 8)
+			bad |= bad >> 32;
+		zero = (bad & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL;
+		zero = ~(zero | bad | 0x7f7f7f7f7f7f7f7fULL) & lane_msb;
+		if (zero)
+			return pos + sr_lowest_bit(zero) / 8;
+		pos += sizeof(uint64_t);
+	}
+	while (pos + unitsize <= len) {
+		if (stage_match(stl, cs, &buf[pos], &buf[pos - unitsize]))
+			return pos;
+		pos += unitsize;
+	}
+
+	return pos;
 }
 
 /* Returns the offset (in samples) within buf of where the trigger
@@ -175,36 +545,43 @@ static gboolean logic_check_match(struct soft_trigger_logic *stl,
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
+	struct soft_trigger_logic_stage *stage;
 	int offset;
-	int i;
-	gboolean match_found;
+	int i, next;
+	gboolean match_found, in_sequence;
 
 	offset = -1;
+	in_sequence = FALSE;
 	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+		stage = &stl->stages[stl->cur_stage];
+		if (!stage->has_matches)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
-				break;
+		/*
+		 * While waiting for the first stage, skip in bulk over
+		 * samples which don't match. Edge conditions are checked
+		 * against the preceding sample in the same buffer, which
+		 * must have been the most recently checked sample.
+		 */
+		if (stl->cur_stage == 0 && stl->evaluated && in_sequence) {
+			next = stage_skip(stl, stage, buf, i, len);
+			if (next != i) {
+				i = next;
+				memcpy(stl->prev_sample, buf + i - stl->unitsize,
+					stl->unitsize);
+				if (i >= len)
+					break;
 			}
 		}
+
+		/* Disabled channels with a trigger were ignored already. */
+		match_found = stage_check(stl, stage, buf + i);
 		memcpy(stl->prev_sample, buf + i, stl->unitsize);
+		in_sequence = TRUE;
 		if (match_found) {
 			/* Matched on the current stage. */
-			if (l_stage->next) {
+			if (stl->cur_stage + 1 < stl->num_stages) {
 				/* Advance to next stage. */
 				stl->cur_stage++;
 			} else {
@@ -231,6 +608,7 @@ SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 			i -= stl->cur_stage * stl->unitsize;
 			if (i < -1)
 				i = -1; /* Oops, went back past this buffer. */
+			in_sequence = FALSE;
 			/* Reset trigger stage. */
 			stl->cur_stage = 0;
 		}
@@ -0,0 +1,371 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdint.h>
+#include <string.h>
+#include <glib.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPOSE_X86_KERNELS 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+	defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define TRANSPOSE_NEON_KERNELS 1
+#include <arm_neon.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "transpose"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Bit matrix transposition.
+ *
+ * Several devices send sample data in "channel major" layout: a word
+ * holds a run of consecutive samples of one channel, and words for all
+ * enabled channels follow each other. The session feed wants "sample
+ * major" layout, one unit per sample point which holds all channels'
+ * bits. Converting between the two is a transposition of a square bit
+ * matrix, which is done here once for all drivers instead of bit by
+ * bit loops in each of them.
+ *
+ * All routines share the same convention: bit j of input row i ends
+ * up in bit i of output row j. Input and output may be the same array.
+ * Drivers place a channel's word in the row which corresponds to the
+ * channel's bit position in the logic unit. Words which carry their
+ * first sample in the most significant bit get their output rows
+ * picked in reverse order.
+ */
+
+/*
+ * The scalar fallback swaps ever smaller off-diagonal blocks of the
+ * matrix (half size blocks first, single bits last). Each step is a
+ * shift/xor/mask operation on a pair of rows, there are no branches
+ * on the data. The 8x8 case is cheap enough to not need anything else.
+ */
+#define TRANSPOSE_STEP(a, rows, s, m) \
+	do { \
+		size_t k_; \
+		for (k_ = 0; k_ < (rows); k_++) { \
+			if (k_ & (s)) \
+				continue; \
+			t = ((a[k_] >> (s)) ^ a[k_ + (s)]) & (m); \
+			a[k_ + (s)] ^= t; \
+			a[k_] ^= t << (s); \
+		} \
+	} while (0)
+
+/**
+ * Transpose an 8x8 bit matrix.
+ *
+ * Bit j of src[i] ends up in bit i of dst[j]. The source and the
+ * destination may be the same array.
+ *
+ * @param[out] dst 8 output rows.
+ * @param[in] src 8 input rows.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_bits8(uint8_t *dst, const uint8_t *src)
+{
+	uint8_t t;
+
+	if (dst != src)
+		memmove(dst, src, 8 * sizeof(dst[0]));
+	TRANSPOSE_STEP(dst, 8, 4, 0x0f);
+	TRANSPOSE_STEP(dst, 8, 2, 0x33);
+	TRANSPOSE_STEP(dst, 8, 1, 0x55);
+}
+
+static void transpose_bits16_scalar(uint16_t *dst, const uint16_t *src)
+{
+	uint16_t t;
+
+	if (dst != src)
+		memmove(dst, src, 16 * sizeof(dst[0]));
+	TRANSPOSE_STEP(dst, 16, 8, 0x00ff);
+	TRANSPOSE_STEP(dst, 16, 4, 0x0f0f);
+	TRANSPOSE_STEP(dst, 16, 2, 0x3333);
+	TRANSPOSE_STEP(dst, 16, 1, 0x5555);
+}
+
+static void transpose_bits32_scalar(uint32_t *dst, const uint32_t *src)
+{
+	uint32_t t;
+
+	if (dst != src)
+		memmove(dst, src, 32 * sizeof(dst[0]));
+	TRANSPOSE_STEP(dst, 32, 16, 0x0000ffffUL);
+	TRANSPOSE_STEP(dst, 32, 8, 0x00ff00ffUL);
+	TRANSPOSE_STEP(dst, 32, 4, 0x0f0f0f0fUL);
+	TRANSPOSE_STEP(dst, 32, 2, 0x33333333UL);
+	TRANSPOSE_STEP(dst, 32, 1, 0x55555555UL);
+}
+
+#undef TRANSPOSE_STEP
+
+#ifdef TRANSPOSE_X86_KERNELS
+
+/*
+ * The vector kernels gather the same byte of all rows into one
+ * register ("byte plane"), then shift each bit position into the
+ * bytes' MSB in turn and collect them with a movemask instruction.
+ * Which yields one output row (16 or 32 input rows' bits) per step.
+ */
+
+__attribute__((target("sse2")))
+static void transpose_bits16_sse2(uint16_t *dst, const uint16_t *src)
+{
+	__m128i rows_lo, rows_hi, mask, plane_lo, plane_hi;
+
+	rows_lo = _mm_loadu_si128((const __m128i *)&src[0]);
+	rows_hi = _mm_loadu_si128((const __m128i *)&src[8]);
+	mask = _mm_set1_epi16(0x00ff);
+	plane_lo = _mm_packus_epi16(_mm_and_si128(rows_lo, mask),
+		_mm_and_si128(rows_hi, mask));
+	plane_hi = _mm_packus_epi16(_mm_srli_epi16(rows_lo, 8),
+		_mm_srli_epi16(rows_hi, 8));
+
+	/* Shift counts must be immediates for some compilers. */
+#define TRANSPOSE_BIT16(b) \
+	dst[b] = _mm_movemask_epi8(_mm_slli_epi16(plane_lo, 7 - (b))); \
+	dst[8 + b] = _mm_movemask_epi8(_mm_slli_epi16(plane_hi, 7 - (b)))
+	TRANSPOSE_BIT16(0);
+	TRANSPOSE_BIT16(1);
+	TRANSPOSE_BIT16(2);
+	TRANSPOSE_BIT16(3);
+	TRANSPOSE_BIT16(4);
+	TRANSPOSE_BIT16(5);
+	TRANSPOSE_BIT16(6);
+	TRANSPOSE_BIT16(7);
+#undef TRANSPOSE_BIT16
+}
+
+__attribute__((target("sse2")))
+static __m128i transpose_plane_sse2(const __m128i *rows, int byte)
+{
+	__m128i mask, count, p0, p1, p2, p3;
+
+	mask = _mm_set1_epi32(0xff);
+	count = _mm_cvtsi32_si128(8 * byte);
+	p0 = _mm_and_si128(_mm_srl_epi32(rows[0], count), mask);
+	p1 = _mm_and_si128(_mm_srl_epi32(rows[1], count), mask);
+	p2 = _mm_and_si128(_mm_srl_epi32(rows[2], count), mask);
+	p3 = _mm_and_si128(_mm_srl_epi32(rows[3], count), mask);
+
+	return _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+		_mm_packs_epi32(p2, p3));
+}
+
+__attribute__((target("sse2")))
+static void transpose_bits32_sse2(uint32_t *dst, const uint32_t *src)
+{
+	__m128i rows[8], lo, hi;
+	int idx, byte;
+	uint32_t out[32];
+
+	for (idx = 0; idx < 8; idx++)
+		rows[idx] = _mm_loadu_si128((const __m128i *)&src[4 * idx]);
+
+	for (byte = 0; byte < 4; byte++) {
+		lo = transpose_plane_sse2(&rows[0], byte);
+		hi = transpose_plane_sse2(&rows[4], byte);
+#define TRANSPOSE_BIT32(b) \
+	out[8 * byte + (b)] = \
+		(uint32_t)_mm_movemask_epi8(_mm_slli_epi16(lo, 7 - (b))) | \
+		(uint32_t)_mm_movemask_epi8(_mm_slli_epi16(hi, 7 - (b))) << 16
+		TRANSPOSE_BIT32(0);
+		TRANSPOSE_BIT32(1);
+		TRANSPOSE_BIT32(2);
+		TRANSPOSE_BIT32(3);
+		TRANSPOSE_BIT32(4);
+		TRANSPOSE_BIT32(5);
+		TRANSPOSE_BIT32(6);
+		TRANSPOSE_BIT32(7);
+#undef TRANSPOSE_BIT32
+	}
+	memcpy(dst, out, sizeof(out));
+}
+
+/*
+ * The AVX2 variant keeps all 32 rows in four registers. The in-lane
+ * pack instructions interleave groups of four rows, a final dword
+ * permutation restores the row order before bits get collected.
+ */
+__attribute__((target("avx2")))
+static void transpose_bits32_avx2(uint32_t *dst, const uint32_t *src)
+{
+	__m256i rows[4], mask, order, p0, p1, p2, p3, plane;
+	__m128i count;
+	int idx, byte;
+	uint32_t out[32];
+
+	for (idx = 0; idx < 4; idx++)
+		rows[idx] = _mm256_loadu_si256((const __m256i *)&src[8 * idx]);
+	mask = _mm256_set1_epi32(0xff);
+	order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (byte = 0; byte < 4; byte++) {
+		count = _mm_cvtsi32_si128(8 * byte);
+		p0 = _mm256_and_si256(_mm256_srl_epi32(rows[0], count), mask);
+		p1 = _mm256_and_si256(_mm256_srl_epi32(rows[1], count), mask);
+		p2 = _mm256_and_si256(_mm256_srl_epi32(rows[2], count), mask);
+		p3 = _mm256_and_si256(_mm256_srl_epi32(rows[3], count), mask);
+		plane = _mm256_packus_epi16(_mm256_packs_epi32(p0, p1),
+			_mm256_packs_epi32(p2, p3));
+		plane = _mm256_permutevar8x32_epi32(plane, order);
+#define TRANSPOSE_BIT32(b) \
+	out[8 * byte + (b)] = (uint32_t)_mm256_movemask_epi8( \
+		_mm256_slli_epi16(plane, 7 - (b)))
+		TRANSPOSE_BIT32(0);
+		TRANSPOSE_BIT32(1);
+		TRANSPOSE_BIT32(2);
+		TRANSPOSE_BIT32(3);
+		TRANSPOSE_BIT32(4);
+		TRANSPOSE_BIT32(5);
+		TRANSPOSE_BIT32(6);
+		TRANSPOSE_BIT32(7);
+#undef TRANSPOSE_BIT32
+	}
+	memcpy(dst, out, sizeof(out));
+}
+
+#endif
+
+#ifdef TRANSPOSE_NEON_KERNELS
+
+/*
+ * NEON lacks a movemask instruction. Test each bit position across a
+ * byte plane, weigh the resulting all-ones lanes by their row's bit
+ * value, and sum up the eight lanes of each half.
+ */
+static const uint8_t transpose_neon_weights[16] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+};
+
+static inline uint16_t transpose_collect_neon(uint8x16_t plane,
+	uint8x16_t weights, int bit)
+{
+	uint8x16_t set;
+
+	set = vandq_u8(vtstq_u8(plane, vdupq_n_u8(1 << bit)), weights);
+
+	return vaddv_u8(vget_low_u8(set)) |
+		(uint16_t)vaddv_u8(vget_high_u8(set)) << 8;
+}
+
+static void transpose_bits16_neon(uint16_t *dst, const uint16_t *src)
+{
+	uint8x16x2_t planes;
+	uint8x16_t weights;
+	uint16_t out[16];
+	int bit;
+
+	weights = vld1q_u8(transpose_neon_weights);
+	planes = vld2q_u8((const uint8_t *)src);
+	for (bit = 0; bit < 8; bit++) {
+		out[bit] = transpose_collect_neon(planes.val[0], weights, bit);
+		out[8 + bit] = transpose_collect_neon(planes.val[1], weights, bit);
+	}
+	memcpy(dst, out, sizeof(out));
+}
+
+static void transpose_bits32_neon(uint32_t *dst, const uint32_t *src)
+{
+	uint8x16x4_t lo, hi;
+	uint8x16_t weights;
+	uint32_t out[32];
+	int byte, bit;
+
+	weights = vld1q_u8(transpose_neon_weights);
+	lo = vld4q_u8((const uint8_t *)&src[0]);
+	hi = vld4q_u8((const uint8_t *)&src[16]);
+	for (byte = 0; byte < 4; byte++) {
+		for (bit = 0; bit < 8; bit++) {
+			out[8 * byte + bit] =
+				transpose_collect_neon(lo.val[byte], weights, bit) |
+				(uint32_t)transpose_collect_neon(hi.val[byte], weights, bit) << 16;
+		}
+	}
+	memcpy(dst, out, sizeof(out));
+}
+
+#endif
+
+/**
+ * Transpose a 16x16 bit matrix.
+ *
+ * Bit j of src[i] ends up in bit i of dst[j]. The source and the
+ * destination may be the same array.
+ *
+ * @param[out] dst 16 output rows.
+ * @param[in] src 16 input rows.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_bits16(uint16_t *dst, const uint16_t *src)
+{
+#if defined(TRANSPOSE_X86_KERNELS)
+	if (sr_cpu_features() & SR_CPU_SSE2) {
+		transpose_bits16_sse2(dst, src);
+		return;
+	}
+	transpose_bits16_scalar(dst, src);
+#elif defined(TRANSPOSE_NEON_KERNELS)
+	transpose_bits16_neon(dst, src);
+#else
+	transpose_bits16_scalar(dst, src);
+#endif
+}
+
+/**
+ * Transpose a 32x32 bit matrix.
+ *
+ * Bit j of src[i] ends up in bit i of dst[j]. The source and the
+ * destination may be the same array.
+ *
+ * @param[out] dst 32 output rows.
+ * @param[in] src 32 input rows.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_bits32(uint32_t *dst, const uint32_t *src)
+{
+#if defined(TRANSPOSE_X86_KERNELS)
+	int features;
+
+	features = sr_cpu_features();
+	if (features & SR_CPU_AVX2) {
+		transpose_bits32_avx2(dst, src);
+		return;
+	}
+	if (features & SR_CPU_SSE2) {
+		transpose_bits32_sse2(dst, src);
+		return;
+	}
+	transpose_bits32_scalar(dst, src);
+#elif defined(TRANSPOSE_NEON_KERNELS)
+	transpose_bits32_neon(dst, src);
+#else
+	transpose_bits32_scalar(dst, src);
+#endif
+}
@@ -48,6 +48,7 @@ struct usb_source {
 	/* Needed to keep track of installed sources */
 	struct sr_session *session;
 
+	struct sr_context *ctx;
 	struct libusb_context *usb_ctx;
 	GPtrArray *pollfds;
 };
@@ -165,6 +166,8 @@ static void usb_source_finalize(GSource *source)
 	g_ptr_array_unref(usource->pollfds);
 	usource->pollfds = NULL;
 
+	g_atomic_int_add(&usource->ctx->usb_sources, -1);
+
 	sr_session_source_destroyed(usource->session,
 			usource->usb_ctx, source);
 }
@@ -249,7 +252,7 @@ static void usb_source_free_pollfd(void *data)
  * @return A new event source object, or NULL on failure.
  */
 static GSource *usb_source_new(struct sr_session *session,
-		struct libusb_context *usb_ctx, int timeout_ms)
+		struct sr_context *ctx, int timeout_ms)
 {
 	static GSourceFuncs usb_source_funcs = {
 		.prepare  = &usb_source_prepare,
@@ -259,8 +262,10 @@ static GSource *usb_source_new(struct sr_session *session,
 	};
 	GSource *source;
 	struct usb_source *usource;
+	struct libusb_context *usb_ctx;
 	const struct libusb_pollfd **upollfds, **upfd;
 
+	usb_ctx = ctx->libusb_ctx;
 	upollfds = libusb_get_pollfds(usb_ctx);
 	if (!upollfds) {
 		sr_err("Failed to get libusb file descriptors.");
@@ -279,8 +284,10 @@ static GSource *usb_source_new(struct sr_session *session,
 		usource->due_us = INT64_MAX;
 	}
 	usource->session = session;
+	usource->ctx = ctx;
 	usource->usb_ctx = usb_ctx;
 	usource->pollfds = g_ptr_array_new_full(8, &usb_source_free_pollfd);
+	g_atomic_int_inc(&ctx->usb_sources);
 
 	for (upfd = upollfds; *upfd != NULL; upfd++)
 		usb_pollfd_added((*upfd)->fd, (*upfd)->events, usource);
@@ -499,7 +506,14 @@ SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 	GSource *source;
 	int ret;
 
-	source = usb_source_new(session, ctx->libusb_ctx, timeout);
+	/* Events must not get handled by two threads concurrently. */
+	if (ctx->usb_event_thread) {
+		sr_err("USB events are handled by a dedicated thread, "
+			"cannot add an event source.");
+		return SR_ERR_NA;
+	}
+
+	source = usb_source_new(session, ctx, timeout);
 	if (!source)
 		return SR_ERR;
 
@@ -516,6 +530,377 @@ SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
 }
 
+/** Dedicated thread which handles the events of a libusb context. */
+struct usb_event_thread {
+	GThread *thread;
+	struct libusb_context *usb_ctx;
+	int stop;
+	int users;
+};
+
+/** A filled buffer, or a transfer which gets handed back to the driver. */
+struct usb_queue_item {
+	struct libusb_transfer *transfer;
+	uint8_t *data;
+	int length;
+};
+
+/** Queue of completed transfers, filled by the USB event thread. */
+struct usb_queue {
+	struct sr_session *session;
+	GMainContext *main_context;
+	GSource *source;
+	GAsyncQueue *items;
+	GAsyncQueue *spare;
+	size_t buffer_size;
+	int stopping;
+};
+
+/** Event source which drains a USB queue in the session thread. */
+struct usb_queue_source {
+	GSource base;
+
+	/* Needed to keep track of installed sources */
+	struct sr_session *session;
+	void *key;
+
+	struct usb_queue *queue;
+};
+
+/* Upper bound for the event thread's reaction to a stop request. */
+#define USB_EVENT_THREAD_POLL_US	(100 * 1000)
+
+static gpointer usb_event_thread_run(gpointer data)
+{
+	struct usb_event_thread *et;
+	struct timeval tv;
+	int ret;
+
+	et = data;
+
+	while (!g_atomic_int_get(&et->stop)) {
+		tv.tv_sec = 0;
+		tv.tv_usec = USB_EVENT_THREAD_POLL_US;
+		ret = libusb_handle_events_timeout_completed(et->usb_ctx,
+			&tv, &et->stop);
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
+			sr_warn("Failed to handle USB events: %s.",
+				libusb_error_name(ret));
+	}
+
+	return NULL;
+}
+
+/**
+ * Start handling a libusb context's events in a dedicated thread.
+ *
+ * Transfer callbacks of all devices on the context run in that thread
+ * while it exists. Calls nest, the thread keeps running until every
+ * caller has called usb_event_thread_stop().
+ *
+ * The context's events must not get handled elsewhere at the same time.
+ * The thread does not start while usb_source_add() event sources exist,
+ * and usb_source_add() fails while the thread runs. Callers can fall
+ * back to an event source in that case.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The session's main loop handles the context's events.
+ * @retval SR_ERR The thread could not be started.
+ *
+ * @private
+ */
+SR_PRIV int usb_event_thread_start(struct sr_context *ctx)
+{
+	struct usb_event_thread *et;
+	GError *error;
+
+	et = ctx->usb_event_thread;
+	if (et) {
+		et->users++;
+		return SR_OK;
+	}
+	if (g_atomic_int_get(&ctx->usb_sources)) {
+		sr_dbg("USB events are handled by the main loop, "
+			"not starting an event thread.");
+		return SR_ERR_NA;
+	}
+
+	et = g_malloc0(sizeof(*et));
+	et->usb_ctx = ctx->libusb_ctx;
+	et->users = 1;
+
+	error = NULL;
+	et->thread = g_thread_try_new("usb-events",
+		usb_event_thread_run, et, &error);
+	if (!et->thread) {
+		sr_err("Cannot start USB event thread: %s.", error->message);
+		g_error_free(error);
+		g_free(et);
+		return SR_ERR;
+	}
+	ctx->usb_event_thread = et;
+
+	return SR_OK;
+}
+
+/**
+ * Release a reference to the context's USB event thread.
+ *
+ * The last caller terminates and joins the thread.
+ *
+ * @param ctx The libsigrok context.
+ *
+ * @private
+ */
+SR_PRIV void usb_event_thread_stop(struct sr_context *ctx)
+{
+	struct usb_event_thread *et;
+
+	et = ctx->usb_event_thread;
+	if (!et || --et->users > 0)
+		return;
+
+	g_atomic_int_set(&et->stop, 1);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	libusb_interrupt_event_handler(et->usb_ctx);
+#endif
+	g_thread_join(et->thread);
+
+	ctx->usb_event_thread = NULL;
+	g_free(et);
+}
+
+static void usb_queue_item_free(void *data)
+{
+	struct usb_queue_item *item;
+
+	item = data;
+	g_free(item->data);
+	g_slice_free(struct usb_queue_item, item);
+}
+
+static gboolean usb_queue_source_prepare(GSource *source, int *timeout)
+{
+	struct usb_queue_source *qsource;
+
+	qsource = (struct usb_queue_source *)source;
+	*timeout = -1;
+
+	return g_async_queue_length(qsource->queue->items) > 0;
+}
+
+static gboolean usb_queue_source_check(GSource *source)
+{
+	struct usb_queue_source *qsource;
+
+	qsource = (struct usb_queue_source *)source;
+
+	return g_async_queue_length(qsource->queue->items) > 0;
+}
+
+static gboolean usb_queue_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct usb_queue_source *qsource;
+	struct usb_queue *queue;
+	struct usb_queue_item *item;
+	usb_queue_callback cb;
+
+	qsource = (struct usb_queue_source *)source;
+	queue = qsource->queue;
+
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch event.");
+		return G_SOURCE_REMOVE;
+	}
+	cb = (usb_queue_callback)(void (*)(void))callback;
+
+	while ((item = g_async_queue_try_pop(queue->items))) {
+		cb(item->transfer, item->data, item->length, user_data);
+		/* The callback may have released the queue. */
+		if (g_source_is_destroyed(source)) {
+			usb_queue_item_free(item);
+			return G_SOURCE_REMOVE;
+		}
+		if (item->data)
+			g_async_queue_push(queue->spare, item->data);
+		g_slice_free(struct usb_queue_item, item);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void usb_queue_source_finalize(GSource *source)
+{
+	struct usb_queue_source *qsource;
+	struct usb_queue *queue;
+
+	qsource = (struct usb_queue_source *)source;
+	queue = qsource->queue;
+
+	sr_spew("%s", __func__);
+
+	if (queue)
+		queue->source = NULL;
+	sr_session_source_destroyed(qsource->session, qsource->key, source);
+}
+
+/**
+ * Create a queue which passes completed USB transfers from the USB
+ * event thread to the session thread.
+ *
+ * Transfer callbacks running in the event thread hand their transfers
+ * to usb_queue_push(). Filled buffers are swapped with spare buffers
+ * of @a buffer_size bytes, and the transfer gets resubmitted right
+ * away. The session thread receives the data later by means of @a cb,
+ * with a NULL transfer. The buffer returns to the pool when @a cb
+ * returns. Transfers which did not complete successfully, and all
+ * transfers after usb_queue_stop(), are not resubmitted but get passed
+ * to @a cb as is, the driver decides whether to resubmit or free them.
+ *
+ * @param session The session the queue's event source belongs to.
+ * @param buffer_size The size of the drivers' transfer buffers.
+ * @param cb The function to call in the session thread.
+ * @param cb_data Data to pass to @a cb.
+ *
+ * @return A new queue, or NULL on failure.
+ *
+ * @private
+ */
+SR_PRIV struct usb_queue *usb_queue_new(struct sr_session *session,
+		size_t buffer_size, usb_queue_callback cb, void *cb_data)
+{
+	static GSourceFuncs usb_queue_source_funcs = {
+		.prepare  = &usb_queue_source_prepare,
+		.check    = &usb_queue_source_check,
+		.dispatch = &usb_queue_source_dispatch,
+		.finalize = &usb_queue_source_finalize
+	};
+	struct usb_queue *queue;
+	struct usb_queue_source *qsource;
+	GSource *source;
+
+	queue = g_malloc0(sizeof(*queue));
+	queue->session = session;
+	queue->main_context = g_main_context_ref(session->main_context);
+	queue->items = g_async_queue_new_full(&usb_queue_item_free);
+	queue->spare = g_async_queue_new_full(&g_free);
+	queue->buffer_size = buffer_size;
+
+	source = g_source_new(&usb_queue_source_funcs,
+		sizeof(struct usb_queue_source));
+	qsource = (struct usb_queue_source *)source;
+	qsource->session = session;
+	qsource->key = queue;
+	qsource->queue = queue;
+	g_source_set_name(source, "usb-queue");
+	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+
+	queue->source = source;
+	if (sr_session_source_add_internal(session, queue, source) != SR_OK) {
+		g_source_unref(source);
+		usb_queue_free(queue);
+		return NULL;
+	}
+	g_source_unref(source);
+
+	return queue;
+}
+
+/**
+ * Pass a completed transfer to the session thread.
+ *
+ * To be called from transfer callbacks in the USB event thread.
+ *
+ * @param queue The queue.
+ * @param transfer The completed transfer.
+ *
+ * @private
+ */
+SR_PRIV void usb_queue_push(struct usb_queue *queue,
+		struct libusb_transfer *transfer)
+{
+	struct usb_queue_item *item;
+	uint8_t *spare;
+	int ret;
+
+	item = g_slice_new0(struct usb_queue_item);
+	spare = NULL;
+
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED
+			&& transfer->actual_length > 0
+			&& (size_t)transfer->length <= queue->buffer_size
+			&& !g_atomic_int_get(&queue->stopping)) {
+		spare = g_async_queue_try_pop(queue->spare);
+		if (!spare)
+			spare = g_try_malloc(queue->buffer_size);
+	}
+
+	if (spare) {
+		item->data = transfer->buffer;
+		item->length = transfer->actual_length;
+		transfer->buffer = spare;
+		ret = libusb_submit_transfer(transfer);
+		if (ret != LIBUSB_SUCCESS) {
+			sr_err("%s: %s", __func__, libusb_error_name(ret));
+			g_async_queue_push(queue->items, item);
+			/* Let the driver see an empty, failed transfer. */
+			item = g_slice_new0(struct usb_queue_item);
+			transfer->status = LIBUSB_TRANSFER_ERROR;
+			transfer->actual_length = 0;
+			item->transfer = transfer;
+		}
+	} else {
+		item->transfer = transfer;
+	}
+	g_async_queue_push(queue->items, item);
+
+	g_main_context_wakeup(queue->main_context);
+}
+
+/**
+ * Stop resubmitting transfers from the USB event thread.
+ *
+ * Subsequently completing transfers get passed to the driver as is.
+ *
+ * @param queue The queue.
+ *
+ * @private
+ */
+SR_PRIV void usb_queue_stop(struct usb_queue *queue)
+{
+	g_atomic_int_set(&queue->stopping, 1);
+}
+
+/**
+ * Remove a queue's event source and release the queue.
+ *
+ * No transfer of the queue must still be pending. Can be called
+ * from within the queue's callback.
+ *
+ * @param queue The queue.
+ *
+ * @private
+ */
+SR_PRIV void usb_queue_free(struct usb_queue *queue)
+{
+	struct usb_queue_source *qsource;
+
+	qsource = (struct usb_queue_source *)queue->source;
+	if (qsource) {
+		/* Finalization may be deferred while the source dispatches. */
+		qsource->queue = NULL;
+		sr_session_source_remove_internal(queue->session, queue);
+	}
+
+	g_async_queue_unref(queue->items);
+	g_async_queue_unref(queue->spare);
+	g_main_context_unref(queue->main_context);
+	g_free(queue);
+}
+
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 {
 	uint8_t port_numbers[8];
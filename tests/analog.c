@@ -428,6 +428,62 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+/*
+ * Use an odd number of values, such that conversion routines which
+ * process several values at once also run their tail handling.
+ */
+START_TEST(test_analog_to_double_int16)
+{
+	int ret;
+	size_t i;
+	int16_t in[37], iout[37];
+	float fout[37];
+	double dout[37];
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	for (i = 0; i < ARRAY_SIZE(in); i++)
+		in[i] = (i % 2) ? -1000 * (int)i : 1000 * (int)i;
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = ARRAY_SIZE(in);
+	analog.data = &in[0];
+	encoding.unitsize = sizeof(in[0]);
+	encoding.is_float = FALSE;
+	encoding.is_signed = TRUE;
+	encoding.is_bigendian = host_be;
+	encoding.scale.p = 1;
+	encoding.scale.q = 4;
+	encoding.offset.p = 3;
+	encoding.offset.q = 2;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	ret = sr_analog_to_float(&analog, &fout[0]);
+	fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+	ret = sr_analog_to_double(&analog, &dout[0]);
+	fail_unless(ret == SR_OK, "sr_analog_to_double() failed: %d.", ret);
+	ret = sr_analog_to_int16(&analog, &iout[0]);
+	fail_unless(ret == SR_OK, "sr_analog_to_int16() failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(in); i++) {
+		fail_unless(dout[i] == in[i] / 4.0 + 1.5,
+			"%zu: %f != %f", i, dout[i], in[i] / 4.0 + 1.5);
+		fail_unless(fout[i] == (float)dout[i],
+			"%zu: %f != %f", i, fout[i], dout[i]);
+		fail_unless(iout[i] == in[i], "%zu: %d != %d", i, iout[i], in[i]);
+	}
+
+	/* Unsigned 16bit values don't fit into int16_t. */
+	encoding.is_signed = FALSE;
+	ret = sr_analog_to_int16(&analog, &iout[0]);
+	fail_unless(ret == SR_ERR, "sr_analog_to_int16() passed for u16.");
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -697,6 +753,7 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_to_double_int16);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
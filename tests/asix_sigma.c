@@ -0,0 +1,219 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#ifdef HAVE_HW_ASIX_SIGMA
+
+#include "hardware/asix-sigma/protocol.h"
+
+/* Reference: deinterlace one sample from a 100MHz (2x8) item, bit by bit. */
+static uint16_t ref_deinterlace_2x8(uint16_t indata, int idx)
+{
+	uint16_t outdata;
+
+	indata >>= idx;
+	outdata = 0;
+	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
+	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
+	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
+	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
+	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
+	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
+	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
+	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
+
+	return outdata;
+}
+
+/* Reference: deinterlace one sample from a 200MHz (4x4) item, bit by bit. */
+static uint16_t ref_deinterlace_4x4(uint16_t indata, int idx)
+{
+	uint16_t outdata;
+
+	indata >>= idx;
+	outdata = 0;
+	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
+	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
+	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
+	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
+
+	return outdata;
+}
+
+static uint16_t ref_deinterlace(uint16_t indata, size_t samples_per_event,
+	size_t idx)
+{
+	if (samples_per_event == 4)
+		return ref_deinterlace_4x4(indata, idx);
+	if (samples_per_event == 2)
+		return ref_deinterlace_2x8(indata, idx);
+	return indata;
+}
+
+/* 50MHz, 100MHz, and 200MHz modes. */
+static const size_t samples_per_event[] = { 1, 2, 4, };
+
+/* The lookup tables must match the bit formula for every 16bit item. */
+START_TEST(test_deinterlace_all_items)
+{
+	struct sigma_dram_cluster cluster;
+	uint16_t samples[EVENTS_PER_CLUSTER * 4];
+	uint32_t item, first;
+	size_t spe, count, evt, idx;
+	uint16_t expect;
+
+	spe = samples_per_event[_i];
+	sigma_deinterlace_init();
+	for (first = 0; first <= 0xffff; first += EVENTS_PER_CLUSTER) {
+		memset(&cluster, 0, sizeof(cluster));
+		for (evt = 0; evt < EVENTS_PER_CLUSTER; evt++) {
+			item = (first + evt) & 0xffff;
+			write_u16le((uint8_t *)&cluster.samples[evt], item);
+		}
+		count = sigma_deinterlace_cluster(&cluster,
+			EVENTS_PER_CLUSTER, spe, samples);
+		fail_unless(count == EVENTS_PER_CLUSTER * spe,
+			"%zu samples instead of %zu.",
+			count, EVENTS_PER_CLUSTER * spe);
+		for (evt = 0; evt < EVENTS_PER_CLUSTER; evt++) {
+			item = (first + evt) & 0xffff;
+			for (idx = 0; idx < spe; idx++) {
+				expect = ref_deinterlace(item, spe, idx);
+				fail_unless(samples[evt * spe + idx] == expect,
+					"Item 0x%04x, %zu samples per event, "
+					"sample %zu: 0x%04x instead of 0x%04x.",
+					item, spe, idx,
+					samples[evt * spe + idx], expect);
+			}
+		}
+	}
+}
+END_TEST
+
+/*
+ * A stand-in for the USB DRAM read. Slow enough that the download is
+ * far from complete when the test aborts it.
+ */
+static gint reads_started;
+static gint reads_done;
+
+static int fake_read_dram(struct dev_context *devc,
+	size_t line, size_t count, uint8_t *data)
+{
+	struct sigma_dram_line *lines;
+	size_t idx;
+
+	(void)devc;
+
+	g_atomic_int_inc(&reads_started);
+	lines = (struct sigma_dram_line *)data;
+	for (idx = 0; idx < count; idx++) {
+		write_u16le((uint8_t *)&lines[idx].cluster[0].timestamp,
+			(line + idx) % ROW_COUNT);
+	}
+	g_usleep(1000);
+	g_atomic_int_inc(&reads_done);
+
+	return SR_OK;
+}
+
+/* Aborting a download while lines are in flight joins the thread. */
+START_TEST(test_abort_download)
+{
+	struct dev_context *devc;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_buffer *buf;
+	int ret, reads;
+	uint16_t ts;
+
+	devc = g_malloc0(sizeof(*devc));
+	interp = &devc->interp;
+	interp->start.line = ROW_COUNT - 5;
+	interp->fetch.lines_total = ROW_COUNT;
+	interp->fetch.read_dram = fake_read_dram;
+	reads_started = 0;
+	reads_done = 0;
+
+	ret = sigma_fetch_start(devc);
+	fail_unless(ret == SR_OK, "Cannot start the download: %d.", ret);
+	fail_unless(interp->fetch.thread != NULL, "No download thread.");
+
+	/* Consume one buffer, like the decoder does. */
+	buf = g_async_queue_pop(interp->fetch.full_bufs);
+	interp->fetch.curr_buf = buf;
+	fail_unless(buf->status == SR_OK, "Read status %d.", buf->status);
+	fail_unless(buf->count == interp->fetch.lines_per_read,
+		"%zu lines instead of %zu.",
+		buf->count, interp->fetch.lines_per_read);
+	ts = read_u16le((const uint8_t *)&buf->lines[0].cluster[0].timestamp);
+	fail_unless(ts == ROW_COUNT - 5, "Started at line %u.", ts);
+
+	sigma_abort_download(devc);
+	fail_unless(interp->fetch.thread == NULL, "Thread was not joined.");
+	fail_unless(interp->fetch.curr_buf == NULL, "Buffer was kept.");
+	fail_unless(!interp->fetch.free_bufs && !interp->fetch.full_bufs,
+		"Buffer queues were kept.");
+
+	/* No read may be in progress, or start later on. */
+	reads = g_atomic_int_get(&reads_started);
+	fail_unless(reads == g_atomic_int_get(&reads_done),
+		"%d reads started, %d completed.",
+		reads, g_atomic_int_get(&reads_done));
+	g_usleep(20 * 1000);
+	fail_unless(g_atomic_int_get(&reads_started) == reads,
+		"Reads continued after the abort.");
+	fail_unless((size_t)reads * interp->fetch.lines_per_read <
+		interp->fetch.lines_total,
+		"Download completed before the abort.");
+
+	/* Repeated aborts are harmless. */
+	sigma_abort_download(devc);
+	g_free(devc);
+}
+END_TEST
+
+#endif
+
+Suite *suite_asix_sigma(void)
+{
+	Suite *s;
+#ifdef HAVE_HW_ASIX_SIGMA
+	TCase *tc;
+#endif
+
+	s = suite_create("asix-sigma");
+
+#ifdef HAVE_HW_ASIX_SIGMA
+	tc = tcase_create("deinterlace");
+	tcase_add_loop_test(tc, test_deinterlace_all_items,
+		0, ARRAY_SIZE(samples_per_event));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("download");
+	tcase_add_test(tc, test_abort_download);
+	suite_add_tcase(s, tc);
+#endif
+
+	return s;
+}
@@ -0,0 +1,646 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput benchmarks for the acquisition and file I/O paths.
+ *
+ * The demo driver acquires a fixed number of samples, which pass the
+ * session's datafeed (optionally a feed queue, a soft trigger, or a
+ * transform) and either get counted, or get formatted by an output
+ * module. Input modules get timed on files which the output modules
+ * have created before.
+ *
+ * Results go to stdout as tab separated lines, one per benchmark,
+ * after a header line which names the columns. The best of several
+ * runs is reported. Set SIGROK_NO_SIMD in the environment to have the
+ * library use its scalar code paths, and compare both runs' results.
+ *
+ * Each benchmark runs in a child process of its own where the platform
+ * supports it, so that the peak resident set size is the benchmark's
+ * own. Otherwise the peak_rss_kib column reports -1.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_SYS_WAIT_H)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCH_CHILD_PROCESS
+#endif
+#include <libsigrok/libsigrok.h>
+
+#define DEFAULT_SAMPLES		(10 * 1000 * 1000)
+#define DEFAULT_FILE_SAMPLES	(1000 * 1000)
+#define DEFAULT_RUNS		3
+#define INPUT_CHUNK_SIZE	(4 * 1024 * 1024)
+
+/* Which of the demo device's channels take part in an acquisition. */
+enum bench_channels {
+	BENCH_LOGIC,
+	BENCH_ANALOG,
+	BENCH_MIXED,
+};
+
+struct bench_result {
+	uint64_t samples;
+	uint64_t bytes;
+	double seconds;
+};
+
+struct bench_feed {
+	const struct sr_output *output;
+	GString *text;
+	gboolean keep_text;
+	gboolean failed;
+	struct bench_result result;
+};
+
+static struct sr_context *ctx;
+static struct sr_dev_inst *demo_sdi;
+static uint64_t opt_samples = DEFAULT_SAMPLES;
+static uint64_t opt_file_samples = DEFAULT_FILE_SAMPLES;
+static int opt_runs = DEFAULT_RUNS;
+static char *opt_filter;
+static gboolean in_child;
+
+/* Peak resident set size of the benchmark's child process. */
+static long peak_rss_kib(void)
+{
+#ifdef BENCH_CHILD_PROCESS
+	struct rusage usage;
+
+	if (!in_child || getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+static gboolean bench_selected(const char *name)
+{
+	if (!opt_filter)
+		return TRUE;
+
+	return strstr(name, opt_filter) != NULL;
+}
+
+/*
+ * Start a benchmark. Forks a child process which runs the benchmark,
+ * and waits for it to terminate. Returns TRUE in the process which is
+ * to run the benchmark, and to call bench_finish() afterwards.
+ */
+static gboolean bench_start(const char *name)
+{
+#ifdef BENCH_CHILD_PROCESS
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0) {
+		/* Run it in this process, without memory statistics. */
+		return TRUE;
+	}
+	if (pid == 0) {
+		in_child = TRUE;
+		return TRUE;
+	}
+	if (waitpid(pid, &status, 0) != pid ||
+			!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		fprintf(stderr, "%s: benchmark process failed\n", name);
+
+	return FALSE;
+#else
+	(void)name;
+
+	return TRUE;
+#endif
+}
+
+/* Terminate the benchmark's child process. */
+static void bench_finish(void)
+{
+#ifdef BENCH_CHILD_PROCESS
+	if (!in_child)
+		return;
+	fflush(stdout);
+	fflush(stderr);
+	_exit(EXIT_SUCCESS);
+#endif
+}
+
+static void bench_report(const char *name, const struct bench_result *res)
+{
+	double seconds;
+
+	seconds = res->seconds > 0 ? res->seconds : 1e-9;
+	printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%.6f\t%.0f\t%.3f\t%ld\n",
+		name, res->samples, res->bytes, res->seconds,
+		res->samples / seconds, res->bytes / seconds / 1e6,
+		peak_rss_kib());
+	fflush(stdout);
+}
+
+static void bench_report_error(const char *name, const char *reason)
+{
+	fprintf(stderr, "%s: %s\n", name, reason);
+}
+
+/* Keep the fastest of the runs, a benchmark's results must agree. */
+static void bench_best(struct bench_result *best,
+	const struct bench_result *res)
+{
+	if (best->seconds <= 0 || res->seconds < best->seconds)
+		*best = *res;
+}
+
+static void bench_datafeed(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct bench_feed *feed;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	GString *out;
+
+	(void)sdi;
+
+	feed = cb_data;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (logic->unitsize)
+			feed->result.samples += logic->length / logic->unitsize;
+		if (!feed->output)
+			feed->result.bytes += logic->length;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		feed->result.samples += analog->num_samples;
+		if (!feed->output)
+			feed->result.bytes += (uint64_t)analog->num_samples *
+				analog->encoding->unitsize;
+		break;
+	default:
+		break;
+	}
+
+	if (!feed->output || feed->failed)
+		return;
+
+	out = NULL;
+	if (sr_output_send(feed->output, packet, &out) != SR_OK) {
+		feed->failed = TRUE;
+		return;
+	}
+	if (!out)
+		return;
+	feed->result.bytes += out->len;
+	if (feed->keep_text)
+		g_string_append_len(feed->text, out->str, out->len);
+	g_string_free(out, TRUE);
+}
+
+static void demo_channels_setup(enum bench_channels channels)
+{
+	struct sr_channel *ch;
+	GSList *l;
+	gboolean enable;
+
+	for (l = sr_dev_inst_channels_get(demo_sdi); l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			enable = channels != BENCH_ANALOG;
+		else
+			enable = channels != BENCH_LOGIC;
+		sr_dev_channel_enable(ch, enable);
+	}
+}
+
+static struct sr_channel *demo_channel_get(int type)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sr_dev_inst_channels_get(demo_sdi); l; l = l->next) {
+		ch = l->data;
+		if (ch->type == type)
+			return ch;
+	}
+
+	return NULL;
+}
+
+static int demo_init(void)
+{
+	struct sr_dev_driver **drivers, *driver;
+	GSList *devices;
+	int i;
+
+	driver = NULL;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (strcmp(drivers[i]->name, "demo") == 0)
+			driver = drivers[i];
+	}
+	if (!driver) {
+		fprintf(stderr, "The demo driver is not available.\n");
+		return SR_ERR_NA;
+	}
+	if (sr_driver_init(ctx, driver) != SR_OK)
+		return SR_ERR;
+
+	devices = sr_driver_scan(driver, NULL);
+	if (!devices)
+		return SR_ERR;
+	demo_sdi = devices->data;
+	g_slist_free(devices);
+
+	if (sr_dev_open(demo_sdi) != SR_OK)
+		return SR_ERR;
+
+	/* Don't have the demo device pace the samples in real time. */
+	if (sr_config_set(demo_sdi, NULL, SR_CONF_UNTHROTTLED,
+			g_variant_new_boolean(TRUE)) != SR_OK)
+		return SR_ERR;
+
+	return sr_config_set(demo_sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_GHZ(1)));
+}
+
+/*
+ * Run one acquisition of the demo device. The session gets set up by
+ * the caller's options: a feed queue, a soft trigger, a transform,
+ * or an output module which all datafeed packets get passed to.
+ */
+static int demo_run(struct bench_feed *feed, uint64_t samples,
+	const struct sr_transform_module *tmod, gboolean trigger,
+	gboolean feed_queue)
+{
+	struct sr_session *session;
+	struct sr_trigger *trig;
+	struct sr_trigger_stage *stage;
+	const struct sr_transform *t;
+	int64_t start;
+	int ret;
+
+	ret = sr_config_set(demo_sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(samples));
+	if (ret != SR_OK)
+		return ret;
+
+	if (sr_session_new(ctx, &session) != SR_OK)
+		return SR_ERR;
+	sr_session_dev_add(session, demo_sdi);
+	sr_session_datafeed_callback_add(session, bench_datafeed, feed);
+
+	trig = NULL;
+	if (trigger) {
+		trig = sr_trigger_new(NULL);
+		stage = sr_trigger_stage_add(trig);
+		sr_trigger_match_add(stage, demo_channel_get(SR_CHANNEL_LOGIC),
+			SR_TRIGGER_RISING, 0);
+		sr_session_trigger_set(session, trig);
+	}
+	if (feed_queue)
+		sr_session_feed_queue_set(session, 256, SR_FEED_QUEUE_BLOCK);
+	t = NULL;
+	if (tmod && !(t = sr_transform_new(tmod, NULL, demo_sdi))) {
+		sr_session_destroy(session);
+		return SR_ERR;
+	}
+
+	start = g_get_monotonic_time();
+	ret = sr_session_start(session);
+	if (ret == SR_OK)
+		ret = sr_session_run(session);
+	feed->result.seconds = (g_get_monotonic_time() - start) / 1e6;
+
+	sr_session_destroy(session);
+	sr_transform_free(t);
+	sr_trigger_free(trig);
+
+	return ret;
+}
+
+static void bench_session(const char *name, enum bench_channels channels,
+	const struct sr_transform_module *tmod, gboolean trigger,
+	gboolean feed_queue)
+{
+	struct bench_feed feed;
+	struct bench_result best;
+	int run;
+
+	if (!bench_selected(name) || !bench_start(name))
+		return;
+
+	demo_channels_setup(channels);
+	memset(&best, 0, sizeof(best));
+	for (run = 0; run < opt_runs; run++) {
+		memset(&feed, 0, sizeof(feed));
+		if (demo_run(&feed, opt_samples, tmod, trigger, feed_queue) != SR_OK) {
+			bench_report_error(name, "acquisition failed");
+			break;
+		}
+		bench_best(&best, &feed.result);
+	}
+	if (run == opt_runs)
+		bench_report(name, &best);
+	bench_finish();
+}
+
+static void bench_output(const struct sr_output_module *omod)
+{
+	struct bench_feed feed;
+	struct bench_result best;
+	char *name;
+	int run, ret;
+
+	if (sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING))
+		return;
+	name = g_strdup_printf("output/%s", sr_output_id_get(omod));
+	if (!bench_selected(name) || !bench_start(name)) {
+		g_free(name);
+		return;
+	}
+
+	demo_channels_setup(BENCH_MIXED);
+	memset(&best, 0, sizeof(best));
+	for (run = 0; run < opt_runs; run++) {
+		memset(&feed, 0, sizeof(feed));
+		feed.output = sr_output_new(omod, NULL, demo_sdi, NULL);
+		if (!feed.output) {
+			bench_report_error(name, "cannot create output");
+			break;
+		}
+		ret = demo_run(&feed, opt_samples, NULL, FALSE, FALSE);
+		sr_output_free(feed.output);
+		if (ret != SR_OK || feed.failed) {
+			bench_report_error(name, "output failed");
+			break;
+		}
+		bench_best(&best, &feed.result);
+	}
+	if (run == opt_runs)
+		bench_report(name, &best);
+	g_free(name);
+	bench_finish();
+}
+
+/* Have an output module create a file for an input module benchmark. */
+static char *input_file_create(const char *output_id,
+	enum bench_channels channels)
+{
+	const struct sr_output_module *omod;
+	struct bench_feed feed;
+	GError *error;
+	char *filename;
+	int fd, ret;
+
+	omod = sr_output_find((char *)output_id);
+	if (!omod)
+		return NULL;
+
+	demo_channels_setup(channels);
+	memset(&feed, 0, sizeof(feed));
+	feed.output = sr_output_new(omod, NULL, demo_sdi, NULL);
+	if (!feed.output)
+		return NULL;
+	feed.text = g_string_sized_new(16 * 1024 * 1024);
+	feed.keep_text = TRUE;
+	ret = demo_run(&feed, opt_file_samples, NULL, FALSE, FALSE);
+	sr_output_free(feed.output);
+
+	filename = NULL;
+	error = NULL;
+	if (ret == SR_OK && !feed.failed) {
+		fd = g_file_open_tmp("sigrok-bench-XXXXXX", &filename, &error);
+		if (fd >= 0) {
+			g_close(fd, NULL);
+			if (!g_file_set_contents(filename, feed.text->str,
+					feed.text->len, &error)) {
+				g_unlink(filename);
+				g_free(filename);
+				filename = NULL;
+			}
+		}
+	}
+	if (error)
+		g_error_free(error);
+	g_string_free(feed.text, TRUE);
+
+	return filename;
+}
+
+/*
+ * Feed a file to an input module in chunks, the way applications do.
+ * The input's device gets added to the session as soon as the module
+ * has seen enough data to provide it.
+ */
+static int input_run(const struct sr_input_module *imod, const char *filename,
+	struct bench_feed *feed)
+{
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GString *buf;
+	FILE *f;
+	size_t len;
+	int64_t start;
+	int ret;
+
+	if (!(f = g_fopen(filename, "rb")))
+		return SR_ERR_IO;
+	if (!(in = sr_input_new(imod, NULL))) {
+		fclose(f);
+		return SR_ERR;
+	}
+	sr_session_new(ctx, &session);
+	sr_session_datafeed_callback_add(session, bench_datafeed, feed);
+	buf = g_string_sized_new(INPUT_CHUNK_SIZE);
+
+	ret = SR_OK;
+	sdi = NULL;
+	start = g_get_monotonic_time();
+	while (ret == SR_OK) {
+		g_string_set_size(buf, INPUT_CHUNK_SIZE);
+		len = fread(buf->str, 1, INPUT_CHUNK_SIZE, f);
+		if (!len)
+			break;
+		g_string_set_size(buf, len);
+		feed->result.bytes += len;
+		ret = sr_input_send(in, buf);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	if (ret == SR_OK)
+		ret = sr_input_end(in);
+	feed->result.seconds = (g_get_monotonic_time() - start) / 1e6;
+
+	g_string_free(buf, TRUE);
+	sr_input_free(in);
+	sr_session_destroy(session);
+	fclose(f);
+
+	return ret;
+}
+
+static void bench_input(const char *input_id, const char *output_id,
+	enum bench_channels channels)
+{
+	const struct sr_input_module *imod;
+	struct bench_feed feed;
+	struct bench_result best;
+	char *name, *filename;
+	int run;
+
+	name = g_strdup_printf("input/%s", input_id);
+	if (!bench_selected(name) || !bench_start(name)) {
+		g_free(name);
+		return;
+	}
+	imod = sr_input_find(input_id);
+	filename = imod ? input_file_create(output_id, channels) : NULL;
+	if (!filename) {
+		bench_report_error(name, "cannot create input file");
+		g_free(name);
+		bench_finish();
+		return;
+	}
+
+	memset(&best, 0, sizeof(best));
+	for (run = 0; run < opt_runs; run++) {
+		memset(&feed, 0, sizeof(feed));
+		if (input_run(imod, filename, &feed) != SR_OK) {
+			bench_report_error(name, "input failed");
+			break;
+		}
+		bench_best(&best, &feed.result);
+	}
+	if (run == opt_runs)
+		bench_report(name, &best);
+
+	g_unlink(filename);
+	g_free(filename);
+	g_free(name);
+	bench_finish();
+}
+
+static int parse_options(int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error;
+	gint64 samples, file_samples;
+	gboolean ok;
+	const GOptionEntry entries[] = {
+		{ "samples", 'n', 0, G_OPTION_ARG_INT64, &samples,
+			"Number of samples per acquisition", "N" },
+		{ "file-samples", 'f', 0, G_OPTION_ARG_INT64, &file_samples,
+			"Number of samples in input module test files", "N" },
+		{ "runs", 'r', 0, G_OPTION_ARG_INT, &opt_runs,
+			"Number of runs per benchmark, the best is reported", "N" },
+		{ "filter", 'k', 0, G_OPTION_ARG_STRING, &opt_filter,
+			"Only run benchmarks which contain this text", "TEXT" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL },
+	};
+
+	samples = opt_samples;
+	file_samples = opt_file_samples;
+	context = g_option_context_new(NULL);
+	g_option_context_set_summary(context,
+		"Measure the libsigrok datafeed and file I/O throughput.");
+	g_option_context_add_main_entries(context, entries, NULL);
+	error = NULL;
+	ok = g_option_context_parse(context, &argc, &argv, &error);
+	g_option_context_free(context);
+	if (!ok) {
+		fprintf(stderr, "%s\n", error->message);
+		g_error_free(error);
+		return SR_ERR_ARG;
+	}
+	if (samples <= 0 || file_samples <= 0 || opt_runs <= 0) {
+		fprintf(stderr, "Sample counts and runs must be positive.\n");
+		return SR_ERR_ARG;
+	}
+	opt_samples = samples;
+	opt_file_samples = file_samples;
+
+	return SR_OK;
+}
+
+int main(int argc, char **argv)
+{
+	const struct sr_transform_module **transforms;
+	const struct sr_output_module **outputs;
+	char *name;
+	int i;
+
+	if (parse_options(argc, argv) != SR_OK)
+		return EXIT_FAILURE;
+
+	sr_log_loglevel_set(SR_LOG_ERR);
+	if (sr_init(&ctx) != SR_OK)
+		return EXIT_FAILURE;
+	if (demo_init() != SR_OK) {
+		sr_exit(ctx);
+		return EXIT_FAILURE;
+	}
+
+	printf("# libsigrok %s, simd %s\n", sr_package_version_string_get(),
+		g_getenv("SIGROK_NO_SIMD") ? "off" : "on");
+	printf("benchmark\tsamples\tbytes\tseconds\tsamples_per_s\tmb_per_s\tpeak_rss_kib\n");
+
+	bench_session("session/logic", BENCH_LOGIC, NULL, FALSE, FALSE);
+	bench_session("session/analog", BENCH_ANALOG, NULL, FALSE, FALSE);
+	bench_session("session/mixed", BENCH_MIXED, NULL, FALSE, FALSE);
+	bench_session("session/feed_queue", BENCH_MIXED, NULL, FALSE, TRUE);
+	bench_session("trigger/logic", BENCH_LOGIC, NULL, TRUE, FALSE);
+
+	transforms = sr_transform_list();
+	for (i = 0; transforms && transforms[i]; i++) {
+		name = g_strdup_printf("transform/%s",
+			sr_transform_id_get(transforms[i]));
+		bench_session(name, BENCH_MIXED, transforms[i], FALSE, FALSE);
+		g_free(name);
+	}
+
+	outputs = sr_output_list();
+	for (i = 0; outputs && outputs[i]; i++)
+		bench_output(outputs[i]);
+
+	bench_input("binary", "binary", BENCH_LOGIC);
+	bench_input("csv", "csv", BENCH_LOGIC);
+	bench_input("vcd", "vcd", BENCH_LOGIC);
+	bench_input("wav", "wav", BENCH_ANALOG);
+
+	sr_dev_close(demo_sdi);
+	sr_exit(ctx);
+	g_free(opt_filter);
+
+	return EXIT_SUCCESS;
+}
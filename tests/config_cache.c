@@ -0,0 +1,369 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+/*
+ * A stub driver which counts its config_get() calls. The samplerate is
+ * a setting which may get cached, the voltage is a reading which must
+ * always come from the driver.
+ */
+
+/* Long enough to not expire while a test runs, unless it waits. */
+#define LONG_TTL_US (10 * 1000 * 1000)
+#define SHORT_TTL_US (20 * 1000)
+
+#define GETTER_THREADS 4
+#define GETTER_CALLS 2000
+
+static const uint32_t devopts[] = {
+	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_VOLTAGE | SR_CONF_GET,
+};
+
+static const uint32_t uncached_keys[] = {
+	SR_CONF_VOLTAGE,
+};
+
+static gint get_calls;
+static volatile uint64_t samplerate;
+static int stub_priv;
+
+/* Lets a test hold config_get() after the driver read the samplerate. */
+static gboolean hold_get;
+static GMutex hold_mutex;
+static GCond hold_cond;
+static gboolean hold_entered, hold_released;
+
+static int stub_config_get(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	uint64_t rate;
+
+	(void)sdi;
+	(void)cg;
+
+	g_atomic_int_inc(&get_calls);
+	switch (key) {
+	case SR_CONF_SAMPLERATE:
+		rate = samplerate;
+		if (hold_get) {
+			g_mutex_lock(&hold_mutex);
+			hold_entered = TRUE;
+			g_cond_broadcast(&hold_cond);
+			while (!hold_released)
+				g_cond_wait(&hold_cond, &hold_mutex);
+			g_mutex_unlock(&hold_mutex);
+		}
+		*data = g_variant_new_uint64(rate);
+		break;
+	case SR_CONF_VOLTAGE:
+		*data = g_variant_new_double(1.5);
+		break;
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+static int stub_config_set(uint32_t key, GVariant *data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	(void)sdi;
+	(void)cg;
+
+	if (key != SR_CONF_SAMPLERATE)
+		return SR_ERR_NA;
+	samplerate = g_variant_get_uint64(data);
+
+	return SR_OK;
+}
+
+static int stub_config_list(uint32_t key, GVariant **data,
+	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
+{
+	(void)sdi;
+	(void)cg;
+
+	if (key != SR_CONF_DEVICE_OPTIONS)
+		return SR_ERR_NA;
+	*data = std_gvar_array_u32(ARRAY_AND_SIZE(devopts));
+
+	return SR_OK;
+}
+
+static int stub_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static int stub_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver stub_driver = {
+	.name = "config-cache-stub",
+	.longname = "Config cache test stub",
+	.config_get = stub_config_get,
+	.config_set = stub_config_set,
+	.config_list = stub_config_list,
+	.dev_acquisition_start = stub_acquisition_start,
+	.dev_acquisition_stop = stub_acquisition_stop,
+};
+
+static struct sr_dev_inst *stub_device(gint64 ttl_us)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", NULL);
+	sdi->driver = &stub_driver;
+	sdi->priv = &stub_priv;
+	sdi->status = SR_ST_ACTIVE;
+	sr_config_cache_enable(sdi, ttl_us, ARRAY_AND_SIZE(uncached_keys));
+	get_calls = 0;
+	samplerate = SR_MHZ(1);
+
+	return sdi;
+}
+
+/* Get the samplerate, and check which value the caller received. */
+static void get_samplerate(const struct sr_dev_inst *sdi, uint64_t expect)
+{
+	GVariant *data;
+	int ret;
+
+	ret = sr_config_get(&stub_driver, sdi, NULL, SR_CONF_SAMPLERATE, &data);
+	fail_unless(ret == SR_OK, "Cannot get samplerate: %d.", ret);
+	fail_unless(g_variant_get_uint64(data) == expect,
+		"Samplerate %" PRIu64 " instead of %" PRIu64 ".",
+		g_variant_get_uint64(data), expect);
+	g_variant_unref(data);
+}
+
+static void set_samplerate(const struct sr_dev_inst *sdi, uint64_t value)
+{
+	int ret;
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(value));
+	fail_unless(ret == SR_OK, "Cannot set samplerate: %d.", ret);
+}
+
+/* Repeated gets are served from the cache. */
+START_TEST(test_cache_hit)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = stub_device(LONG_TTL_US);
+	get_samplerate(sdi, SR_MHZ(1));
+	get_samplerate(sdi, SR_MHZ(1));
+	get_samplerate(sdi, SR_MHZ(1));
+	fail_unless(get_calls == 1, "%d driver calls instead of 1.", get_calls);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/* Entries older than the lifetime get queried again. */
+START_TEST(test_cache_expiry)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = stub_device(SHORT_TTL_US);
+	get_samplerate(sdi, SR_MHZ(1));
+	g_usleep(2 * SHORT_TTL_US);
+	/* Changed behind the library's back, e.g. on the front panel. */
+	samplerate = SR_MHZ(2);
+	get_samplerate(sdi, SR_MHZ(2));
+	fail_unless(get_calls == 2, "%d driver calls instead of 2.", get_calls);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/* Setting any key drops the cached values. */
+START_TEST(test_cache_config_set)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = stub_device(LONG_TTL_US);
+	get_samplerate(sdi, SR_MHZ(1));
+	set_samplerate(sdi, SR_MHZ(5));
+	get_samplerate(sdi, SR_MHZ(5));
+	get_samplerate(sdi, SR_MHZ(5));
+	fail_unless(get_calls == 2, "%d driver calls instead of 2.", get_calls);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/* Starting an acquisition drops the cached values. */
+START_TEST(test_cache_acquisition_start)
+{
+	struct sr_dev_inst *sdi;
+	int ret;
+
+	sdi = stub_device(LONG_TTL_US);
+	get_samplerate(sdi, SR_MHZ(1));
+	samplerate = SR_MHZ(3);
+	ret = sr_dev_acquisition_start(sdi);
+	fail_unless(ret == SR_OK, "Cannot start acquisition: %d.", ret);
+	get_samplerate(sdi, SR_MHZ(3));
+	fail_unless(get_calls == 2, "%d driver calls instead of 2.", get_calls);
+	sr_dev_acquisition_stop(sdi);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/* Readings never get cached. */
+START_TEST(test_cache_uncached_key)
+{
+	struct sr_dev_inst *sdi;
+	GVariant *data;
+	int i, ret;
+
+	sdi = stub_device(LONG_TTL_US);
+	for (i = 0; i < 3; i++) {
+		ret = sr_config_get(&stub_driver, sdi, NULL, SR_CONF_VOLTAGE,
+			&data);
+		fail_unless(ret == SR_OK, "Cannot get voltage: %d.", ret);
+		g_variant_unref(data);
+	}
+	fail_unless(get_calls == 3, "%d driver calls instead of 3.", get_calls);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+static gpointer held_getter_func(gpointer data)
+{
+	GVariant *value;
+	uint64_t rate;
+
+	if (sr_config_get(&stub_driver, data, NULL, SR_CONF_SAMPLERATE,
+			&value) != SR_OK)
+		return NULL;
+	rate = g_variant_get_uint64(value);
+	g_variant_unref(value);
+
+	return GSIZE_TO_POINTER(rate);
+}
+
+/*
+ * A set which completes while a get is in the driver invalidates the
+ * cache. The value which that get read before is not stored.
+ */
+START_TEST(test_cache_set_during_get)
+{
+	struct sr_dev_inst *sdi;
+	GThread *thread;
+	gsize rate;
+
+	sdi = stub_device(LONG_TTL_US);
+	hold_entered = hold_released = FALSE;
+	hold_get = TRUE;
+	thread = g_thread_new("getter", held_getter_func, sdi);
+	g_mutex_lock(&hold_mutex);
+	while (!hold_entered)
+		g_cond_wait(&hold_cond, &hold_mutex);
+	g_mutex_unlock(&hold_mutex);
+
+	set_samplerate(sdi, SR_MHZ(7));
+
+	g_mutex_lock(&hold_mutex);
+	hold_released = TRUE;
+	g_cond_broadcast(&hold_cond);
+	g_mutex_unlock(&hold_mutex);
+	rate = GPOINTER_TO_SIZE(g_thread_join(thread));
+	hold_get = FALSE;
+	fail_unless(rate == SR_MHZ(1), "Held get returned %zu.", (size_t)rate);
+
+	get_samplerate(sdi, SR_MHZ(7));
+	fail_unless(get_calls == 2, "%d driver calls instead of 2.", get_calls);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+static gpointer getter_func(gpointer data)
+{
+	const struct sr_dev_inst *sdi;
+	GVariant *value;
+	uint64_t rate;
+	int i;
+
+	sdi = data;
+	for (i = 0; i < GETTER_CALLS; i++) {
+		if (sr_config_get(&stub_driver, sdi, NULL, SR_CONF_SAMPLERATE,
+				&value) != SR_OK)
+			return GINT_TO_POINTER(FALSE);
+		rate = g_variant_get_uint64(value);
+		g_variant_unref(value);
+		if (rate < SR_MHZ(1) || rate > SR_MHZ(1) + GETTER_CALLS)
+			return GINT_TO_POINTER(FALSE);
+	}
+
+	return GINT_TO_POINTER(TRUE);
+}
+
+/* Gets from several threads, while another one keeps setting. */
+START_TEST(test_cache_threads)
+{
+	struct sr_dev_inst *sdi;
+	GThread *threads[GETTER_THREADS];
+	size_t i;
+
+	sdi = stub_device(SHORT_TTL_US);
+	for (i = 0; i < GETTER_THREADS; i++)
+		threads[i] = g_thread_new("getter", getter_func, sdi);
+	for (i = 1; i <= GETTER_CALLS; i++)
+		set_samplerate(sdi, SR_MHZ(1) + i);
+	for (i = 0; i < GETTER_THREADS; i++) {
+		fail_unless(GPOINTER_TO_INT(g_thread_join(threads[i])),
+			"Getter thread %zu got a bad value.", i);
+	}
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+Suite *suite_config_cache(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("config-cache");
+
+	tc = tcase_create("cache");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_cache_hit);
+	tcase_add_test(tc, test_cache_expiry);
+	tcase_add_test(tc, test_cache_config_set);
+	tcase_add_test(tc, test_cache_acquisition_start);
+	tcase_add_test(tc, test_cache_uncached_key);
+	tcase_add_test(tc, test_cache_set_during_get);
+	tcase_add_test(tc, test_cache_threads);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,793 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+/* Pattern block size of sr_logic_fill(), see src/session.c. */
+#define LOGIC_FILL_BLOCK 4096
+/* Guard bytes behind the fill area, must remain untouched. */
+#define GUARD_SIZE 16
+#define GUARD_BYTE 0xee
+
+static const struct {
+	size_t unitsize;
+	uint64_t count;
+} fill_cases[] = {
+	{ 1, 0, },
+	{ 1, 1, },
+	{ 1, LOGIC_FILL_BLOCK + 1, },
+	{ 3, 1, },
+	{ 3, 2, },
+	{ 3, 3, },
+	{ 3, LOGIC_FILL_BLOCK / 3 - 1, },
+	{ 3, LOGIC_FILL_BLOCK / 3, },
+	{ 3, LOGIC_FILL_BLOCK / 3 + 1, },
+	{ 3, 3 * LOGIC_FILL_BLOCK + 7, },
+	{ 8, 1, },
+	{ 8, LOGIC_FILL_BLOCK / 8, },
+	{ 8, LOGIC_FILL_BLOCK / 8 + 1, },
+	{ 8, 5 * LOGIC_FILL_BLOCK / 8 - 1, },
+	{ 5000, 3, },
+};
+
+/* Queue layouts, the sample count is the queue's capacity. */
+static const struct {
+	size_t unitsize;
+	size_t sample_count;
+	gboolean rle;
+} queue_cases[] = {
+	{ 1, 64, FALSE, },
+	{ 1, 64, TRUE, },
+	{ 3, 17, FALSE, },
+	{ 3, 17, TRUE, },
+	{ 8, 5, FALSE, },
+	{ 8, 5, TRUE, },
+	{ 3, 0, FALSE, },
+	{ 3, 0, TRUE, },
+};
+
+/* Run lengths, in multiples of the queue's capacity plus an offset. */
+static const struct {
+	size_t capacities;
+	int offset;
+} run_lengths[] = {
+	{ 0, 1, },
+	{ 0, 0, },
+	{ 1, -1, },
+	{ 0, 2, },
+	{ 1, 1, },
+	{ 0, 7, },
+	{ 3, 0, },
+	{ 0, 1, },
+	{ 2, 1, },
+};
+
+static GByteArray *received;
+static GByteArray *received_legacy;
+static size_t packets_rle, packets_logic;
+static size_t max_runs, max_length;
+
+static uint8_t value_byte(size_t run, size_t idx)
+{
+	uint32_t x;
+
+	/* Every fourth run repeats the previous run's value. */
+	if (run % 4 == 3)
+		run--;
+	x = run * 0x9e3779b1UL + idx * 0x85ebca6bUL;
+	x ^= x >> 15;
+
+	return x;
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+static void append_rle(GByteArray *out,
+	const struct sr_datafeed_logic_rle *rle)
+{
+	const uint8_t *value;
+	uint64_t run, n;
+
+	for (run = 0; run < rle->num_runs; run++) {
+		value = (const uint8_t *)rle->values + run * rle->unitsize;
+		for (n = 0; n < rle->lengths[run]; n++)
+			g_byte_array_append(out, value, rle->unitsize);
+	}
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+
+	(void)sdi;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (cb_data) {
+			g_byte_array_append(received_legacy,
+				logic->data, logic->length);
+			break;
+		}
+		packets_logic++;
+		max_length = MAX(max_length, logic->length);
+		g_byte_array_append(received, logic->data, logic->length);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		fail_unless(cb_data == NULL, "RLE data for legacy callback.");
+		packets_rle++;
+		max_runs = MAX(max_runs, rle->num_runs);
+		append_rle(received, rle);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Check sr_logic_fill() against a sample by sample copy. */
+START_TEST(test_logic_fill)
+{
+	size_t unitsize, size, i;
+	uint64_t count;
+	uint8_t value[5000];
+	uint8_t *buf, *expect;
+
+	unitsize = fill_cases[_i].unitsize;
+	count = fill_cases[_i].count;
+	for (i = 0; i < unitsize; i++)
+		value[i] = value_byte(_i, i);
+
+	size = unitsize * count;
+	buf = g_malloc(size + GUARD_SIZE);
+	expect = g_malloc(size + GUARD_SIZE);
+	memset(buf, GUARD_BYTE, size + GUARD_SIZE);
+	memset(expect, GUARD_BYTE, size + GUARD_SIZE);
+	for (i = 0; i < count; i++)
+		memcpy(&expect[i * unitsize], value, unitsize);
+
+	sr_logic_fill(buf, value, unitsize, count);
+	for (i = 0; i < size + GUARD_SIZE; i++) {
+		if (buf[i] != expect[i])
+			fail("Unit size %zu, count %" PRIu64 ": byte %zu differs.",
+				unitsize, count, i);
+	}
+
+	g_free(buf);
+	g_free(expect);
+}
+END_TEST
+
+/*
+ * Submit runs which cross the queue's buffer end in various ways, and
+ * check that the session feed receives the expanded sample data, in
+ * packets of the queue's capacity.
+ */
+START_TEST(test_submit_runs)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct feed_queue_logic *q;
+	GByteArray *expect;
+	size_t unitsize, capacity, run, idx, i;
+	size_t counts[2 * G_N_ELEMENTS(run_lengths)];
+	uint8_t values[2 * G_N_ELEMENTS(run_lengths) * 8];
+	uint32_t flags;
+	int ret;
+
+	unitsize = queue_cases[_i].unitsize;
+	received = g_byte_array_new();
+	received_legacy = g_byte_array_new();
+	expect = g_byte_array_new();
+	packets_rle = packets_logic = 0;
+	max_runs = max_length = 0;
+
+	sr_session_new(srtest_ctx, &session);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_session_dev_add(session, sdi);
+	flags = queue_cases[_i].rle ? SR_DATAFEED_LOGIC_RLE : 0;
+	sr_session_datafeed_callback_add_full(session, datafeed_in, NULL, flags);
+	/* RLE packets get expanded for callbacks which don't accept them. */
+	if (queue_cases[_i].rle)
+		sr_session_datafeed_callback_add(session, datafeed_in, sdi);
+
+	q = feed_queue_logic_alloc(sdi, queue_cases[_i].sample_count, unitsize);
+	fail_unless(q != NULL);
+	capacity = queue_cases[_i].sample_count;
+	if (!capacity)
+		capacity = 1000;
+
+	for (run = 0; run < G_N_ELEMENTS(counts); run++) {
+		idx = run % G_N_ELEMENTS(run_lengths);
+		counts[run] = run_lengths[idx].capacities * capacity +
+			run_lengths[idx].offset;
+		for (i = 0; i < unitsize; i++)
+			values[run * unitsize + i] = value_byte(run, i);
+		for (idx = 0; idx < counts[run]; idx++)
+			g_byte_array_append(expect, &values[run * unitsize], unitsize);
+	}
+
+	/* Submit in two calls, the second one continues a partial buffer. */
+	ret = feed_queue_logic_submit_runs(q, values, counts, 3);
+	fail_unless(ret == SR_OK);
+	ret = feed_queue_logic_submit_runs(q, &values[3 * unitsize],
+		&counts[3], G_N_ELEMENTS(counts) - 3);
+	fail_unless(ret == SR_OK);
+	ret = feed_queue_logic_flush(q);
+	fail_unless(ret == SR_OK);
+	feed_queue_logic_free(q);
+
+	fail_unless(received->len == expect->len, "Case %d: %u bytes "
+		"instead of %u.", _i, received->len, expect->len);
+	fail_unless(memcmp(received->data, expect->data, expect->len) == 0,
+		"Case %d: sample data differs.", _i);
+	if (queue_cases[_i].rle) {
+		fail_unless(packets_rle && !packets_logic);
+		fail_unless(received_legacy->len == expect->len);
+		fail_unless(memcmp(received_legacy->data, expect->data,
+			expect->len) == 0, "Case %d: expanded data differs.", _i);
+		if (queue_cases[_i].sample_count)
+			fail_unless(max_runs <= capacity);
+	} else {
+		fail_unless(packets_logic && !packets_rle);
+		if (queue_cases[_i].sample_count)
+			fail_unless(max_length == capacity * unitsize);
+	}
+
+	sr_session_destroy(session);
+	sr_dev_inst_free(sdi);
+	g_byte_array_free(received, TRUE);
+	g_byte_array_free(received_legacy, TRUE);
+	g_byte_array_free(expect, TRUE);
+}
+END_TEST
+
+/*
+ * Check that the queue starts sending RLE packets when a callback which
+ * accepts them shows up after the queue was allocated.
+ */
+START_TEST(test_submit_runs_late_rle)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct feed_queue_logic *q;
+	const uint8_t value = 0x5a;
+	const size_t count = 1000;
+	size_t i;
+
+	received = g_byte_array_new();
+	packets_rle = packets_logic = 0;
+
+	sr_session_new(srtest_ctx, &session);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_session_dev_add(session, sdi);
+	q = feed_queue_logic_alloc(sdi, 16, 1);
+	fail_unless(q != NULL);
+
+	sr_session_datafeed_callback_add_full(session, datafeed_in, NULL,
+		SR_DATAFEED_LOGIC_RLE);
+	fail_unless(feed_queue_logic_submit_runs(q, &value, &count, 1) == SR_OK);
+	fail_unless(feed_queue_logic_flush(q) == SR_OK);
+	feed_queue_logic_free(q);
+
+	fail_unless(packets_rle == 1 && !packets_logic);
+	fail_unless(received->len == count);
+	for (i = 0; i < count; i++)
+		fail_unless(received->data[i] == value);
+
+	sr_session_destroy(session);
+	sr_dev_inst_free(sdi);
+	g_byte_array_free(received, TRUE);
+}
+END_TEST
+
+/*
+ * Session feed queue tests. Stub devices start producer threads which
+ * send packets while the session's main loop runs. A timer keeps the
+ * session running until all producers are done.
+ */
+#define MAX_PRODUCERS 2
+/* Feed queue depth for the order and the drop tests. */
+#define QUEUE_DEPTH 8
+/* Logic packets per producer in the merge test, fit in the queue. */
+#define MERGE_PACKETS 150
+#define MERGE_DEPTH 256
+
+struct delivery {
+	size_t dev;
+	int type;
+	uint64_t length;
+	uint8_t first;
+};
+
+static struct sr_dev_inst *producer_sdis[MAX_PRODUCERS];
+static GThread *producer_threads[MAX_PRODUCERS];
+static size_t producer_count;
+static gint producers_done;
+static GThreadFunc producer_func;
+static GArray *deliveries;
+
+/* Lets the drop test hold the consumer thread in its callback. */
+static gboolean hold_first_packet;
+static GMutex gate_mutex;
+static GCond gate_cond;
+static gboolean gate_entered, gate_open;
+
+static const uint64_t merge_samplerates[MAX_PRODUCERS] = {
+	SR_MHZ(1), SR_KHZ(400),
+};
+
+static int stub_dev_open(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static int stub_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	size_t idx;
+
+	for (idx = 0; producer_sdis[idx] != sdi; idx++)
+		;
+	producer_threads[idx] = g_thread_new("producer", producer_func,
+		GSIZE_TO_POINTER(idx));
+
+	return SR_OK;
+}
+
+static int stub_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver stub_driver = {
+	.name = "feed-queue-stub",
+	.longname = "Feed queue test stub",
+	.dev_open = stub_dev_open,
+	.dev_acquisition_start = stub_acquisition_start,
+	.dev_acquisition_stop = stub_acquisition_stop,
+};
+
+static void send_logic(size_t idx, uint64_t length, uint8_t value)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[64];
+	int ret;
+
+	memset(data, value, length);
+	logic.length = length;
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	ret = sr_session_send(producer_sdis[idx], &packet);
+	fail_unless(ret == SR_OK, "Cannot send packet: %d.", ret);
+}
+
+static void send_end(size_t idx)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	sr_session_send(producer_sdis[idx], &packet);
+	g_atomic_int_inc(&producers_done);
+}
+
+static void record_delivery(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	struct delivery d;
+
+	(void)cb_data;
+
+	memset(&d, 0, sizeof(d));
+	for (d.dev = 0; producer_sdis[d.dev] != sdi; d.dev++)
+		;
+	d.type = packet->type;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		d.length = logic->length;
+		d.first = *(const uint8_t *)logic->data;
+	}
+	g_array_append_val(deliveries, d);
+
+	/* The drop test has the first packet wait for the gate. */
+	if (hold_first_packet && deliveries->len == 1) {
+		g_mutex_lock(&gate_mutex);
+		gate_entered = TRUE;
+		g_cond_broadcast(&gate_cond);
+		while (!gate_open)
+			g_cond_wait(&gate_cond, &gate_mutex);
+		g_mutex_unlock(&gate_mutex);
+	}
+}
+
+static int producers_check(int fd, int revents, void *cb_data)
+{
+	size_t idx;
+
+	(void)fd;
+	(void)revents;
+	(void)cb_data;
+
+	if ((size_t)g_atomic_int_get(&producers_done) < producer_count)
+		return G_SOURCE_CONTINUE;
+	for (idx = 0; idx < producer_count; idx++)
+		g_thread_join(producer_threads[idx]);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Run a session with the given number of stub devices, and collect
+ * the packets which its datafeed callback receives.
+ */
+static void run_session(size_t count, size_t depth, int policy,
+	gboolean merge, GThreadFunc func, size_t *high_water, uint64_t *dropped,
+	uint64_t *unordered)
+{
+	struct sr_session *session;
+	size_t idx;
+	int ret;
+
+	deliveries = g_array_new(FALSE, FALSE, sizeof(struct delivery));
+	producer_count = count;
+	producer_func = func;
+	g_atomic_int_set(&producers_done, 0);
+	gate_entered = gate_open = FALSE;
+
+	sr_session_new(srtest_ctx, &session);
+	for (idx = 0; idx < count; idx++) {
+		producer_sdis[idx] = sr_dev_inst_user_new("Vendor", "Model", NULL);
+		sr_dev_inst_channel_add(producer_sdis[idx], 0,
+			SR_CHANNEL_LOGIC, "D0");
+		producer_sdis[idx]->driver = &stub_driver;
+		producer_sdis[idx]->status = SR_ST_ACTIVE;
+		sr_session_dev_add(session, producer_sdis[idx]);
+	}
+	sr_session_datafeed_callback_add(session, record_delivery, NULL);
+	fail_unless(sr_session_feed_queue_set(session, depth, policy) == SR_OK);
+	fail_unless(sr_session_feed_queue_merge_set(session, merge) == SR_OK);
+
+	ret = sr_session_start(session);
+	fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+	ret = sr_session_source_add(session, -1, 0, 10, producers_check, NULL);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_run(session);
+	fail_unless(ret == SR_OK);
+
+	sr_session_feed_queue_stats_get(session, high_water, dropped, unordered);
+	sr_session_destroy(session);
+	for (idx = 0; idx < count; idx++) {
+		sr_dev_inst_free(producer_sdis[idx]);
+		producer_sdis[idx] = NULL;
+	}
+}
+
+static uint64_t order_length(size_t seq)
+{
+	return 1 + seq % 7;
+}
+
+static gpointer produce_order(gpointer data)
+{
+	size_t seq;
+
+	for (seq = 0; seq < 2000; seq++)
+		send_logic(GPOINTER_TO_SIZE(data), order_length(seq), seq);
+	send_end(GPOINTER_TO_SIZE(data));
+
+	return NULL;
+}
+
+/*
+ * Have the consumer wait in the callback while the producer sends more
+ * packets than the queue holds. The queue is empty at that time, the
+ * first QUEUE_DEPTH packets fit, the rest gets dropped.
+ */
+static gpointer produce_drop(gpointer data)
+{
+	size_t idx, seq;
+
+	idx = GPOINTER_TO_SIZE(data);
+	send_logic(idx, 1, 0);
+	g_mutex_lock(&gate_mutex);
+	while (!gate_entered)
+		g_cond_wait(&gate_cond, &gate_mutex);
+	g_mutex_unlock(&gate_mutex);
+
+	for (seq = 1; seq <= 3 * QUEUE_DEPTH; seq++)
+		send_logic(idx, 1, seq);
+
+	g_mutex_lock(&gate_mutex);
+	gate_open = TRUE;
+	g_cond_broadcast(&gate_cond);
+	g_mutex_unlock(&gate_mutex);
+	send_end(idx);
+
+	return NULL;
+}
+
+static uint64_t merge_length(uint32_t *state)
+{
+	return 1 + next_random(state) % 64;
+}
+
+static gpointer produce_merge(gpointer data)
+{
+	size_t idx, seq;
+	uint32_t state;
+
+	idx = GPOINTER_TO_SIZE(data);
+	state = 0xfeed + idx;
+	sr_session_send_meta(producer_sdis[idx], SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(merge_samplerates[idx]));
+	for (seq = 0; seq < MERGE_PACKETS; seq++) {
+		send_logic(idx, merge_length(&state), seq);
+		/* Vary which producer gets ahead. */
+		if (next_random(&state) % 16 == 0)
+			g_usleep(100);
+	}
+	send_end(idx);
+
+	return NULL;
+}
+
+/* A single producer's packets arrive complete, and in order. */
+START_TEST(test_session_queue_order)
+{
+	const struct delivery *d;
+	size_t high_water, seq;
+	uint64_t dropped;
+
+	run_session(1, QUEUE_DEPTH, SR_FEED_QUEUE_BLOCK, FALSE,
+		produce_order, &high_water, &dropped, NULL);
+
+	fail_unless(deliveries->len == 2000 + 1,
+		"%u packets instead of 2001.", deliveries->len);
+	for (seq = 0; seq < 2000; seq++) {
+		d = &g_array_index(deliveries, struct delivery, seq);
+		fail_unless(d->type == SR_DF_LOGIC &&
+			d->length == order_length(seq) && d->first == (uint8_t)seq,
+			"Packet %zu out of order.", seq);
+	}
+	d = &g_array_index(deliveries, struct delivery, seq);
+	fail_unless(d->type == SR_DF_END);
+	fail_unless(dropped == 0, "%" PRIu64 " packets dropped.", dropped);
+	fail_unless(high_water > 0 && high_water <= QUEUE_DEPTH,
+		"High water mark %zu.", high_water);
+
+	g_array_free(deliveries, TRUE);
+}
+END_TEST
+
+/* The drop policy discards data packets of a full queue, and counts them. */
+START_TEST(test_session_queue_drop)
+{
+	const struct delivery *d;
+	size_t high_water, seq;
+	uint64_t dropped;
+
+	hold_first_packet = TRUE;
+	run_session(1, QUEUE_DEPTH, SR_FEED_QUEUE_DROP, FALSE,
+		produce_drop, &high_water, &dropped, NULL);
+	hold_first_packet = FALSE;
+
+	fail_unless(dropped == 2 * QUEUE_DEPTH,
+		"%" PRIu64 " packets dropped instead of %d.",
+		dropped, 2 * QUEUE_DEPTH);
+	fail_unless(high_water == QUEUE_DEPTH,
+		"High water mark %zu instead of %d.", high_water, QUEUE_DEPTH);
+	fail_unless(deliveries->len == 1 + QUEUE_DEPTH + 1,
+		"%u packets delivered.", deliveries->len);
+	for (seq = 0; seq <= QUEUE_DEPTH; seq++) {
+		d = &g_array_index(deliveries, struct delivery, seq);
+		fail_unless(d->type == SR_DF_LOGIC && d->first == seq,
+			"Packet %zu is not the one which was sent.", seq);
+	}
+	d = &g_array_index(deliveries, struct delivery, seq);
+	fail_unless(d->type == SR_DF_END, "End of stream got dropped.");
+
+	g_array_free(deliveries, TRUE);
+}
+END_TEST
+
+/*
+ * Merged delivery of two producer threads. As long as no queue fills
+ * up, the packets arrive in the order of their start time (the sample
+ * count at the device's samplerate), ties in the order of the devices.
+ * Compare against a merge of the two known packet sequences.
+ */
+START_TEST(test_session_queue_merge)
+{
+	const struct delivery *d;
+	struct delivery want;
+	uint64_t lengths[MAX_PRODUCERS][MERGE_PACKETS];
+	uint64_t samples[MAX_PRODUCERS];
+	size_t pos[MAX_PRODUCERS];
+	size_t idx, seq, dev;
+	uint32_t state;
+	double t, best_time, position;
+	size_t high_water;
+	uint64_t dropped, unordered;
+
+	for (idx = 0; idx < MAX_PRODUCERS; idx++) {
+		state = 0xfeed + idx;
+		for (seq = 0; seq < MERGE_PACKETS; seq++) {
+			lengths[idx][seq] = merge_length(&state);
+			next_random(&state);
+		}
+	}
+
+	run_session(MAX_PRODUCERS, MERGE_DEPTH, SR_FEED_QUEUE_BLOCK, TRUE,
+		produce_merge, &high_water, &dropped, &unordered);
+	fail_unless(deliveries->len == MAX_PRODUCERS * (MERGE_PACKETS + 2),
+		"%u packets delivered.", deliveries->len);
+
+	/*
+	 * Each stream: meta (due at the current position), the logic
+	 * packets, the end (at the stream's last sample).
+	 */
+	memset(samples, 0, sizeof(samples));
+	memset(pos, 0, sizeof(pos));
+	position = 0.0;
+	for (seq = 0; seq < deliveries->len; seq++) {
+		dev = MAX_PRODUCERS;
+		best_time = 0.0;
+		for (idx = 0; idx < MAX_PRODUCERS; idx++) {
+			if (pos[idx] > MERGE_PACKETS + 1)
+				continue;
+			if (pos[idx] == 0)
+				t = position;
+			else
+				t = (double)samples[idx] / merge_samplerates[idx];
+			if (dev == MAX_PRODUCERS || t < best_time) {
+				dev = idx;
+				best_time = t;
+			}
+		}
+		if (best_time > position)
+			position = best_time;
+
+		memset(&want, 0, sizeof(want));
+		want.dev = dev;
+		if (pos[dev] == 0) {
+			want.type = SR_DF_META;
+		} else if (pos[dev] <= MERGE_PACKETS) {
+			want.type = SR_DF_LOGIC;
+			want.length = lengths[dev][pos[dev] - 1];
+			want.first = pos[dev] - 1;
+			samples[dev] += want.length;
+		} else {
+			want.type = SR_DF_END;
+		}
+		pos[dev]++;
+
+		d = &g_array_index(deliveries, struct delivery, seq);
+		fail_unless(d->dev == want.dev && d->type == want.type &&
+			d->length == want.length && d->first == want.first,
+			"Packet %zu: device %zu type %d instead of device %zu "
+			"type %d.", seq, d->dev, d->type, want.dev, want.type);
+	}
+	fail_unless(dropped == 0);
+	fail_unless(unordered == 0, "%" PRIu64 " packets unordered.",
+		unordered);
+
+	g_array_free(deliveries, TRUE);
+}
+END_TEST
+
+/*
+ * The first device fills its queue before the second one sends. The
+ * merge cannot wait for the second device, and counts the packets it
+ * delivers regardless. Callbacks cannot change while the queue runs.
+ */
+static gpointer produce_unordered(gpointer data)
+{
+	struct sr_session *session;
+	size_t idx, seq;
+	int ret;
+
+	idx = GPOINTER_TO_SIZE(data);
+	if (idx == 0) {
+		for (seq = 0; seq < 3 * QUEUE_DEPTH; seq++)
+			send_logic(idx, 1, seq);
+		send_end(idx);
+		return NULL;
+	}
+
+	while (!g_atomic_int_get(&producers_done))
+		g_usleep(1000);
+	session = producer_sdis[idx]->session;
+	ret = sr_session_datafeed_callback_add(session, record_delivery, NULL);
+	fail_unless(ret == SR_ERR, "Callback added while the queue runs.");
+	ret = sr_session_datafeed_callback_remove_all(session);
+	fail_unless(ret == SR_ERR, "Callbacks removed while the queue runs.");
+	send_logic(idx, 1, 0);
+	send_end(idx);
+
+	return NULL;
+}
+
+START_TEST(test_session_queue_unordered)
+{
+	size_t high_water;
+	uint64_t dropped, unordered;
+
+	run_session(MAX_PRODUCERS, QUEUE_DEPTH, SR_FEED_QUEUE_BLOCK, TRUE,
+		produce_unordered, &high_water, &dropped, &unordered);
+
+	fail_unless(deliveries->len == 3 * QUEUE_DEPTH + 1 + 2,
+		"%u packets delivered.", deliveries->len);
+	fail_unless(dropped == 0, "%" PRIu64 " packets dropped.", dropped);
+	fail_unless(unordered >= 2 * QUEUE_DEPTH,
+		"%" PRIu64 " packets unordered.", unordered);
+
+	g_array_free(deliveries, TRUE);
+}
+END_TEST
+
+Suite *suite_feed_queue(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("feed_queue");
+
+	tc = tcase_create("logic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_logic_fill, 0, G_N_ELEMENTS(fill_cases));
+	tcase_add_loop_test(tc, test_submit_runs, 0, G_N_ELEMENTS(queue_cases));
+	tcase_add_test(tc, test_submit_runs_late_rle);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("session");
+	tcase_set_timeout(tc, 30);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_queue_order);
+	tcase_add_test(tc, test_session_queue_drop);
+	tcase_add_test(tc, test_session_queue_merge);
+	tcase_add_test(tc, test_session_queue_unordered);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
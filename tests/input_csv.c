@@ -0,0 +1,309 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/*
+ * The CSV input module finds line terminations, column separators and
+ * comment leaders with SIMD kernels where the CPU has them, and decodes
+ * plain decimal analog text with its own exact conversion. These tests
+ * compare the imported data against values which were taken from the
+ * generated text. The test suite runs a second time with SIGROK_NO_SIMD=1
+ * set, which covers the scalar scanner as well.
+ */
+
+#define ROW_COUNT 3000
+/* Logic columns: 12 bits binary, 8 bits hex. */
+#define BIN_BITS 12
+#define HEX_BITS 8
+#define UNITSIZE 3
+
+static const struct {
+	const char *separator;
+	const char *comment;
+	const char *eol;
+	size_t chunk_size;
+} cases[] = {
+	{ ",", ";", "\n", 7, },
+	{ ",", ";", "\r\n", 1000, },
+	{ "::", "//", "\n", 64, },
+	{ "\t", "#", "\n", 1 << 20, },
+	{ ";", "", "\r\n", 4096, },
+};
+
+/*
+ * Analog text at the edges of the exact conversion: the mantissa and
+ * the power of ten limits, and text which needs the library routine.
+ */
+static const char *analog_edges[] = {
+	"0", "-0", "+0", "1", "-1", "0.1", "0.5", ".5", "5.", "-.25",
+	"1e22", "1e23", "1e-22", "1e-23", "1E5", "1e+5", "123.456e-3",
+	"9007199254740992", "9007199254740993", "-9007199254740993",
+	"18446744073709551615", "12345678901234567890", "0.1234567890123456789",
+	"4.35", "0.3", "2.2250738585072014e-308", "1.7976931348623157e308",
+	"00000000000000000001", "1.000000000000000000001", "1e-0", "7e022",
+	"0e999",
+};
+
+static GByteArray *logic_data;
+static GArray *analog_data;
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* Decimal text with varying digit counts, and optional exponents. */
+static void gen_analog(GString *s, uint32_t *state)
+{
+	uint32_t r;
+	size_t i, int_digits, frac_digits;
+
+	r = next_random(state);
+	if (r % 4 == 0)
+		g_string_append_c(s, (r & 0x10) ? '-' : '+');
+	int_digits = (r >> 8) % 13;
+	frac_digits = (r >> 12) % 13;
+	if ((r >> 16) % 8 == 0)
+		frac_digits += 8;
+	if (!int_digits && !frac_digits)
+		int_digits = 1;
+	for (i = 0; i < int_digits; i++)
+		g_string_append_c(s, '0' + next_random(state) % 10);
+	if (frac_digits || (r >> 20) % 4 == 0)
+		g_string_append_c(s, '.');
+	for (i = 0; i < frac_digits; i++)
+		g_string_append_c(s, '0' + next_random(state) % 10);
+	if ((r >> 24) % 3 == 0) {
+		g_string_append_printf(s, "%c%s%d", (r & 0x20) ? 'e' : 'E',
+			(r & 0x40) ? "-" : "", (r >> 26) % 40);
+	}
+}
+
+/*
+ * Rows of an ignored column of varying width, the logic columns with
+ * optional leading zeros and trailing spaces, and an analog column.
+ * Comment lines and trailing comments get interspersed.
+ */
+static GString *gen_csv(size_t idx, GByteArray *logic, GArray *analog)
+{
+	GString *s, *text;
+	uint32_t state, r, bits;
+	size_t row, i;
+	double value;
+	uint8_t sample[UNITSIZE];
+
+	s = g_string_new(NULL);
+	text = g_string_new(NULL);
+	state = 0x5eed + idx;
+	for (row = 0; row < ROW_COUNT; row++) {
+		r = next_random(&state);
+		if (row && *cases[idx].comment && r % 16 == 0) {
+			g_string_append_printf(s, "%s comment %u%s",
+				cases[idx].comment, r, cases[idx].eol);
+		}
+		for (i = 0; i <= (r >> 4) % 70; i++)
+			g_string_append_c(s, 'a' + next_random(&state) % 26);
+		g_string_append(s, cases[idx].separator);
+
+		bits = next_random(&state);
+		for (i = 0; i < (r >> 12) % 4; i++)
+			g_string_append_c(s, '0');
+		for (i = BIN_BITS; i > 0; i--)
+			g_string_append_c(s, (bits & (1 << (i - 1))) ? '1' : '0');
+		if (r & 0x100)
+			g_string_append(s, "  ");
+		g_string_append(s, cases[idx].separator);
+		g_string_append_printf(s, "%0*x", 2 + (int)((r >> 16) % 3),
+			(bits >> 16) & 0xff);
+		g_string_append(s, cases[idx].separator);
+
+		g_string_truncate(text, 0);
+		if (row < G_N_ELEMENTS(analog_edges))
+			g_string_append(text, analog_edges[row]);
+		else
+			gen_analog(text, &state);
+		g_string_append(s, text->str);
+		if (*cases[idx].comment && r % 16 == 1) {
+			g_string_append_printf(s, " %s trailing %s",
+				cases[idx].comment, cases[idx].separator);
+		}
+		g_string_append(s, cases[idx].eol);
+
+		bits = (bits & ((1 << BIN_BITS) - 1)) |
+			(((bits >> 16) & ((1 << HEX_BITS) - 1)) << BIN_BITS);
+		for (i = 0; i < UNITSIZE; i++)
+			sample[i] = bits >> (8 * i);
+		g_byte_array_append(logic, sample, UNITSIZE);
+		value = g_ascii_strtod(text->str, NULL);
+		g_array_append_val(analog, value);
+	}
+	g_string_free(text, TRUE);
+
+	return s;
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	(void)sdi;
+	(void)cb_data;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		fail_unless(logic->unitsize == UNITSIZE);
+		g_byte_array_append(logic_data, logic->data, logic->length);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		fail_unless(analog->encoding->is_float &&
+			analog->encoding->unitsize == sizeof(double),
+			"Unexpected analog encoding.");
+		g_array_append_vals(analog_data, analog->data,
+			analog->num_samples);
+		break;
+	default:
+		break;
+	}
+}
+
+static void import_csv(size_t idx, const GString *text)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *buf;
+	size_t pos, len;
+	int ret;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "column_formats",
+		g_variant_ref_sink(g_variant_new_string("-,b12,x8,a")));
+	g_hash_table_insert(options, "column_separator",
+		g_variant_ref_sink(g_variant_new_string(cases[idx].separator)));
+	g_hash_table_insert(options, "comment_leader",
+		g_variant_ref_sink(g_variant_new_string(cases[idx].comment)));
+	imod = sr_input_find("csv");
+	fail_unless(imod != NULL, "Cannot find CSV input module.");
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Cannot create CSV input.");
+	g_hash_table_destroy(options);
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+
+	sdi = NULL;
+	for (pos = 0; pos < text->len; pos += len) {
+		len = MIN(cases[idx].chunk_size, text->len - pos);
+		buf = g_string_new_len(&text->str[pos], len);
+		ret = sr_input_send(in, buf);
+		g_string_free(buf, TRUE);
+		fail_unless(ret == SR_OK, "Case %zu: cannot send chunk at %zu.",
+			idx, pos);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	fail_unless(sdi != NULL, "No device after the first line.");
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "Cannot end input: %d.", ret);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+}
+
+/*
+ * Check the columns' logic and analog data. Analog values must match
+ * the library's string conversion exactly, which is what the module
+ * used before it got its own conversion for plain decimal text.
+ */
+START_TEST(test_csv_columns)
+{
+	GString *text;
+	GByteArray *expect_logic;
+	GArray *expect_analog;
+	double got, want;
+	size_t i;
+
+	expect_logic = g_byte_array_new();
+	expect_analog = g_array_new(FALSE, FALSE, sizeof(double));
+	logic_data = g_byte_array_new();
+	analog_data = g_array_new(FALSE, FALSE, sizeof(double));
+	text = gen_csv(_i, expect_logic, expect_analog);
+
+	import_csv(_i, text);
+
+	fail_unless(logic_data->len == expect_logic->len,
+		"Case %d: %u logic bytes instead of %u.", _i,
+		logic_data->len, expect_logic->len);
+	for (i = 0; i < expect_logic->len; i += UNITSIZE) {
+		if (memcmp(&logic_data->data[i], &expect_logic->data[i], UNITSIZE))
+			fail("Case %d: logic data differs in row %zu.",
+				_i, i / UNITSIZE);
+	}
+	fail_unless(analog_data->len == expect_analog->len,
+		"Case %d: %u analog values instead of %u.", _i,
+		analog_data->len, expect_analog->len);
+	for (i = 0; i < expect_analog->len; i++) {
+		got = g_array_index(analog_data, double, i);
+		want = g_array_index(expect_analog, double, i);
+		if (memcmp(&got, &want, sizeof(got)) != 0)
+			fail("Case %d, row %zu: analog value %.17g instead of %.17g.",
+				_i, i, got, want);
+	}
+
+	g_string_free(text, TRUE);
+	g_byte_array_free(expect_logic, TRUE);
+	g_array_free(expect_analog, TRUE);
+	g_byte_array_free(logic_data, TRUE);
+	g_array_free(analog_data, TRUE);
+}
+END_TEST
+
+Suite *suite_input_csv(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-csv");
+
+	tc = tcase_create("columns");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_csv_columns, 0, G_N_ELEMENTS(cases));
+	suite_add_tcase(s, tc);
+
+	return s;
+}
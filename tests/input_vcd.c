@@ -0,0 +1,327 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* Several of the input module's mapped chunks (512 KiB each). */
+#define VALUE_CHANGES 400000
+
+/*
+ * Multi-character identifiers, a vector, a real, and signals which get
+ * ignored: an unsupported type, and one beyond the channel limit.
+ */
+static const char *header =
+	"$timescale 1 us $end\n"
+	"$scope module top $end\n"
+	"$var wire 1 ! clk $end\n"
+	"$var wire 1 #a data $end\n"
+	"$var reg 4 \" bus [3:0] $end\n"
+	"$var string 1 str name $end\n"
+	"$var real 64 $x volt $end\n"
+	"$var wire 1 aZ9 en $end\n"
+	"$var wire 1 skp late $end\n"
+	"$upscope $end\n"
+	"$enddefinitions $end\n";
+
+/* Matches the header's channels, "skp" exceeds this channel count. */
+#define NUM_CHANNELS 8
+
+static const char *bit_ids[] = { "!", "#a", "aZ9", "skp", };
+
+/* Chunk sizes which the application sends. */
+static const size_t chunk_sizes[] = {
+	64 * 1024,
+	1024 * 1024 + 3,
+};
+
+static GByteArray *logic_data;
+static GByteArray *analog_data;
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+static GString *gen_vcd(void)
+{
+	GString *s;
+	uint32_t state, r;
+	uint64_t ts;
+	size_t i;
+
+	s = g_string_new(header);
+	g_string_append(s, "#0\n$dumpvars\n0!\n0#a\nb0000 \"\nr0 $x\n"
+		"0aZ9\n0skp\nsidle str\n$end\n");
+	state = 0xc0ffee;
+	ts = 0;
+	for (i = 0; i < VALUE_CHANGES; i++) {
+		r = next_random(&state);
+		switch (r % 8) {
+		case 0:
+		case 1:
+			ts += 1 + (r >> 8) % 3;
+			g_string_append_printf(s, "#%" PRIu64 "\n", ts);
+			break;
+		case 2:
+			g_string_append_printf(s, "b%d%d%d%d \"\n",
+				(r >> 8) & 1, (r >> 9) & 1,
+				(r >> 10) & 1, (r >> 11) & 1);
+			break;
+		case 3:
+			g_string_append_printf(s, "r%d.%d $x\n",
+				(r >> 8) % 100, (r >> 16) % 10);
+			break;
+		case 4:
+			g_string_append_printf(s, "sword%d str\n", (r >> 8) % 10);
+			break;
+		case 5:
+			if ((r >> 8) % 64 == 0)
+				g_string_append(s, "$comment #1 b1 ! $end\n");
+			else
+				g_string_append_printf(s, "#%" PRIu64 " 1! 0#a\n",
+					++ts);
+			break;
+		default:
+			g_string_append_printf(s, "%c%s\n", "01xz"[(r >> 8) % 4],
+				bit_ids[(r >> 16) % G_N_ELEMENTS(bit_ids)]);
+			break;
+		}
+	}
+
+	return s;
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	float *values;
+	int ret;
+
+	(void)sdi;
+	(void)cb_data;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		g_byte_array_append(logic_data, logic->data, logic->length);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		values = g_malloc(analog->num_samples * sizeof(values[0]));
+		ret = sr_analog_to_float(analog, values);
+		fail_unless(ret == SR_OK, "Cannot convert analog data.");
+		g_byte_array_append(analog_data, (const uint8_t *)values,
+			analog->num_samples * sizeof(values[0]));
+		g_free(values);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Import the text in chunks of the given size. Optionally opts in to
+ * the memory mapped import of the file which holds the same text.
+ */
+static void import_vcd(const GString *text, size_t chunk_size,
+	const char *mapfile, GByteArray *logic, GByteArray *analog)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *buf;
+	size_t pos, len;
+	int ret;
+
+	logic_data = logic;
+	analog_data = analog;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "numchannels",
+		g_variant_ref_sink(g_variant_new_uint32(NUM_CHANNELS)));
+	if (mapfile)
+		g_hash_table_insert(options, "mapfile",
+			g_variant_ref_sink(g_variant_new_string(mapfile)));
+	imod = sr_input_find("vcd");
+	fail_unless(imod != NULL, "Cannot find VCD input module.");
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Cannot create VCD input.");
+	g_hash_table_destroy(options);
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+
+	sdi = NULL;
+	for (pos = 0; pos < text->len; pos += len) {
+		len = MIN(chunk_size, text->len - pos);
+		buf = g_string_new_len(&text->str[pos], len);
+		ret = sr_input_send(in, buf);
+		g_string_free(buf, TRUE);
+		fail_unless(ret == SR_OK, "Cannot send chunk: %d.", ret);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	fail_unless(sdi != NULL, "No device after the header.");
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "Cannot end input: %d.", ret);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+}
+
+static char *write_vcd(const GString *text)
+{
+	char *name;
+	int fd;
+
+	fd = g_file_open_tmp("input-vcd-XXXXXX.vcd", &name, NULL);
+	fail_unless(fd >= 0, "Cannot create temporary file.");
+	fail_unless(write(fd, text->str, text->len) == (ssize_t)text->len,
+		"Cannot write temporary file.");
+	close(fd);
+
+	return name;
+}
+
+/*
+ * The memory mapped import must result in the same session data as the
+ * line based parser, independently of the application's chunk size.
+ */
+START_TEST(test_vcd_mapped)
+{
+	GString *text;
+	GByteArray *logic, *analog, *mapped_logic, *mapped_analog;
+	char *filename;
+
+	text = gen_vcd();
+	filename = write_vcd(text);
+
+	logic = g_byte_array_new();
+	analog = g_byte_array_new();
+	mapped_logic = g_byte_array_new();
+	mapped_analog = g_byte_array_new();
+	import_vcd(text, chunk_sizes[_i], NULL, logic, analog);
+	import_vcd(text, chunk_sizes[_i], filename, mapped_logic, mapped_analog);
+
+	fail_unless(logic->len > 0 && analog->len > 0, "No session data.");
+	fail_unless(mapped_logic->len == logic->len,
+		"%u logic bytes instead of %u.", mapped_logic->len, logic->len);
+	fail_unless(memcmp(mapped_logic->data, logic->data, logic->len) == 0,
+		"Logic data differs.");
+	fail_unless(mapped_analog->len == analog->len,
+		"%u analog bytes instead of %u.", mapped_analog->len, analog->len);
+	fail_unless(memcmp(mapped_analog->data, analog->data, analog->len) == 0,
+		"Analog data differs.");
+
+	g_byte_array_free(logic, TRUE);
+	g_byte_array_free(analog, TRUE);
+	g_byte_array_free(mapped_logic, TRUE);
+	g_byte_array_free(mapped_analog, TRUE);
+	g_unlink(filename);
+	g_free(filename);
+	g_string_free(text, TRUE);
+}
+END_TEST
+
+/* Data beyond the mapped file's end must not get accepted. */
+START_TEST(test_vcd_mapped_mismatch)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	GHashTable *options;
+	GString *text, *buf;
+	char *filename;
+	size_t len;
+	int ret;
+
+	text = gen_vcd();
+	filename = write_vcd(text);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "mapfile",
+		g_variant_ref_sink(g_variant_new_string(filename)));
+	imod = sr_input_find("vcd");
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Cannot create VCD input.");
+	g_hash_table_destroy(options);
+
+	sr_session_new(srtest_ctx, &session);
+	len = strlen(header);
+	buf = g_string_new_len(text->str, len);
+	ret = sr_input_send(in, buf);
+	g_string_free(buf, TRUE);
+	fail_unless(ret == SR_OK);
+	fail_unless(sr_input_dev_inst_get(in) != NULL);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+	/* Maps the file, and processes the complete text. */
+	buf = g_string_new_len(&text->str[len], text->len - len);
+	ret = sr_input_send(in, buf);
+	g_string_free(buf, TRUE);
+	fail_unless(ret == SR_OK);
+
+	buf = g_string_new("#99999999\n");
+	ret = sr_input_send(in, buf);
+	g_string_free(buf, TRUE);
+	fail_unless(ret != SR_OK, "Accepted data beyond the mapped file.");
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_unlink(filename);
+	g_free(filename);
+	g_string_free(text, TRUE);
+}
+END_TEST
+
+Suite *suite_input_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-vcd");
+
+	tc = tcase_create("mapped");
+	tcase_set_timeout(tc, 60);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_vcd_mapped, 0, G_N_ELEMENTS(chunk_sizes));
+	tcase_add_test(tc, test_vcd_mapped_mismatch);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
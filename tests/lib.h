@@ -45,7 +45,12 @@ Suite *suite_core(void);
 Suite *suite_driver_all(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
+Suite *suite_input_csv(void);
+Suite *suite_input_vcd(void);
 Suite *suite_output_all(void);
+Suite *suite_output_csv(void);
+Suite *suite_output_srzip(void);
+Suite *suite_output_vcd(void);
 Suite *suite_transform_all(void);
 Suite *suite_session(void);
 Suite *suite_strutil(void);
@@ -54,5 +59,10 @@ Suite *suite_device(void);
 Suite *suite_trigger(void);
 Suite *suite_analog(void);
 Suite *suite_conv(void);
+Suite *suite_transpose(void);
+Suite *suite_feed_queue(void);
+Suite *suite_scpi(void);
+Suite *suite_config_cache(void);
+Suite *suite_asix_sigma(void);
 
 #endif
@@ -0,0 +1,22 @@
+#!/bin/sh
+##
+## This file is part of the libsigrok project.
+##
+## This program is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## This program is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+# Run the unit tests with the library's SIMD code paths disabled.
+SIGROK_NO_SIMD=1
+export SIGROK_NO_SIMD
+exec ./tests/main "$@"
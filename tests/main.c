@@ -37,7 +37,12 @@ int main(void)
 	srunner_add_suite(srunner, suite_driver_all());
 	srunner_add_suite(srunner, suite_input_all());
 	srunner_add_suite(srunner, suite_input_binary());
+	srunner_add_suite(srunner, suite_input_csv());
+	srunner_add_suite(srunner, suite_input_vcd());
 	srunner_add_suite(srunner, suite_output_all());
+	srunner_add_suite(srunner, suite_output_csv());
+	srunner_add_suite(srunner, suite_output_srzip());
+	srunner_add_suite(srunner, suite_output_vcd());
 	srunner_add_suite(srunner, suite_transform_all());
 	srunner_add_suite(srunner, suite_session());
 	srunner_add_suite(srunner, suite_strutil());
@@ -46,6 +51,11 @@ int main(void)
 	srunner_add_suite(srunner, suite_trigger());
 	srunner_add_suite(srunner, suite_analog());
 	srunner_add_suite(srunner, suite_conv());
+	srunner_add_suite(srunner, suite_transpose());
+	srunner_add_suite(srunner, suite_feed_queue());
+	srunner_add_suite(srunner, suite_scpi());
+	srunner_add_suite(srunner, suite_config_cache());
+	srunner_add_suite(srunner, suite_asix_sigma());
 
 	srunner_run_all(srunner, CK_VERBOSE);
 	ret = srunner_ntests_failed(srunner);
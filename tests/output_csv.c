@@ -0,0 +1,205 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+/* Number of generated values per sweep. */
+#define SWEEP_COUNT 20000
+
+/*
+ * Values which sit at the edges of the CSV module's own formatter:
+ * signed zero, denormals, the fixed/exponent notation thresholds of
+ * "%g", and values which are (close to) rounding ties at the sixth
+ * significant digit.
+ */
+static const float edge_values[] = {
+	0.0f, -0.0f, 1.0f, -1.0f, 0.1f, 0.5f, 2.5f, -123.456f,
+	1.0f / 3, 2.0f / 3, 3.14159265f, 65536.0f, 100000.0f, 1e6f,
+	1e-4f, -1e-4f, 9.99995e-5f, 9.999949e-5f, 1.00001e-4f,
+	999999.4f, 999999.5f, 999999.6f, 999998.5f, -999999.5f,
+	123456.5f, 12345.65f, 1234.565f, 0.000123456f, 0.0001234565f,
+	100000.5f, 99999.95f, 9.999995f, 0.9999995f, 0.99999949f,
+	1e-45f, 1e-40f, -1e-40f, FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX,
+	FLT_EPSILON, 1e10f, 1.5e-5f,
+};
+
+static GString *received;
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/*
+ * Sweeps over generated values: arbitrary bit patterns (which includes
+ * infinities and NaNs), and decimal ties at all scales of the fixed
+ * notation range.
+ */
+static void gen_values(float *values, size_t count, int sweep)
+{
+	uint32_t state, bits;
+	size_t i;
+	int exp;
+
+	state = 0x2468ace + sweep;
+	for (i = 0; i < count; i++) {
+		bits = next_random(&state);
+		switch (sweep) {
+		case 0:
+			memcpy(&values[i], &bits, sizeof(values[i]));
+			break;
+		case 1:
+			exp = bits % 11 - 5;
+			values[i] = (100000 + (bits >> 8) % 900000 + 0.5) *
+				pow(10, exp - 5);
+			break;
+		default:
+			values[i] = (double)(bits % 2000001) / 1000 - 1000;
+			break;
+		}
+	}
+}
+
+/* Run the values through the CSV output module, one row per value. */
+static void format_values(const float *values, size_t count)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GHashTable *options;
+	GString *out;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("sigrok", "csv-test", NULL);
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_ANALOG, "A0");
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "header",
+		g_variant_ref_sink(g_variant_new_boolean(FALSE)));
+	g_hash_table_insert(options, "label",
+		g_variant_ref_sink(g_variant_new_string("off")));
+	omod = sr_output_find("csv");
+	fail_unless(omod != NULL, "Cannot find CSV output module.");
+	o = sr_output_new(omod, options, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create CSV output.");
+	g_hash_table_destroy(options);
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 6);
+	meaning.channels = sr_dev_inst_channels_get(sdi);
+	analog.num_samples = count;
+	analog.data = (void *)values;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	out = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "Cannot send packet: %d.", ret);
+	fail_unless(out != NULL);
+	g_string_assign(received, out->str);
+	g_string_free(out, TRUE);
+
+	sr_output_free(o);
+	sr_dev_inst_free(sdi);
+}
+
+/*
+ * Compare the module's rows with the locale independent "%g" output,
+ * which is what the module emitted before it got its own formatter.
+ */
+static void check_values(const float *values, size_t count)
+{
+	char expect[G_ASCII_DTOSTR_BUF_SIZE];
+	const char *row, *end;
+	uint32_t bits;
+	size_t i;
+
+	received = g_string_new(NULL);
+	format_values(values, count);
+
+	row = received->str;
+	for (i = 0; i < count; i++) {
+		end = strchr(row, '\n');
+		fail_unless(end != NULL, "Missing row %zu.", i);
+		g_ascii_formatd(expect, sizeof(expect), "%g", values[i]);
+		if ((size_t)(end - row) != strlen(expect) ||
+				strncmp(row, expect, end - row) != 0) {
+			memcpy(&bits, &values[i], sizeof(bits));
+			fail("Value %.9g (0x%08" PRIx32 "): '%.*s' instead of "
+				"'%s'.", values[i], bits,
+				(int)(end - row), row, expect);
+		}
+		row = end + 1;
+	}
+	fail_unless(*row == '\0', "Extra rows.");
+
+	g_string_free(received, TRUE);
+	received = NULL;
+}
+
+START_TEST(test_csv_float_edges)
+{
+	check_values(edge_values, G_N_ELEMENTS(edge_values));
+}
+END_TEST
+
+START_TEST(test_csv_float_sweep)
+{
+	float *values;
+
+	values = g_malloc(SWEEP_COUNT * sizeof(values[0]));
+	gen_values(values, SWEEP_COUNT, _i);
+	check_values(values, SWEEP_COUNT);
+	g_free(values);
+}
+END_TEST
+
+Suite *suite_output_csv(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("output-csv");
+
+	tc = tcase_create("float");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_csv_float_edges);
+	tcase_add_loop_test(tc, test_csv_float_sweep, 0, 3);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,422 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <check.h>
+#include <zip.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* The srzip output module's chunk size, see src/output/srzip.c. */
+#define SRZIP_CHUNK_SIZE (4 * 1024 * 1024)
+/* Spans several archive members, the last one partially filled. */
+#define SAMPLE_COUNT (3 * SRZIP_CHUNK_SIZE + 12345)
+/* Smaller than, and not a divisor of the chunk size. */
+#define PACKET_SIZE (1000 * 1000)
+
+static const char *codecs[] = {
+	"deflate",
+	"store",
+	"lzo",
+};
+
+/* Read-ahead depths, smaller and larger than the number of chunks. */
+static const uint64_t read_ahead[] = {
+	2,
+	16,
+};
+
+/* Replayed sample ranges, relative to the archive's chunks. */
+static const struct {
+	uint64_t start;
+	uint64_t end;
+} ranges[] = {
+	/* Within the first chunk. */
+	{ 100, 200, },
+	/* Starts and ends mid-chunk, in different chunks. */
+	{ SRZIP_CHUNK_SIZE / 2, 2 * SRZIP_CHUNK_SIZE + 777, },
+	/* Exactly on chunk boundaries. */
+	{ 0, SRZIP_CHUNK_SIZE, },
+	{ SRZIP_CHUNK_SIZE, 2 * SRZIP_CHUNK_SIZE, },
+	/* Across a boundary. */
+	{ SRZIP_CHUNK_SIZE - 1, SRZIP_CHUNK_SIZE + 1, },
+	/* Open-ended. */
+	{ 2 * SRZIP_CHUNK_SIZE + 5, 0, },
+	/* Ends past the data. */
+	{ SAMPLE_COUNT - 10, SAMPLE_COUNT + 1000, },
+	/* Past the data. */
+	{ SAMPLE_COUNT, 0, },
+	{ SAMPLE_COUNT + 1, SAMPLE_COUNT + 5, },
+};
+
+/* Read-ahead depths for the range replays, includes reading inline. */
+static const uint64_t range_read_ahead[] = {
+	0,
+	3,
+};
+
+static GByteArray *received;
+static gboolean have_seen_df_end;
+
+/* Hashed sample positions, incompressible data. */
+static uint8_t sample_value(size_t idx)
+{
+	uint32_t x;
+
+	x = idx;
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	return x;
+}
+
+static char *tmpfile_name(void)
+{
+	char *name;
+	int fd;
+
+	fd = g_file_open_tmp("srzip-XXXXXX.sr", &name, NULL);
+	fail_unless(fd >= 0, "Cannot create temporary file.");
+	close(fd);
+
+	return name;
+}
+
+static void write_archive(const char *filename, const char *codec,
+		gboolean stream)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_config src;
+	GHashTable *options;
+	GString *out;
+	uint8_t *buf;
+	size_t idx, i, len;
+	char name[8];
+	int ret;
+
+	sdi = sr_dev_inst_user_new("sigrok", "srzip-test", NULL);
+	for (idx = 0; idx < 8; idx++) {
+		snprintf(name, sizeof(name), "D%zu", idx);
+		sr_dev_inst_channel_add(sdi, idx, SR_CHANNEL_LOGIC, name);
+	}
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "stream",
+		g_variant_ref_sink(g_variant_new_boolean(stream)));
+	g_hash_table_insert(options, "compression",
+		g_variant_ref_sink(g_variant_new_string(codec)));
+
+	omod = sr_output_find("srzip");
+	fail_unless(omod != NULL, "Cannot find srzip output module.");
+	o = sr_output_new(omod, options, sdi, filename);
+	fail_unless(o != NULL, "Cannot create srzip output (%s).", codec);
+	g_hash_table_destroy(options);
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(SR_MHZ(1)));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "Sending META failed: %d.", ret);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+
+	buf = g_malloc(PACKET_SIZE);
+	for (idx = 0; idx < SAMPLE_COUNT; idx += len) {
+		len = MIN(PACKET_SIZE, SAMPLE_COUNT - idx);
+		for (i = 0; i < len; i++)
+			buf[i] = sample_value(idx + i);
+		logic.length = len;
+		logic.unitsize = 1;
+		logic.data = buf;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		ret = sr_output_send(o, &packet, &out);
+		fail_unless(ret == SR_OK, "Sending LOGIC failed: %d.", ret);
+	}
+	g_free(buf);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "Sending END failed: %d.", ret);
+
+	sr_output_free(o);
+}
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	fail_unless(!have_seen_df_end, "Packet after SR_DF_END.");
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		fail_unless(logic->unitsize == 1,
+			"Unexpected unit size %u.", logic->unitsize);
+		g_byte_array_append(received, logic->data, logic->length);
+		break;
+	case SR_DF_END:
+		have_seen_df_end = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+static struct sr_session *load_archive(const char *filename,
+		struct sr_dev_inst **sdi)
+{
+	struct sr_session *session;
+	GSList *devlist;
+	int ret;
+
+	ret = sr_session_load(srtest_ctx, filename, &session);
+	fail_unless(ret == SR_OK, "Cannot load '%s': %d.", filename, ret);
+	sr_session_dev_list(session, &devlist);
+	fail_unless(devlist != NULL);
+	*sdi = devlist->data;
+	g_slist_free(devlist);
+
+	return session;
+}
+
+/*
+ * Replay the archive, optionally with read-ahead, and optionally a
+ * sample range (end 0 is open-ended). Check the received samples.
+ */
+static void check_archive(const char *filename, uint64_t depth,
+		uint64_t start, uint64_t end)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GVariant *gvar;
+	size_t idx;
+	uint64_t first, last;
+	int ret;
+
+	received = g_byte_array_new();
+	have_seen_df_end = FALSE;
+
+	session = load_archive(filename, &sdi);
+	if (depth) {
+		ret = sr_config_set(sdi, NULL, SR_CONF_READ_AHEAD,
+			g_variant_new_uint64(depth));
+		fail_unless(ret == SR_OK, "Cannot set read-ahead: %d.", ret);
+		ret = sr_config_get(sr_dev_inst_driver_get(sdi), sdi, NULL,
+			SR_CONF_READ_AHEAD, &gvar);
+		fail_unless(ret == SR_OK);
+		fail_unless(g_variant_get_uint64(gvar) == depth);
+		g_variant_unref(gvar);
+	}
+	if (start || end) {
+		ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLE_RANGE,
+			g_variant_new("(tt)", start, end));
+		fail_unless(ret == SR_OK, "Cannot set sample range: %d.", ret);
+	}
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	ret = sr_session_start(session);
+	fail_unless(ret == SR_OK, "Cannot start session: %d.", ret);
+	ret = sr_session_run(session);
+	fail_unless(ret == SR_OK, "Cannot run session: %d.", ret);
+	sr_session_destroy(session);
+
+	first = MIN(start, SAMPLE_COUNT);
+	last = end ? MIN(end, SAMPLE_COUNT) : SAMPLE_COUNT;
+	last = MAX(first, last);
+	fail_unless(have_seen_df_end, "No SR_DF_END seen.");
+	fail_unless(received->len == last - first,
+		"Range %" PRIu64 "-%" PRIu64 ": expected %" PRIu64
+		" samples, got %u.", start, end, last - first, received->len);
+	for (idx = 0; idx < received->len; idx++) {
+		if (received->data[idx] != sample_value(first + idx))
+			fail("Range %" PRIu64 "-%" PRIu64 ": sample %zu differs.",
+				start, end, idx);
+	}
+
+	g_byte_array_free(received, TRUE);
+	received = NULL;
+}
+
+/* Check the archive's format version, lzo1x needs a recent reader. */
+static void check_version(const char *filename, const char *codec)
+{
+	struct zip *archive;
+	struct zip_file *zf;
+	char s[8];
+	zip_int64_t len;
+
+	archive = zip_open(filename, 0, NULL);
+	fail_unless(archive != NULL, "Cannot open '%s'.", filename);
+	zf = zip_fopen(archive, "version", 0);
+	fail_unless(zf != NULL, "No version in '%s'.", filename);
+	len = zip_fread(zf, s, sizeof(s) - 1);
+	fail_unless(len > 0);
+	s[len] = '\0';
+	zip_fclose(zf);
+	zip_discard(archive);
+
+	if (!strcmp(codec, "lzo"))
+		fail_unless(!strcmp(s, "3"), "Version %s for lzo.", s);
+	else
+		fail_unless(!strcmp(s, "2"), "Version %s for %s.", s, codec);
+}
+
+/* Check that streamed chunks read back unchanged, and in order. */
+START_TEST(test_srzip_stream)
+{
+	char *filename;
+
+	filename = tmpfile_name();
+	write_archive(filename, codecs[_i], TRUE);
+	check_version(filename, codecs[_i]);
+	check_archive(filename, 0, 0, 0);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Check that the regular mode's archive content is the same. */
+START_TEST(test_srzip_regular)
+{
+	char *filename;
+
+	filename = tmpfile_name();
+	write_archive(filename, codecs[_i], FALSE);
+	check_version(filename, codecs[_i]);
+	check_archive(filename, 0, 0, 0);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Check that chunks which get read ahead arrive in their order. */
+START_TEST(test_srzip_read_ahead)
+{
+	char *filename;
+
+	filename = tmpfile_name();
+	write_archive(filename, "deflate", TRUE);
+	check_archive(filename, read_ahead[_i], 0, 0);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/*
+ * Replay sample ranges which start and end within chunks, on their
+ * boundaries, and beyond the data. Only the chunks which hold samples
+ * of the range get read.
+ */
+START_TEST(test_srzip_range)
+{
+	char *filename;
+	size_t idx;
+
+	filename = tmpfile_name();
+	write_archive(filename, "deflate", TRUE);
+	for (idx = 0; idx < G_N_ELEMENTS(ranges); idx++) {
+		check_archive(filename, range_read_ahead[_i],
+			ranges[idx].start, ranges[idx].end);
+	}
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Empty ranges get rejected, and leave the previous range in place. */
+START_TEST(test_srzip_range_invalid)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GVariant *gvar;
+	uint64_t start, end;
+	char *filename;
+	int ret;
+
+	filename = tmpfile_name();
+	write_archive(filename, "store", TRUE);
+	session = load_archive(filename, &sdi);
+
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLE_RANGE,
+		g_variant_new("(tt)", (uint64_t)10, (uint64_t)0));
+	fail_unless(ret == SR_OK, "Cannot set open-ended range: %d.", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLE_RANGE,
+		g_variant_new("(tt)", (uint64_t)20, (uint64_t)20));
+	fail_unless(ret == SR_ERR_ARG, "Accepted an empty range: %d.", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLE_RANGE,
+		g_variant_new("(tt)", (uint64_t)30, (uint64_t)20));
+	fail_unless(ret == SR_ERR_ARG, "Accepted a reversed range: %d.", ret);
+
+	ret = sr_config_get(sr_dev_inst_driver_get(sdi), sdi, NULL,
+		SR_CONF_SAMPLE_RANGE, &gvar);
+	fail_unless(ret == SR_OK);
+	g_variant_get(gvar, "(tt)", &start, &end);
+	g_variant_unref(gvar);
+	fail_unless(start == 10 && end == 0, "Range %" PRIu64 "-%" PRIu64 ".",
+		start, end);
+
+	sr_session_destroy(session);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+Suite *suite_output_srzip(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("output-srzip");
+
+	tc = tcase_create("roundtrip");
+	tcase_set_timeout(tc, 60);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_srzip_stream, 0, G_N_ELEMENTS(codecs));
+	tcase_add_loop_test(tc, test_srzip_regular, 0, G_N_ELEMENTS(codecs));
+	tcase_add_loop_test(tc, test_srzip_read_ahead, 0, G_N_ELEMENTS(read_ahead));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("range");
+	tcase_set_timeout(tc, 60);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_srzip_range, 0,
+		G_N_ELEMENTS(range_read_ahead));
+	tcase_add_test(tc, test_srzip_range_invalid);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,321 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define MAX_UNITSIZE 8
+#define RUN_COUNT 400
+/* Runs at the end which get sent in one SR_DF_LOGIC_RLE packet. */
+#define RLE_RUN_COUNT 5
+
+static const struct {
+	size_t unitsize;
+	size_t channels;
+	uint64_t disabled;
+	uint64_t samplerate;
+} cases[] = {
+	{ 1, 8, 0, SR_MHZ(1), },
+	{ 1, 5, 0x04, SR_KHZ(200), },
+	{ 2, 16, 0, 1, },
+	{ 3, 20, 0x80001, SR_MHZ(3), },
+	{ 3, 24, 0x800000, SR_MHZ(1), },
+	{ 8, 64, (UINT64_C(1) << 63) | (UINT64_C(1) << 31), SR_MHZ(1), },
+	{ 8, 40, 0, SR_KHZ(12500), },
+};
+
+/* Sizes of the SR_DF_LOGIC packets which carry the expanded runs. */
+static const size_t packet_sizes[] = { 1, 7, 64, 333, 4096, };
+
+/* Huge run lengths, in the RLE packet. */
+static const uint64_t rle_lengths[RLE_RUN_COUNT] = {
+	UINT64_C(1) << 40, 3, 0, UINT64_C(1) << 33, 1,
+};
+
+struct run {
+	uint8_t value[MAX_UNITSIZE];
+	uint64_t count;
+};
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/*
+ * Generate runs of samples. Most runs flip a single bit, which may
+ * belong to a disabled or a non-existing channel. Some runs repeat
+ * the previous value, some are long enough to cover several words.
+ */
+static void gen_runs(struct run *runs, size_t unitsize)
+{
+	uint32_t state, r;
+	size_t i, bit;
+
+	state = 0x1234567;
+	memset(runs, 0, RUN_COUNT * sizeof(runs[0]));
+	for (i = 0; i < RUN_COUNT; i++) {
+		if (i)
+			memcpy(runs[i].value, runs[i - 1].value, unitsize);
+		r = next_random(&state);
+		switch (r % 8) {
+		case 0:
+			for (bit = 0; bit < unitsize; bit++)
+				runs[i].value[bit] = next_random(&state);
+			break;
+		case 1:
+			break;
+		default:
+			bit = (r >> 8) % (unitsize * 8);
+			runs[i].value[bit / 8] ^= 1 << (bit % 8);
+			break;
+		}
+		r = next_random(&state);
+		runs[i].count = 1 + r % 4;
+		if (r % 5 == 0)
+			runs[i].count = 17 + (r >> 8) % 200;
+	}
+	for (i = 0; i < RLE_RUN_COUNT; i++)
+		runs[RUN_COUNT - RLE_RUN_COUNT + i].count = rle_lengths[i];
+}
+
+static uint64_t timescale_freq(uint64_t samplerate)
+{
+	uint64_t timescale;
+	int up;
+
+	timescale = 1;
+	while (timescale < samplerate)
+		timescale *= 10;
+	for (up = 0; up < 2; up++) {
+		if (timescale / samplerate * samplerate == timescale)
+			break;
+		timescale *= 10;
+	}
+
+	return timescale;
+}
+
+static void append_timestamp(GString *s, uint64_t samplerate, uint64_t snum)
+{
+	double ts;
+
+	ts = (double)snum;
+	ts /= samplerate;
+	ts *= timescale_freq(samplerate);
+	g_string_append_printf(s, "\n#%.0f", ts);
+}
+
+/* Identifiers of the first 94 enabled channels. */
+static void identifier(char *id, size_t idx)
+{
+	id[0] = '!' + idx;
+	id[1] = '\0';
+}
+
+/*
+ * Reference: check each channel's bit against its last value, emit the
+ * timestamp and the values of channels which changed.
+ */
+static GString *expected_text(const struct run *runs, size_t idx)
+{
+	GString *s, *values;
+	uint8_t last[64];
+	uint64_t snum;
+	size_t i, ch, desc;
+	uint8_t bit;
+	char id[2];
+
+	s = g_string_new(NULL);
+	values = g_string_new(NULL);
+	snum = 0;
+	for (i = 0; i < RUN_COUNT; i++) {
+		if (!runs[i].count)
+			continue;
+		g_string_truncate(values, 0);
+		desc = 0;
+		for (ch = 0; ch < cases[idx].channels; ch++) {
+			if (cases[idx].disabled & (UINT64_C(1) << ch))
+				continue;
+			identifier(id, desc++);
+			bit = (runs[i].value[ch / 8] >> (ch % 8)) & 1;
+			if (snum && bit == last[ch])
+				continue;
+			last[ch] = bit;
+			g_string_append_printf(values, " %c%s",
+				bit ? '1' : '0', id);
+		}
+		if (values->len) {
+			append_timestamp(s, cases[idx].samplerate, snum);
+			g_string_append_c(s, ' ');
+			g_string_append(s, values->str);
+		}
+		snum += runs[i].count;
+	}
+	append_timestamp(s, cases[idx].samplerate, snum);
+	g_string_append_c(s, '\n');
+	g_string_free(values, TRUE);
+
+	return s;
+}
+
+static void send_packet(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet, GString *text)
+{
+	GString *out;
+	int ret;
+
+	out = NULL;
+	ret = sr_output_send(o, packet, &out);
+	fail_unless(ret == SR_OK, "Cannot send packet: %d.", ret);
+	if (out) {
+		g_string_append_len(text, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+}
+
+/*
+ * Feed runs of samples to the VCD output module, most of them as plain
+ * logic packets of varying size, the last ones run-length encoded. The
+ * value changes must match the reference's, independently of how the
+ * samples got split into packets.
+ */
+START_TEST(test_vcd_changes)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle logic_rle;
+	struct sr_config src;
+	struct run *runs;
+	GByteArray *samples;
+	GString *text, *expect;
+	GSList *l;
+	struct sr_channel *ch;
+	uint8_t rle_values[RLE_RUN_COUNT * MAX_UNITSIZE];
+	size_t unitsize, i, n, pos, len;
+	const char *body;
+	char name[8];
+
+	unitsize = cases[_i].unitsize;
+	runs = g_malloc(RUN_COUNT * sizeof(runs[0]));
+	gen_runs(runs, unitsize);
+
+	sdi = sr_dev_inst_user_new("sigrok", "vcd-test", NULL);
+	for (i = 0; i < cases[_i].channels; i++) {
+		snprintf(name, sizeof(name), "D%zu", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		if (cases[_i].disabled & (UINT64_C(1) << ch->index))
+			sr_dev_channel_enable(ch, FALSE);
+	}
+
+	omod = sr_output_find("vcd");
+	fail_unless(omod != NULL, "Cannot find VCD output module.");
+	o = sr_output_new(omod, NULL, sdi, NULL);
+	fail_unless(o != NULL, "Cannot create VCD output.");
+
+	text = g_string_new(NULL);
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(cases[_i].samplerate));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	send_packet(o, &packet, text);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+
+	samples = g_byte_array_new();
+	for (i = 0; i < RUN_COUNT - RLE_RUN_COUNT; i++) {
+		for (n = 0; n < runs[i].count; n++)
+			g_byte_array_append(samples, runs[i].value, unitsize);
+	}
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = unitsize;
+	for (pos = 0, i = 0; pos < samples->len; pos += len, i++) {
+		len = packet_sizes[i % G_N_ELEMENTS(packet_sizes)] * unitsize;
+		len = MIN(len, samples->len - pos);
+		logic.length = len;
+		logic.data = &samples->data[pos];
+		send_packet(o, &packet, text);
+	}
+	g_byte_array_free(samples, TRUE);
+
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &logic_rle;
+	for (i = 0; i < RLE_RUN_COUNT; i++)
+		memcpy(&rle_values[i * unitsize],
+			runs[RUN_COUNT - RLE_RUN_COUNT + i].value, unitsize);
+	logic_rle.unitsize = unitsize;
+	logic_rle.num_runs = RLE_RUN_COUNT;
+	logic_rle.values = rle_values;
+	logic_rle.lengths = (uint64_t *)rle_lengths;
+	send_packet(o, &packet, text);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	send_packet(o, &packet, text);
+	sr_output_free(o);
+
+	/* Skip the header, it contains the current date. */
+	body = strstr(text->str, "$enddefinitions $end\n");
+	fail_unless(body != NULL, "No VCD header.");
+	body += strlen("$enddefinitions $end\n");
+	expect = expected_text(runs, _i);
+	fail_unless(strcmp(body, expect->str) == 0,
+		"Case %d: VCD text differs.", _i);
+
+	g_string_free(expect, TRUE);
+	g_string_free(text, TRUE);
+	g_free(runs);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+Suite *suite_output_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("output-vcd");
+
+	tc = tcase_create("logic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_vcd_changes, 0, G_N_ELEMENTS(cases));
+	suite_add_tcase(s, tc);
+
+	return s;
+}
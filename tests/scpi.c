@@ -0,0 +1,372 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+#include "lib.h"
+
+/*
+ * A fake SCPI transport, and a device behind it which answers queries
+ * from a table. The device's output gets read in chunks of a given
+ * size. A response is complete when all of it was read, and it ended
+ * in a newline.
+ */
+
+/* How the fake device handles compound program messages. */
+enum compound_mode {
+	COMPOUND_FULL,
+	/* Answers the first two queries only. */
+	COMPOUND_PARTIAL,
+	/* Does not answer at all. */
+	COMPOUND_SILENT,
+	/* Answers one query with text which cannot get parsed. */
+	COMPOUND_BAD,
+};
+
+struct fake_device {
+	GString *sent;
+	GByteArray *output;
+	size_t read_size;
+	gboolean complete;
+	enum compound_mode mode;
+};
+
+static const struct {
+	const char *query;
+	const char *response;
+} replies[] = {
+	{ "NAME?", "\"Channel; one\"", },
+	{ "LABEL?", "'it''s;x'", },
+	{ "COUNT?", "42", },
+	{ "LEVEL?", "1.5E+3", },
+	{ "STATE?", "ON", },
+	{ "NOTE?", "\"say \"\"a;b\"\" twice\"", },
+	{ "GAIN?", "-0.25", },
+	/* Block data which contains newlines, or ends in one. */
+	{ "DATA1?", "#15a\nb;c", },
+	{ "DATA2?", "#212line1\nline2\n", },
+	{ "EMPTY?", "#10", },
+};
+
+/* Read sizes of the transport. */
+static const size_t read_sizes[] = { 1, 5, 4096, };
+
+static struct fake_device fake;
+
+static const char *fake_reply(const char *query)
+{
+	size_t i;
+
+	if (*query == ':')
+		query++;
+	for (i = 0; i < G_N_ELEMENTS(replies); i++) {
+		if (strcmp(query, replies[i].query) == 0)
+			return replies[i].response;
+	}
+	fail("Unexpected query '%s'.", query);
+
+	return NULL;
+}
+
+static void fake_respond(const char *message)
+{
+	GString *response;
+	char **queries;
+	size_t i;
+
+	queries = g_strsplit(message, ";", 0);
+	response = g_string_new(NULL);
+	if (!queries[1]) {
+		if (strchr(message, '?'))
+			g_string_append(response, fake_reply(message));
+	} else if (fake.mode != COMPOUND_SILENT) {
+		for (i = 0; queries[i]; i++) {
+			if (fake.mode == COMPOUND_PARTIAL && i == 2)
+				break;
+			if (i)
+				g_string_append_c(response, ';');
+			if (fake.mode == COMPOUND_BAD && i == 2)
+				g_string_append(response, "bogus");
+			else
+				g_string_append(response, fake_reply(queries[i]));
+		}
+	}
+	if (response->len) {
+		g_string_append_c(response, '\n');
+		g_byte_array_append(fake.output, (const uint8_t *)response->str,
+			response->len);
+	}
+	g_string_free(response, TRUE);
+	g_strfreev(queries);
+}
+
+static int fake_send(void *priv, const char *command)
+{
+	char *message;
+
+	(void)priv;
+
+	g_string_append(fake.sent, command);
+	message = g_strchomp(g_strdup(command));
+	fake_respond(message);
+	g_free(message);
+
+	return SR_OK;
+}
+
+static int fake_read_begin(void *priv)
+{
+	(void)priv;
+
+	fake.complete = FALSE;
+
+	return SR_OK;
+}
+
+static int fake_read_data(void *priv, char *buf, int maxlen)
+{
+	size_t len;
+
+	(void)priv;
+
+	len = MIN((size_t)maxlen, fake.read_size);
+	len = MIN(len, fake.output->len);
+	if (!len)
+		return 0;
+	memcpy(buf, fake.output->data, len);
+	g_byte_array_remove_range(fake.output, 0, len);
+	fake.complete = !fake.output->len && buf[len - 1] == '\n';
+
+	return len;
+}
+
+static int fake_read_complete(void *priv)
+{
+	(void)priv;
+
+	return fake.complete;
+}
+
+static void fake_scpi_init(struct sr_scpi_dev_inst *scpi, size_t read_size,
+	enum compound_mode mode)
+{
+	memset(scpi, 0, sizeof(*scpi));
+	scpi->name = "fake";
+	scpi->send = fake_send;
+	scpi->read_begin = fake_read_begin;
+	scpi->read_data = fake_read_data;
+	scpi->read_complete = fake_read_complete;
+	scpi->read_timeout_us = 20 * 1000;
+	g_mutex_init(&scpi->scpi_mutex);
+
+	fake.sent = g_string_new(NULL);
+	fake.output = g_byte_array_new();
+	fake.read_size = read_size;
+	fake.complete = FALSE;
+	fake.mode = mode;
+}
+
+static void fake_scpi_cleanup(struct sr_scpi_dev_inst *scpi)
+{
+	g_mutex_clear(&scpi->scpi_mutex);
+	g_string_free(fake.sent, TRUE);
+	g_byte_array_free(fake.output, TRUE);
+}
+
+/*
+ * Run a joined batch of all table queries, and check the results. The
+ * responses which are strings contain ';' characters inside quotes.
+ */
+static void run_batch(size_t read_size, enum compound_mode mode,
+	const char *expect_sent)
+{
+	struct sr_scpi_dev_inst scpi;
+	struct sr_scpi_batch *batch;
+	char *name, *label, *note;
+	int count;
+	double level;
+	gboolean state;
+	float gain;
+	int ret;
+
+	fake_scpi_init(&scpi, read_size, mode);
+	batch = sr_scpi_batch_new(SCPI_BATCH_JOINED);
+	sr_scpi_batch_get_string(batch, &name, "NAME?");
+	sr_scpi_batch_get_string(batch, &label, "LABEL?");
+	sr_scpi_batch_get_int(batch, &count, "COUNT?");
+	sr_scpi_batch_get_double(batch, &level, "LEVEL?");
+	sr_scpi_batch_get_bool(batch, &state, "STATE?");
+	sr_scpi_batch_get_string(batch, &note, "NOTE?");
+	sr_scpi_batch_get_float(batch, &gain, "GAIN?");
+	ret = sr_scpi_batch_run(&scpi, batch);
+	sr_scpi_batch_free(batch);
+
+	fail_unless(ret == SR_OK, "Batch failed: %d.", ret);
+	fail_unless(strcmp(fake.sent->str, expect_sent) == 0,
+		"Sent '%s' instead of '%s'.", fake.sent->str, expect_sent);
+	fail_unless(fake.output->len == 0, "Response not read completely.");
+	fail_unless(g_strcmp0(name, "\"Channel; one\"") == 0,
+		"Name '%s'.", name);
+	fail_unless(g_strcmp0(label, "'it''s;x'") == 0, "Label '%s'.", label);
+	fail_unless(count == 42);
+	fail_unless(level == 1500.0);
+	fail_unless(state == TRUE);
+	fail_unless(g_strcmp0(note, "\"say \"\"a;b\"\" twice\"") == 0,
+		"Note '%s'.", note);
+	fail_unless(gain == -0.25f);
+
+	g_free(name);
+	g_free(label);
+	g_free(note);
+	fake_scpi_cleanup(&scpi);
+}
+
+#define COMPOUND_MESSAGE ":NAME?;:LABEL?;:COUNT?;:LEVEL?;:STATE?;:NOTE?;:GAIN?\n"
+#define SINGLE_MESSAGES "NAME?\nLABEL?\nCOUNT?\nLEVEL?\nSTATE?\nNOTE?\nGAIN?\n"
+
+/* One compound message, its response gets split at unquoted ';'. */
+START_TEST(test_batch_joined)
+{
+	run_batch(read_sizes[_i], COMPOUND_FULL, COMPOUND_MESSAGE);
+}
+END_TEST
+
+/* Fewer responses than queries, the queries get sent one by one. */
+START_TEST(test_batch_partial)
+{
+	run_batch(read_sizes[_i], COMPOUND_PARTIAL,
+		COMPOUND_MESSAGE SINGLE_MESSAGES);
+}
+END_TEST
+
+/* No response: clear the device's errors, then send one by one. */
+START_TEST(test_batch_timeout)
+{
+	run_batch(read_sizes[_i], COMPOUND_SILENT,
+		COMPOUND_MESSAGE "*CLS\n" SINGLE_MESSAGES);
+}
+END_TEST
+
+/* A response which does not parse, the queries get sent one by one. */
+START_TEST(test_batch_bad_response)
+{
+	run_batch(read_sizes[_i], COMPOUND_BAD,
+		COMPOUND_MESSAGE SINGLE_MESSAGES);
+}
+END_TEST
+
+/*
+ * Read two blocks in a row. Each block's data is followed by a message
+ * terminator, which must not get mistaken for the next block's start.
+ */
+START_TEST(test_block_consecutive)
+{
+	struct sr_scpi_dev_inst scpi;
+	GByteArray *block;
+	int ret;
+
+	fake_scpi_init(&scpi, read_sizes[_i], COMPOUND_FULL);
+	block = g_byte_array_new();
+
+	ret = sr_scpi_get_block_into(&scpi, "DATA1?", block, NULL, NULL);
+	fail_unless(ret == SR_OK, "First block failed: %d.", ret);
+	fail_unless(block->len == 5 && memcmp(block->data, "a\nb;c", 5) == 0,
+		"First block data differs.");
+	fail_unless(fake.output->len == 0, "Terminator not consumed.");
+
+	ret = sr_scpi_get_block_into(&scpi, "DATA2?", block, NULL, NULL);
+	fail_unless(ret == SR_OK, "Second block failed: %d.", ret);
+	fail_unless(block->len == 12 &&
+		memcmp(block->data, "line1\nline2\n", 12) == 0,
+		"Second block data differs.");
+	fail_unless(fake.output->len == 0, "Terminator not consumed.");
+
+	fail_unless(strcmp(fake.sent->str, "DATA1?\nDATA2?\n") == 0);
+
+	g_byte_array_free(block, TRUE);
+	fake_scpi_cleanup(&scpi);
+}
+END_TEST
+
+/*
+ * An empty block is no error. sr_scpi_get_block() returns no array for
+ * it, sr_scpi_get_block_into() an empty one. Both consume the message
+ * terminator.
+ */
+START_TEST(test_block_empty)
+{
+	struct sr_scpi_dev_inst scpi;
+	GByteArray *block;
+	int ret;
+
+	fake_scpi_init(&scpi, read_sizes[_i], COMPOUND_FULL);
+
+	block = g_byte_array_new();
+	ret = sr_scpi_get_block_into(&scpi, "DATA1?", block, NULL, NULL);
+	fail_unless(ret == SR_OK && block->len == 5, "First block failed.");
+	ret = sr_scpi_get_block_into(&scpi, "EMPTY?", block, NULL, NULL);
+	fail_unless(ret == SR_OK, "Empty block failed: %d.", ret);
+	fail_unless(block->len == 0, "%u bytes in the empty block.",
+		block->len);
+	fail_unless(fake.output->len == 0, "Terminator not consumed.");
+	g_byte_array_free(block, TRUE);
+
+	block = NULL;
+	ret = sr_scpi_get_block(&scpi, "EMPTY?", &block);
+	fail_unless(ret == SR_OK, "Empty block failed: %d.", ret);
+	fail_unless(block == NULL, "Empty block returned an array.");
+	fail_unless(fake.output->len == 0, "Terminator not consumed.");
+
+	ret = sr_scpi_get_block(&scpi, "DATA2?", &block);
+	fail_unless(ret == SR_OK && block && block->len == 12,
+		"Block after the empty one failed.");
+	g_byte_array_free(block, TRUE);
+
+	fake_scpi_cleanup(&scpi);
+}
+END_TEST
+
+Suite *suite_scpi(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("scpi");
+
+	tc = tcase_create("batch");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_batch_joined, 0, G_N_ELEMENTS(read_sizes));
+	tcase_add_loop_test(tc, test_batch_partial, 0, G_N_ELEMENTS(read_sizes));
+	tcase_add_loop_test(tc, test_batch_timeout, 0, G_N_ELEMENTS(read_sizes));
+	tcase_add_loop_test(tc, test_batch_bad_response, 0,
+		G_N_ELEMENTS(read_sizes));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("block");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_block_consecutive, 0,
+		G_N_ELEMENTS(read_sizes));
+	tcase_add_loop_test(tc, test_block_empty, 0, G_N_ELEMENTS(read_sizes));
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,8 +19,10 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 /*
@@ -185,6 +187,185 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/* Check that packets without buffer backed data get copied. */
+START_TEST(test_packet_copy_unbuffered)
+{
+	struct sr_datafeed_packet packet, *copy;
+	struct sr_datafeed_logic logic, *logic_copy;
+	uint8_t data[16];
+	int ret;
+
+	memset(data, 0x5a, sizeof(data));
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	fail_unless(sr_packet_buffer_get(&packet) == NULL);
+
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK, "sr_packet_copy() failed: %d.", ret);
+	logic_copy = (struct sr_datafeed_logic *)copy->payload;
+	fail_unless(logic_copy->data != logic.data);
+	fail_unless(memcmp(logic_copy->data, data, sizeof(data)) == 0);
+	fail_unless(sr_packet_buffer_get(copy) == NULL);
+	sr_packet_free(copy);
+}
+END_TEST
+
+/* Check that run-length encoded logic packets get copied. */
+START_TEST(test_packet_copy_logic_rle)
+{
+	struct sr_datafeed_packet packet, *copy;
+	struct sr_datafeed_logic_rle rle, *rle_copy;
+	uint16_t values[3] = { 0x0001, 0x8000, 0x0001 };
+	uint64_t lengths[3] = { 1000, 1, 1000000 };
+	int ret;
+
+	rle.num_runs = 3;
+	rle.unitsize = sizeof(values[0]);
+	rle.values = values;
+	rle.lengths = lengths;
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+
+	fail_unless(sr_packet_buffer_get(&packet) == NULL);
+
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK, "sr_packet_copy() failed: %d.", ret);
+	fail_unless(copy->type == SR_DF_LOGIC_RLE);
+	rle_copy = (struct sr_datafeed_logic_rle *)copy->payload;
+	fail_unless(rle_copy->num_runs == rle.num_runs);
+	fail_unless(rle_copy->unitsize == rle.unitsize);
+	fail_unless(rle_copy->values != rle.values);
+	fail_unless(memcmp(rle_copy->values, values, sizeof(values)) == 0);
+	fail_unless(rle_copy->lengths != rle.lengths);
+	fail_unless(memcmp(rle_copy->lengths, lengths, sizeof(lengths)) == 0);
+	sr_packet_free(copy);
+}
+END_TEST
+
+/* Check that released buffers get re-used when they are large enough. */
+START_TEST(test_buffer_pool_reuse)
+{
+	struct sr_session *session;
+	struct sr_buffer *buf1, *buf2, *buf3;
+
+	sr_session_new(srtest_ctx, &session);
+
+	buf1 = sr_session_buffer_new(session, 1000);
+	fail_unless(buf1 != NULL);
+	fail_unless(sr_buffer_size_get(buf1) >= 1000);
+	sr_buffer_unref(buf1);
+
+	buf2 = sr_session_buffer_new(session, 500);
+	fail_unless(buf2 == buf1, "Unused buffer was not re-used.");
+	buf3 = sr_session_buffer_new(session, 2000);
+	fail_unless(buf3 != NULL && buf3 != buf2);
+	fail_unless(sr_buffer_size_get(buf3) >= 2000);
+
+	sr_buffer_unref(buf2);
+	sr_buffer_unref(buf3);
+	sr_session_destroy(session);
+}
+END_TEST
+
+/* Check that buffers don't get re-used while references remain. */
+START_TEST(test_buffer_refcount)
+{
+	struct sr_session *session;
+	struct sr_buffer *buf, *other;
+
+	sr_session_new(srtest_ctx, &session);
+
+	buf = sr_session_buffer_new(session, 64);
+	fail_unless(sr_buffer_ref(buf) == buf);
+	sr_buffer_unref(buf);
+	other = sr_session_buffer_new(session, 64);
+	fail_unless(other != buf, "Referenced buffer was re-used.");
+	sr_buffer_unref(other);
+
+	sr_buffer_unref(buf);
+	other = sr_session_buffer_new(session, 64);
+	fail_unless(other == buf, "Released buffer was not re-used.");
+	sr_buffer_unref(other);
+
+	sr_session_destroy(session);
+}
+END_TEST
+
+static struct sr_datafeed_packet *buffered_copy;
+static struct sr_buffer *buffered_seen;
+
+static void datafeed_keep(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	buffered_seen = sr_packet_buffer_get(packet);
+	fail_unless(sr_packet_copy(packet, &buffered_copy) == SR_OK);
+}
+
+/*
+ * Check that copies of buffer backed packets share the data, and keep
+ * it valid past the sender's release and the session's destruction.
+ */
+START_TEST(test_buffer_packet_copy)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_buffer *buf, *other;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	const struct sr_datafeed_logic *logic_copy;
+	uint8_t *data;
+	int ret;
+
+	sr_session_new(srtest_ctx, &session);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, datafeed_keep, NULL);
+
+	buf = sr_session_buffer_new(session, 256);
+	data = sr_buffer_data_get(buf);
+	memset(data, 0xa5, 256);
+	logic.length = 128;
+	logic.unitsize = 1;
+	logic.data = data + 64;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	/* Not sent along with a buffer, not considered buffer backed. */
+	fail_unless(sr_packet_buffer_get(&packet) == NULL);
+
+	buffered_copy = NULL;
+	buffered_seen = NULL;
+	ret = sr_session_send_buffer(sdi, &packet, buf);
+	fail_unless(ret == SR_OK, "sr_session_send_buffer() failed: %d.", ret);
+	fail_unless(buffered_seen == buf);
+	fail_unless(buffered_copy != NULL);
+	logic_copy = buffered_copy->payload;
+	fail_unless(logic_copy->data == logic.data, "Copy did not share data.");
+	fail_unless(sr_packet_buffer_get(&packet) == NULL);
+
+	/* The copy's reference keeps the data after the sender's release. */
+	sr_buffer_unref(buf);
+	other = sr_session_buffer_new(session, 256);
+	fail_unless(other != buf, "Buffer re-used while a copy references it.");
+	sr_buffer_unref(other);
+	sr_session_destroy(session);
+	fail_unless(((uint8_t *)logic_copy->data)[127] == 0xa5);
+
+	/* The last reference frees the buffer, the pool is gone already. */
+	sr_packet_free(buffered_copy);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +390,18 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("packet");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_packet_copy_unbuffered);
+	tcase_add_test(tc, test_packet_copy_logic_rle);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("buffer");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_buffer_pool_reuse);
+	tcase_add_test(tc, test_buffer_refcount);
+	tcase_add_test(tc, test_buffer_packet_copy);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
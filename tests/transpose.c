@@ -0,0 +1,212 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdint.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+/*
+ * The library picks a SIMD kernel at runtime where the CPU has one.
+ * These tests compare whatever got picked against a bit by bit
+ * reference. The test suite runs a second time with SIGROK_NO_SIMD=1
+ * set, which covers the portable code path as well.
+ */
+
+enum pattern {
+	PATTERN_ZERO,
+	PATTERN_ONES,
+	PATTERN_IDENTITY,
+	PATTERN_ANTI_DIAGONAL,
+	PATTERN_FIRST_ROW,
+	PATTERN_LAST_COLUMN,
+	PATTERN_CHECKER,
+	PATTERN_RANDOM,
+};
+
+static const struct {
+	enum pattern pattern;
+	uint32_t seed;
+} patterns[] = {
+	{ PATTERN_ZERO, 0, },
+	{ PATTERN_ONES, 0, },
+	{ PATTERN_IDENTITY, 0, },
+	{ PATTERN_ANTI_DIAGONAL, 0, },
+	{ PATTERN_FIRST_ROW, 0, },
+	{ PATTERN_LAST_COLUMN, 0, },
+	{ PATTERN_CHECKER, 0, },
+	{ PATTERN_RANDOM, 1, },
+	{ PATTERN_RANDOM, 0x5eed, },
+	{ PATTERN_RANDOM, 0xdeadbeef, },
+	{ PATTERN_RANDOM, 0x80000000, },
+};
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* Fill a matrix of "size" rows with "size" bits each. */
+static void fill_matrix(uint32_t *rows, size_t size, size_t idx)
+{
+	uint32_t mask, state;
+	size_t i;
+
+	mask = (size == 32) ? 0xffffffffUL : (1UL << size) - 1;
+	state = patterns[idx].seed;
+	for (i = 0; i < size; i++) {
+		switch (patterns[idx].pattern) {
+		case PATTERN_ZERO:
+			rows[i] = 0;
+			break;
+		case PATTERN_ONES:
+			rows[i] = mask;
+			break;
+		case PATTERN_IDENTITY:
+			rows[i] = 1UL << i;
+			break;
+		case PATTERN_ANTI_DIAGONAL:
+			rows[i] = 1UL << (size - 1 - i);
+			break;
+		case PATTERN_FIRST_ROW:
+			rows[i] = i ? 0 : mask;
+			break;
+		case PATTERN_LAST_COLUMN:
+			rows[i] = 1UL << (size - 1);
+			break;
+		case PATTERN_CHECKER:
+			rows[i] = (i & 1) ? 0xaaaaaaaaUL : 0x55555555UL;
+			break;
+		case PATTERN_RANDOM:
+			rows[i] = next_random(&state);
+			break;
+		}
+		rows[i] &= mask;
+	}
+}
+
+/* Reference: bit j of input row i ends up in bit i of output row j. */
+static void transpose_reference(uint32_t *dst, const uint32_t *src,
+	size_t size)
+{
+	size_t i, j;
+
+	for (j = 0; j < size; j++) {
+		dst[j] = 0;
+		for (i = 0; i < size; i++) {
+			if (src[i] & (1UL << j))
+				dst[j] |= 1UL << i;
+		}
+	}
+}
+
+START_TEST(test_transpose_bits8)
+{
+	uint32_t rows[8], expect[8];
+	uint8_t src[8], dst[8];
+	size_t i;
+
+	fill_matrix(rows, 8, _i);
+	transpose_reference(expect, rows, 8);
+	for (i = 0; i < 8; i++)
+		src[i] = rows[i];
+
+	sr_transpose_bits8(dst, src);
+	for (i = 0; i < 8; i++)
+		fail_unless(dst[i] == expect[i], "Pattern %d, row %zu: "
+			"0x%02x instead of 0x%02x.", _i, i, dst[i], expect[i]);
+
+	sr_transpose_bits8(src, src);
+	fail_unless(memcmp(src, dst, sizeof(dst)) == 0,
+		"Pattern %d: in place result differs.", _i);
+}
+END_TEST
+
+START_TEST(test_transpose_bits16)
+{
+	uint32_t rows[16], expect[16];
+	uint16_t src[16], dst[16];
+	size_t i;
+
+	fill_matrix(rows, 16, _i);
+	transpose_reference(expect, rows, 16);
+	for (i = 0; i < 16; i++)
+		src[i] = rows[i];
+
+	sr_transpose_bits16(dst, src);
+	for (i = 0; i < 16; i++)
+		fail_unless(dst[i] == expect[i], "Pattern %d, row %zu: "
+			"0x%04x instead of 0x%04x.", _i, i, dst[i], expect[i]);
+
+	sr_transpose_bits16(src, src);
+	fail_unless(memcmp(src, dst, sizeof(dst)) == 0,
+		"Pattern %d: in place result differs.", _i);
+}
+END_TEST
+
+START_TEST(test_transpose_bits32)
+{
+	uint32_t rows[32], expect[32];
+	uint32_t src[32], dst[32];
+	size_t i;
+
+	fill_matrix(rows, 32, _i);
+	transpose_reference(expect, rows, 32);
+	memcpy(src, rows, sizeof(src));
+
+	sr_transpose_bits32(dst, src);
+	for (i = 0; i < 32; i++)
+		fail_unless(dst[i] == expect[i], "Pattern %d, row %zu: "
+			"0x%08x instead of 0x%08x.", _i, i, dst[i], expect[i]);
+
+	sr_transpose_bits32(src, src);
+	fail_unless(memcmp(src, dst, sizeof(dst)) == 0,
+		"Pattern %d: in place result differs.", _i);
+
+	/* Transposing twice restores the input. */
+	sr_transpose_bits32(src, src);
+	fail_unless(memcmp(src, rows, sizeof(rows)) == 0,
+		"Pattern %d: second transposition differs.", _i);
+}
+END_TEST
+
+Suite *suite_transpose(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("transpose");
+
+	tc = tcase_create("bits");
+	tcase_add_loop_test(tc, test_transpose_bits8, 0, G_N_ELEMENTS(patterns));
+	tcase_add_loop_test(tc, test_transpose_bits16, 0, G_N_ELEMENTS(patterns));
+	tcase_add_loop_test(tc, test_transpose_bits32, 0, G_N_ELEMENTS(patterns));
+	suite_add_tcase(s, tc);
+
+	return s;
+}
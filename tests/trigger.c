@@ -19,9 +19,12 @@
 
 #include <config.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 /* Test lots of triggers/stages/matches/channels */
@@ -249,6 +252,393 @@ START_TEST(test_trigger_match_add_bogus)
 }
 END_TEST
 
+/*
+ * The soft trigger compiles its stages into bit masks, and skips over
+ * samples which cannot match the first stage with SIMD kernels where
+ * the CPU has them. A reference which checks each condition's bit like
+ * the original implementation did must find the same trigger offsets,
+ * and send the same pre-trigger data. Each test runs with the AVX2,
+ * SSE2 and portable kernels.
+ */
+
+#define ST_MAX_UNITSIZE 8
+#define ST_TRIALS 60
+#define ST_SAMPLES 2000
+#define ST_CRAFTED_SAMPLES 300
+
+static const int st_unitsizes[] = { 1, 2, 3, 4, 8, };
+
+static const int st_features[] = {
+	SR_CPU_SSE2 | SR_CPU_AVX2,
+	SR_CPU_SSE2,
+	0,
+};
+
+static const int st_matches[] = {
+	SR_TRIGGER_ZERO, SR_TRIGGER_ONE,
+	SR_TRIGGER_RISING, SR_TRIGGER_FALLING, SR_TRIGGER_EDGE,
+};
+
+/* Positions of the crafted trigger, around the kernels' block sizes. */
+static const size_t st_positions[] = { 1, 7, 8, 15, 16, 17, 31, 32, 33, 64, 200, };
+
+struct ref_matcher {
+	const struct sr_trigger *trigger;
+	int unitsize;
+	int cur_stage;
+	uint64_t count;
+	uint8_t prev_sample[ST_MAX_UNITSIZE];
+	int pre_trigger_size;
+	int pre_trigger_fill;
+	int pre_trigger_head;
+	GByteArray *history;
+};
+
+static GByteArray *st_received;
+static int st_trigger_packets;
+
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x;
+
+	x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+static int ref_bit(const uint8_t *sample, int index)
+{
+	return (sample[index / 8] >> (index % 8)) & 1;
+}
+
+static gboolean ref_match(struct ref_matcher *ref, const uint8_t *sample,
+		const struct sr_trigger_match *match)
+{
+	int bit, prev_bit;
+
+	ref->count++;
+	bit = ref_bit(sample, match->channel->index);
+	if (match->match == SR_TRIGGER_ZERO)
+		return !bit;
+	if (match->match == SR_TRIGGER_ONE)
+		return bit;
+	/* No edge on the very first check. */
+	if (ref->count == 1)
+		return FALSE;
+	prev_bit = ref_bit(ref->prev_sample, match->channel->index);
+	if (match->match == SR_TRIGGER_RISING)
+		return !prev_bit && bit;
+	if (match->match == SR_TRIGGER_FALLING)
+		return prev_bit && !bit;
+
+	return prev_bit != bit;
+}
+
+/* Keeps all data, and tracks the circular pre-trigger buffer's head. */
+static void ref_append(struct ref_matcher *ref, const uint8_t *buf, int len)
+{
+	g_byte_array_append(ref->history, buf, len);
+	if (!ref->pre_trigger_size)
+		return;
+	len = MIN(len, ref->pre_trigger_size);
+	ref->pre_trigger_fill = MIN(ref->pre_trigger_fill + len,
+		ref->pre_trigger_size);
+	ref->pre_trigger_head = (ref->pre_trigger_head + len) %
+		ref->pre_trigger_size;
+}
+
+static int ref_check(struct ref_matcher *ref, const uint8_t *buf, int len,
+		int *pre_trigger_samples, GByteArray *pre_trigger_data)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	const GSList *l;
+	int i, first;
+	gboolean match_found;
+
+	for (i = 0; i < len; i += ref->unitsize) {
+		stage = g_slist_nth_data(ref->trigger->stages, ref->cur_stage);
+		match_found = TRUE;
+		for (l = stage->matches; l; l = l->next) {
+			match = l->data;
+			if (!match->channel->enabled)
+				continue;
+			if (!ref_match(ref, &buf[i], match)) {
+				match_found = FALSE;
+				break;
+			}
+		}
+		memcpy(ref->prev_sample, &buf[i], ref->unitsize);
+		if (match_found) {
+			if (stage != g_slist_last(ref->trigger->stages)->data) {
+				ref->cur_stage++;
+				continue;
+			}
+			ref_append(ref, buf, i);
+			if (ref->pre_trigger_fill < ref->pre_trigger_size)
+				ref->pre_trigger_head = 0;
+			first = MIN(ref->pre_trigger_size - ref->pre_trigger_head,
+				ref->pre_trigger_fill);
+			*pre_trigger_samples = first / ref->unitsize +
+				(ref->pre_trigger_fill - first) / ref->unitsize;
+			g_byte_array_append(pre_trigger_data, ref->history->data +
+				ref->history->len - ref->pre_trigger_fill,
+				ref->pre_trigger_fill);
+			return i / ref->unitsize;
+		} else if (ref->cur_stage > 0) {
+			/* Retry at the sample after the first stage's match. */
+			i -= ref->cur_stage * ref->unitsize;
+			if (i < -1)
+				i = -1;
+			ref->cur_stage = 0;
+		}
+	}
+	ref_append(ref, buf, len);
+
+	return -1;
+}
+
+static void st_datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type == SR_DF_TRIGGER) {
+		st_trigger_packets++;
+	} else if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		g_byte_array_append(st_received, logic->data, logic->length);
+	}
+}
+
+static struct sr_dev_inst *st_device(int unitsize, struct sr_session **session)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", NULL);
+	for (i = 0; i < unitsize * 8; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_session_new(srtest_ctx, session);
+	sr_session_dev_add(*session, sdi);
+	sr_session_datafeed_callback_add(*session, st_datafeed_in, NULL);
+
+	return sdi;
+}
+
+/*
+ * Feed the samples in chunks to the soft trigger and to the reference.
+ * Returns the sample number where the trigger fired, or -1.
+ */
+static int st_run(const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples, const uint8_t *data,
+		const size_t *chunks, size_t num_chunks)
+{
+	struct soft_trigger_logic *stl;
+	struct ref_matcher ref;
+	GByteArray *expect;
+	uint8_t *buf;
+	size_t chunk, pos, len;
+	int unitsize, offset, ref_offset, pre, ref_pre;
+
+	unitsize = logic_channel_unitsize(sdi->channels);
+	stl = soft_trigger_logic_new(sdi, trigger, pre_trigger_samples);
+	fail_unless(stl != NULL, "Cannot create soft trigger.");
+	memset(&ref, 0, sizeof(ref));
+	ref.trigger = trigger;
+	ref.unitsize = unitsize;
+	ref.pre_trigger_size = unitsize * pre_trigger_samples;
+	ref.history = g_byte_array_new();
+	expect = g_byte_array_new();
+	st_received = g_byte_array_new();
+	st_trigger_packets = 0;
+
+	offset = -1;
+	for (chunk = 0, pos = 0; chunk < num_chunks; chunk++, pos += len) {
+		/*
+		 * After a failed later stage the matcher may retry at an
+		 * offset which is not a multiple of the unit size, and read
+		 * a partial sample at the end. Have padding after the data.
+		 */
+		len = chunks[chunk] * unitsize;
+		buf = g_malloc0(len + ST_MAX_UNITSIZE);
+		memcpy(buf, &data[pos], len);
+		pre = ref_pre = -1;
+		offset = soft_trigger_logic_check(stl, buf, len, &pre);
+		ref_offset = ref_check(&ref, buf, len, &ref_pre, expect);
+		g_free(buf);
+		fail_unless(offset == ref_offset,
+			"Chunk %zu: offset %d instead of %d.",
+			chunk, offset, ref_offset);
+		if (offset < 0) {
+			fail_unless(st_received->len == 0 && !st_trigger_packets,
+				"Chunk %zu: data sent before the trigger.", chunk);
+			continue;
+		}
+		fail_unless(pre == ref_pre, "%d pre-trigger samples instead of %d.",
+			pre, ref_pre);
+		fail_unless(st_trigger_packets == 1, "No trigger packet.");
+		fail_unless(st_received->len == expect->len &&
+			memcmp(st_received->data, expect->data, expect->len) == 0,
+			"Pre-trigger data differs.");
+		offset += pos / unitsize;
+		break;
+	}
+
+	g_byte_array_free(st_received, TRUE);
+	g_byte_array_free(expect, TRUE);
+	g_byte_array_free(ref.history, TRUE);
+	soft_trigger_logic_free(stl);
+
+	return offset;
+}
+
+/*
+ * Random triggers with up to three stages, on a few channels which
+ * include the first and the last. Their bits change every now and
+ * then, all other bits are noise.
+ */
+START_TEST(test_soft_trigger_random)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	struct sr_trigger_stage *stage;
+	struct sr_channel *ch;
+	uint8_t *data, *sample;
+	size_t chunks[ST_SAMPLES], num_chunks, left, n;
+	uint32_t state, r;
+	int unitsize, channels[4], levels, trial, i, j, stages, matches;
+
+	unitsize = st_unitsizes[_i / G_N_ELEMENTS(st_features)];
+	sr_cpu_features_limit(st_features[_i % G_N_ELEMENTS(st_features)]);
+	sdi = st_device(unitsize, &session);
+	data = g_malloc(ST_SAMPLES * unitsize);
+	state = 0x7119e5 + _i;
+
+	for (trial = 0; trial < ST_TRIALS; trial++) {
+		channels[0] = 0;
+		channels[1] = next_random(&state) % (unitsize * 8);
+		channels[2] = next_random(&state) % (unitsize * 8);
+		channels[3] = unitsize * 8 - 1;
+
+		trigger = sr_trigger_new(NULL);
+		stages = 1 + next_random(&state) % 3;
+		for (i = 0; i < stages; i++) {
+			stage = sr_trigger_stage_add(trigger);
+			matches = 1 + next_random(&state) % 3;
+			for (j = 0; j < matches; j++) {
+				r = next_random(&state);
+				ch = g_slist_nth_data(sdi->channels, channels[r % 4]);
+				sr_trigger_match_add(stage, ch,
+					st_matches[(r >> 8) % G_N_ELEMENTS(st_matches)], 0);
+			}
+		}
+		/* Conditions on a disabled channel get ignored. */
+		ch = g_slist_nth_data(sdi->channels, channels[1]);
+		sr_dev_channel_enable(ch, next_random(&state) % 4 != 0);
+
+		levels = next_random(&state);
+		for (n = 0; n < ST_SAMPLES; n++) {
+			sample = &data[n * unitsize];
+			for (i = 0; i < unitsize; i++)
+				sample[i] = next_random(&state);
+			r = next_random(&state);
+			if (r % 24 == 0)
+				levels ^= 1 << ((r >> 8) % 4);
+			if (r % 97 == 1)
+				levels ^= 3 << ((r >> 8) % 3);
+			for (i = 0; i < 4; i++) {
+				sample[channels[i] / 8] &= ~(1 << (channels[i] % 8));
+				if (levels & (1 << i))
+					sample[channels[i] / 8] |= 1 << (channels[i] % 8);
+			}
+		}
+
+		num_chunks = 0;
+		for (left = ST_SAMPLES; left; left -= n) {
+			r = next_random(&state);
+			n = (r % 8 == 0) ? 1000 : 1 + (r >> 8) % 200;
+			n = MIN(n, left);
+			chunks[num_chunks++] = n;
+		}
+
+		st_run(sdi, trigger, next_random(&state) % 40, data,
+			chunks, num_chunks);
+		sr_dev_channel_enable(ch, TRUE);
+		sr_trigger_free(trigger);
+	}
+
+	g_free(data);
+	sr_dev_inst_free(sdi);
+	sr_session_destroy(session);
+	sr_cpu_features_limit(SR_CPU_SSE2 | SR_CPU_AVX2);
+}
+END_TEST
+
+/*
+ * A rising and then a falling edge on the last channel, in two stages.
+ * The buffers get split between the edge's samples, or between the
+ * stages' matches.
+ */
+START_TEST(test_soft_trigger_spanning)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	struct sr_channel *ch;
+	uint8_t *data;
+	size_t chunks[2], pos, n;
+	uint32_t state;
+	int unitsize, top, split, offset;
+
+	unitsize = st_unitsizes[_i / G_N_ELEMENTS(st_features)];
+	sr_cpu_features_limit(st_features[_i % G_N_ELEMENTS(st_features)]);
+	sdi = st_device(unitsize, &session);
+	top = unitsize * 8 - 1;
+	ch = g_slist_nth_data(sdi->channels, top);
+	trigger = sr_trigger_new(NULL);
+	sr_trigger_match_add(sr_trigger_stage_add(trigger), ch,
+		SR_TRIGGER_RISING, 0);
+	sr_trigger_match_add(sr_trigger_stage_add(trigger), ch,
+		SR_TRIGGER_FALLING, 0);
+	data = g_malloc(ST_CRAFTED_SAMPLES * unitsize);
+	state = 0x5ba2 + _i;
+
+	for (n = 0; n < G_N_ELEMENTS(st_positions); n++) {
+		pos = st_positions[n];
+		for (split = 0; split < 2; split++) {
+			for (offset = 0; offset < ST_CRAFTED_SAMPLES * unitsize; offset++)
+				data[offset] = next_random(&state);
+			for (offset = 0; offset < ST_CRAFTED_SAMPLES; offset++)
+				data[offset * unitsize + top / 8] &= 0x7f;
+			data[pos * unitsize + top / 8] |= 0x80;
+			chunks[0] = pos + split;
+			chunks[1] = ST_CRAFTED_SAMPLES - chunks[0];
+			offset = st_run(sdi, trigger, 10, data, chunks, 2);
+			fail_unless(offset == (int)pos + 1,
+				"Triggered at %d instead of %zu.", offset, pos + 1);
+		}
+	}
+
+	g_free(data);
+	sr_trigger_free(trigger);
+	sr_dev_inst_free(sdi);
+	sr_session_destroy(session);
+	sr_cpu_features_limit(SR_CPU_SSE2 | SR_CPU_AVX2);
+}
+END_TEST
+
 Suite *suite_trigger(void)
 {
 	Suite *s;
@@ -276,5 +666,14 @@ Suite *suite_trigger(void)
 	tcase_add_test(tc, test_trigger_match_add_bogus);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("soft");
+	tcase_set_timeout(tc, 60);
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_loop_test(tc, test_soft_trigger_random, 0,
+		G_N_ELEMENTS(st_unitsizes) * G_N_ELEMENTS(st_features));
+	tcase_add_loop_test(tc, test_soft_trigger_spanning, 0,
+		G_N_ELEMENTS(st_unitsizes) * G_N_ELEMENTS(st_features));
+	suite_add_tcase(s, tc);
+
 	return s;
 }